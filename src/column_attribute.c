@@ -0,0 +1,101 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Column attributes
+// a dense table of column attributes parallel to the column order list.
+
+#include "es.h"
+
+column_attribute_t *column_attribute_array = NULL; // array of column_attribute_t in column order.
+SIZE_T column_attribute_count = 0;
+static SIZE_T _column_attribute_allocated_count = 0;
+
+// rebuild the column attribute table from the current column order, colors and widths.
+// column_attribute_array[i] matches the i'th column in the column order list.
+// call this after the columns are finalized and before outputting any rows.
+void column_attribute_update(void)
+{
+	SIZE_T count;
+	column_t *column;
+	column_attribute_t *column_attribute;
+	
+	count = 0;
+	column = column_order_start;
+	
+	while(column)
+	{
+		count++;
+
+		column = column->order_next;
+	}
+	
+	if (count > _column_attribute_allocated_count)
+	{
+		if (column_attribute_array)
+		{
+			mem_free(column_attribute_array);
+		}
+		
+		column_attribute_array = mem_alloc(safe_size_mul(count,sizeof(column_attribute_t)));
+		_column_attribute_allocated_count = count;
+	}
+	
+	column_attribute = column_attribute_array;
+	column = column_order_start;
+	
+	while(column)
+	{
+		column_color_t *column_color;
+
+		column_color = column_color_find(column->property_id);
+
+		column_attribute->property_id = column->property_id;
+		column_attribute->width = column_width_get(column->property_id);
+		column_attribute->color = column_color ? column_color->color : 0;
+		column_attribute->has_color = column_color ? 1 : 0;
+		column_attribute->is_right_aligned = property_is_right_aligned(column->property_id) ? 1 : 0;
+		column_attribute->format = property_get_format(column->property_id);
+		
+		column_attribute++;
+		column = column->order_next;
+	}
+	
+	column_attribute_count = count;
+}
+
+// free the column attribute table.
+void column_attribute_clear_all(void)
+{
+	if (column_attribute_array)
+	{
+		mem_free(column_attribute_array);
+		
+		column_attribute_array = NULL;
+	}
+	
+	column_attribute_count = 0;
+	_column_attribute_allocated_count = 0;
+}
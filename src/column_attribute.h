@@ -0,0 +1,56 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// resolved per-column output attributes.
+// built once in column order before outputting rows, so the row loop doesn't need to search the color and width arrays for every cell.
+typedef struct column_attribute_s
+{
+	// EVERYTHING3_PROPERTY_ID_*
+	DWORD property_id;
+	
+	// column width in characters.
+	int width;
+	
+	// the SetConsoleTextAttribute color
+	// only valid if has_color is set.
+	WORD color;
+	
+	// non-zero if the column has a color.
+	BYTE has_color;
+	
+	// non-zero if the column is right aligned.
+	BYTE is_right_aligned;
+	
+	// PROPERTY_FORMAT_*
+	BYTE format;
+	
+}column_attribute_t;
+
+void column_attribute_update(void);
+void column_attribute_clear_all(void);
+
+extern column_attribute_t *column_attribute_array; // array of column_attribute_t in column order.
+extern SIZE_T column_attribute_count;
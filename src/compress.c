@@ -0,0 +1,299 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// compressed output formats for -export-compress.
+// gzip (RFC 1952), zlib (RFC 1950) and raw deflate (RFC 1951).
+// the header is written by compress_init and the trailer by compress_finish.
+
+#include "es.h"
+
+#define _COMPRESS_ADLER32_MOD		65521
+
+// the most bytes that can be added before the Adler-32 sums need reducing.
+#define _COMPRESS_ADLER32_NMAX		5552
+
+static void _compress_write_header(compress_t *compress,int level);
+static void _compress_write_raw(compress_t *compress,const void *data,SIZE_T size);
+static void _compress_update_crc32(compress_t *compress,const BYTE *data,SIZE_T size);
+static void _compress_update_adler32(compress_t *compress,const BYTE *data,SIZE_T size);
+
+static DWORD _compress_crc32_table[256];
+static int _compress_is_crc32_table = 0;
+
+// start a compressed stream.
+// write_proc receives the compressed output.
+void compress_init(compress_t *compress,BYTE type,int level,BOOL (*write_proc)(void *user_data,const void *data,SIZE_T size),void *user_data)
+{
+	compress->type = type;
+	compress->size = 0;
+	
+	if (type == COMPRESS_TYPE_GZIP)
+	{
+		compress->checksum = 0;
+		
+		// the CRC-32 table is only built once.
+		if (!_compress_is_crc32_table)
+		{
+			DWORD i;
+			
+			for(i=0;i<256;i++)
+			{
+				DWORD crc;
+				int bit;
+				
+				crc = i;
+				
+				for(bit=0;bit<8;bit++)
+				{
+					if (crc & 1)
+					{
+						crc = (crc >> 1) ^ 0xEDB88320;
+					}
+					else
+					{
+						crc >>= 1;
+					}
+				}
+				
+				_compress_crc32_table[i] = crc;
+			}
+			
+			_compress_is_crc32_table = 1;
+		}
+	}
+	else
+	{
+		compress->checksum = 1;
+	}
+	
+	deflate_init(&compress->deflate,level,write_proc,user_data);
+	
+	_compress_write_header(compress,level);
+}
+
+void compress_kill(compress_t *compress)
+{
+	deflate_kill(&compress->deflate);
+}
+
+// compress some data.
+// returns FALSE if a write failed.
+BOOL compress_write(compress_t *compress,const void *data,SIZE_T size)
+{
+	switch(compress->type)
+	{
+		case COMPRESS_TYPE_GZIP:
+			_compress_update_crc32(compress,(const BYTE *)data,size);
+			compress->size += (DWORD)size;
+			break;
+			
+		case COMPRESS_TYPE_ZLIB:
+			_compress_update_adler32(compress,(const BYTE *)data,size);
+			break;
+	}
+	
+	return deflate_write(&compress->deflate,data,size);
+}
+
+// finish the compressed stream and write the trailer.
+// returns FALSE if a write failed.
+BOOL compress_finish(compress_t *compress)
+{
+	BYTE trailer[8];
+	
+	deflate_finish(&compress->deflate);
+	
+	switch(compress->type)
+	{
+		case COMPRESS_TYPE_GZIP:
+		
+			// little endian CRC-32 and size.
+			trailer[0] = (BYTE)compress->checksum;
+			trailer[1] = (BYTE)(compress->checksum >> 8);
+			trailer[2] = (BYTE)(compress->checksum >> 16);
+			trailer[3] = (BYTE)(compress->checksum >> 24);
+			trailer[4] = (BYTE)compress->size;
+			trailer[5] = (BYTE)(compress->size >> 8);
+			trailer[6] = (BYTE)(compress->size >> 16);
+			trailer[7] = (BYTE)(compress->size >> 24);
+			
+			_compress_write_raw(compress,trailer,8);
+			
+			break;
+			
+		case COMPRESS_TYPE_ZLIB:
+		
+			// big endian Adler-32.
+			trailer[0] = (BYTE)(compress->checksum >> 24);
+			trailer[1] = (BYTE)(compress->checksum >> 16);
+			trailer[2] = (BYTE)(compress->checksum >> 8);
+			trailer[3] = (BYTE)compress->checksum;
+			
+			_compress_write_raw(compress,trailer,4);
+			
+			break;
+	}
+	
+	return compress->deflate.is_error ? FALSE : TRUE;
+}
+
+static void _compress_write_header(compress_t *compress,int level)
+{
+	BYTE header[10];
+	
+	switch(compress->type)
+	{
+		case COMPRESS_TYPE_GZIP:
+		
+			// no file name or modification time.
+			header[0] = 0x1f;
+			header[1] = 0x8b;
+			header[2] = 8; // deflate
+			header[3] = 0; // flags
+			header[4] = 0;
+			header[5] = 0;
+			header[6] = 0;
+			header[7] = 0;
+			header[8] = (level >= DEFLATE_MAX_LEVEL) ? 2 : ((level <= DEFLATE_MIN_LEVEL) ? 4 : 0);
+			header[9] = 11; // NTFS
+			
+			_compress_write_raw(compress,header,10);
+			
+			break;
+			
+		case COMPRESS_TYPE_ZLIB:
+		
+			{
+				DWORD flags;
+				
+				// deflate with a 32K window.
+				header[0] = 0x78;
+				
+				if (level <= DEFLATE_MIN_LEVEL)
+				{
+					flags = 0;
+				}
+				else
+				if (level < DEFLATE_DEFAULT_LEVEL)
+				{
+					flags = 1;
+				}
+				else
+				if (level == DEFLATE_DEFAULT_LEVEL)
+				{
+					flags = 2;
+				}
+				else
+				{
+					flags = 3;
+				}
+				
+				flags <<= 6;
+				
+				// the header must be a multiple of 31.
+				flags += 31 - (((header[0] << 8) + flags) % 31);
+				
+				header[1] = (BYTE)flags;
+				
+				_compress_write_raw(compress,header,2);
+			}
+			
+			break;
+	}
+}
+
+// write uncompressed data, such as a header or trailer.
+// any compressed data must already be written.
+static void _compress_write_raw(compress_t *compress,const void *data,SIZE_T size)
+{
+	if (!compress->deflate.is_error)
+	{
+		if (!compress->deflate.write_proc(compress->deflate.user_data,data,size))
+		{
+			compress->deflate.is_error = 1;
+		}
+	}
+}
+
+static void _compress_update_crc32(compress_t *compress,const BYTE *data,SIZE_T size)
+{
+	DWORD crc;
+	const BYTE *p;
+	SIZE_T run;
+	
+	crc = compress->checksum ^ 0xffffffff;
+	p = data;
+	run = size;
+	
+	while(run)
+	{
+		crc = _compress_crc32_table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+		
+		p++;
+		run--;
+	}
+	
+	compress->checksum = crc ^ 0xffffffff;
+}
+
+static void _compress_update_adler32(compress_t *compress,const BYTE *data,SIZE_T size)
+{
+	DWORD s1;
+	DWORD s2;
+	const BYTE *p;
+	SIZE_T run;
+	
+	s1 = compress->checksum & 0xffff;
+	s2 = compress->checksum >> 16;
+	p = data;
+	run = size;
+	
+	while(run)
+	{
+		SIZE_T block_run;
+		
+		block_run = run;
+		if (block_run > _COMPRESS_ADLER32_NMAX)
+		{
+			block_run = _COMPRESS_ADLER32_NMAX;
+		}
+		
+		run -= block_run;
+		
+		while(block_run)
+		{
+			s1 += *p;
+			s2 += s1;
+			
+			p++;
+			block_run--;
+		}
+		
+		s1 %= _COMPRESS_ADLER32_MOD;
+		s2 %= _COMPRESS_ADLER32_MOD;
+	}
+	
+	compress->checksum = (s2 << 16) | s1;
+}
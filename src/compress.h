@@ -0,0 +1,52 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// compressed output formats for -export-compress.
+// each format wraps a codec that compresses a stream of data.
+
+#define COMPRESS_TYPE_NONE			0
+#define COMPRESS_TYPE_GZIP			1
+#define COMPRESS_TYPE_ZLIB			2
+#define COMPRESS_TYPE_DEFLATE		3 // raw deflate, no header or checksum.
+
+typedef struct compress_s
+{
+	BYTE type;
+	
+	// all formats use deflate.
+	deflate_t deflate;
+	
+	// CRC-32 for gzip or Adler-32 for zlib of the uncompressed data.
+	DWORD checksum;
+	
+	// the uncompressed size modulo 2^32 for gzip.
+	DWORD size;
+	
+}compress_t;
+
+void compress_init(compress_t *compress,BYTE type,int level,BOOL (*write_proc)(void *user_data,const void *data,SIZE_T size),void *user_data);
+void compress_kill(compress_t *compress);
+BOOL compress_write(compress_t *compress,const void *data,SIZE_T size);
+BOOL compress_finish(compress_t *compress);
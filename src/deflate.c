@@ -0,0 +1,1198 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// streaming deflate encoder (RFC 1951)
+//
+// matches are found with hash chains over a 32K window and lazy matching,
+// the same way zlib does.
+// each block is written with dynamic or fixed huffman codes, whichever is smaller.
+// input is copied into the upper half of a 64K buffer.
+// when the upper half has been compressed, it is moved to the lower half and
+// the hash chains are adjusted.
+
+#include "es.h"
+
+#define _DEFLATE_WINDOW_MASK					(DEFLATE_WINDOW_SIZE - 1)
+#define _DEFLATE_HASH_MASK						(DEFLATE_HASH_SIZE - 1)
+
+#define _DEFLATE_MIN_MATCH						3
+#define _DEFLATE_MAX_MATCH						258
+
+// keep enough input to find the longest match.
+#define _DEFLATE_MIN_LOOKAHEAD					(_DEFLATE_MAX_MATCH + _DEFLATE_MIN_MATCH + 1)
+
+// the furthest match, leaving room for the lookahead.
+#define _DEFLATE_MAX_DISTANCE					(DEFLATE_WINDOW_SIZE - _DEFLATE_MIN_LOOKAHEAD)
+
+// a length 3 match further away than this is stored as literals.
+#define _DEFLATE_TOO_FAR						4096
+
+#define _DEFLATE_LITERAL_LENGTH_CODE_COUNT		286
+#define _DEFLATE_DISTANCE_CODE_COUNT			30
+#define _DEFLATE_CODE_LENGTH_CODE_COUNT			19
+#define _DEFLATE_LENGTH_CODE_COUNT				29
+#define _DEFLATE_END_OF_BLOCK					256
+
+// the literal/length and distance code lengths, run length encoded.
+#define _DEFLATE_MAX_CODE_LENGTH_SYMBOLS		(_DEFLATE_LITERAL_LENGTH_CODE_COUNT + _DEFLATE_DISTANCE_CODE_COUNT)
+
+#define _DEFLATE_MAX_CODE_LENGTH				15
+#define _DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH	7
+
+#define _DEFLATE_BLOCK_TYPE_STORED				0
+#define _DEFLATE_BLOCK_TYPE_FIXED				1
+#define _DEFLATE_BLOCK_TYPE_DYNAMIC				2
+
+static void _deflate_flush_out(deflate_t *deflate);
+static void _deflate_write_bits(deflate_t *deflate,DWORD value,DWORD bit_count);
+static DWORD _deflate_hash(const BYTE *p);
+static DWORD _deflate_insert(deflate_t *deflate,DWORD pos);
+static DWORD _deflate_longest_match(deflate_t *deflate,DWORD cur_match);
+static void _deflate_slide(deflate_t *deflate);
+static void _deflate_process(deflate_t *deflate,int is_finish);
+static void _deflate_add_literal(deflate_t *deflate,BYTE value);
+static void _deflate_add_match(deflate_t *deflate,DWORD distance,DWORD length);
+static DWORD _deflate_get_length_code(DWORD length);
+static DWORD _deflate_get_distance_code(DWORD distance);
+static void _deflate_build_code_lengths(const DWORD *freq_array,DWORD count,DWORD max_length,BYTE *out_length_array);
+static void _deflate_build_codes(const BYTE *length_array,DWORD count,WORD *out_code_array);
+static void _deflate_write_block(deflate_t *deflate,int is_final);
+static void _deflate_write_stored_block(deflate_t *deflate,const BYTE *data,DWORD size,int is_final);
+
+// good length, lazy length, nice length and max chain for each level.
+// these are the zlib settings.
+static const WORD _deflate_level_config_array[DEFLATE_MAX_LEVEL][4] = 
+{
+	{4,4,8,4},
+	{4,5,16,8},
+	{4,6,32,32},
+	{4,4,16,16},
+	{8,16,32,32},
+	{8,16,128,128},
+	{8,32,128,256},
+	{32,128,258,1024},
+	{32,258,258,4096},
+};
+
+static const WORD _deflate_length_base_array[_DEFLATE_LENGTH_CODE_COUNT] = 
+{
+	3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258
+};
+
+static const BYTE _deflate_length_extra_bits_array[_DEFLATE_LENGTH_CODE_COUNT] = 
+{
+	0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
+};
+
+static const WORD _deflate_distance_base_array[_DEFLATE_DISTANCE_CODE_COUNT] = 
+{
+	1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577
+};
+
+static const BYTE _deflate_distance_extra_bits_array[_DEFLATE_DISTANCE_CODE_COUNT] = 
+{
+	0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13
+};
+
+// the order the code length code lengths are stored.
+static const BYTE _deflate_code_length_order_array[_DEFLATE_CODE_LENGTH_CODE_COUNT] = 
+{
+	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15
+};
+
+// level is clamped to DEFLATE_MIN_LEVEL - DEFLATE_MAX_LEVEL.
+void deflate_init(deflate_t *deflate,int level,BOOL (*write_proc)(void *user_data,const void *data,SIZE_T size),void *user_data)
+{
+	const WORD *level_config;
+	
+	if (level < DEFLATE_MIN_LEVEL)
+	{
+		level = DEFLATE_MIN_LEVEL;
+	}
+	
+	if (level > DEFLATE_MAX_LEVEL)
+	{
+		level = DEFLATE_MAX_LEVEL;
+	}
+	
+	level_config = _deflate_level_config_array[level - 1];
+	
+	deflate->write_proc = write_proc;
+	deflate->user_data = user_data;
+	
+	deflate->good_length = level_config[0];
+	deflate->lazy_length = level_config[1];
+	deflate->nice_length = level_config[2];
+	deflate->max_chain = level_config[3];
+	
+	deflate->window = mem_alloc(DEFLATE_WINDOW_SIZE * 2);
+	deflate->head_array = mem_alloc(DEFLATE_HASH_SIZE * sizeof(WORD));
+	deflate->prev_array = mem_alloc(DEFLATE_WINDOW_SIZE * sizeof(WORD));
+	deflate->symbol_length_array = mem_alloc(DEFLATE_MAX_BLOCK_SYMBOLS * sizeof(WORD));
+	deflate->symbol_distance_array = mem_alloc(DEFLATE_MAX_BLOCK_SYMBOLS * sizeof(WORD));
+	deflate->out_buf = mem_alloc(DEFLATE_OUT_BUF_SIZE);
+	
+	os_zero_memory(deflate->head_array,DEFLATE_HASH_SIZE * sizeof(WORD));
+	os_zero_memory(deflate->prev_array,DEFLATE_WINDOW_SIZE * sizeof(WORD));
+	
+	deflate->pos = 0;
+	deflate->lookahead = 0;
+	deflate->match_length = _DEFLATE_MIN_MATCH - 1;
+	deflate->match_pos = 0;
+	deflate->prev_length = _DEFLATE_MIN_MATCH - 1;
+	deflate->prev_match_pos = 0;
+	deflate->is_match_available = 0;
+	deflate->symbol_count = 0;
+	deflate->block_start = 0;
+	deflate->bit_buf = 0;
+	deflate->bit_count = 0;
+	deflate->out_size = 0;
+	deflate->is_error = 0;
+}
+
+void deflate_kill(deflate_t *deflate)
+{
+	mem_free(deflate->out_buf);
+	mem_free(deflate->symbol_distance_array);
+	mem_free(deflate->symbol_length_array);
+	mem_free(deflate->prev_array);
+	mem_free(deflate->head_array);
+	mem_free(deflate->window);
+}
+
+// compress some data.
+// the data is not fully compressed until deflate_finish is called.
+// returns FALSE if a write failed.
+BOOL deflate_write(deflate_t *deflate,const void *data,SIZE_T size)
+{
+	const BYTE *p;
+	SIZE_T run;
+	
+	p = (const BYTE *)data;
+	run = size;
+	
+	while(run)
+	{
+		DWORD avail;
+		DWORD copy_size;
+		
+		// the upper window has been compressed.
+		if (deflate->pos >= DEFLATE_WINDOW_SIZE + _DEFLATE_MAX_DISTANCE)
+		{
+			_deflate_slide(deflate);
+		}
+		
+		avail = (DEFLATE_WINDOW_SIZE * 2) - (deflate->pos + deflate->lookahead);
+		
+		if (run < avail)
+		{
+			copy_size = (DWORD)run;
+		}
+		else
+		{
+			copy_size = avail;
+		}
+		
+		os_copy_memory(deflate->window + deflate->pos + deflate->lookahead,p,copy_size);
+		
+		deflate->lookahead += copy_size;
+		p += copy_size;
+		run -= copy_size;
+		
+		_deflate_process(deflate,0);
+	}
+	
+	return deflate->is_error ? FALSE : TRUE;
+}
+
+// compress the remaining data and write the final block.
+// returns FALSE if a write failed.
+BOOL deflate_finish(deflate_t *deflate)
+{
+	_deflate_process(deflate,1);
+	
+	if (deflate->is_match_available)
+	{
+		_deflate_add_literal(deflate,deflate->window[deflate->pos - 1]);
+		
+		deflate->is_match_available = 0;
+	}
+	
+	_deflate_write_block(deflate,1);
+	
+	_deflate_flush_out(deflate);
+	
+	return deflate->is_error ? FALSE : TRUE;
+}
+
+// pass the compressed output to write_proc.
+static void _deflate_flush_out(deflate_t *deflate)
+{
+	if (deflate->out_size)
+	{
+		if (!deflate->is_error)
+		{
+			if (!deflate->write_proc(deflate->user_data,deflate->out_buf,deflate->out_size))
+			{
+				deflate->is_error = 1;
+			}
+		}
+		
+		deflate->out_size = 0;
+	}
+}
+
+// write up to 16 bits, least significant bit first.
+static void _deflate_write_bits(deflate_t *deflate,DWORD value,DWORD bit_count)
+{
+	deflate->bit_buf |= value << deflate->bit_count;
+	deflate->bit_count += bit_count;
+	
+	while(deflate->bit_count >= 8)
+	{
+		if (deflate->out_size == DEFLATE_OUT_BUF_SIZE)
+		{
+			_deflate_flush_out(deflate);
+		}
+		
+		deflate->out_buf[deflate->out_size++] = (BYTE)deflate->bit_buf;
+		
+		deflate->bit_buf >>= 8;
+		deflate->bit_count -= 8;
+	}
+}
+
+// hash the 3 bytes at p.
+static DWORD _deflate_hash(const BYTE *p)
+{
+	return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & _DEFLATE_HASH_MASK;
+}
+
+// add the string at pos to the hash chains.
+// returns the previous position with the same hash or 0 if there is none.
+static DWORD _deflate_insert(deflate_t *deflate,DWORD pos)
+{
+	DWORD hash;
+	DWORD head;
+	
+	hash = _deflate_hash(deflate->window + pos);
+	head = deflate->head_array[hash];
+	
+	deflate->prev_array[pos & _DEFLATE_WINDOW_MASK] = (WORD)head;
+	deflate->head_array[hash] = (WORD)pos;
+	
+	return head;
+}
+
+// find the longest match at pos, starting with cur_match.
+// only matches longer than prev_length are taken.
+// sets match_pos and returns the match length.
+static DWORD _deflate_longest_match(deflate_t *deflate,DWORD cur_match)
+{
+	const BYTE *scan;
+	DWORD best_length;
+	DWORD max_length;
+	DWORD nice_length;
+	DWORD limit;
+	DWORD chain;
+	
+	scan = deflate->window + deflate->pos;
+	best_length = deflate->prev_length;
+	
+	// never read past the input.
+	max_length = deflate->lookahead;
+	if (max_length > _DEFLATE_MAX_MATCH)
+	{
+		max_length = _DEFLATE_MAX_MATCH;
+	}
+	
+	if (best_length >= max_length)
+	{
+		return best_length;
+	}
+	
+	nice_length = deflate->nice_length;
+	if (nice_length > max_length)
+	{
+		nice_length = max_length;
+	}
+	
+	limit = 0;
+	if (deflate->pos > _DEFLATE_MAX_DISTANCE)
+	{
+		limit = deflate->pos - _DEFLATE_MAX_DISTANCE;
+	}
+	
+	// we already have a good match, don't look as hard.
+	chain = deflate->max_chain;
+	if (deflate->prev_length >= deflate->good_length)
+	{
+		chain >>= 2;
+	}
+	
+	do
+	{
+		const BYTE *match;
+		
+		match = deflate->window + cur_match;
+		
+		// check the byte that would make this match longer first.
+		if ((match[best_length] == scan[best_length]) && (match[0] == scan[0]) && (match[1] == scan[1]))
+		{
+			DWORD length;
+			
+			length = 2;
+			
+			while((length < max_length) && (match[length] == scan[length]))
+			{
+				length++;
+			}
+			
+			if (length > best_length)
+			{
+				deflate->match_pos = cur_match;
+				best_length = length;
+				
+				if (length >= nice_length)
+				{
+					break;
+				}
+			}
+		}
+		
+		cur_match = deflate->prev_array[cur_match & _DEFLATE_WINDOW_MASK];
+	}
+	while((cur_match > limit) && (--chain));
+	
+	return best_length;
+}
+
+// move the upper window to the lower window.
+// positions in the lower window are dropped from the hash chains.
+static void _deflate_slide(deflate_t *deflate)
+{
+	DWORD i;
+	
+	os_copy_memory(deflate->window,deflate->window + DEFLATE_WINDOW_SIZE,DEFLATE_WINDOW_SIZE);
+	
+	deflate->pos -= DEFLATE_WINDOW_SIZE;
+	deflate->match_pos -= DEFLATE_WINDOW_SIZE;
+	deflate->block_start -= DEFLATE_WINDOW_SIZE;
+	
+	for(i=0;i<DEFLATE_HASH_SIZE;i++)
+	{
+		if (deflate->head_array[i] >= DEFLATE_WINDOW_SIZE)
+		{
+			deflate->head_array[i] -= DEFLATE_WINDOW_SIZE;
+		}
+		else
+		{
+			deflate->head_array[i] = 0;
+		}
+	}
+	
+	for(i=0;i<DEFLATE_WINDOW_SIZE;i++)
+	{
+		if (deflate->prev_array[i] >= DEFLATE_WINDOW_SIZE)
+		{
+			deflate->prev_array[i] -= DEFLATE_WINDOW_SIZE;
+		}
+		else
+		{
+			deflate->prev_array[i] = 0;
+		}
+	}
+}
+
+// find literals and matches in the input.
+// a match at pos is only taken if there's no longer match at pos + 1.
+// keeps enough input for the longest match, unless is_finish is set.
+static void _deflate_process(deflate_t *deflate,int is_finish)
+{
+	while((deflate->lookahead >= _DEFLATE_MIN_LOOKAHEAD) || ((is_finish) && (deflate->lookahead)))
+	{
+		DWORD hash_head;
+		
+		hash_head = 0;
+		
+		if (deflate->lookahead >= _DEFLATE_MIN_MATCH)
+		{
+			hash_head = _deflate_insert(deflate,deflate->pos);
+		}
+		
+		deflate->prev_length = deflate->match_length;
+		deflate->prev_match_pos = deflate->match_pos;
+		deflate->match_length = _DEFLATE_MIN_MATCH - 1;
+		
+		if ((hash_head) && (deflate->prev_length < deflate->lazy_length) && (deflate->pos - hash_head <= _DEFLATE_MAX_DISTANCE))
+		{
+			deflate->match_length = _deflate_longest_match(deflate,hash_head);
+			
+			if ((deflate->match_length == _DEFLATE_MIN_MATCH) && (deflate->pos - deflate->match_pos > _DEFLATE_TOO_FAR))
+			{
+				deflate->match_length = _DEFLATE_MIN_MATCH - 1;
+			}
+		}
+		
+		if ((deflate->prev_length >= _DEFLATE_MIN_MATCH) && (deflate->match_length <= deflate->prev_length))
+		{
+			DWORD max_insert;
+			
+			// the previous match is better.
+			max_insert = deflate->pos + deflate->lookahead - _DEFLATE_MIN_MATCH;
+			
+			_deflate_add_match(deflate,deflate->pos - 1 - deflate->prev_match_pos,deflate->prev_length);
+			
+			// add the rest of the match to the hash chains.
+			// pos - 1 and pos are already added.
+			deflate->lookahead -= deflate->prev_length - 1;
+			deflate->prev_length -= 2;
+			
+			do
+			{
+				deflate->pos++;
+				
+				if (deflate->pos <= max_insert)
+				{
+					_deflate_insert(deflate,deflate->pos);
+				}
+			}
+			while(--deflate->prev_length);
+			
+			deflate->is_match_available = 0;
+			deflate->match_length = _DEFLATE_MIN_MATCH - 1;
+			deflate->pos++;
+		}
+		else
+		if (deflate->is_match_available)
+		{
+			// no better match, store the previous byte.
+			_deflate_add_literal(deflate,deflate->window[deflate->pos - 1]);
+			
+			deflate->pos++;
+			deflate->lookahead--;
+		}
+		else
+		{
+			// wait for the next byte before deciding.
+			deflate->is_match_available = 1;
+			deflate->pos++;
+			deflate->lookahead--;
+		}
+	}
+}
+
+static void _deflate_add_literal(deflate_t *deflate,BYTE value)
+{
+	deflate->symbol_length_array[deflate->symbol_count] = value;
+	deflate->symbol_distance_array[deflate->symbol_count] = 0;
+	deflate->symbol_count++;
+	
+	if (deflate->symbol_count == DEFLATE_MAX_BLOCK_SYMBOLS)
+	{
+		_deflate_write_block(deflate,0);
+	}
+}
+
+static void _deflate_add_match(deflate_t *deflate,DWORD distance,DWORD length)
+{
+	deflate->symbol_length_array[deflate->symbol_count] = (WORD)length;
+	deflate->symbol_distance_array[deflate->symbol_count] = (WORD)distance;
+	deflate->symbol_count++;
+	
+	if (deflate->symbol_count == DEFLATE_MAX_BLOCK_SYMBOLS)
+	{
+		_deflate_write_block(deflate,0);
+	}
+}
+
+// returns the length code index, 0-28.
+static DWORD _deflate_get_length_code(DWORD length)
+{
+	DWORD code;
+	
+	code = _DEFLATE_LENGTH_CODE_COUNT - 1;
+	
+	while(length < _deflate_length_base_array[code])
+	{
+		code--;
+	}
+	
+	return code;
+}
+
+// returns the distance code, 0-29.
+static DWORD _deflate_get_distance_code(DWORD distance)
+{
+	DWORD code;
+	
+	code = _DEFLATE_DISTANCE_CODE_COUNT - 1;
+	
+	while(distance < _deflate_distance_base_array[code])
+	{
+		code--;
+	}
+	
+	return code;
+}
+
+// build huffman code lengths from symbol frequencies.
+// unused symbols get a length of 0.
+// at least two symbols always get a code, as a code with one symbol is incomplete.
+// lengths over max_length are shortened by lengthening shorter codes, as in miniz.
+static void _deflate_build_code_lengths(const DWORD *freq_array,DWORD count,DWORD max_length,BYTE *out_length_array)
+{
+	WORD symbol_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT];
+	DWORD node_freq_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT * 2];
+	WORD parent_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT * 2];
+	WORD depth_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT * 2];
+	DWORD length_count_array[_DEFLATE_MAX_CODE_LENGTH + 1];
+	DWORD symbol_count;
+	DWORD leaf_index;
+	DWORD internal_index;
+	DWORD node_count;
+	DWORD total;
+	DWORD length;
+	DWORD i;
+	
+	symbol_count = 0;
+	
+	for(i=0;i<count;i++)
+	{
+		out_length_array[i] = 0;
+		
+		if (freq_array[i])
+		{
+			symbol_array[symbol_count++] = (WORD)i;
+		}
+	}
+	
+	// pad with unused symbols.
+	for(i=0;symbol_count<2;i++)
+	{
+		if (!freq_array[i])
+		{
+			symbol_array[symbol_count++] = (WORD)i;
+		}
+	}
+	
+	// sort by frequency, lowest first.
+	for(i=1;i<symbol_count;i++)
+	{
+		WORD symbol;
+		DWORD j;
+		
+		symbol = symbol_array[i];
+		j = i;
+		
+		while((j) && (freq_array[symbol_array[j - 1]] > freq_array[symbol]))
+		{
+			symbol_array[j] = symbol_array[j - 1];
+			j--;
+		}
+		
+		symbol_array[j] = symbol;
+	}
+	
+	// leaves are nodes 0 to symbol_count - 1.
+	// internal nodes are created in order of increasing frequency, so two queues are enough.
+	for(i=0;i<symbol_count;i++)
+	{
+		node_freq_array[i] = freq_array[symbol_array[i]];
+	}
+	
+	leaf_index = 0;
+	internal_index = symbol_count;
+	node_count = symbol_count;
+	
+	while(node_count < (symbol_count * 2) - 1)
+	{
+		DWORD child_index;
+		
+		node_freq_array[node_count] = 0;
+		
+		for(i=0;i<2;i++)
+		{
+			if ((leaf_index < symbol_count) && ((internal_index >= node_count) || (node_freq_array[leaf_index] <= node_freq_array[internal_index])))
+			{
+				child_index = leaf_index++;
+			}
+			else
+			{
+				child_index = internal_index++;
+			}
+			
+			parent_array[child_index] = (WORD)node_count;
+			node_freq_array[node_count] += node_freq_array[child_index];
+		}
+		
+		node_count++;
+	}
+	
+	// parents always come after their children.
+	depth_array[node_count - 1] = 0;
+	
+	for(i=node_count-1;i>0;i--)
+	{
+		depth_array[i - 1] = depth_array[parent_array[i - 1]] + 1;
+	}
+	
+	for(i=0;i<=max_length;i++)
+	{
+		length_count_array[i] = 0;
+	}
+	
+	for(i=0;i<symbol_count;i++)
+	{
+		if (depth_array[i] > max_length)
+		{
+			length_count_array[max_length]++;
+		}
+		else
+		{
+			length_count_array[depth_array[i]]++;
+		}
+	}
+	
+	// fix the lengths so the code is complete again.
+	total = 0;
+	
+	for(i=1;i<=max_length;i++)
+	{
+		total += length_count_array[i] << (max_length - i);
+	}
+	
+	while(total != ((DWORD)1 << max_length))
+	{
+		length_count_array[max_length]--;
+		
+		for(i=max_length-1;i>0;i--)
+		{
+			if (length_count_array[i])
+			{
+				length_count_array[i]--;
+				length_count_array[i + 1] += 2;
+				
+				break;
+			}
+		}
+		
+		total--;
+	}
+	
+	// the least frequent symbols get the longest codes.
+	leaf_index = 0;
+	
+	for(length=max_length;length>0;length--)
+	{
+		for(i=0;i<length_count_array[length];i++)
+		{
+			out_length_array[symbol_array[leaf_index++]] = (BYTE)length;
+		}
+	}
+}
+
+// build canonical huffman codes from code lengths.
+// the codes are bit reversed, so they can be written least significant bit first.
+static void _deflate_build_codes(const BYTE *length_array,DWORD count,WORD *out_code_array)
+{
+	DWORD length_count_array[_DEFLATE_MAX_CODE_LENGTH + 1];
+	DWORD next_code_array[_DEFLATE_MAX_CODE_LENGTH + 1];
+	DWORD code;
+	DWORD i;
+	
+	for(i=0;i<=_DEFLATE_MAX_CODE_LENGTH;i++)
+	{
+		length_count_array[i] = 0;
+	}
+	
+	for(i=0;i<count;i++)
+	{
+		length_count_array[length_array[i]]++;
+	}
+	
+	length_count_array[0] = 0;
+	code = 0;
+	
+	for(i=1;i<=_DEFLATE_MAX_CODE_LENGTH;i++)
+	{
+		code = (code + length_count_array[i - 1]) << 1;
+		next_code_array[i] = code;
+	}
+	
+	for(i=0;i<count;i++)
+	{
+		DWORD length;
+		
+		length = length_array[i];
+		out_code_array[i] = 0;
+		
+		if (length)
+		{
+			DWORD reversed_code;
+			DWORD j;
+			
+			code = next_code_array[length]++;
+			reversed_code = 0;
+			
+			for(j=0;j<length;j++)
+			{
+				reversed_code = (reversed_code << 1) | (code & 1);
+				code >>= 1;
+			}
+			
+			out_code_array[i] = (WORD)reversed_code;
+		}
+	}
+}
+
+// write the literals and matches in the current block.
+// uses fixed huffman codes if they are smaller than the dynamic codes and the dynamic code header.
+// stores the input bytes instead if they are smaller than either and are still in the window.
+// the final block is padded to a byte.
+static void _deflate_write_block(deflate_t *deflate,int is_final)
+{
+	DWORD literal_length_freq_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT];
+	DWORD distance_freq_array[_DEFLATE_DISTANCE_CODE_COUNT];
+	DWORD code_length_freq_array[_DEFLATE_CODE_LENGTH_CODE_COUNT];
+	BYTE literal_length_length_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT];
+	BYTE distance_length_array[_DEFLATE_DISTANCE_CODE_COUNT];
+	BYTE code_length_length_array[_DEFLATE_CODE_LENGTH_CODE_COUNT];
+	BYTE fixed_literal_length_length_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT];
+	BYTE fixed_distance_length_array[_DEFLATE_DISTANCE_CODE_COUNT];
+	WORD literal_length_code_array[_DEFLATE_LITERAL_LENGTH_CODE_COUNT];
+	WORD distance_code_array[_DEFLATE_DISTANCE_CODE_COUNT];
+	WORD code_length_code_array[_DEFLATE_CODE_LENGTH_CODE_COUNT];
+	BYTE all_length_array[_DEFLATE_MAX_CODE_LENGTH_SYMBOLS];
+	BYTE rle_symbol_array[_DEFLATE_MAX_CODE_LENGTH_SYMBOLS];
+	BYTE rle_extra_array[_DEFLATE_MAX_CODE_LENGTH_SYMBOLS];
+	DWORD rle_count;
+	DWORD literal_length_count;
+	DWORD distance_count;
+	DWORD code_length_count;
+	ES_UINT64 dynamic_bits;
+	ES_UINT64 fixed_bits;
+	ES_UINT64 extra_bits;
+	DWORD raw_size;
+	const BYTE *block_literal_length_length_array;
+	const BYTE *block_distance_length_array;
+	DWORD i;
+	
+	// count symbols.
+	for(i=0;i<_DEFLATE_LITERAL_LENGTH_CODE_COUNT;i++)
+	{
+		literal_length_freq_array[i] = 0;
+	}
+
+	for(i=0;i<_DEFLATE_DISTANCE_CODE_COUNT;i++)
+	{
+		distance_freq_array[i] = 0;
+	}
+	
+	extra_bits = 0;
+	raw_size = 0;
+	
+	for(i=0;i<deflate->symbol_count;i++)
+	{
+		if (deflate->symbol_distance_array[i])
+		{
+			DWORD length_code;
+			DWORD distance_code;
+			
+			length_code = _deflate_get_length_code(deflate->symbol_length_array[i]);
+			distance_code = _deflate_get_distance_code(deflate->symbol_distance_array[i]);
+			
+			literal_length_freq_array[_DEFLATE_END_OF_BLOCK + 1 + length_code]++;
+			distance_freq_array[distance_code]++;
+			
+			extra_bits += _deflate_length_extra_bits_array[length_code] + _deflate_distance_extra_bits_array[distance_code];
+			raw_size += deflate->symbol_length_array[i];
+		}
+		else
+		{
+			literal_length_freq_array[deflate->symbol_length_array[i]]++;
+			
+			raw_size++;
+		}
+	}
+	
+	literal_length_freq_array[_DEFLATE_END_OF_BLOCK] = 1;
+	
+	// dynamic codes.
+	_deflate_build_code_lengths(literal_length_freq_array,_DEFLATE_LITERAL_LENGTH_CODE_COUNT,_DEFLATE_MAX_CODE_LENGTH,literal_length_length_array);
+	_deflate_build_code_lengths(distance_freq_array,_DEFLATE_DISTANCE_CODE_COUNT,_DEFLATE_MAX_CODE_LENGTH,distance_length_array);
+	
+	literal_length_count = _DEFLATE_LITERAL_LENGTH_CODE_COUNT;
+	
+	while((literal_length_count > _DEFLATE_END_OF_BLOCK + 1) && (!literal_length_length_array[literal_length_count - 1]))
+	{
+		literal_length_count--;
+	}
+	
+	distance_count = _DEFLATE_DISTANCE_CODE_COUNT;
+	
+	while((distance_count > 1) && (!distance_length_array[distance_count - 1]))
+	{
+		distance_count--;
+	}
+	
+	// run length encode the code lengths.
+	os_copy_memory(all_length_array,literal_length_length_array,literal_length_count);
+	os_copy_memory(all_length_array + literal_length_count,distance_length_array,distance_count);
+	
+	for(i=0;i<_DEFLATE_CODE_LENGTH_CODE_COUNT;i++)
+	{
+		code_length_freq_array[i] = 0;
+	}
+	
+	rle_count = 0;
+	i = 0;
+	
+	while(i < literal_length_count + distance_count)
+	{
+		BYTE length;
+		DWORD run;
+		
+		length = all_length_array[i];
+		run = 1;
+		
+		while((i + run < literal_length_count + distance_count) && (all_length_array[i + run] == length))
+		{
+			run++;
+		}
+		
+		i += run;
+		
+		if (length)
+		{
+			// the first length, then repeat it 3-6 times.
+			rle_symbol_array[rle_count] = length;
+			rle_extra_array[rle_count] = 0;
+			rle_count++;
+			run--;
+			
+			while(run >= 3)
+			{
+				DWORD repeat;
+				
+				repeat = run < 6 ? run : 6;
+				
+				rle_symbol_array[rle_count] = 16;
+				rle_extra_array[rle_count] = (BYTE)(repeat - 3);
+				rle_count++;
+				run -= repeat;
+			}
+		}
+		else
+		{
+			// 11-138 zeros, then 3-10 zeros.
+			while(run >= 11)
+			{
+				DWORD repeat;
+				
+				repeat = run < 138 ? run : 138;
+				
+				rle_symbol_array[rle_count] = 18;
+				rle_extra_array[rle_count] = (BYTE)(repeat - 11);
+				rle_count++;
+				run -= repeat;
+			}
+			
+			if (run >= 3)
+			{
+				rle_symbol_array[rle_count] = 17;
+				rle_extra_array[rle_count] = (BYTE)(run - 3);
+				rle_count++;
+				run = 0;
+			}
+		}
+		
+		while(run)
+		{
+			rle_symbol_array[rle_count] = length;
+			rle_extra_array[rle_count] = 0;
+			rle_count++;
+			run--;
+		}
+	}
+	
+	for(i=0;i<rle_count;i++)
+	{
+		code_length_freq_array[rle_symbol_array[i]]++;
+	}
+	
+	_deflate_build_code_lengths(code_length_freq_array,_DEFLATE_CODE_LENGTH_CODE_COUNT,_DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH,code_length_length_array);
+	
+	code_length_count = _DEFLATE_CODE_LENGTH_CODE_COUNT;
+	
+	while((code_length_count > 4) && (!code_length_length_array[_deflate_code_length_order_array[code_length_count - 1]]))
+	{
+		code_length_count--;
+	}
+	
+	// fixed codes.
+	for(i=0;i<_DEFLATE_LITERAL_LENGTH_CODE_COUNT;i++)
+	{
+		if (i < 144)
+		{
+			fixed_literal_length_length_array[i] = 8;
+		}
+		else
+		if (i < 256)
+		{
+			fixed_literal_length_length_array[i] = 9;
+		}
+		else
+		if (i < 280)
+		{
+			fixed_literal_length_length_array[i] = 7;
+		}
+		else
+		{
+			fixed_literal_length_length_array[i] = 8;
+		}
+	}
+	
+	for(i=0;i<_DEFLATE_DISTANCE_CODE_COUNT;i++)
+	{
+		fixed_distance_length_array[i] = 5;
+	}
+	
+	// compare sizes.
+	// extra bits are the same for both.
+	dynamic_bits = 5 + 5 + 4 + (code_length_count * 3);
+	fixed_bits = 0;
+	
+	for(i=0;i<rle_count;i++)
+	{
+		dynamic_bits += code_length_length_array[rle_symbol_array[i]];
+		
+		switch(rle_symbol_array[i])
+		{
+			case 16:
+				dynamic_bits += 2;
+				break;
+				
+			case 17:
+				dynamic_bits += 3;
+				break;
+				
+			case 18:
+				dynamic_bits += 7;
+				break;
+		}
+	}
+	
+	for(i=0;i<_DEFLATE_LITERAL_LENGTH_CODE_COUNT;i++)
+	{
+		dynamic_bits += (ES_UINT64)literal_length_freq_array[i] * literal_length_length_array[i];
+		fixed_bits += (ES_UINT64)literal_length_freq_array[i] * fixed_literal_length_length_array[i];
+	}
+	
+	for(i=0;i<_DEFLATE_DISTANCE_CODE_COUNT;i++)
+	{
+		dynamic_bits += (ES_UINT64)distance_freq_array[i] * distance_length_array[i];
+		fixed_bits += (ES_UINT64)distance_freq_array[i] * fixed_distance_length_array[i];
+	}
+	
+	// the input bytes are no longer available once the block start is slid out of the window.
+	if (deflate->block_start >= 0)
+	{
+		ES_UINT64 stored_bits;
+		ES_UINT64 compressed_bits;
+		
+		// the first header is padded to a byte, each 65535 byte chunk has LEN and NLEN.
+		// later chunks have a byte for their header and padding.
+		stored_bits = ((deflate->bit_count + 3 + 7) & ~7) - deflate->bit_count;
+		stored_bits += (ES_UINT64)raw_size * 8;
+		stored_bits += (ES_UINT64)(raw_size ? (raw_size + 65534) / 65535 : 1) * 32;
+		stored_bits += (ES_UINT64)(raw_size ? (raw_size - 1) / 65535 : 0) * 8;
+		
+		compressed_bits = 3 + extra_bits + (dynamic_bits < fixed_bits ? dynamic_bits : fixed_bits);
+		
+		if (stored_bits < compressed_bits)
+		{
+			_deflate_write_stored_block(deflate,deflate->window + deflate->block_start,raw_size,is_final);
+			
+			deflate->block_start += raw_size;
+			deflate->symbol_count = 0;
+			
+			return;
+		}
+	}
+	
+	deflate->block_start += raw_size;
+	
+	// block header.
+	_deflate_write_bits(deflate,is_final ? 1 : 0,1);
+	
+	if (dynamic_bits < fixed_bits)
+	{
+		_deflate_write_bits(deflate,_DEFLATE_BLOCK_TYPE_DYNAMIC,2);
+		_deflate_write_bits(deflate,literal_length_count - 257,5);
+		_deflate_write_bits(deflate,distance_count - 1,5);
+		_deflate_write_bits(deflate,code_length_count - 4,4);
+		
+		for(i=0;i<code_length_count;i++)
+		{
+			_deflate_write_bits(deflate,code_length_length_array[_deflate_code_length_order_array[i]],3);
+		}
+		
+		_deflate_build_codes(code_length_length_array,_DEFLATE_CODE_LENGTH_CODE_COUNT,code_length_code_array);
+		
+		for(i=0;i<rle_count;i++)
+		{
+			_deflate_write_bits(deflate,code_length_code_array[rle_symbol_array[i]],code_length_length_array[rle_symbol_array[i]]);
+			
+			switch(rle_symbol_array[i])
+			{
+				case 16:
+					_deflate_write_bits(deflate,rle_extra_array[i],2);
+					break;
+					
+				case 17:
+					_deflate_write_bits(deflate,rle_extra_array[i],3);
+					break;
+					
+				case 18:
+					_deflate_write_bits(deflate,rle_extra_array[i],7);
+					break;
+			}
+		}
+		
+		block_literal_length_length_array = literal_length_length_array;
+		block_distance_length_array = distance_length_array;
+	}
+	else
+	{
+		_deflate_write_bits(deflate,_DEFLATE_BLOCK_TYPE_FIXED,2);
+		
+		block_literal_length_length_array = fixed_literal_length_length_array;
+		block_distance_length_array = fixed_distance_length_array;
+	}
+	
+	_deflate_build_codes(block_literal_length_length_array,_DEFLATE_LITERAL_LENGTH_CODE_COUNT,literal_length_code_array);
+	_deflate_build_codes(block_distance_length_array,_DEFLATE_DISTANCE_CODE_COUNT,distance_code_array);
+	
+	// symbols.
+	for(i=0;i<deflate->symbol_count;i++)
+	{
+		DWORD distance;
+		
+		distance = deflate->symbol_distance_array[i];
+		
+		if (distance)
+		{
+			DWORD length;
+			DWORD length_code;
+			DWORD distance_code;
+			
+			length = deflate->symbol_length_array[i];
+			length_code = _deflate_get_length_code(length);
+			distance_code = _deflate_get_distance_code(distance);
+			
+			_deflate_write_bits(deflate,literal_length_code_array[_DEFLATE_END_OF_BLOCK + 1 + length_code],block_literal_length_length_array[_DEFLATE_END_OF_BLOCK + 1 + length_code]);
+			_deflate_write_bits(deflate,length - _deflate_length_base_array[length_code],_deflate_length_extra_bits_array[length_code]);
+			_deflate_write_bits(deflate,distance_code_array[distance_code],block_distance_length_array[distance_code]);
+			_deflate_write_bits(deflate,distance - _deflate_distance_base_array[distance_code],_deflate_distance_extra_bits_array[distance_code]);
+		}
+		else
+		{
+			DWORD literal;
+			
+			literal = deflate->symbol_length_array[i];
+			
+			_deflate_write_bits(deflate,literal_length_code_array[literal],block_literal_length_length_array[literal]);
+		}
+	}
+	
+	_deflate_write_bits(deflate,literal_length_code_array[_DEFLATE_END_OF_BLOCK],block_literal_length_length_array[_DEFLATE_END_OF_BLOCK]);
+	
+	deflate->symbol_count = 0;
+	
+	if (is_final)
+	{
+		if (deflate->bit_count)
+		{
+			_deflate_write_bits(deflate,0,8 - deflate->bit_count);
+		}
+	}
+}
+
+// write the input bytes as stored blocks of up to 65535 bytes.
+// at least one block is written.
+static void _deflate_write_stored_block(deflate_t *deflate,const BYTE *data,DWORD size,int is_final)
+{
+	for(;;)
+	{
+		DWORD chunk_size;
+		DWORD run;
+		
+		chunk_size = size < 65535 ? size : 65535;
+		size -= chunk_size;
+		
+		// block header, padded to a byte.
+		_deflate_write_bits(deflate,((is_final) && (!size)) ? 1 : 0,1);
+		_deflate_write_bits(deflate,_DEFLATE_BLOCK_TYPE_STORED,2);
+		
+		if (deflate->bit_count)
+		{
+			_deflate_write_bits(deflate,0,8 - deflate->bit_count);
+		}
+		
+		_deflate_write_bits(deflate,chunk_size,16);
+		_deflate_write_bits(deflate,chunk_size ^ 0xffff,16);
+		
+		run = chunk_size;
+		
+		while(run)
+		{
+			DWORD copy_size;
+			
+			if (deflate->out_size == DEFLATE_OUT_BUF_SIZE)
+			{
+				_deflate_flush_out(deflate);
+			}
+			
+			copy_size = (DWORD)(DEFLATE_OUT_BUF_SIZE - deflate->out_size);
+			
+			if (copy_size > run)
+			{
+				copy_size = run;
+			}
+			
+			os_copy_memory(deflate->out_buf + deflate->out_size,data,copy_size);
+			
+			deflate->out_size += copy_size;
+			data += copy_size;
+			run -= copy_size;
+		}
+		
+		if (!size)
+		{
+			break;
+		}
+	}
+}
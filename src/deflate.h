@@ -0,0 +1,111 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// streaming deflate encoder (RFC 1951)
+// compressed data is passed to write_proc as it is produced.
+
+// the LZ77 window size.
+#define DEFLATE_WINDOW_SIZE				32768
+
+// the number of hash chain heads.
+#define DEFLATE_HASH_BITS				15
+#define DEFLATE_HASH_SIZE				(1 << DEFLATE_HASH_BITS)
+
+// the maximum number of literals and matches in one block.
+#define DEFLATE_MAX_BLOCK_SYMBOLS		16384
+
+// the size of the compressed output buffer.
+#define DEFLATE_OUT_BUF_SIZE			65536
+
+// compression levels.
+#define DEFLATE_MIN_LEVEL				1
+#define DEFLATE_DEFAULT_LEVEL			6
+#define DEFLATE_MAX_LEVEL				9
+
+typedef struct deflate_s
+{
+	// receives the compressed data.
+	// returns FALSE if the write failed.
+	BOOL (*write_proc)(void *user_data,const void *data,SIZE_T size);
+	void *user_data;
+	
+	// match search limits from the compression level.
+	DWORD max_chain;
+	DWORD good_length;
+	DWORD lazy_length;
+	DWORD nice_length;
+	
+	// two windows of input.
+	// the lower window holds the history, the upper window the input to compress.
+	BYTE *window;
+	
+	// the most recent position for each hash.
+	// 0 is no position.
+	WORD *head_array;
+	
+	// the previous position with the same hash, indexed by position modulo the window size.
+	WORD *prev_array;
+	
+	// the position in the window of the next byte to compress.
+	DWORD pos;
+	
+	// the number of input bytes from pos.
+	DWORD lookahead;
+	
+	// lazy matching state.
+	DWORD match_length;
+	DWORD match_pos;
+	DWORD prev_length;
+	DWORD prev_match_pos;
+	int is_match_available;
+	
+	// the literals and matches in the current block.
+	// a literal has a distance of 0.
+	WORD *symbol_length_array;
+	WORD *symbol_distance_array;
+	DWORD symbol_count;
+	
+	// the position in the window of the first input byte in the current block.
+	// negative once the start of the block has been slid out of the window.
+	int block_start;
+	
+	// bits waiting to be written, least significant bit first.
+	DWORD bit_buf;
+	DWORD bit_count;
+	
+	// compressed output.
+	BYTE *out_buf;
+	SIZE_T out_size;
+	
+	// set if a write failed.
+	// no more data is written.
+	int is_error;
+	
+}deflate_t;
+
+void deflate_init(deflate_t *deflate,int level,BOOL (*write_proc)(void *user_data,const void *data,SIZE_T size),void *user_data);
+void deflate_kill(deflate_t *deflate);
+BOOL deflate_write(deflate_t *deflate,const void *data,SIZE_T size);
+BOOL deflate_finish(deflate_t *deflate);
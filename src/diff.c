@@ -0,0 +1,733 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// result set snapshots for -diff-since
+// the state file is a flat binary snapshot of the previous result set.
+
+#include "es.h"
+
+#define _DIFF_FILE_MAGIC				"ESDIFF01"
+#define _DIFF_FILE_USER_DATA_MAGIC		"ESDIFFU1"
+#define _DIFF_FILE_MAGIC_SIZE			8
+#define _DIFF_FILE_BUF_SIZE				65536
+
+// a long path in UTF-8 is at most 32767 wchars * 3 bytes.
+#define _DIFF_MAX_PATH_LEN				(32767 * 3)
+
+#define _DIFF_MAX_USER_DATA_SIZE		(16 * 1024 * 1024)
+
+// buffered file io for the state file.
+typedef struct _diff_file_s
+{
+	HANDLE file_handle;
+	BYTE *buf;
+	BYTE *p;
+	DWORD avail;
+	int is_error;
+	
+}_diff_file_t;
+
+static int _diff_item_compare(const diff_item_t *a,const diff_item_t *b);
+static int _diff_change_compare(const diff_change_t *a,const diff_change_t *b);
+static void _diff_file_read(_diff_file_t *file,void *data,SIZE_T size);
+static void _diff_file_write(_diff_file_t *file,const void *data,SIZE_T size);
+static void _diff_file_flush(_diff_file_t *file);
+static void _diff_change_add(array_t *change_array,pool_t *change_pool,DWORD type,const diff_item_t *item);
+static BOOL _diff_list_load(diff_list_t *list,const wchar_t *filename,const char *magic,utf8_buf_t *out_user_data_cbuf);
+static BOOL _diff_list_save(const diff_list_t *list,const wchar_t *filename,const char *magic,const void *user_data,SIZE_T user_data_size);
+static BOOL _diff_list_is_path_equal(const diff_item_t *item,const ES_UTF8 *path,SIZE_T path_len);
+static const diff_item_t *_diff_list_find(const diff_list_t *list,ES_UINT64 path_hash,const ES_UTF8 *path,SIZE_T path_len,DWORD required_flags);
+
+void diff_list_init(diff_list_t *list)
+{
+	pool_init(&list->pool);
+	array_init(&list->array);
+}
+
+void diff_list_kill(diff_list_t *list)
+{
+	array_kill(&list->array);
+	pool_kill(&list->pool);
+}
+
+// add an item to the list.
+// the list is no longer sorted.
+void diff_list_add(diff_list_t *list,const ES_UTF8 *path,SIZE_T path_len,DWORD flags,ES_UINT64 size,ES_UINT64 date_modified)
+{
+	diff_item_t *item;
+	
+	if (path_len > ES_DWORD_MAX)
+	{
+		// ignore insane paths.
+		return;
+	}
+	
+	item = pool_alloc(&list->pool,safe_size_add(sizeof(diff_item_t),safe_size_add_one(path_len)));
+	
+	item->path_hash = hash_fnv1a_64(path,path_len);
+	item->size = size;
+	item->date_modified = date_modified;
+	item->flags = flags;
+	item->path_len = (DWORD)path_len;
+	
+	os_copy_memory(DIFF_ITEM_PATH(item),path,path_len);
+	DIFF_ITEM_PATH(item)[path_len] = 0;
+	
+	array_insert(&list->array,SIZE_MAX,item);
+}
+
+// sort the list by path hash so two lists can be compared with a single merge walk.
+void diff_list_sort(diff_list_t *list)
+{
+	os_sort(list->array.indexes,list->array.count,_diff_item_compare);
+}
+
+// order by hash, then path.
+// the path compare is only needed for hash collisions.
+static int _diff_item_compare(const diff_item_t *a,const diff_item_t *b)
+{
+	if (a->path_hash < b->path_hash)
+	{
+		return -1;
+	}
+
+	if (a->path_hash > b->path_hash)
+	{
+		return 1;
+	}
+	
+	return utf8_string_compare(DIFF_ITEM_PATH(a),DIFF_ITEM_PATH(b));
+}
+
+// order changes by path for display.
+static int _diff_change_compare(const diff_change_t *a,const diff_change_t *b)
+{
+	int cmp;
+	
+	cmp = utf8_string_compare(DIFF_ITEM_PATH(a->item),DIFF_ITEM_PATH(b->item));
+	if (cmp)
+	{
+		return cmp;
+	}
+	
+	if (a->type < b->type)
+	{
+		return -1;
+	}
+
+	if (a->type > b->type)
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+static void _diff_file_read(_diff_file_t *file,void *data,SIZE_T size)
+{
+	BYTE *d;
+	SIZE_T run;
+	
+	d = data;
+	run = size;
+	
+	while(run)
+	{
+		SIZE_T copy_size;
+		
+		if (!file->avail)
+		{
+			DWORD numread;
+			
+			if (file->is_error)
+			{
+				break;
+			}
+			
+			if ((!ReadFile(file->file_handle,file->buf,_DIFF_FILE_BUF_SIZE,&numread,NULL)) || (!numread))
+			{
+				file->is_error = 1;
+				
+				break;
+			}
+			
+			file->p = file->buf;
+			file->avail = numread;
+		}
+		
+		copy_size = run;
+		if (copy_size > file->avail)
+		{
+			copy_size = file->avail;
+		}
+		
+		os_copy_memory(d,file->p,copy_size);
+		
+		file->p += copy_size;
+		file->avail -= (DWORD)copy_size;
+		d += copy_size;
+		run -= copy_size;
+	}
+	
+	if (run)
+	{
+		// zero fill on error.
+		os_zero_memory(d,run);
+	}
+}
+
+static void _diff_file_flush(_diff_file_t *file)
+{
+	if (file->p != file->buf)
+	{
+		DWORD size;
+		DWORD numwritten;
+		
+		size = (DWORD)(file->p - file->buf);
+		
+		if ((!file->is_error) && ((!WriteFile(file->file_handle,file->buf,size,&numwritten,NULL)) || (numwritten != size)))
+		{
+			file->is_error = 1;
+		}
+		
+		file->p = file->buf;
+		file->avail = _DIFF_FILE_BUF_SIZE;
+	}
+}
+
+static void _diff_file_write(_diff_file_t *file,const void *data,SIZE_T size)
+{
+	const BYTE *s;
+	SIZE_T run;
+	
+	s = data;
+	run = size;
+	
+	while(run)
+	{
+		SIZE_T copy_size;
+		
+		if (!file->avail)
+		{
+			_diff_file_flush(file);
+		}
+		
+		copy_size = run;
+		if (copy_size > file->avail)
+		{
+			copy_size = file->avail;
+		}
+		
+		os_copy_memory(file->p,s,copy_size);
+		
+		file->p += copy_size;
+		file->avail -= (DWORD)copy_size;
+		s += copy_size;
+		run -= copy_size;
+	}
+}
+
+// load a snapshot from filename.
+// the list is sorted.
+// a missing or invalid state file is treated as an empty snapshot.
+// returns TRUE if the state file was loaded.
+// Otherwise, returns FALSE.
+BOOL diff_list_load(diff_list_t *list,const wchar_t *filename)
+{
+	return _diff_list_load(list,filename,_DIFF_FILE_MAGIC,NULL);
+}
+
+// load a snapshot saved with diff_list_save_user_data.
+// out_user_data_cbuf is set to the saved user data.
+// returns TRUE if the state file was loaded.
+// Otherwise, returns FALSE and the list is empty.
+BOOL diff_list_load_user_data(diff_list_t *list,const wchar_t *filename,utf8_buf_t *out_user_data_cbuf)
+{
+	return _diff_list_load(list,filename,_DIFF_FILE_USER_DATA_MAGIC,out_user_data_cbuf);
+}
+
+// the user data is only read if out_user_data_cbuf is not NULL.
+static BOOL _diff_list_load(diff_list_t *list,const wchar_t *filename,const char *magic,utf8_buf_t *out_user_data_cbuf)
+{
+	BOOL ret;
+	_diff_file_t file;
+	
+	ret = FALSE;
+	
+	file.file_handle = os_open_file(filename);
+	
+	if (file.file_handle != INVALID_HANDLE_VALUE)
+	{
+		BYTE file_magic[_DIFF_FILE_MAGIC_SIZE];
+		int is_magic;
+		utf8_buf_t path_cbuf;
+		
+		utf8_buf_init(&path_cbuf);
+
+		file.buf = mem_alloc(_DIFF_FILE_BUF_SIZE);
+		file.p = file.buf;
+		file.avail = 0;
+		file.is_error = 0;
+		
+		_diff_file_read(&file,file_magic,_DIFF_FILE_MAGIC_SIZE);
+		
+		is_magic = 1;
+		
+		{
+			SIZE_T magic_index;
+			
+			for(magic_index=0;magic_index<_DIFF_FILE_MAGIC_SIZE;magic_index++)
+			{
+				if (file_magic[magic_index] != (BYTE)magic[magic_index])
+				{
+					is_magic = 0;
+					break;
+				}
+			}
+		}
+		
+		if ((!file.is_error) && (is_magic) && (out_user_data_cbuf))
+		{
+			ES_UINT64 user_data_size;
+			
+			_diff_file_read(&file,&user_data_size,sizeof(ES_UINT64));
+			
+			if (user_data_size > _DIFF_MAX_USER_DATA_SIZE)
+			{
+				// corrupt.
+				file.is_error = 1;
+			}
+			else
+			{
+				utf8_buf_grow_length(out_user_data_cbuf,(SIZE_T)user_data_size);
+				
+				_diff_file_read(&file,out_user_data_cbuf->buf,(SIZE_T)user_data_size);
+				
+				out_user_data_cbuf->buf[user_data_size] = 0;
+			}
+		}
+		
+		if ((!file.is_error) && (is_magic))
+		{
+			ES_UINT64 count;
+			ES_UINT64 run;
+			
+			_diff_file_read(&file,&count,sizeof(ES_UINT64));
+			
+			run = count;
+			
+			while(run)
+			{
+				diff_item_t header;
+				
+				_diff_file_read(&file,&header,sizeof(diff_item_t));
+				
+				if (header.path_len > _DIFF_MAX_PATH_LEN)
+				{
+					// corrupt.
+					file.is_error = 1;
+				}
+
+				if (file.is_error)
+				{
+					break;
+				}
+				
+				utf8_buf_grow_length(&path_cbuf,header.path_len);
+				
+				_diff_file_read(&file,path_cbuf.buf,header.path_len);
+				
+				if (file.is_error)
+				{
+					break;
+				}
+				
+				path_cbuf.buf[header.path_len] = 0;
+
+				diff_list_add(list,path_cbuf.buf,header.path_len,header.flags,header.size,header.date_modified);
+				
+				run--;
+			}
+			
+			if (file.is_error)
+			{
+				// truncated, start over.
+				array_empty(&list->array);
+				pool_empty(&list->pool);
+			}
+			else
+			{
+				ret = TRUE;
+			}
+		}
+
+		mem_free(file.buf);
+		
+		utf8_buf_kill(&path_cbuf);
+		
+		CloseHandle(file.file_handle);
+	}
+	
+	// the saved list is already sorted, but don't trust it.
+	diff_list_sort(list);
+	
+	return ret;
+}
+
+// save a snapshot to filename.
+// the snapshot is written to a temporary file first so a failed write doesn't lose the previous state.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+BOOL diff_list_save(const diff_list_t *list,const wchar_t *filename)
+{
+	return _diff_list_save(list,filename,_DIFF_FILE_MAGIC,NULL,0);
+}
+
+// save a snapshot with some user data to filename.
+// user_data must not be NULL, load with diff_list_load_user_data.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+BOOL diff_list_save_user_data(const diff_list_t *list,const wchar_t *filename,const void *user_data,SIZE_T user_data_size)
+{
+	return _diff_list_save(list,filename,_DIFF_FILE_USER_DATA_MAGIC,user_data,user_data_size);
+}
+
+// the user data is only written if user_data is not NULL.
+static BOOL _diff_list_save(const diff_list_t *list,const wchar_t *filename,const char *magic,const void *user_data,SIZE_T user_data_size)
+{
+	BOOL ret;
+	wchar_buf_t temp_filename_wcbuf;
+	_diff_file_t file;
+	
+	ret = FALSE;
+	
+	wchar_buf_init(&temp_filename_wcbuf);
+	
+	wchar_buf_copy_wchar_string(&temp_filename_wcbuf,filename);
+	wchar_buf_cat_utf8_string(&temp_filename_wcbuf,".tmp");
+	
+	file.file_handle = os_create_file(temp_filename_wcbuf.buf);
+	
+	if (file.file_handle != INVALID_HANDLE_VALUE)
+	{
+		ES_UINT64 count;
+		SIZE_T run;
+		diff_item_t **item_p;
+		
+		file.buf = mem_alloc(_DIFF_FILE_BUF_SIZE);
+		file.p = file.buf;
+		file.avail = _DIFF_FILE_BUF_SIZE;
+		file.is_error = 0;
+		
+		count = list->array.count;
+		
+		_diff_file_write(&file,magic,_DIFF_FILE_MAGIC_SIZE);
+		
+		if (user_data)
+		{
+			ES_UINT64 user_data_size64;
+			
+			user_data_size64 = user_data_size;
+			
+			_diff_file_write(&file,&user_data_size64,sizeof(ES_UINT64));
+			_diff_file_write(&file,user_data,user_data_size);
+		}
+		
+		_diff_file_write(&file,&count,sizeof(ES_UINT64));
+		
+		item_p = (diff_item_t **)list->array.indexes;
+		run = list->array.count;
+		
+		while(run)
+		{
+			_diff_file_write(&file,*item_p,sizeof(diff_item_t) + (*item_p)->path_len);
+			
+			item_p++;
+			run--;
+		}
+		
+		_diff_file_flush(&file);
+		
+		mem_free(file.buf);
+
+		CloseHandle(file.file_handle);
+		
+		if (!file.is_error)
+		{
+			if (os_replace_file(temp_filename_wcbuf.buf,filename))
+			{
+				ret = TRUE;
+			}
+		}
+		
+		if (!ret)
+		{
+			DeleteFile(temp_filename_wcbuf.buf);
+		}
+	}
+	
+	wchar_buf_kill(&temp_filename_wcbuf);
+	
+	return ret;
+}
+
+static void _diff_change_add(array_t *change_array,pool_t *change_pool,DWORD type,const diff_item_t *item)
+{
+	diff_change_t *change;
+	
+	change = pool_alloc(change_pool,sizeof(diff_change_t));
+	
+	change->type = type;
+	change->item = item;
+	
+	array_insert(change_array,SIZE_MAX,change);
+}
+
+// compare two sorted lists with a single merge walk.
+// adds a diff_change_t to out_change_array for each added, removed or modified item.
+// changes reference items in old_list and new_list, so both lists must outlive out_change_array.
+// returns the number of changes.
+SIZE_T diff_list_compare(const diff_list_t *old_list,const diff_list_t *new_list,array_t *out_change_array,pool_t *change_pool)
+{
+	diff_item_t **old_p;
+	diff_item_t **new_p;
+	SIZE_T old_run;
+	SIZE_T new_run;
+	
+	old_p = (diff_item_t **)old_list->array.indexes;
+	old_run = old_list->array.count;
+	new_p = (diff_item_t **)new_list->array.indexes;
+	new_run = new_list->array.count;
+	
+	while((old_run) || (new_run))
+	{
+		int cmp;
+		
+		if (!old_run)
+		{
+			cmp = 1;
+		}
+		else
+		if (!new_run)
+		{
+			cmp = -1;
+		}
+		else
+		{
+			cmp = _diff_item_compare(*old_p,*new_p);
+		}
+		
+		if (cmp < 0)
+		{
+			_diff_change_add(out_change_array,change_pool,DIFF_CHANGE_TYPE_REMOVED,*old_p);
+			
+			old_p++;
+			old_run--;
+		}
+		else
+		if (cmp > 0)
+		{
+			_diff_change_add(out_change_array,change_pool,DIFF_CHANGE_TYPE_ADDED,*new_p);
+
+			new_p++;
+			new_run--;
+		}
+		else
+		{
+			if (((*old_p)->size != (*new_p)->size) || ((*old_p)->date_modified != (*new_p)->date_modified))
+			{
+				_diff_change_add(out_change_array,change_pool,DIFF_CHANGE_TYPE_MODIFIED,*new_p);
+			}
+			
+			old_p++;
+			old_run--;
+			new_p++;
+			new_run--;
+		}
+	}
+	
+	return out_change_array->count;
+}
+
+// sort changes by path for display.
+void diff_sort_changes(array_t *change_array)
+{
+	os_sort(change_array->indexes,change_array->count,_diff_change_compare);
+}
+
+static BOOL _diff_list_is_path_equal(const diff_item_t *item,const ES_UTF8 *path,SIZE_T path_len)
+{
+	const ES_UTF8 *item_path;
+	SIZE_T run;
+	
+	if (item->path_len != path_len)
+	{
+		return FALSE;
+	}
+	
+	item_path = DIFF_ITEM_PATH(item);
+	run = path_len;
+	
+	while(run)
+	{
+		if (*item_path != *path)
+		{
+			return FALSE;
+		}
+		
+		item_path++;
+		path++;
+		run--;
+	}
+	
+	return TRUE;
+}
+
+// find an item with a binary search on the path hash.
+// path doesn't need to be null terminated.
+// returns NULL if not found.
+static const diff_item_t *_diff_list_find(const diff_list_t *list,ES_UINT64 path_hash,const ES_UTF8 *path,SIZE_T path_len,DWORD required_flags)
+{
+	SIZE_T blo;
+	SIZE_T bhi;
+	
+	blo = 0;
+	bhi = list->array.count;
+	
+	// find the first item with this hash.
+	while(blo < bhi)
+	{
+		SIZE_T bpos;
+		
+		bpos = blo + ((bhi - blo) / 2);
+		
+		if (((diff_item_t *)list->array.indexes[bpos])->path_hash < path_hash)
+		{
+			blo = bpos + 1;
+		}
+		else
+		{
+			bhi = bpos;
+		}
+	}
+	
+	// check each item with the same hash.
+	while(blo < list->array.count)
+	{
+		const diff_item_t *item;
+		
+		item = list->array.indexes[blo];
+		
+		if (item->path_hash != path_hash)
+		{
+			break;
+		}
+		
+		if ((item->flags & required_flags) == required_flags)
+		{
+			if (_diff_list_is_path_equal(item,path,path_len))
+			{
+				return item;
+			}
+		}
+		
+		blo++;
+	}
+	
+	return NULL;
+}
+
+// check if a path is in a sorted list of paths.
+// an item with DIFF_ITEM_FLAG_FOLDER also matches everything under the folder.
+// returns TRUE if the path matches.
+// Otherwise, returns FALSE.
+BOOL diff_list_match_path(const diff_list_t *path_list,const ES_UTF8 *path,SIZE_T path_len)
+{
+	ES_UINT64 hash;
+	SIZE_T hash_len;
+	SIZE_T path_index;
+	
+	if (!path_list->array.count)
+	{
+		return FALSE;
+	}
+	
+	// hash each parent along the way.
+	// the hash is continued from the previous parent.
+	hash = hash_fnv1a_64(NULL,0);
+	hash_len = 0;
+	
+	for(path_index=1;path_index<path_len;path_index++)
+	{
+		if ((path[path_index] == '\\') || (path[path_index] == '/'))
+		{
+			hash = hash_fnv1a_64_append(hash,path + hash_len,path_index - hash_len);
+			hash_len = path_index;
+			
+			if (_diff_list_find(path_list,hash,path,path_index,DIFF_ITEM_FLAG_FOLDER))
+			{
+				return TRUE;
+			}
+		}
+	}
+	
+	hash = hash_fnv1a_64_append(hash,path + hash_len,path_len - hash_len);
+	
+	if (_diff_list_find(path_list,hash,path,path_len,0))
+	{
+		return TRUE;
+	}
+	
+	return FALSE;
+}
+
+// remove every item that matches path_list.
+// path_list must be sorted.
+// see diff_list_match_path.
+// the list stays sorted.
+// the item memory is not released until the list is killed.
+void diff_list_remove_matching(diff_list_t *list,const diff_list_t *path_list)
+{
+	SIZE_T index;
+	SIZE_T count;
+	
+	count = 0;
+	
+	for(index=0;index<list->array.count;index++)
+	{
+		diff_item_t *item;
+		
+		item = list->array.indexes[index];
+		
+		if (!diff_list_match_path(path_list,DIFF_ITEM_PATH(item),item->path_len))
+		{
+			list->array.indexes[count] = item;
+			count++;
+		}
+	}
+	
+	list->array.count = count;
+}
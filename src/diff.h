@@ -0,0 +1,91 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// result set snapshots for -diff-since
+// a snapshot is a list of full paths with their size and date modified, sorted by path hash.
+
+#define DIFF_ITEM_PATH(item)				((ES_UTF8 *)(((diff_item_t *)(item)) + 1))
+
+#define DIFF_ITEM_FLAG_FOLDER				0x00000001
+
+// the type of change between two snapshots.
+#define DIFF_CHANGE_TYPE_ADDED				0
+#define DIFF_CHANGE_TYPE_REMOVED			1
+#define DIFF_CHANGE_TYPE_MODIFIED			2
+
+typedef struct diff_item_s
+{
+	// FNV-1a hash of the path.
+	ES_UINT64 path_hash;
+	
+	ES_UINT64 size;
+	ES_UINT64 date_modified;
+	
+	// one or more of DIFF_ITEM_FLAG_*
+	DWORD flags;
+	
+	// length of the path in bytes.
+	DWORD path_len;
+	
+	// path follows, null terminated.
+	// ES_UTF8 path[path_len+1];
+
+}diff_item_t;
+
+typedef struct diff_list_s
+{
+	// item storage.
+	pool_t pool;
+	
+	// array of diff_item_t *
+	// sorted by diff_list_sort.
+	array_t array;
+
+}diff_list_t;
+
+typedef struct diff_change_s
+{
+	// DIFF_CHANGE_TYPE_*
+	DWORD type;
+	
+	// the new item for added or modified items.
+	// the old item for removed items.
+	const diff_item_t *item;
+
+}diff_change_t;
+
+void diff_list_init(diff_list_t *list);
+void diff_list_kill(diff_list_t *list);
+void diff_list_add(diff_list_t *list,const ES_UTF8 *path,SIZE_T path_len,DWORD flags,ES_UINT64 size,ES_UINT64 date_modified);
+void diff_list_sort(diff_list_t *list);
+BOOL diff_list_load(diff_list_t *list,const wchar_t *filename);
+BOOL diff_list_save(const diff_list_t *list,const wchar_t *filename);
+BOOL diff_list_load_user_data(diff_list_t *list,const wchar_t *filename,utf8_buf_t *out_user_data_cbuf);
+BOOL diff_list_save_user_data(const diff_list_t *list,const wchar_t *filename,const void *user_data,SIZE_T user_data_size);
+BOOL diff_list_match_path(const diff_list_t *path_list,const ES_UTF8 *path,SIZE_T path_len);
+void diff_list_remove_matching(diff_list_t *list,const diff_list_t *path_list);
+SIZE_T diff_list_compare(const diff_list_t *old_list,const diff_list_t *new_list,array_t *out_change_array,pool_t *change_pool);
+void diff_sort_changes(array_t *change_array);
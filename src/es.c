@@ -31,7 +31,6 @@
 // [HIGH] json should only print the trailing , at the start of a non-first line and the terminating ] should always be added when using read journal mode.
 // [HIGH] c# cmdlet for powershell.
 // [HIGH] separate old-name and new-name filters when reading the journal.
-// [HIGH] es -createfilelist -need filename filters -need semicolon delimited list parser.
 // consider checking the calling process for powershell 7 and using --argv by default.
 // es server that is active while the console window is opened and handles all requests, so multiple calls from the same console window share the same connection and cache.
 // ansi escapes -option to escape colors so they are piped to other commands like find.
@@ -160,12 +159,51 @@
 #define _ES_MODE_READ_JOURNAL				5
 
 #define _ES_EXPORT_BUF_SIZE			65536
+#define _ES_LINE_READER_BUF_SIZE	65536
+
+// the maximum number of results to request in one -partitions range.
+#define _ES_PARTITION_MAX_RESULTS	65536
+
+// rebuild a -view if more paths than this have changed.
+#define _ES_VIEW_MAX_CHANGED_PATHS	65536
+
+// the maximum number of changed paths to search at once for a -view.
+#define _ES_VIEW_MAX_RECHECK_PATHS	256
+
+// how often to cancel pipe reads after the -deadline expires, in milliseconds.
+#define _ES_DEADLINE_CANCEL_INTERVAL	10
+
+// the maximum number of -stat-from-stdin lookups sent before reading a reply.
+// this is further limited so the unread replies always fit in the pipe buffer.
+// otherwise, Everything could block writing replies while we block writing requests.
+#define _ES_STAT_MAX_IN_FLIGHT			256
+
+// the default and maximum number of -get-folder-size lookups sent before reading a reply.
+// also limited by the pipe buffer size, like _ES_STAT_MAX_IN_FLIGHT.
+#define _ES_FOLDER_SIZE_DEFAULT_IN_FLIGHT	256
+#define _ES_FOLDER_SIZE_MAX_IN_FLIGHT		512
+
+// how -export-shard splits the export into numbered files.
+#define _ES_SHARD_TYPE_NONE			0
+#define _ES_SHARD_TYPE_ROWS			1
+#define _ES_SHARD_TYPE_BYTES		2
+#define _ES_SHARD_TYPE_BY			3
+
+// the part of a date used as a -group-by key.
+#define _ES_GROUP_KEY_DATE_PART_NONE	0
+#define _ES_GROUP_KEY_DATE_PART_YEAR	1
+#define _ES_GROUP_KEY_DATE_PART_MONTH	2
+#define _ES_GROUP_KEY_DATE_PART_DAY		3
 
 #define _ES_PAUSE_TEXT				"ESC=Quit; Up,Down,Left,Right,Page Up,Page Down,Home,End=Scroll"
 #define _ES_BLANK_PAUSE_TEXT		"                                                              "
 
 #define _ES_MSGFLT_ALLOW			1
 
+// backoff limits in milliseconds when we have to poll Everything.
+#define _ES_WAIT_MIN_BACKOFF		1
+#define _ES_WAIT_MAX_BACKOFF		100
+
 typedef struct _es_tagCHANGEFILTERSTRUCT_s
 {
 	DWORD cbSize;
@@ -181,8 +219,402 @@ typedef struct _es_read_journal_s
 	
 }_es_read_journal_t;
 
+// a -view state file.
+typedef struct _es_view_s
+{
+	// the journal position the view is current to.
+	ES_UINT64 journal_id;
+	ES_UINT64 next_change_id;
+	
+	// the saved search.
+	DWORD search_flags;
+	wchar_buf_t search_wcbuf;
+	
+	// the results, sorted by path hash.
+	diff_list_t list;
+	
+}_es_view_t;
+
+// the start of the -view user data.
+// the UTF-8 search follows.
+typedef struct _es_view_header_s
+{
+	ES_UINT64 journal_id;
+	ES_UINT64 next_change_id;
+	DWORD search_flags;
+	
+}_es_view_header_t;
+
+// reading the journal for a -view.
+typedef struct _es_view_journal_s
+{
+	// stop before this change.
+	ES_UINT64 end_change_id;
+	
+	// set once every change up to end_change_id has been read.
+	int is_done;
+	
+	// the changed paths.
+	// DIFF_ITEM_FLAG_FOLDER is set if everything under the path also changed.
+	diff_list_t changed_list;
+	
+	utf8_buf_t path_cbuf;
+	
+}_es_view_journal_t;
+
+// the reply to an ipc3 search.
+// read from the pipe or from the result cache.
+typedef struct _es_ipc3_reply_s
+{
+	// the stream to read the reply from.
+	ipc3_stream_t *stream;
+	
+	ipc3_stream_pipe_t pipe_stream;
+	
+	// the whole reply, read into memory so it can be saved to the cache.
+	ipc3_stream_pool_t pool_stream;
+	int is_pool_stream;
+	
+	// INVALID_HANDLE_VALUE if not read from the cache.
+	HANDLE file_handle;
+	ipc3_stream_file_t file_stream;
+	
+}_es_ipc3_reply_t;
+
+// reads UTF-8 lines from a file or stdin.
+typedef struct _es_line_reader_s
+{
+	HANDLE file_handle;
+	
+	// don't close stdin.
+	int is_close;
+	
+	int is_eof;
+	
+	// check for a BOM on the first read.
+	int is_first;
+	
+	BYTE *buf;
+	BYTE *p;
+	DWORD avail;
+	
+}_es_line_reader_t;
+
+// the query state that a -batch line can change.
+typedef struct _es_batch_state_s
+{
+	ES_UINT64 offset;
+	ES_UINT64 max_results;
+	DWORD primary_sort_property_id;
+	char primary_sort_ascending;
+	
+	// secondary sorts in sort order.
+	SIZE_T secondary_sort_count;
+	secondary_sort_t *secondary_sort_copy_array;
+	
+	// column property ids in column order.
+	SIZE_T column_count;
+	DWORD *column_property_id_array;
+	
+}_es_batch_state_t;
+
+// a -batch query with its own state, so it can run on any connection.
+typedef struct _es_batch_query_s
+{
+	// the next query in the work or done queue.
+	struct _es_batch_query_s *next;
+	
+	// the line number, ignoring blank lines and comments.
+	SIZE_T index;
+	
+	// the line from the batch file.
+	wchar_t *line;
+	
+	// the viewport, sort and columns for output.
+	_es_batch_state_t state;
+	
+	// the search request.
+	utf8_buf_t packet_cbuf;
+	SIZE_T packet_size;
+	
+	// the entire reply, read by the connection thread.
+	ipc3_stream_pool_t pool_stream;
+	
+	// milliseconds from sending the request until the reply was read.
+	DWORD latency;
+	
+}_es_batch_query_t;
+
+// queues shared between the main thread and the connection threads.
+typedef struct _es_batch_pool_s
+{
+	CRITICAL_SECTION cs;
+	
+	// released once for each queued query.
+	HANDLE work_semaphore;
+	
+	// released once for each completed query.
+	HANDLE done_semaphore;
+	
+	_es_batch_query_t *work_start;
+	_es_batch_query_t *work_last;
+	_es_batch_query_t *done_start;
+	_es_batch_query_t *done_last;
+	
+}_es_batch_pool_t;
+
+// a pipe connection with its own thread.
+typedef struct _es_batch_connection_s
+{
+	_es_batch_pool_t *pool;
+	HANDLE pipe_handle;
+	HANDLE thread_handle;
+	
+	// set if the pipe is no longer in sync.
+	int is_broken;
+	
+}_es_batch_connection_t;
+
+// a -batch file run on a pool of connections.
+typedef struct _es_batch_file_s
+{
+	_es_line_reader_t reader;
+	DWORD search_flags;
+	
+	// the command line search and state.
+	wchar_buf_t base_search_wcbuf;
+	_es_batch_state_t base_state;
+	
+	const wchar_t *delimiter;
+	int is_latency;
+	
+}_es_batch_file_t;
+
+// a -partitions query split into ranges.
+typedef struct _es_partition_s
+{
+	DWORD search_flags;
+	ipc3_search_property_request_t *property_request_array;
+	SIZE_T property_request_count;
+	
+	// the folder and file count from the count query.
+	SIZE_T result_count;
+	
+	// the next range to search.
+	SIZE_T next_offset;
+	SIZE_T end_offset;
+	
+	// the number of results left to output.
+	SIZE_T output_count;
+	
+	int is_first_line;
+	
+	// set if a range saw a different result list.
+	int is_changed;
+	
+	utf8_buf_t property_text_cbuf;
+	
+}_es_partition_t;
+
+// a sort value from the current item of an -instances reply.
+typedef struct _es_instance_key_s
+{
+	// set if the value is text.
+	// Otherwise, value is used.
+	int is_text;
+	ES_UINT64 value;
+	wchar_buf_t text_wcbuf;
+	
+}_es_instance_key_t;
+
+// an Everything instance in an -instances search.
+typedef struct _es_instance_s
+{
+	// the instance name, empty for the default instance.
+	wchar_buf_t name_wcbuf;
+	
+	HANDLE pipe_handle;
+	ipc3_stream_pipe_t pipe_stream;
+	
+	// records the current item so it can be output later.
+	ipc3_stream_record_t record_stream;
+	ipc3_result_list_t result_list;
+	
+	// the number of items left to read from the reply.
+	SIZE_T result_run;
+	
+	// the sort key index for each property in the reply.
+	// SIZE_MAX if the property is not a sort key.
+	SIZE_T *property_key_index_array;
+	
+	// the sort values of the current item.
+	_es_instance_key_t *key_array;
+	BYTE item_flags;
+	
+	// the sort values of the previous item.
+	// used to check the reply is in the same order as the merge.
+	_es_instance_key_t *prev_key_array;
+	BYTE prev_item_flags;
+	int is_prev_item;
+	
+	// the position in the -instances list.
+	SIZE_T index;
+	
+	// set if the result list and streams need to be closed.
+	int is_reply;
+	
+}_es_instance_t;
+
+// a sort used to merge -instances replies.
+typedef struct _es_merge_sort_s
+{
+	DWORD property_id;
+	BOOL is_ascending;
+	
+}_es_merge_sort_t;
+
+// an -instances search.
+typedef struct _es_merge_s
+{
+	_es_instance_t *instance_array;
+	SIZE_T instance_count;
+	
+	_es_merge_sort_t *sort_array;
+	SIZE_T sort_count;
+	
+	// a binary heap of instances with a current item.
+	// the instance with the smallest item is first.
+	_es_instance_t **heap_array;
+	SIZE_T heap_count;
+	
+	utf8_buf_t key_text_cbuf;
+	
+	// set if a reply was not in the merge order.
+	int is_out_of_order;
+	
+}_es_merge_t;
+
+// an -agg aggregate.
+typedef struct _es_group_agg_s
+{
+	// GROUP_AGG_TYPE_*
+	BYTE agg_type;
+	
+	// the property to aggregate.
+	// EVERYTHING3_INVALID_PROPERTY_ID for count.
+	DWORD property_id;
+	
+	// the index of the property in the reply.
+	// SIZE_MAX if the property is not in the reply.
+	SIZE_T property_request_index;
+	
+}_es_group_agg_t;
+
+// a -group-by search.
+typedef struct _es_group_by_s
+{
+	DWORD key_property_id;
+	
+	// _ES_GROUP_KEY_DATE_PART_*
+	int key_date_part;
+	
+	// the number of path parts to keep from a text key.
+	// 0 keeps the whole key.
+	SIZE_T key_depth;
+	
+	_es_group_agg_t *agg_array;
+	SIZE_T agg_count;
+	
+	// the agg_type of each aggregate for the group list.
+	BYTE *agg_type_array;
+	
+}_es_group_by_t;
+
+// a column in an -approx search.
+typedef struct _es_approx_column_s
+{
+	DWORD property_id;
+	
+	// set if the reply value is text.
+	// text values only have a distinct count.
+	int is_text;
+	
+	// the number of values added.
+	ES_UINT64 count;
+	
+	sketch_hll_t hll;
+	sketch_quantile_t quantile;
+	
+}_es_approx_column_t;
+
+// a kept item in a -sample search.
+typedef struct _es_sample_item_s
+{
+	// the index of the item in the results.
+	ES_UINT64 index;
+	
+	// the recorded item data.
+	BYTE *buf;
+	SIZE_T size;
+	
+}_es_sample_item_t;
+
+// pipelined -stat-from-stdin or -get-folder-size lookups.
+typedef struct _es_stat_s
+{
+	// paths from the command line, sent before the paths from reader.
+	// can be NULL.
+	const array_t *path_list;
+	SIZE_T path_list_index;
+	
+	// only read when is_reader is set.
+	_es_line_reader_t reader;
+	int is_reader;
+	
+	// the IPC3 command sent for each path.
+	int command;
+	
+	// the maximum number of lookups sent before reading a reply.
+	SIZE_T max_in_flight;
+	
+	// the paths of the lookups sent, waiting for a reply.
+	// a ring buffer of max_in_flight paths, starting at first_index.
+	wchar_t **path_array;
+	SIZE_T first_index;
+	SIZE_T in_flight_count;
+	
+	// no more paths.
+	int is_eof;
+	
+	wchar_buf_t path_json_name_wcbuf;
+	wchar_buf_t size_json_name_wcbuf;
+	wchar_buf_t date_modified_json_name_wcbuf;
+	wchar_buf_t date_created_json_name_wcbuf;
+	wchar_buf_t attributes_json_name_wcbuf;
+	
+}_es_stat_t;
+
+// an extra -export-* file written from the same results.
+// holds the main export state while swapped with _es_tee_swap.
+typedef struct _es_tee_s
+{
+	struct _es_tee_s *next;
+	
+	BYTE export_type;
+	HANDLE export_file;
+	BYTE *export_buf;
+	BYTE *export_p;
+	DWORD export_avail;
+	int header;
+	int footer;
+	
+}_es_tee_t;
+
 static int _es_main(void);
 static void DECLSPEC_NORETURN _es_bad_switch_param(const char *format,...);
+static void DECLSPEC_NORETURN _es_write_output_failed(void);
+static BOOL _es_try_write_output(HANDLE file_handle,const void *data,SIZE_T size);
+static void _es_write_output(HANDLE file_handle,const void *data,DWORD size);
 static void _es_console_fill(SIZE_T count,int ascii_ch);
 static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int is_highlighted);
 static void _es_output_cell_utf8_string(const ES_UTF8 *text,int is_highlighted);
@@ -231,10 +663,12 @@ static void _es_output_cell_dimensions_property(EVERYTHING3_DIMENSIONS *dimensio
 static void _es_output_cell_aspect_ratio_property(DWORD value);
 static void _es_output_cell_data_property(const BYTE *data,SIZE_T size);
 static void _es_output_cell_separator(void);
+static const ES_UTF8 *_es_get_cell_separator_text(void);
 static void _es_output_noncell_wchar_string(const wchar_t *text);
 static void _es_output_noncell_wchar_string_n(const wchar_t *text,SIZE_T length_in_wchars);
 static void _es_output_noncell_utf8_string(const ES_UTF8 *text);
 static void _es_output_noncell_printf(const ES_UTF8 *text,...);
+static void _es_output_noncell_newline(void);
 static void _es_output_header(void);
 static void _es_output_line_begin(int is_first);
 static void _es_output_line_end(int is_more);
@@ -243,11 +677,110 @@ static void _es_output_page_end(void);
 static void _es_output_cell_printf(int is_highlighted,ES_UTF8 *format,...);
 static BOOL _es_ipc1_query(void);
 static BOOL _es_ipc2_query(void);
+static DWORD _es_ipc3_get_search_flags(void);
+static DWORD _es_ipc3_get_property_request_flags(DWORD property_id);
+static SIZE_T _es_ipc3_build_search_packet(DWORD search_flags,SIZE_T viewport_offset,SIZE_T viewport_count,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count,utf8_buf_t *out_packet_cbuf);
+static BOOL _es_ipc3_write_search(HANDLE pipe_handle,DWORD search_flags,SIZE_T viewport_offset,SIZE_T viewport_count,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count);
+static BOOL _es_ipc3_reply_open(_es_ipc3_reply_t *reply,HANDLE pipe_handle,DWORD search_flags,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count);
+static void _es_ipc3_reply_close(_es_ipc3_reply_t *reply);
+static ipc3_search_property_request_t *_es_ipc3_alloc_property_request_array(SIZE_T *out_property_request_count);
 static BOOL _es_ipc3_query(void);
+static void _es_ipc3_read_diff_list(ipc3_result_list_t *result_list,diff_list_t *list);
+static BOOL _es_ipc3_diff_since(const wchar_t *filename);
+static const ES_UTF8 *_es_diff_item_get_name(const diff_item_t *item);
+static int _es_view_item_compare(const diff_item_t *a,const diff_item_t *b);
+static void _es_output_view(const diff_list_t *list);
+static BOOL _es_view_search(HANDLE pipe_handle,DWORD search_flags,wchar_buf_t *search_wcbuf,diff_list_t *list);
+static BOOL _es_view_journal_callback_proc(void *user_data,_ipc3_journal_change_t *change);
+static BOOL _es_view_recheck(HANDLE pipe_handle,_es_view_t *view,const diff_list_t *changed_list);
+static BOOL _es_view_update(HANDLE pipe_handle,_es_view_t *view,ES_UINT64 end_change_id);
+static BOOL _es_view_load(_es_view_t *view,const wchar_t *filename);
+static BOOL _es_view_save(const _es_view_t *view,const wchar_t *filename);
+static BOOL _es_ipc3_view(const wchar_t *filename);
+static BOOL _es_line_reader_open(_es_line_reader_t *reader,const wchar_t *filename);
+static void _es_line_reader_close(_es_line_reader_t *reader);
+static BOOL _es_line_reader_read_line(_es_line_reader_t *reader,wchar_buf_t *out_wcbuf);
+static void _es_batch_state_save(_es_batch_state_t *state);
+static void _es_batch_state_restore(const _es_batch_state_t *state);
+static void _es_batch_state_kill(_es_batch_state_t *state);
+static void _es_batch_parse_line(const wchar_t *line,wchar_buf_t *out_search_wcbuf);
+static BOOL _es_batch_read_query(_es_line_reader_t *reader,const _es_batch_state_t *base_state,const wchar_t *base_search,wchar_buf_t *out_line_wcbuf,wchar_buf_t *out_query_wcbuf,_es_batch_state_t *out_state);
+static SIZE_T _es_batch_build_search_packet(DWORD search_flags,wchar_buf_t *query_wcbuf,utf8_buf_t *out_packet_cbuf);
+static BOOL _es_ipc3_batch_read_next(DWORD search_flags,_es_line_reader_t *reader,const _es_batch_state_t *base_state,const wchar_t *base_search,wchar_buf_t *out_line_wcbuf,utf8_buf_t *out_packet_cbuf,SIZE_T *out_packet_size,_es_batch_state_t *out_state);
+static void _es_batch_output_result_list(ipc3_result_list_t *result_list,const wchar_t *line,const wchar_t *delimiter,int is_latency,DWORD latency);
+static BOOL _es_ipc3_batch_output(HANDLE pipe_handle,const wchar_t *line,const wchar_t *delimiter,int is_latency,DWORD send_tick);
+static BOOL _es_ipc3_batch(const wchar_t *filename,const wchar_t *delimiter,int is_latency);
+static DWORD _es_batch_get_search_flags(void);
+static _es_batch_query_t *_es_batch_query_alloc(_es_line_reader_t *reader,DWORD search_flags,const _es_batch_state_t *base_state,const wchar_t *base_search);
+static void _es_batch_query_free(_es_batch_query_t *query);
+static void _es_batch_query_output(_es_batch_query_t *query,const wchar_t *delimiter,int is_latency);
+static DWORD WINAPI _es_batch_connection_thread_proc(void *param);
+static _es_batch_connection_t *_es_batch_connect(SIZE_T connection_count,SIZE_T *out_connected_count);
+static void _es_batch_disconnect(_es_batch_connection_t *connection_array,SIZE_T connected_count);
+static void _es_batch_run(_es_batch_connection_t *connection_array,SIZE_T connected_count,SIZE_T in_flight_count,int is_as_completed,_es_batch_query_t *(*next_query_proc)(void *user_data),void (*output_query_proc)(void *user_data,_es_batch_query_t *query),void *user_data);
+static _es_batch_query_t *_es_batch_file_next_query_proc(void *user_data);
+static void _es_batch_file_output_query_proc(void *user_data,_es_batch_query_t *query);
+static _es_batch_query_t *_es_partition_next_query_proc(void *user_data);
+static void _es_partition_output_query_proc(void *user_data,_es_batch_query_t *query);
+static BOOL _es_ipc3_partitioned_query(SIZE_T connection_count);
+static BOOL _es_instance_read_item(_es_merge_t *merge,_es_instance_t *instance);
+static int _es_instance_compare_keys(const _es_merge_t *merge,BYTE a_item_flags,const _es_instance_key_t *a_key_array,BYTE b_item_flags,const _es_instance_key_t *b_key_array);
+static int _es_instance_compare(const _es_merge_t *merge,const _es_instance_t *a,const _es_instance_t *b);
+static void _es_merge_heap_sift_up(_es_merge_t *merge,SIZE_T index);
+static void _es_merge_heap_sift_down(_es_merge_t *merge,SIZE_T index);
+static void _es_output_merged_results(_es_merge_t *merge,SIZE_T result_count,ES_UINT64 total_result_size);
+static BOOL _es_ipc3_federated_query(const wchar_t *instance_list);
+static BOOL _es_group_parse_function(const wchar_t *s,const char *function_name,wchar_buf_t *out_argument_wcbuf);
+static DWORD _es_group_find_property(const wchar_t *property_name);
+static const ES_UTF8 *_es_group_get_agg_name(BYTE agg_type);
+static void _es_group_by_init(_es_group_by_t *group_by,const wchar_t *key,const wchar_t *agg_list,SIZE_T key_depth);
+static void _es_group_by_kill(_es_group_by_t *group_by);
+static SIZE_T _es_group_find_reply_property(const ipc3_result_list_t *result_list,DWORD property_id);
+static ES_UINT64 _es_group_get_date_key(ES_UINT64 filetime,int date_part);
+static SIZE_T _es_group_get_key_depth_length(const ES_UTF8 *key,SIZE_T key_len,SIZE_T key_depth);
+static void _es_group_read_results(_es_group_by_t *group_by,ipc3_result_list_t *result_list);
+static void _es_output_group_field(int is_first,const wchar_t *json_name,const wchar_t *value,int is_text);
+static void _es_output_groups(const _es_group_by_t *group_by,const group_list_t *group_list);
+static BOOL _es_ipc3_group_query(_es_group_by_t *group_by);
+static void _es_approx_read_results(ipc3_result_list_t *result_list);
+static void _es_output_approx_columns(_es_approx_column_t *approx_column_array,SIZE_T column_count);
+static BOOL _es_ipc3_approx_query(void);
+static void _es_rollup_read_results(ipc3_result_list_t *result_list,SIZE_T rollup_depth);
+static void _es_output_rollup(const rollup_tree_t *tree);
+static BOOL _es_ipc3_rollup_query(SIZE_T rollup_depth);
+static int _es_sample_item_compare(const _es_sample_item_t *a,const _es_sample_item_t *b);
+static void _es_sample_read_results(ipc3_result_list_t *result_list,ipc3_stream_record_t *record_stream,ES_UINT64 sample_size,ES_UINT64 seed);
+static BOOL _es_ipc3_sample_query(ES_UINT64 sample_size,ES_UINT64 seed);
+static void _es_stat_init(_es_stat_t *stat,HANDLE pipe_handle,int command,SIZE_T max_in_flight,SIZE_T reply_size);
+static void _es_stat_kill(_es_stat_t *stat);
+static BOOL _es_stat_get_next_path(_es_stat_t *stat,wchar_buf_t *out_wcbuf);
+static BOOL _es_stat_read_reply(HANDLE pipe_handle,WIN32_FILE_ATTRIBUTE_DATA *out_data,int *out_is_found);
+static void _es_output_stat_filetime(const wchar_t *json_name,const FILETIME *ft,int is_found);
+static void _es_output_stat(const _es_stat_t *stat,const wchar_t *path,const WIN32_FILE_ATTRIBUTE_DATA *data,int is_found,int is_first_line,int is_more);
+static BOOL _es_stat_send_more(_es_stat_t *stat,HANDLE pipe_handle);
+static BOOL _es_ipc3_stat_from_stdin(void);
+static BOOL _es_folder_size_read_reply(HANDLE pipe_handle,ES_UINT64 *out_size);
+static BOOL _es_ipc3_get_folder_sizes(const array_t *folder_list,const wchar_t *folder_list_filename,SIZE_T max_in_flight);
+static void _es_ls_read_results(ipc3_result_list_t *result_list,SIZE_T prefix_len);
+static BOOL _es_ipc3_ls_query(const wchar_t *path);
+static BOOL _es_ipc3_batch_concurrent(const wchar_t *filename,const wchar_t *delimiter,int is_latency,SIZE_T connection_count,SIZE_T in_flight_count,int is_as_completed);
+static const ES_UTF8 *_es_diff_change_type_get_text(DWORD type);
+static void _es_output_change_field(const ES_UTF8 *text);
+static void _es_output_diff_item_cell(const diff_item_t *item,utf8_buf_t *path_cbuf);
+static BOOL _es_is_diff_item_property(DWORD property_id);
+static void _es_output_diff_changes(const array_t *change_array);
 static void _es_output_ipc1_results(EVERYTHING_IPC_LIST *list,SIZE_T index_start,SIZE_T count);
 static void _es_output_ipc2_results(EVERYTHING_IPC_LIST2 *list,SIZE_T index_start,SIZE_T count);
 static ES_UINT64 _es_ipc2_calculate_total_size(EVERYTHING_IPC_LIST2 *list);
+static void _es_output_ipc3_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,int is_first_line,int is_more);
 static void _es_output_ipc3_results(ipc3_result_list_t *result_list,SIZE_T index_start,SIZE_T count);
+static DWORD WINAPI _es_deadline_thread_proc(void *param);
+static void _es_deadline_start(void);
+static void _es_deadline_stop(void);
+static void _es_deadline_set_is_reading(int is_reading);
+static void _es_output_ipc3_recorded_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,const void *buf,SIZE_T size,int is_64bit,int is_first_line,int is_more);
+static void _es_tee_output_ipc3_recorded_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,const void *buf,SIZE_T size,int is_64bit,int is_first_line,int is_more);
+static void _es_output_ipc3_results_before_deadline(ipc3_result_list_t *result_list);
 static LRESULT __stdcall _es_window_proc(HWND hwnd,UINT msg,WPARAM wParam,LPARAM lParam);
 static void _es_help(void);
 static HWND _es_find_ipc_window(void);
@@ -260,6 +793,22 @@ static void _es_format_duration(ES_UINT64 filetime,wchar_buf_t *wcbuf);
 static void _es_format_attributes(DWORD attributes,wchar_buf_t *wcbuf);
 static const wchar_t *_es_parse_command_line_option_name(const wchar_t *argv,const ES_UTF8 *s);
 static BOOL _es_flush_export_buffer(void);
+static void _es_set_export_file(const wchar_t *filename,BYTE export_type);
+static BOOL _es_is_tee_export_type(BYTE export_type);
+static void _es_tee_swap(_es_tee_t *tee);
+static void _es_tee_close_all(void);
+static void _es_shard_get_filename(DWORD shard_index,wchar_buf_t *out_wcbuf);
+static void _es_shard_open(void);
+static void _es_shard_start(void);
+static void _es_shard_next(void);
+static BOOL _es_shard_get_key(ipc3_result_list_t *result_list,const void *buf,SIZE_T size,int is_64bit,SIZE_T *out_key_offset,SIZE_T *out_key_size);
+static BOOL _es_shard_is_last_row(ipc3_result_list_t *result_list,const void *pending_buf,SIZE_T pending_size,const void *next_buf,SIZE_T next_size,int is_64bit);
+static BYTE _es_compress_type_from_name(const wchar_t *name);
+static BOOL _es_compress_write_proc(void *user_data,const void *data,SIZE_T size);
+static DWORD WINAPI _es_compress_thread_proc(void *param);
+static void _es_compress_start(void);
+static void _es_compress_export_buffer(DWORD size);
+static void _es_compress_finish(void);
 static void _es_output_cell_csv_wchar_string(const wchar_t *s,int is_highlighted);
 static void _es_output_cell_csv_wchar_string_with_optional_quotes(int is_always_double_quote,int separator_ch,const wchar_t *s,int is_highlighted);
 static void _es_get_command_argv(wchar_buf_t *wcbuf);
@@ -277,6 +826,8 @@ static void _es_do_run_history_command(void);
 static BOOL _es_check_sorts(const wchar_t *argv);
 static void _es_wait_for_db_loaded(void);
 static void _es_wait_for_db_not_busy(void);
+static void _es_register_ipc_created_message(void);
+static DWORD _es_wait_backoff(DWORD tickstart,DWORD backoff);
 static BOOL _es_is_literal_switch(const wchar_t *s);
 static BOOL _es_should_quote(int separator_ch,const wchar_t *s);
 static BOOL _es_is_unbalanced_quotes(const wchar_t *s);
@@ -342,6 +893,25 @@ static HANDLE _es_export_file = INVALID_HANDLE_VALUE;
 static BYTE *_es_export_buf = 0;
 static BYTE *_es_export_p;
 static DWORD _es_export_avail = 0;
+static _es_tee_t *_es_tee_start = NULL;
+static _es_tee_t *_es_tee_last = NULL;
+static wchar_buf_t *_es_export_filename_wcbuf = NULL; // the main -export-* filename.
+static BYTE _es_shard_type = _ES_SHARD_TYPE_NONE;
+static ES_UINT64 _es_shard_limit = 0; // rows or bytes per shard.
+static DWORD _es_shard_property_id = EVERYTHING3_INVALID_PROPERTY_ID; // by=<property>
+static DWORD _es_shard_index = 0; // the open shard, starting at 1.
+static ES_UINT64 _es_shard_row_count = 0; // rows written to the open shard.
+static BYTE _es_compress_type = COMPRESS_TYPE_NONE;
+static int _es_compress_level = DEFLATE_DEFAULT_LEVEL;
+static compress_t *_es_compress = NULL; // only used by the compress thread while it's running.
+static HANDLE _es_compress_thread_handle = NULL;
+static HANDLE _es_compress_ready_event = NULL; // set when _es_compress_buf is ready to compress.
+static HANDLE _es_compress_idle_event = NULL; // set when the compress thread is waiting for the next buffer.
+static BYTE *_es_compress_buf = NULL; // the export buffer being compressed.
+static DWORD _es_compress_size = 0;
+static int _es_compress_is_stop = 0;
+static int _es_compress_is_error = 0; // set by the compress thread if a write failed.
+static DWORD _es_compress_last_error = 0;
 static char _es_size_leading_zero = 0; // depreciated.
 static char _es_run_count_leading_zero = 0; // depreciated
 static char _es_digit_grouping = 1;
@@ -393,11 +963,24 @@ static char _es_double_quote = 0; // always use double quotes for filenames.
 static char _es_csv_double_quote = 1; // always use double quotes for CSV for consistancy.
 static char _es_utf8_bom = 0;
 static wchar_buf_t *_es_search_wcbuf = NULL;
+static const wchar_t *_es_result_cache_path = NULL; // -result-cache folder, NULL if disabled.
+static DWORD _es_deadline = 0; // -deadline in milliseconds, 0 = no deadline.
+static DWORD _es_deadline_tickstart = 0;
+static volatile LONG _es_deadline_is_expired = 0;
+static int _es_deadline_is_reading = 0; // protected by _es_deadline_cs.
+static CRITICAL_SECTION _es_deadline_cs;
+static HANDLE _es_deadline_stop_event = NULL;
+static HANDLE _es_deadline_thread_handle = NULL;
+static HANDLE _es_deadline_main_thread_handle = NULL;
 static HWND _es_reply_hwnd = 0;
+static UINT _es_ipc_created_message = 0; // RegisterWindowMessage(EVERYTHING_IPC_CREATED)
+static char _es_ipc_created = 0; // set when we receive the EVERYTHING_IPC_CREATED notification.
 static char _es_loaded_appdata_ini = 0; // loaded settings from appdata, we should save to appdata.
 static column_t *_es_output_column = NULL; // current output column
+static const column_attribute_t *_es_output_column_attribute = NULL; // current output column attributes, parallel to _es_output_column.
 static SIZE_T _es_output_cell_overflow = 0;
 static char _es_is_in_header = 0;
+static char _es_is_diff_output = 0; // -diff-since rows have a change type before the cells.
 static char _es_no_default_filename_column = 0; // Don't automatically add the filename column.
 static char _es_no_default_size_column = 0; // EFU only
 static char _es_no_default_date_modified_column = 0; // EFU only
@@ -722,85 +1305,411 @@ static BOOL _es_ipc2_query(void)
 	return ret;
 }
 
-static BOOL _es_ipc3_query(void)
+// get the search flags for the current match options.
+static DWORD _es_ipc3_get_search_flags(void)
 {
-	BOOL ret;
-	HANDLE pipe_handle;
+	DWORD search_flags;
+
+#if SIZE_MAX == ES_UINT64_MAX
+
+	search_flags = IPC3_SEARCH_FLAG_64BIT;
+
+#elif SIZE_MAX == ES_DWORD_MAX
+
+	search_flags = 0;
+
+#else
+	#error unknown SIZE_MAX
+#endif
 	
-	ret = FALSE;
+	if (_es_match_case)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_CASE;
+	}
+	
+	if (_es_match_diacritics)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_DIACRITICS;
+	}
+	
+	if (_es_match_whole_word)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_WHOLEWORD;
+	}
+	
+	if (_es_match_path)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_PATH;
+	}
+	
+	if (_es_match_prefix)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_PREFIX;
+	}
+	
+	if (_es_match_suffix)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_MATCH_SUFFIX;
+	}
+	
+	if (_es_ignore_punctuation)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_IGNORE_PUNCTUATION;
+	}
+	
+	if (_es_ignore_whitespace)
+	{
+		search_flags |= IPC3_SEARCH_FLAG_IGNORE_WHITESPACE;
+	}
 
-	pipe_handle = ipc3_connect_pipe();
-	if (pipe_handle != INVALID_HANDLE_VALUE)
+	return search_flags;
+}
+
+// get the request flags for a property.
+static DWORD _es_ipc3_get_property_request_flags(DWORD property_id)
+{
+	DWORD property_request_flags;
+	
+	property_request_flags = 0;
+	
+	if (_es_highlight)
+	{	
+		switch(property_get_format(property_id))
+		{
+			case PROPERTY_FORMAT_TEXT8:
+			case PROPERTY_FORMAT_TEXT10:
+			case PROPERTY_FORMAT_TEXT12:
+			case PROPERTY_FORMAT_TEXT16:
+			case PROPERTY_FORMAT_TEXT24:
+			case PROPERTY_FORMAT_TEXT30:
+			case PROPERTY_FORMAT_TEXT32:
+			case PROPERTY_FORMAT_TEXT47:
+			case PROPERTY_FORMAT_TEXT48:
+			case PROPERTY_FORMAT_TEXT64:
+			case PROPERTY_FORMAT_EXTENSION:
+			case PROPERTY_FORMAT_FORMATTED_TEXT8:
+			case PROPERTY_FORMAT_FORMATTED_TEXT12:
+			case PROPERTY_FORMAT_FORMATTED_TEXT16:
+			case PROPERTY_FORMAT_FORMATTED_TEXT24:
+			case PROPERTY_FORMAT_FORMATTED_TEXT32:
+				property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT;
+				break;
+		}
+	}
+	
+	// these properties are normally integers.
+	// but we don't want to have to deal with formatting them in ES.
+	// so just request preformatted strings from Everything.
+	// eg: file-signature: a integer value of 10 = image/png
+	switch(property_get_format(property_id))
 	{
-		DWORD search_flags;
-		utf8_buf_t search_cbuf;
-		utf8_buf_t packet_cbuf;
-		SIZE_T packet_size;
-		SIZE_T search_sort_count;
-		SIZE_T search_property_request_count;
+		case PROPERTY_FORMAT_FORMATTED_TEXT8:
+		case PROPERTY_FORMAT_FORMATTED_TEXT12:
+		case PROPERTY_FORMAT_FORMATTED_TEXT16:
+		case PROPERTY_FORMAT_FORMATTED_TEXT24:
+		case PROPERTY_FORMAT_FORMATTED_TEXT32:
+			// maybe an option to export raw values?
+			property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT;
+			break;
+			
+		case PROPERTY_FORMAT_NONE:
+			if (_es_export_type == _ES_EXPORT_TYPE_NONE)
+			{
+				property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT;
+			}
+			break;
+	}
+	
+	return property_request_flags;
+}
 
-		utf8_buf_init(&search_cbuf);
-		utf8_buf_init(&packet_cbuf);
+// build a search request packet with the current search text and sort.
+// returns the size of the packet in bytes.
+static SIZE_T _es_ipc3_build_search_packet(DWORD search_flags,SIZE_T viewport_offset,SIZE_T viewport_count,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count,utf8_buf_t *out_packet_cbuf)
+{
+	utf8_buf_t search_cbuf;
+	SIZE_T packet_size;
+	SIZE_T search_sort_count;
 	
-		utf8_buf_copy_wchar_string(&search_cbuf,_es_search_wcbuf->buf);
+	utf8_buf_init(&search_cbuf);
 
-#if SIZE_MAX == ES_UINT64_MAX
+	utf8_buf_copy_wchar_string(&search_cbuf,_es_search_wcbuf->buf);
 
-		search_flags = IPC3_SEARCH_FLAG_64BIT;
+	search_sort_count = 1 + secondary_sort_array->count;
+	
+	// search_flags
+	packet_size = sizeof(DWORD);
+	
+	// search_len
+	packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,search_cbuf.length_in_bytes));
+	
+	// search_text
+	packet_size = safe_size_add(packet_size,search_cbuf.length_in_bytes);
 
-#elif SIZE_MAX == ES_DWORD_MAX
+	// view port offset
+	packet_size = safe_size_add(packet_size,sizeof(SIZE_T));
+	packet_size = safe_size_add(packet_size,sizeof(SIZE_T));
 
-		search_flags = 0;
+	// sort
+	packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,search_sort_count));
+	packet_size = safe_size_add(packet_size,safe_size_mul(search_sort_count,sizeof(ipc3_search_sort_t)));
+
+	// property request 
+	packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,property_request_count));
+	packet_size = safe_size_add(packet_size,safe_size_mul(property_request_count,sizeof(ipc3_search_property_request_t)));
 	
-#else
-		#error unknown SIZE_MAX
-#endif
-		
-		if (_es_match_case)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_CASE;
-		}
-		
-		if (_es_match_diacritics)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_DIACRITICS;
-		}
-		
-		if (_es_match_whole_word)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_WHOLEWORD;
-		}
+	// allocate packet.
+	utf8_buf_grow_size(out_packet_cbuf,packet_size);
+	
+	// write packet.
+	{
+		BYTE *packet_d;
 		
-		if (_es_match_path)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_PATH;
-		}
+		packet_d = (BYTE *)out_packet_cbuf->buf;
 		
-		if (_es_match_prefix)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_PREFIX;
-		}
+		// search flags
+		packet_d = _es_copy_dword(packet_d,search_flags);
 		
-		if (_es_match_suffix)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_MATCH_SUFFIX;
-		}
+		// search text
+		packet_d = ipc3_copy_len_vlq(packet_d,search_cbuf.length_in_bytes);
+		packet_d = os_copy_memory(packet_d,search_cbuf.buf,search_cbuf.length_in_bytes);
+
+		// viewport
+		packet_d = _es_copy_size_t(packet_d,viewport_offset);
+		packet_d = _es_copy_size_t(packet_d,viewport_count);
+
+		// primary sort
 		
-		if (_es_ignore_punctuation)
-		{
-			search_flags |= IPC3_SEARCH_FLAG_IGNORE_PUNCTUATION;
-		}
+		packet_d = ipc3_copy_len_vlq(packet_d,search_sort_count);
+
+		packet_d = _es_copy_dword(packet_d,_es_primary_sort_property_id);
+		packet_d = _es_copy_dword(packet_d,_es_resolve_sort_ascending(_es_primary_sort_property_id,_es_primary_sort_ascending) ? 0 : IPC3_SEARCH_SORT_FLAG_DESCENDING);
+
+		// secondary sort.
 		
-		if (_es_ignore_whitespace)
 		{
-			search_flags |= IPC3_SEARCH_FLAG_IGNORE_WHITESPACE;
+			secondary_sort_t *secondary_sort;
+			
+			secondary_sort = secondary_sort_start;
+			
+			while(secondary_sort)
+			{
+				packet_d = _es_copy_dword(packet_d,secondary_sort->property_id);
+				packet_d = _es_copy_dword(packet_d,_es_resolve_sort_ascending(secondary_sort->property_id,secondary_sort->ascending) ? 0 : IPC3_SEARCH_SORT_FLAG_DESCENDING);
+				
+				secondary_sort = secondary_sort->next;
+			}
 		}
 
-		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		// property requests
+		packet_d = ipc3_copy_len_vlq(packet_d,property_request_count);
+
 		{
-			int is_size_indexed;
-			int is_date_modified_indexed;
-			int is_date_created_indexed;
+			SIZE_T property_request_run;
+			const ipc3_search_property_request_t *property_request_p;
+			
+			property_request_p = property_request_array;
+			property_request_run = property_request_count;
+			
+			while(property_request_run)
+			{
+				packet_d = _es_copy_dword(packet_d,property_request_p->property_id);
+				packet_d = _es_copy_dword(packet_d,property_request_p->flags);
+				
+				property_request_p++;
+				property_request_run--;
+			}
+		}
+
+		DEBUG_ASSERT((packet_d - (BYTE *)out_packet_cbuf->buf) == packet_size);
+	}
+
+	utf8_buf_kill(&search_cbuf);
+	
+	return packet_size;
+}
+
+// send a search request with the current search text and sort.
+// returns TRUE if the request was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_write_search(HANDLE pipe_handle,DWORD search_flags,SIZE_T viewport_offset,SIZE_T viewport_count,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count)
+{
+	BOOL ret;
+	utf8_buf_t packet_cbuf;
+	SIZE_T packet_size;
+	
+	ret = FALSE;
+
+	utf8_buf_init(&packet_cbuf);
+	
+	packet_size = _es_ipc3_build_search_packet(search_flags,viewport_offset,viewport_count,property_request_array,property_request_count,&packet_cbuf);
+
+	// send the search query packet
+	if (ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
+	{
+		ret = TRUE;
+	}
+
+	utf8_buf_kill(&packet_cbuf);
+	
+	return ret;
+}
+
+// send a search and setup the stream to read the reply.
+// with -result-cache, the reply is read from the cache if the journal has not moved.
+// Otherwise, the whole reply is read into memory so it can be saved to the cache.
+// returns TRUE if the search was sent or the reply was found in the cache.
+// Otherwise, returns FALSE.
+// the reply should be closed with _es_ipc3_reply_close.
+static BOOL _es_ipc3_reply_open(_es_ipc3_reply_t *reply,HANDLE pipe_handle,DWORD search_flags,const ipc3_search_property_request_t *property_request_array,SIZE_T property_request_count)
+{
+	BOOL ret;
+	utf8_buf_t packet_cbuf;
+	SIZE_T packet_size;
+	ipc3_journal_info_t journal_info;
+	int got_journal_info;
+	
+	ret = FALSE;
+	got_journal_info = 0;
+	
+	reply->stream = NULL;
+	reply->file_handle = INVALID_HANDLE_VALUE;
+	reply->is_pool_stream = 0;
+
+	utf8_buf_init(&packet_cbuf);
+	
+	packet_size = _es_ipc3_build_search_packet(search_flags,safe_size_from_uint64(_es_offset),safe_size_from_uint64(_es_max_results),property_request_array,property_request_count,&packet_cbuf);
+
+	if (_es_result_cache_path)
+	{
+		// the cache can't be used without the journal.
+		if (ipc3_ioctl_expect_output_size(pipe_handle,IPC3_COMMAND_GET_JOURNAL_INFO,NULL,0,&journal_info,sizeof(ipc3_journal_info_t)))
+		{
+			got_journal_info = 1;
+			
+			reply->file_handle = result_cache_open(_es_result_cache_path,packet_cbuf.buf,packet_size,&journal_info);
+			
+			if (reply->file_handle != INVALID_HANDLE_VALUE)
+			{
+				ipc3_stream_file_init(&reply->file_stream,reply->file_handle);
+				
+				reply->stream = (ipc3_stream_t *)&reply->file_stream;
+				
+				ret = TRUE;
+			}
+		}
+	}
+
+	if (!ret)
+	{
+		// send the search query packet
+		if (ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
+		{
+			// initialize the stream that we will use to read the reply from the pipe.
+			// stream will be x86 by default.
+			ipc3_stream_pipe_init(&reply->pipe_stream,pipe_handle);
+			
+			reply->stream = (ipc3_stream_t *)&reply->pipe_stream;
+			
+			if (got_journal_info)
+			{
+				ipc3_stream_pool_init(&reply->pool_stream,(ipc3_stream_t *)&reply->pipe_stream);
+				
+				reply->is_pool_stream = 1;
+				reply->stream = (ipc3_stream_t *)&reply->pool_stream;
+				
+				ipc3_stream_pool_read_all(&reply->pool_stream);
+				
+				// don't cache errors.
+				if (!reply->pool_stream.base.is_error)
+				{
+					result_cache_save(_es_result_cache_path,packet_cbuf.buf,packet_size,&journal_info,&reply->pool_stream);
+				}
+			}
+			
+			ret = TRUE;
+		}
+	}
+
+	utf8_buf_kill(&packet_cbuf);
+	
+	return ret;
+}
+
+static void _es_ipc3_reply_close(_es_ipc3_reply_t *reply)
+{
+	if (reply->file_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_stream_close((ipc3_stream_t *)&reply->file_stream);
+		CloseHandle(reply->file_handle);
+	}
+	else
+	{
+		if (reply->is_pool_stream)
+		{
+			ipc3_stream_close((ipc3_stream_t *)&reply->pool_stream);
+		}
+		
+		ipc3_stream_close((ipc3_stream_t *)&reply->pipe_stream);
+	}
+}
+
+// allocate a property request for each column, in column order.
+// returns NULL if there are no columns.
+// the caller should free the returned array with mem_free.
+static ipc3_search_property_request_t *_es_ipc3_alloc_property_request_array(SIZE_T *out_property_request_count)
+{
+	ipc3_search_property_request_t *property_request_array;
+	
+	property_request_array = NULL;
+	
+	if (column_array->count)
+	{
+		ipc3_search_property_request_t *property_request_d;
+		column_t *column;
+		
+		property_request_array = mem_alloc(safe_size_mul(column_array->count,sizeof(ipc3_search_property_request_t)));
+		
+		property_request_d = property_request_array;
+		column = column_order_start;
+		
+		while(column)
+		{
+			property_request_d->property_id = column->property_id;
+			property_request_d->flags = _es_ipc3_get_property_request_flags(column->property_id);
+			
+			property_request_d++;
+			column = column->order_next;
+		}
+	}
+	
+	*out_property_request_count = column_array->count;
+	
+	return property_request_array;
+}
+
+static BOOL _es_ipc3_query(void)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		DWORD search_flags;
+		ipc3_search_property_request_t *property_request_array;
+		SIZE_T property_request_count;
+		_es_ipc3_reply_t reply;
+
+		search_flags = _es_ipc3_get_search_flags();
+
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			int is_size_indexed;
+			int is_date_modified_indexed;
+			int is_date_created_indexed;
 			int is_attributes_indexed;
 			
 			is_size_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_SIZE);
@@ -832,500 +1741,6247 @@ static BOOL _es_ipc3_query(void)
 			search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
 		}
 		
-		search_sort_count = 1 + secondary_sort_array->count;
-		search_property_request_count = column_array->count;
-		
-		// search_flags
-		packet_size = sizeof(DWORD);
-		
-		// search_len
-		packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,search_cbuf.length_in_bytes));
-		
-		// search_text
-		packet_size = safe_size_add(packet_size,search_cbuf.length_in_bytes);
-
-		// view port offset
-		packet_size = safe_size_add(packet_size,sizeof(SIZE_T));
-		packet_size = safe_size_add(packet_size,sizeof(SIZE_T));
-
-		// sort
-		packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,search_sort_count));
-		packet_size = safe_size_add(packet_size,safe_size_mul(search_sort_count,sizeof(ipc3_search_sort_t)));
-
-		// property request 
-		packet_size = safe_size_add(packet_size,(SIZE_T)ipc3_copy_len_vlq(NULL,search_property_request_count));
-		packet_size = safe_size_add(packet_size,safe_size_mul(search_property_request_count,sizeof(ipc3_search_property_request_t)));
+		property_request_array = _es_ipc3_alloc_property_request_array(&property_request_count);
 		
-		// allocate packet.
-		utf8_buf_grow_size(&packet_cbuf,packet_size);
+		// the deadline can cancel the search.
+		_es_deadline_start();
+		_es_deadline_set_is_reading(1);
 		
-		// write packet.
+		// send the search query packet
+		// or read the reply from the result cache.
+		if (_es_ipc3_reply_open(&reply,pipe_handle,search_flags,property_request_array,property_request_count))
 		{
-			BYTE *packet_d;
-			
-			packet_d = (BYTE *)packet_cbuf.buf;
+			ipc3_stream_pool_t memory_stream;
+			ipc3_result_list_t result_list;
+			int got_memory_stream;
 			
-			// search flags
-			packet_d = _es_copy_dword(packet_d,search_flags);
+			got_memory_stream = 0;
 			
-			// search text
-			packet_d = ipc3_copy_len_vlq(packet_d,search_cbuf.length_in_bytes);
-			packet_d = os_copy_memory(packet_d,search_cbuf.buf,search_cbuf.length_in_bytes);
-
-			// viewport
-			packet_d = _es_copy_size_t(packet_d,safe_size_from_uint64(_es_offset));
-			packet_d = _es_copy_size_t(packet_d,safe_size_from_uint64(_es_max_results));
+			// we are committed to ipc3
+			// if we are exporting as EFU, make sure the attribute column is shown.
+			// but don't allow reordering.
+			if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+			{
+				_es_add_standard_efu_columns(0,0,0,1,0);
+			}
 
-			// primary sort
+			// setup our initial result list from the stream.
+			// don't read any items yet.
+			ipc3_result_list_init(&result_list,reply.stream);
 			
-			packet_d = ipc3_copy_len_vlq(packet_d,search_sort_count);
-
-			packet_d = _es_copy_dword(packet_d,_es_primary_sort_property_id);
-			packet_d = _es_copy_dword(packet_d,_es_resolve_sort_ascending(_es_primary_sort_property_id,_es_primary_sort_ascending) ? 0 : IPC3_SEARCH_SORT_FLAG_DESCENDING);
-
-			// secondary sort.
+			_es_deadline_set_is_reading(0);
 			
+			if (_es_no_result_error)
 			{
-				secondary_sort_t *secondary_sort;
-				
-				secondary_sort = secondary_sort_start;
-				
-				while(secondary_sort)
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
 				{
-					packet_d = _es_copy_dword(packet_d,secondary_sort->property_id);
-					packet_d = _es_copy_dword(packet_d,_es_resolve_sort_ascending(secondary_sort->property_id,secondary_sort->ascending) ? 0 : IPC3_SEARCH_SORT_FLAG_DESCENDING);
-					
-					secondary_sort = secondary_sort->next;
+					_es_ret = ES_ERROR_NO_RESULTS;
 				}
 			}
-
-			// property requests
-			packet_d = ipc3_copy_len_vlq(packet_d,search_property_request_count);
-
+			
+			if (_es_get_result_count)
 			{
-				column_t *column;
-				
-				column = column_order_start;
-				
-				while(column)
+				_es_output_noncell_result_count(result_list.folder_result_count + result_list.file_result_count);
+			}
+			else
+			if (_es_get_total_size)
+			{
+				_es_output_noncell_total_size(result_list.total_result_size);
+			}
+			else
+			{
+				if (_es_pause)
 				{
-					DWORD property_request_flags;
+					// setup a pool stream.
+					// we read the entire stream into memory as it gets accessed.
+					// we store the stream position for each item index so we can quickly jump to a location.
+					ipc3_stream_pool_init(&memory_stream,reply.stream);
 					
-					property_request_flags = 0;
+					got_memory_stream = 1;
 					
-					if (_es_highlight)
-					{	
-						switch(property_get_format(column->property_id))
-						{
-							case PROPERTY_FORMAT_TEXT8:
-							case PROPERTY_FORMAT_TEXT10:
-							case PROPERTY_FORMAT_TEXT12:
-							case PROPERTY_FORMAT_TEXT16:
-							case PROPERTY_FORMAT_TEXT24:
-							case PROPERTY_FORMAT_TEXT30:
-							case PROPERTY_FORMAT_TEXT32:
-							case PROPERTY_FORMAT_TEXT47:
-							case PROPERTY_FORMAT_TEXT48:
-							case PROPERTY_FORMAT_TEXT64:
-							case PROPERTY_FORMAT_EXTENSION:
-							case PROPERTY_FORMAT_FORMATTED_TEXT8:
-							case PROPERTY_FORMAT_FORMATTED_TEXT12:
-							case PROPERTY_FORMAT_FORMATTED_TEXT16:
-							case PROPERTY_FORMAT_FORMATTED_TEXT24:
-							case PROPERTY_FORMAT_FORMATTED_TEXT32:
-								property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT;
-								break;
-						}
-					}
+					// set the pool stream as the main stream.
+					result_list.stream = (ipc3_stream_t *)&memory_stream;
 					
-					// these properties are normally integers.
-					// but we don't want to have to deal with formatting them in ES.
-					// so just request preformatted strings from Everything.
-					// eg: file-signature: a integer value of 10 = image/png
-					switch(property_get_format(column->property_id))
+					// allocate index to stream offset array.
+					// index_to_stream_offset_valid_count will still be zero.
+					if (result_list.viewport_count)
 					{
-						case PROPERTY_FORMAT_FORMATTED_TEXT8:
-						case PROPERTY_FORMAT_FORMATTED_TEXT12:
-						case PROPERTY_FORMAT_FORMATTED_TEXT16:
-						case PROPERTY_FORMAT_FORMATTED_TEXT24:
-						case PROPERTY_FORMAT_FORMATTED_TEXT32:
-							// maybe an option to export raw values?
-							property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT;
-							break;
-							
-						case PROPERTY_FORMAT_NONE:
-							if (_es_export_type == _ES_EXPORT_TYPE_NONE)
-							{
-								property_request_flags |= IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT;
-							}
-							break;
+						result_list.index_to_stream_offset_array = mem_alloc(safe_size_mul(result_list.viewport_count,sizeof(SIZE_T)));
 					}
 					
-					packet_d = _es_copy_dword(packet_d,column->property_id);
-					packet_d = _es_copy_dword(packet_d,property_request_flags);
-					
-					column = column->order_next;
-				}
-			}
-
-			DEBUG_ASSERT((packet_d - (BYTE *)packet_cbuf.buf) == packet_size);
-			
-			// send the search query packet
-			if (ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
-			{
-				ipc3_stream_pipe_t pipe_stream;
-				ipc3_stream_pool_t memory_stream;
-				ipc3_result_list_t result_list;
-				int got_memory_stream;
-				
-				got_memory_stream = 0;
-				
-				// we are committed to ipc3
-				// if we are exporting as EFU, make sure the attribute column is shown.
-				// but don't allow reordering.
-				if (_es_export_type == _ES_EXPORT_TYPE_EFU)
-				{
-					_es_add_standard_efu_columns(0,0,0,1,0);
-				}
-
-				// initialize the stream that we will use to read the reply from the pipe.
-				// stream will be x86 by default.
-				ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
-				
-				// setup our initial result list from the stream.
-				// don't read any items yet.
-				ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
-				
-				if (_es_no_result_error)
-				{
-					if (result_list.folder_result_count + result_list.file_result_count == 0)
-					{
-						_es_ret = ES_ERROR_NO_RESULTS;
-					}
-				}
-				
-				if (_es_get_result_count)
-				{
-					_es_output_noncell_result_count(result_list.folder_result_count + result_list.file_result_count);
+					// output the pause stream.
+					_es_output_pause(ES_IPC_VERSION_FLAG_IPC3,&result_list);
 				}
 				else
-				if (_es_get_total_size)
+				if ((_es_deadline) || (_es_tee_start) || (_es_shard_type != _ES_SHARD_TYPE_NONE))
 				{
-					_es_output_noncell_total_size(result_list.total_result_size);
+					// each result is recorded before it is output.
+					_es_output_ipc3_results_before_deadline(&result_list);
 				}
 				else
 				{
-					if (_es_pause)
+					SIZE_T total_item_count;
+					
+					total_item_count = result_list.viewport_count;
+					if (_es_header > 0)
 					{
-						// setup a pool stream.
-						// we read the entire stream into memory as it gets accessed.
-						// we store the stream position for each item index so we can quickly jump to a location.
-						ipc3_stream_pool_init(&memory_stream,(ipc3_stream_t *)&pipe_stream);
-						
-						got_memory_stream = 1;
-						
-						// set the pool stream as the main stream.
-						result_list.stream = (ipc3_stream_t *)&memory_stream;
-						
-						// allocate index to stream offset array.
-						// index_to_stream_offset_valid_count will still be zero.
-						if (result_list.viewport_count)
-						{
-							result_list.index_to_stream_offset_array = mem_alloc(safe_size_mul(result_list.viewport_count,sizeof(SIZE_T)));
-						}
-						
-						// output the pause stream.
-						_es_output_pause(ES_IPC_VERSION_FLAG_IPC3,&result_list);
+						total_item_count = safe_size_add_one(total_item_count);
 					}
-					else
+					
+					if (_es_footer > 0)
 					{
-						SIZE_T total_item_count;
-						
-						total_item_count = result_list.viewport_count;
-						if (_es_header > 0)
-						{
-							total_item_count = safe_size_add_one(total_item_count);
-						}
-						
-						if (_es_footer > 0)
-						{
-							total_item_count = safe_size_add_one(total_item_count);
-						}
-						
-						_es_output_ipc3_results(&result_list,0,total_item_count);
+						total_item_count = safe_size_add_one(total_item_count);
 					}
+					
+					_es_output_ipc3_results(&result_list,0,total_item_count);
 				}
+			}
 
-				if (result_list.stream->is_error)
+			if (result_list.stream->is_error)
+			{
+				if (_es_deadline_is_expired)
 				{
-					_es_ret = ES_ERROR_IPC_ERROR;
+					// the deadline cancelled reading the reply.
+					_es_ret = ES_ERROR_DEADLINE_EXPIRED;
 				}
-					
-				// don't try to process ipc2 or ipc1 if we sent the request successfully.
-				ret = TRUE;
-				
-				if (got_memory_stream)
+				else
 				{
-					ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+					_es_ret = ES_ERROR_IPC_ERROR;
 				}
-
-				ipc3_result_list_kill(&result_list);
-				ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
 			}
+				
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			if (got_memory_stream)
+			{
+				ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+			}
+
+			ipc3_result_list_kill(&result_list);
+			_es_ipc3_reply_close(&reply);
+		}
+		
+		_es_deadline_stop();
+		
+		if (property_request_array)
+		{
+			mem_free(property_request_array);
 		}
-	
-		utf8_buf_kill(&packet_cbuf);
-		utf8_buf_kill(&search_cbuf);
 
+		// closing the pipe cancels the search if the deadline expired.
 		CloseHandle(pipe_handle);
 	}
 
 	return ret;
 }
 
-static int _es_compare_list_items(const EVERYTHING_IPC_ITEM *a,const EVERYTHING_IPC_ITEM *b)
+// get the text for a -diff-since change type.
+static const ES_UTF8 *_es_diff_change_type_get_text(DWORD type)
 {
-	int cmp_ret;
+	switch(type)
+	{
+		case DIFF_CHANGE_TYPE_ADDED:
+			return "Added";
+			
+		case DIFF_CHANGE_TYPE_REMOVED:
+			return "Removed";
+			
+		case DIFF_CHANGE_TYPE_MODIFIED:
+			return "Modified";
+	}
+	
+	return "";
+}
 
-	// folders first.
-	if (a->flags & EVERYTHING_IPC_FOLDER)
+// output the change type of a -diff-since row before the cells.
+// the change type isn't a property, so it doesn't take over a column.
+// m3u files can only hold paths, so the change type is not shown.
+static void _es_output_change_field(const ES_UTF8 *text)
+{
+	if ((_es_export_type == _ES_EXPORT_TYPE_M3U) || (_es_export_type == _ES_EXPORT_TYPE_M3U8))
 	{
-		if (b->flags & EVERYTHING_IPC_FOLDER)
-		{
-			// both folders.
-			// fall through.
-		}
-		else
-		{
-			// A<B
-			return -1;
-		}
+		return;
+	}
+	
+	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+	{
+		_es_output_noncell_printf("\"change\":\"%s\"",text);
 	}
 	else
+	if ((_es_export_type == _ES_EXPORT_TYPE_CSV) || (_es_export_type == _ES_EXPORT_TYPE_TSV) || (_es_export_type == _ES_EXPORT_TYPE_EFU))
 	{
-		if (b->flags & EVERYTHING_IPC_FOLDER)
-		{
-			// A>B
-			return 1;
-		}
-		else
-		{
-			// both files
-			// fall through.
-		}
+		_es_output_noncell_utf8_string(text);
+	}
+	else
+	{
+		// pad to the longest change type so the cells line up.
+		_es_output_noncell_printf("%-8s",text);
 	}
 	
-	cmp_ret = CompareString(LOCALE_USER_DEFAULT,NORM_IGNORECASE,EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),-1,EVERYTHING_IPC_ITEMPATH(_es_sort_list,b),-1);
-	
-//debug_printf("cmp %S %S %d\n",EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),EVERYTHING_IPC_ITEMPATH(_es_sort_list,b),cmp_ret)	;
-
-	if (cmp_ret)
+	if (column_order_start)
 	{
-		if (cmp_ret == CSTR_LESS_THAN)
-		{
-			return -1;
-		}
-		else
-		if (cmp_ret == CSTR_GREATER_THAN)
-		{
-			return 1;
-		}
+		_es_output_noncell_utf8_string(_es_get_cell_separator_text());
 	}
-
-	return wchar_string_compare(EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),EVERYTHING_IPC_ITEMPATH(_es_sort_list,b));
 }
 
-void DECLSPEC_NORETURN es_fatal(int error_code)
+// returns TRUE if the property is stored in a -diff-since or -view snapshot.
+// Otherwise, returns FALSE.
+static BOOL _es_is_diff_item_property(DWORD property_id)
 {
-	const char *msg;
-	int show_help;
-	
-	_es_flush_export_buffer();
-
-	if (_es_export_file != INVALID_HANDLE_VALUE)
+	switch(property_id)
 	{
-		CloseHandle(_es_export_file);
-		
-		_es_export_file = INVALID_HANDLE_VALUE;
+		case EVERYTHING3_PROPERTY_ID_FULL_PATH:
+		case EVERYTHING3_PROPERTY_ID_NAME:
+		case EVERYTHING3_PROPERTY_ID_PATH:
+		case EVERYTHING3_PROPERTY_ID_SIZE:
+		case EVERYTHING3_PROPERTY_ID_DATE_MODIFIED:
+		case EVERYTHING3_PROPERTY_ID_ATTRIBUTES:
+			return TRUE;
 	}
 	
-	msg = 0;
-	show_help = 0;
+	return FALSE;
+}
 
-	switch(error_code)
+// output the cell for the current column from a snapshot item.
+// only the columns allowed by _es_is_diff_item_property are stored in a snapshot.
+static void _es_output_diff_item_cell(const diff_item_t *item,utf8_buf_t *path_cbuf)
+{
+	switch(_es_output_column->property_id)
 	{
-		case ES_ERROR_REGISTER_WINDOW_CLASS:
-			msg = "Failed to register window class.\r\n";
-			break;
+		case EVERYTHING3_PROPERTY_ID_FULL_PATH:
+		
+			utf8_buf_copy_utf8_string_n(path_cbuf,DIFF_ITEM_PATH(item),item->path_len);
 			
-		case ES_ERROR_CREATE_WINDOW:
-			msg = "Failed to create window.\r\n";
-			break;
+			// append slash
+			if (_es_folder_append_path_separator)
+			{
+				if (item->flags & DIFF_ITEM_FLAG_FOLDER)
+				{
+					utf8_buf_cat_path_separator(path_cbuf);
+				}
+			}
 			
-		case ES_ERROR_OUT_OF_MEMORY:
-			msg = "Out of memory.\r\n";
+			_es_output_cell_text_property_utf8_string_n(path_cbuf->buf,path_cbuf->length_in_bytes);
 			break;
 			
-		case ES_ERROR_EXPECTED_SWITCH_PARAMETER:
-			msg = "Expected switch parameter.\r\n";
-			// this error is permanent, show help:
-			show_help = 1;
+		case EVERYTHING3_PROPERTY_ID_NAME:
+			_es_output_cell_text_property_utf8_string(_es_diff_item_get_name(item));
 			break;
 			
-		case ES_ERROR_CREATE_FILE:
-			msg = "Failed to create output file.\r\n";
+		case EVERYTHING3_PROPERTY_ID_PATH:
+		
+			{
+				const ES_UTF8 *name;
+				SIZE_T path_len;
+				
+				name = _es_diff_item_get_name(item);
+				
+				// exclude the trailing path separator.
+				path_len = name - DIFF_ITEM_PATH(item);
+				if (path_len)
+				{
+					path_len--;
+				}
+				
+				_es_output_cell_text_property_utf8_string_n(DIFF_ITEM_PATH(item),path_len);
+			}
+			
 			break;
 			
-		case ES_ERROR_UNKNOWN_SWITCH:
-			msg = "Unknown switch.\r\n";
-			// this error is permanent, show help:
-			show_help = 1;
+		case EVERYTHING3_PROPERTY_ID_SIZE:
+			_es_output_cell_size_property(item->size);
 			break;
 			
-		case ES_ERROR_IPC_ERROR:
-			msg = "Unable to send IPC message or bad IPC reply.\r\n";
+		case EVERYTHING3_PROPERTY_ID_DATE_MODIFIED:
+			_es_output_cell_filetime_property(item->date_modified);
 			break;
 			
-		case ES_ERROR_NO_IPC:
-			msg = "Everything IPC not found. Please make sure Everything is running.\r\n";
+		case EVERYTHING3_PROPERTY_ID_ATTRIBUTES:
+			_es_output_cell_attribute_property(item->flags & DIFF_ITEM_FLAG_FOLDER ? FILE_ATTRIBUTE_DIRECTORY : 0);
 			break;
 			
-		case ES_ERROR_NO_RESULTS:
-			msg = "No results found.\r\n";
+		default:
+			_es_output_cell_unknown_property();
 			break;
 	}
+
+}
+
+// output the changes from a -diff-since query.
+// changes are sorted by path.
+static void _es_output_diff_changes(const array_t *change_array)
+{
+	SIZE_T index;
+	SIZE_T run;
+	int is_first_line;
+	utf8_buf_t path_cbuf;
 	
-	if (msg)
+	utf8_buf_init(&path_cbuf);
+	
+	_es_is_diff_output = 1;
+	
+	_es_output_page_begin();
+
+	if (_es_header > 0)
 	{
-		os_error_printf("Error %d: %s",error_code,msg);
+		_es_output_header();
 	}
 	
-	if (show_help)
+	index = safe_size_from_uint64(_es_offset);
+	if (index > change_array->count)
 	{
-		_es_help();
+		index = change_array->count;
 	}
-
-	ExitProcess(error_code);
-}
-
-static void DECLSPEC_NORETURN _es_bad_switch_param(const char *format,...)
-{
-	va_list argptr;
-	utf8_buf_t cbuf;
-
-	va_start(argptr,format);
-	utf8_buf_init(&cbuf);
-
-	utf8_buf_vprintf(&cbuf,format,argptr);
-
-	os_error_printf("Error %d: %s",ES_ERROR_EXPECTED_SWITCH_PARAMETER,cbuf.buf);
-
-	utf8_buf_kill(&cbuf);
-	va_end(argptr);
-
-	ExitProcess(ES_ERROR_EXPECTED_SWITCH_PARAMETER);
-}
-
-static void _es_console_fill(SIZE_T count,int ascii_ch)
-{
-	if (_es_output_cibuf)
+	
+	run = change_array->count - index;
+	if (run > safe_size_from_uint64(_es_max_results))
 	{
-		SIZE_T i;
-		
-		for(i=0;i<count;i++)
-		{
-			if ((int)i + _es_output_cibuf_x >= _es_console_window_wide)
-			{
-				break;
-			}
-
-			if ((int)i + _es_output_cibuf_x >= 0)
-			{
-				_es_output_cibuf[(int)i+_es_output_cibuf_x].Attributes = _es_output_color;
-				_es_output_cibuf[(int)i+_es_output_cibuf_x].Char.UnicodeChar = ascii_ch;
-			}
-		}
-		
-		_es_output_cibuf_x += (int)count;
+		run = safe_size_from_uint64(_es_max_results);
 	}
-	else
-	if (_es_output_is_char)
+	
+	is_first_line = 1;
+	
+	while(run)
 	{
-		wchar_buf_t wcbuf;
-		wchar_t *d;
-		DWORD numwritten;
-		SIZE_T i;
+		const diff_change_t *change;
 		
-		wchar_buf_init(&wcbuf);
-
-		wchar_buf_grow_size(&wcbuf,count);
-
-		d = wcbuf.buf;
+		change = change_array->indexes[index];
+	
+		_es_output_line_begin(is_first_line);
 		
-		for(i=0;i<count;i++)
-		{
-			*d++ = ascii_ch;
-		}
-
-		if (count <= ES_DWORD_MAX)
-		{
-			WriteConsole(_es_output_handle,wcbuf.buf,(DWORD)count,&numwritten,0);
-		}
+		_es_output_change_field(_es_diff_change_type_get_text(change->type));
 		
-		wchar_buf_kill(&wcbuf);
-	}
-	else
-	{
-		utf8_buf_t cbuf;
-		BYTE *d;
-		DWORD numwritten;
-		SIZE_T i;
+		_es_output_column = column_order_start;
+		_es_output_column_attribute = column_attribute_array;
 		
-		utf8_buf_init(&cbuf);
+		while(_es_output_column)
+		{
+			_es_output_cell_separator();
 
-		utf8_buf_grow_size(&cbuf,count);
+			_es_output_diff_item_cell(change->item,&path_cbuf);
 
-		d = cbuf.buf;
-		
-		for(i=0;i<count;i++)
-		{
-			*d++ = ascii_ch;
+			_es_output_column = _es_output_column->order_next;
+			_es_output_column_attribute++;
 		}
+		
+		index++;
+		run--;
 
-		if (count <= ES_DWORD_MAX)
-		{
-			WriteFile(_es_output_handle,cbuf.buf,(DWORD)count,&numwritten,0);
-		}
+		_es_output_line_end(run ? 1 : 0);
 		
-		utf8_buf_kill(&cbuf);
+		is_first_line = 0;
+	}
+	
+	if (_es_footer > 0)
+	{
+		_es_output_footer(change_array->count,ES_UINT64_MAX);
 	}
+
+	_es_output_page_end();
+	
+	_es_is_diff_output = 0;
+	
+	utf8_buf_kill(&path_cbuf);
 }
 
-// get the length in wchars from a wchar string.
-static SIZE_T _es_highlighted_wchar_string_get_length_in_wchars(const wchar_t *s)
+// read every result from a result list into a snapshot.
+// the list is not sorted.
+// stops on a read error, check result_list->stream->is_error.
+static void _es_ipc3_read_diff_list(ipc3_result_list_t *result_list,diff_list_t *list)
 {
-	const wchar_t *p;
-	SIZE_T len;
+	utf8_buf_t path_cbuf;
+	SIZE_T result_run;
+	const ipc3_result_list_property_request_t *result_property_request_array;
 	
-	len = 0;
-	p = s;
-	while(*p)
+	utf8_buf_init(&path_cbuf);
+	
+	result_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
 	{
-		if (*p == '*')
+		BYTE item_flags;
+		ES_UINT64 size;
+		ES_UINT64 date_modified;
+		SIZE_T property_request_run;
+		const ipc3_result_list_property_request_t *property_request_p;
+		
+		size = ES_UINT64_MAX;
+		date_modified = ES_UINT64_MAX;
+		utf8_buf_empty(&path_cbuf);
+		
+		item_flags = ipc3_stream_read_byte(result_list->stream);
+		
+		property_request_run = result_list->property_request_count;
+		property_request_p = result_property_request_array;
+		
+		while(property_request_run)
 		{
-			if (p[1] == '*')
+			switch(property_request_p->property_id)
 			{
-				len++;
-				p += 2;
-				continue;	
+				case EVERYTHING3_PROPERTY_ID_FULL_PATH:
+					ipc3_result_list_read_property_text(result_list->stream,property_request_p,&path_cbuf);
+					break;
+					
+				case EVERYTHING3_PROPERTY_ID_SIZE:
+					size = ipc3_result_list_read_property_uint64(result_list->stream,property_request_p);
+					break;
+					
+				case EVERYTHING3_PROPERTY_ID_DATE_MODIFIED:
+					date_modified = ipc3_result_list_read_property_uint64(result_list->stream,property_request_p);
+					break;
+					
+				default:
+					ipc3_result_list_skip_property_value(result_list->stream,property_request_p);
+					break;
 			}
 			
-			p++;
-			continue;
+			property_request_p++;
+			property_request_run--;
 		}
 		
-		len++;
-		p++;
+		if (result_list->stream->is_error)
+		{
+			break;
+		}
+		
+		diff_list_add(list,path_cbuf.buf,path_cbuf.length_in_bytes,(item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER) ? DIFF_ITEM_FLAG_FOLDER : 0,size,date_modified);
+		
+		result_run--;
+	}
+	
+	utf8_buf_kill(&path_cbuf);
+}
+
+// search and compare the results with the snapshot saved in filename.
+// outputs added, removed and modified items and saves the new snapshot to filename.
+// the state file is only replaced if the full result list was read successfully.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_diff_since(const wchar_t *filename)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_search_property_request_t property_request_array[3];
+		
+		// always request raw values, we compare them.
+		property_request_array[0].property_id = EVERYTHING3_PROPERTY_ID_FULL_PATH;
+		property_request_array[0].flags = 0;
+		property_request_array[1].property_id = EVERYTHING3_PROPERTY_ID_SIZE;
+		property_request_array[1].flags = 0;
+		property_request_array[2].property_id = EVERYTHING3_PROPERTY_ID_DATE_MODIFIED;
+		property_request_array[2].flags = 0;
+		
+		// we need every result for the snapshot.
+		// the offset and max results are applied to the changes.
+		if (_es_ipc3_write_search(pipe_handle,_es_ipc3_get_search_flags(),0,SIZE_MAX,property_request_array,3))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			diff_list_t old_list;
+			diff_list_t new_list;
+			array_t change_array;
+			pool_t change_pool;
+			
+			diff_list_init(&old_list);
+			diff_list_init(&new_list);
+			array_init(&change_array);
+			pool_init(&change_pool);
+
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			// read the new snapshot.
+			_es_ipc3_read_diff_list(&result_list,&new_list);
+			
+			if (result_list.stream->is_error)
+			{
+				// keep the old snapshot.
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			else
+			{
+				diff_list_sort(&new_list);
+				
+				// a missing state file is an empty snapshot.
+				// so the first run shows everything as added.
+				diff_list_load(&old_list,filename);
+
+				diff_list_compare(&old_list,&new_list,&change_array,&change_pool);
+				
+				diff_sort_changes(&change_array);
+				
+				if (_es_no_result_error)
+				{
+					if (!change_array.count)
+					{
+						_es_ret = ES_ERROR_NO_RESULTS;
+					}
+				}
+				
+				if (_es_get_result_count)
+				{
+					_es_output_noncell_result_count(change_array.count);
+				}
+				else
+				{
+					_es_output_diff_changes(&change_array);
+				}
+				
+				if (!diff_list_save(&new_list,filename))
+				{
+					es_fatal(ES_ERROR_CREATE_FILE);
+				}
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			pool_kill(&change_pool);
+			array_kill(&change_array);
+			diff_list_kill(&new_list);
+			diff_list_kill(&old_list);
+
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		}
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// get the name part of a full path.
+static const ES_UTF8 *_es_diff_item_get_name(const diff_item_t *item)
+{
+	const ES_UTF8 *path;
+	const ES_UTF8 *name;
+	const ES_UTF8 *p;
+	
+	path = DIFF_ITEM_PATH(item);
+	name = path;
+	p = path;
+	
+	while(*p)
+	{
+		if ((*p == '\\') || (*p == '/'))
+		{
+			name = p + 1;
+		}
+		
+		p++;
+	}
+	
+	return name;
+}
+
+// order view items for output.
+// only name, path, size and date modified are stored, other sorts use the full path.
+static int _es_view_item_compare(const diff_item_t *a,const diff_item_t *b)
+{
+	int cmp;
+	
+	cmp = 0;
+	
+	switch(_es_primary_sort_property_id)
+	{
+		case EVERYTHING3_PROPERTY_ID_NAME:
+			cmp = utf8_string_compare(_es_diff_item_get_name(a),_es_diff_item_get_name(b));
+			break;
+			
+		case EVERYTHING3_PROPERTY_ID_SIZE:
+		
+			if (a->size < b->size)
+			{
+				cmp = -1;
+			}
+			else
+			if (a->size > b->size)
+			{
+				cmp = 1;
+			}
+			
+			break;
+			
+		case EVERYTHING3_PROPERTY_ID_DATE_MODIFIED:
+		
+			if (a->date_modified < b->date_modified)
+			{
+				cmp = -1;
+			}
+			else
+			if (a->date_modified > b->date_modified)
+			{
+				cmp = 1;
+			}
+			
+			break;
+	}
+	
+	if (!cmp)
+	{
+		cmp = utf8_string_compare(DIFF_ITEM_PATH(a),DIFF_ITEM_PATH(b));
+	}
+	
+	if (_es_primary_sort_ascending < 0)
+	{
+		cmp = -cmp;
+	}
+	
+	return cmp;
+}
+
+// output the results from a -view.
+static void _es_output_view(const diff_list_t *list)
+{
+	diff_item_t **item_array;
+	SIZE_T index;
+	SIZE_T run;
+	int is_first_line;
+	ES_UINT64 total_size;
+	utf8_buf_t path_cbuf;
+	
+	utf8_buf_init(&path_cbuf);
+	
+	// the list is sorted by hash, sort a copy for output.
+	item_array = mem_alloc(safe_size_mul_sizeof_pointer(list->array.count));
+	
+	total_size = 0;
+	
+	for(index=0;index<list->array.count;index++)
+	{
+		item_array[index] = list->array.indexes[index];
+		
+		if ((!(item_array[index]->flags & DIFF_ITEM_FLAG_FOLDER)) && (item_array[index]->size != ES_UINT64_MAX))
+		{
+			total_size += item_array[index]->size;
+		}
+	}
+	
+	os_sort(item_array,list->array.count,_es_view_item_compare);
+
+	if (_es_get_result_count)
+	{
+		_es_output_noncell_result_count(list->array.count);
+	}
+	else
+	if (_es_get_total_size)
+	{
+		_es_output_noncell_total_size(total_size);
+	}
+	else
+	{
+		_es_output_page_begin();
+
+		if (_es_header > 0)
+		{
+			_es_output_header();
+		}
+		
+		index = safe_size_from_uint64(_es_offset);
+		if (index > list->array.count)
+		{
+			index = list->array.count;
+		}
+		
+		run = list->array.count - index;
+		if (run > safe_size_from_uint64(_es_max_results))
+		{
+			run = safe_size_from_uint64(_es_max_results);
+		}
+		
+		is_first_line = 1;
+		
+		while(run)
+		{
+			const diff_item_t *item;
+			
+			item = item_array[index];
+		
+			_es_output_line_begin(is_first_line);
+			
+			_es_output_column = column_order_start;
+			_es_output_column_attribute = column_attribute_array;
+			
+			while(_es_output_column)
+			{
+				_es_output_cell_separator();
+
+				_es_output_diff_item_cell(item,&path_cbuf);
+
+				_es_output_column = _es_output_column->order_next;
+				_es_output_column_attribute++;
+			}
+			
+			index++;
+			run--;
+
+			_es_output_line_end(run ? 1 : 0);
+			
+			is_first_line = 0;
+		}
+		
+		if (_es_footer > 0)
+		{
+			_es_output_footer(list->array.count,total_size);
+		}
+
+		_es_output_page_end();
+	}
+	
+	mem_free(item_array);
+	
+	utf8_buf_kill(&path_cbuf);
+}
+
+// search and read every result into list.
+// the pipe is kept in sync so it can be used for another search.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+static BOOL _es_view_search(HANDLE pipe_handle,DWORD search_flags,wchar_buf_t *search_wcbuf,diff_list_t *list)
+{
+	BOOL ret;
+	ipc3_search_property_request_t property_request_array[3];
+	wchar_buf_t *old_search_wcbuf;
+	BOOL is_sent;
+	
+	ret = FALSE;
+	
+	property_request_array[0].property_id = EVERYTHING3_PROPERTY_ID_FULL_PATH;
+	property_request_array[0].flags = 0;
+	property_request_array[1].property_id = EVERYTHING3_PROPERTY_ID_SIZE;
+	property_request_array[1].flags = 0;
+	property_request_array[2].property_id = EVERYTHING3_PROPERTY_ID_DATE_MODIFIED;
+	property_request_array[2].flags = 0;
+	
+	// _es_ipc3_write_search uses _es_search_wcbuf
+	old_search_wcbuf = _es_search_wcbuf;
+	_es_search_wcbuf = search_wcbuf;
+	
+	is_sent = _es_ipc3_write_search(pipe_handle,search_flags,0,SIZE_MAX,property_request_array,3);
+	
+	_es_search_wcbuf = old_search_wcbuf;
+	
+	if (is_sent)
+	{
+		ipc3_stream_pipe_t pipe_stream;
+		ipc3_result_list_t result_list;
+		
+		ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+		
+		ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+		
+		_es_ipc3_read_diff_list(&result_list,list);
+		
+		if (!result_list.stream->is_error)
+		{
+			ret = TRUE;
+		}
+		
+		ipc3_result_list_kill(&result_list);
+		
+		if (!ipc3_stream_pipe_skip_reply(&pipe_stream))
+		{
+			ret = FALSE;
+		}
+		
+		ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+	}
+	
+	return ret;
+}
+
+// collect the paths changed by each journal change.
+// stops at end_change_id.
+static BOOL _es_view_journal_callback_proc(void *user_data,_ipc3_journal_change_t *change)
+{
+	_es_view_journal_t *view_journal;
+	DWORD flags;
+	
+	view_journal = user_data;
+	
+	if (change->change_id >= view_journal->end_change_id)
+	{
+		view_journal->is_done = 1;
+		
+		return FALSE;
+	}
+	
+	if (change->type == IPC3_JOURNAL_ITEM_TYPE_NOP)
+	{
+		// we don't know what changed.
+		return FALSE;
+	}
+	
+	// everything under a deleted, renamed or moved folder also changed.
+	flags = 0;
+	
+	switch(change->type)
+	{
+		case IPC3_JOURNAL_ITEM_TYPE_FOLDER_DELETE:
+		case IPC3_JOURNAL_ITEM_TYPE_FOLDER_RENAME:
+		case IPC3_JOURNAL_ITEM_TYPE_FOLDER_MOVE:
+			flags = DIFF_ITEM_FLAG_FOLDER;
+			break;
+	}
+	
+	utf8_buf_path_cat_filename(change->old_path,change->old_name,&view_journal->path_cbuf);
+	diff_list_add(&view_journal->changed_list,view_journal->path_cbuf.buf,view_journal->path_cbuf.length_in_bytes,flags,ES_UINT64_MAX,ES_UINT64_MAX);
+	
+	if ((change->new_path_len) || (change->new_name_len))
+	{
+		utf8_buf_path_cat_filename(change->new_path_len ? change->new_path : change->old_path,change->new_name_len ? change->new_name : change->old_name,&view_journal->path_cbuf);
+		diff_list_add(&view_journal->changed_list,view_journal->path_cbuf.buf,view_journal->path_cbuf.length_in_bytes,flags,ES_UINT64_MAX,ES_UINT64_MAX);
+	}
+	
+	if (view_journal->changed_list.array.count > _ES_VIEW_MAX_CHANGED_PATHS)
+	{
+		// a full search is cheaper.
+		return FALSE;
+	}
+	
+	if (change->change_id + 1 >= view_journal->end_change_id)
+	{
+		// don't wait for the next change.
+		view_journal->is_done = 1;
+		
+		return FALSE;
+	}
+	
+	return TRUE;
+}
+
+// search the changed paths again and add the results that are still in the view.
+// changed_list must be sorted.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+static BOOL _es_view_recheck(HANDLE pipe_handle,_es_view_t *view,const diff_list_t *changed_list)
+{
+	BOOL ret;
+	utf8_buf_t view_search_cbuf;
+	utf8_buf_t search_cbuf;
+	wchar_buf_t search_wcbuf;
+	diff_list_t result_list;
+	SIZE_T index;
+	
+	ret = TRUE;
+	utf8_buf_init(&view_search_cbuf);
+	utf8_buf_init(&search_cbuf);
+	wchar_buf_init(&search_wcbuf);
+	diff_list_init(&result_list);
+	
+	utf8_buf_copy_wchar_string(&view_search_cbuf,view->search_wcbuf.buf);
+	
+	index = 0;
+	
+	while(index < changed_list->array.count)
+	{
+		SIZE_T path_count;
+		const diff_item_t *prev_item;
+		
+		// <view search> <path:"a"|path:"b"|...>
+		// path: matches the path and everything under it, the results are filtered below.
+		utf8_buf_copy_utf8_string(&search_cbuf,"<");
+		utf8_buf_cat_utf8_string_n(&search_cbuf,view_search_cbuf.buf,view_search_cbuf.length_in_bytes);
+		utf8_buf_cat_utf8_string(&search_cbuf,"> <");
+		
+		path_count = 0;
+		prev_item = NULL;
+		
+		while((index < changed_list->array.count) && (path_count < _ES_VIEW_MAX_RECHECK_PATHS))
+		{
+			const diff_item_t *item;
+			
+			item = changed_list->array.indexes[index];
+			
+			// the same path is usually changed many times.
+			if ((!prev_item) || (prev_item->path_hash != item->path_hash) || (utf8_string_compare(DIFF_ITEM_PATH(prev_item),DIFF_ITEM_PATH(item)) != 0))
+			{
+				if (path_count)
+				{
+					utf8_buf_cat_utf8_string(&search_cbuf,"|");
+				}
+				
+				utf8_buf_cat_utf8_string(&search_cbuf,"path:\"");
+				utf8_buf_cat_utf8_string_n(&search_cbuf,DIFF_ITEM_PATH(item),item->path_len);
+				utf8_buf_cat_utf8_string(&search_cbuf,"\"");
+				
+				path_count++;
+			}
+			
+			prev_item = item;
+			index++;
+		}
+		
+		utf8_buf_cat_utf8_string(&search_cbuf,">");
+		
+		wchar_buf_copy_utf8_string_n(&search_wcbuf,search_cbuf.buf,search_cbuf.length_in_bytes);
+		
+		if (!_es_view_search(pipe_handle,view->search_flags,&search_wcbuf,&result_list))
+		{
+			ret = FALSE;
+			
+			break;
+		}
+	}
+	
+	if (ret)
+	{
+		SIZE_T result_index;
+		
+		for(result_index=0;result_index<result_list.array.count;result_index++)
+		{
+			const diff_item_t *item;
+			
+			item = result_list.array.indexes[result_index];
+			
+			if (diff_list_match_path(changed_list,DIFF_ITEM_PATH(item),item->path_len))
+			{
+				diff_list_add(&view->list,DIFF_ITEM_PATH(item),item->path_len,item->flags,item->size,item->date_modified);
+			}
+		}
+	}
+	
+	diff_list_kill(&result_list);
+	wchar_buf_kill(&search_wcbuf);
+	utf8_buf_kill(&search_cbuf);
+	utf8_buf_kill(&view_search_cbuf);
+	
+	return ret;
+}
+
+// apply the journal changes since the view was saved, up to end_change_id.
+// the view list is not sorted.
+// returns TRUE if successful.
+// Otherwise, returns FALSE and the view should be rebuilt.
+static BOOL _es_view_update(HANDLE pipe_handle,_es_view_t *view,ES_UINT64 end_change_id)
+{
+	BOOL ret;
+	_es_view_journal_t view_journal;
+	
+	ret = FALSE;
+	
+	view_journal.end_change_id = end_change_id;
+	view_journal.is_done = 0;
+	diff_list_init(&view_journal.changed_list);
+	utf8_buf_init(&view_journal.path_cbuf);
+	
+	// always returns FALSE.
+	ipc3_read_journal(view->journal_id,view->next_change_id,IPC3_READ_JOURNAL_FLAG_CHANGE_ID | IPC3_READ_JOURNAL_FLAG_OLD_PATH | IPC3_READ_JOURNAL_FLAG_OLD_NAME | IPC3_READ_JOURNAL_FLAG_NEW_PATH | IPC3_READ_JOURNAL_FLAG_NEW_NAME,&view_journal,_es_view_journal_callback_proc);
+	
+	if (view_journal.is_done)
+	{
+		diff_list_sort(&view_journal.changed_list);
+		
+		// remove the changed paths and search them again.
+		diff_list_remove_matching(&view->list,&view_journal.changed_list);
+		
+		if (_es_view_recheck(pipe_handle,view,&view_journal.changed_list))
+		{
+			ret = TRUE;
+		}
+	}
+	
+	utf8_buf_kill(&view_journal.path_cbuf);
+	diff_list_kill(&view_journal.changed_list);
+	
+	return ret;
+}
+
+// load a view from filename.
+// returns TRUE if successful.
+// Otherwise, returns FALSE and the view is empty.
+static BOOL _es_view_load(_es_view_t *view,const wchar_t *filename)
+{
+	BOOL ret;
+	utf8_buf_t user_data_cbuf;
+	
+	ret = FALSE;
+	utf8_buf_init(&user_data_cbuf);
+	
+	if (diff_list_load_user_data(&view->list,filename,&user_data_cbuf))
+	{
+		if (user_data_cbuf.length_in_bytes >= sizeof(_es_view_header_t))
+		{
+			_es_view_header_t header;
+			
+			os_copy_memory(&header,user_data_cbuf.buf,sizeof(_es_view_header_t));
+			
+			view->journal_id = header.journal_id;
+			view->next_change_id = header.next_change_id;
+			view->search_flags = header.search_flags;
+			
+			wchar_buf_copy_utf8_string_n(&view->search_wcbuf,user_data_cbuf.buf + sizeof(_es_view_header_t),user_data_cbuf.length_in_bytes - sizeof(_es_view_header_t));
+			
+			ret = TRUE;
+		}
+	}
+	
+	if (!ret)
+	{
+		diff_list_kill(&view->list);
+		diff_list_init(&view->list);
+	}
+	
+	utf8_buf_kill(&user_data_cbuf);
+	
+	return ret;
+}
+
+// save a view to filename.
+// the view list must be sorted.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+static BOOL _es_view_save(const _es_view_t *view,const wchar_t *filename)
+{
+	BOOL ret;
+	utf8_buf_t search_cbuf;
+	utf8_buf_t user_data_cbuf;
+	_es_view_header_t header;
+	
+	utf8_buf_init(&search_cbuf);
+	utf8_buf_init(&user_data_cbuf);
+	
+	os_zero_memory(&header,sizeof(_es_view_header_t));
+	
+	header.journal_id = view->journal_id;
+	header.next_change_id = view->next_change_id;
+	header.search_flags = view->search_flags;
+	
+	utf8_buf_copy_wchar_string(&search_cbuf,view->search_wcbuf.buf);
+	
+	utf8_buf_grow_length(&user_data_cbuf,safe_size_add(sizeof(_es_view_header_t),search_cbuf.length_in_bytes));
+	os_copy_memory(user_data_cbuf.buf,&header,sizeof(_es_view_header_t));
+	os_copy_memory(user_data_cbuf.buf + sizeof(_es_view_header_t),search_cbuf.buf,search_cbuf.length_in_bytes);
+	
+	ret = diff_list_save_user_data(&view->list,filename,user_data_cbuf.buf,user_data_cbuf.length_in_bytes);
+	
+	utf8_buf_kill(&user_data_cbuf);
+	utf8_buf_kill(&search_cbuf);
+	
+	return ret;
+}
+
+// answer a standing search from a local snapshot that is kept current with the journal.
+// the first run takes a full snapshot.
+// later runs only search the paths that changed since the last run.
+// an empty search uses the saved search, a different search replaces the view.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_view(const wchar_t *filename)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		_es_view_t view;
+		ipc3_journal_info_t journal_info;
+		int got_journal_info;
+		int is_rebuild;
+		int is_error;
+		DWORD search_flags;
+		
+		wchar_buf_init(&view.search_wcbuf);
+		diff_list_init(&view.list);
+		
+		search_flags = _es_ipc3_get_search_flags();
+		is_rebuild = 1;
+		is_error = 0;
+		
+		view.journal_id = ES_UINT64_MAX;
+		view.next_change_id = ES_UINT64_MAX;
+		view.search_flags = search_flags;
+		
+		// without the journal, the view is just a search.
+		got_journal_info = ipc3_ioctl_expect_output_size(pipe_handle,IPC3_COMMAND_GET_JOURNAL_INFO,NULL,0,&journal_info,sizeof(ipc3_journal_info_t));
+		
+		if ((got_journal_info) && (_es_view_load(&view,filename)))
+		{
+			if ((!_es_search_wcbuf->length_in_wchars) || ((search_flags == view.search_flags) && (wchar_string_compare(_es_search_wcbuf->buf,view.search_wcbuf.buf) == 0)))
+			{
+				// a new journal means Everything reindexed.
+				if (view.journal_id == journal_info.journal_id)
+				{
+					if (view.next_change_id == journal_info.next_change_id)
+					{
+						// nothing changed.
+						is_rebuild = 0;
+					}
+					else
+					if (_es_view_update(pipe_handle,&view,journal_info.next_change_id))
+					{
+						is_rebuild = 0;
+					}
+				}
+			}
+		}
+		
+		if (is_rebuild)
+		{
+			if (_es_search_wcbuf->length_in_wchars)
+			{
+				wchar_buf_copy_wchar_string_n(&view.search_wcbuf,_es_search_wcbuf->buf,_es_search_wcbuf->length_in_wchars);
+				view.search_flags = search_flags;
+			}
+			
+			diff_list_kill(&view.list);
+			diff_list_init(&view.list);
+			
+			if (!_es_view_search(pipe_handle,view.search_flags,&view.search_wcbuf,&view.list))
+			{
+				is_error = 1;
+			}
+		}
+		
+		// the journal info was read before any search.
+		// so any change we missed is read again next time.
+		view.journal_id = journal_info.journal_id;
+		view.next_change_id = journal_info.next_change_id;
+		
+		if (is_error)
+		{
+			// keep the old view.
+			_es_ret = ES_ERROR_IPC_ERROR;
+		}
+		else
+		{
+			diff_list_sort(&view.list);
+			
+			if (got_journal_info)
+			{
+				if (!_es_view_save(&view,filename))
+				{
+					es_fatal(ES_ERROR_CREATE_FILE);
+				}
+			}
+			
+			if (_es_no_result_error)
+			{
+				if (!view.list.array.count)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			_es_output_view(&view.list);
+		}
+		
+		// don't try to process ipc2 or ipc1 if we sent the request successfully.
+		ret = TRUE;
+		
+		diff_list_kill(&view.list);
+		wchar_buf_kill(&view.search_wcbuf);
+
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// open a line reader.
+// a filename of - reads from stdin.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+static BOOL _es_line_reader_open(_es_line_reader_t *reader,const wchar_t *filename)
+{
+	if ((filename[0] == '-') && (!filename[1]))
+	{
+		reader->file_handle = GetStdHandle(STD_INPUT_HANDLE);
+		reader->is_close = 0;
+	}
+	else
+	{
+		reader->file_handle = os_open_file(filename);
+		reader->is_close = 1;
+	}
+	
+	if ((reader->file_handle == INVALID_HANDLE_VALUE) || (!reader->file_handle))
+	{
+		return FALSE;
+	}
+	
+	reader->buf = mem_alloc(_ES_LINE_READER_BUF_SIZE);
+	reader->p = reader->buf;
+	reader->avail = 0;
+	reader->is_eof = 0;
+	reader->is_first = 1;
+	
+	return TRUE;
+}
+
+static void _es_line_reader_close(_es_line_reader_t *reader)
+{
+	mem_free(reader->buf);
+	
+	if (reader->is_close)
+	{
+		CloseHandle(reader->file_handle);
+	}
+}
+
+// read the next line without the trailing CRLF or LF.
+// returns TRUE if a line was read.
+// returns FALSE at the end of the file.
+static BOOL _es_line_reader_read_line(_es_line_reader_t *reader,wchar_buf_t *out_wcbuf)
+{
+	BOOL ret;
+	utf8_buf_t line_cbuf;
+	SIZE_T line_length;
+	
+	ret = FALSE;
+	utf8_buf_init(&line_cbuf);
+	
+	for(;;)
+	{
+		BYTE *newline_p;
+		DWORD run;
+		
+		if (!reader->avail)
+		{
+			DWORD numread;
+			
+			if (reader->is_eof)
+			{
+				break;
+			}
+			
+			// a closed stdin pipe is also the end of the file.
+			if ((!ReadFile(reader->file_handle,reader->buf,_ES_LINE_READER_BUF_SIZE,&numread,NULL)) || (!numread))
+			{
+				reader->is_eof = 1;
+				
+				break;
+			}
+			
+			reader->p = reader->buf;
+			reader->avail = numread;
+			
+			if (reader->is_first)
+			{
+				// skip UTF-8 BOM
+				if ((numread >= 3) && (reader->buf[0] == 0xEF) && (reader->buf[1] == 0xBB) && (reader->buf[2] == 0xBF))
+				{
+					reader->p += 3;
+					reader->avail -= 3;
+				}
+				
+				reader->is_first = 0;
+			}
+			
+			continue;
+		}
+		
+		ret = TRUE;
+		
+		newline_p = reader->p;
+		run = reader->avail;
+		
+		while(run)
+		{
+			if (*newline_p == '\n')
+			{
+				break;
+			}
+			
+			newline_p++;
+			run--;
+		}
+		
+		utf8_buf_cat_utf8_string_n(&line_cbuf,(const ES_UTF8 *)reader->p,newline_p - reader->p);
+		
+		if (run)
+		{
+			// eat the LF.
+			reader->avail = run - 1;
+			reader->p = newline_p + 1;
+			
+			break;
+		}
+		
+		reader->avail = 0;
+	}
+	
+	line_length = line_cbuf.length_in_bytes;
+	
+	// remove CR
+	if ((line_length) && (line_cbuf.buf[line_length - 1] == '\r'))
+	{
+		line_length--;
+	}
+	
+	wchar_buf_copy_utf8_string_n(out_wcbuf,line_cbuf.buf,line_length);
+	
+	utf8_buf_kill(&line_cbuf);
+	
+	return ret;
+}
+
+// store the current viewport, sort and columns.
+// the state should be killed with _es_batch_state_kill.
+static void _es_batch_state_save(_es_batch_state_t *state)
+{
+	state->offset = _es_offset;
+	state->max_results = _es_max_results;
+	state->primary_sort_property_id = _es_primary_sort_property_id;
+	state->primary_sort_ascending = _es_primary_sort_ascending;
+	
+	state->secondary_sort_count = secondary_sort_array->count;
+	state->secondary_sort_copy_array = NULL;
+	
+	if (state->secondary_sort_count)
+	{
+		secondary_sort_t *secondary_sort;
+		secondary_sort_t *secondary_sort_d;
+		
+		state->secondary_sort_copy_array = mem_alloc(safe_size_mul(state->secondary_sort_count,sizeof(secondary_sort_t)));
+		
+		secondary_sort = secondary_sort_start;
+		secondary_sort_d = state->secondary_sort_copy_array;
+		
+		while(secondary_sort)
+		{
+			secondary_sort_d->property_id = secondary_sort->property_id;
+			secondary_sort_d->ascending = secondary_sort->ascending;
+			
+			secondary_sort_d++;
+			secondary_sort = secondary_sort->next;
+		}
+	}
+	
+	state->column_count = column_array->count;
+	state->column_property_id_array = NULL;
+	
+	if (state->column_count)
+	{
+		column_t *column;
+		DWORD *column_property_id_d;
+		
+		state->column_property_id_array = mem_alloc(safe_size_mul(state->column_count,sizeof(DWORD)));
+		
+		column = column_order_start;
+		column_property_id_d = state->column_property_id_array;
+		
+		while(column)
+		{
+			*column_property_id_d++ = column->property_id;
+			
+			column = column->order_next;
+		}
+	}
+}
+
+// set the current viewport, sort and columns from a saved state.
+static void _es_batch_state_restore(const _es_batch_state_t *state)
+{
+	SIZE_T index;
+	
+	_es_offset = state->offset;
+	_es_max_results = state->max_results;
+	_es_primary_sort_property_id = state->primary_sort_property_id;
+	_es_primary_sort_ascending = state->primary_sort_ascending;
+	
+	secondary_sort_clear_all();
+	
+	for(index=0;index<state->secondary_sort_count;index++)
+	{
+		secondary_sort_add(state->secondary_sort_copy_array[index].property_id,state->secondary_sort_copy_array[index].ascending);
+	}
+	
+	column_clear_all();
+	
+	for(index=0;index<state->column_count;index++)
+	{
+		column_add(state->column_property_id_array[index]);
+	}
+}
+
+static void _es_batch_state_kill(_es_batch_state_t *state)
+{
+	if (state->column_property_id_array)
+	{
+		mem_free(state->column_property_id_array);
+	}
+
+	if (state->secondary_sort_copy_array)
+	{
+		mem_free(state->secondary_sort_copy_array);
+	}
+}
+
+// parse the switches from a -batch line.
+// only switches that change the viewport, sort or columns are allowed.
+// the rest of the line is copied to out_search_wcbuf.
+static void _es_batch_parse_line(const wchar_t *line,wchar_buf_t *out_search_wcbuf)
+{
+	wchar_buf_t argv_wcbuf;
+	
+	wchar_buf_init(&argv_wcbuf);
+	wchar_buf_empty(out_search_wcbuf);
+
+	// reuse the command line parser.
+	// the real command line has already been parsed.
+	_es_command_line = line;
+	_es_command_line_was_eq = 0;
+	
+	for(;;)
+	{
+		_es_get_argv(&argv_wcbuf);
+		if (!_es_command_line)
+		{
+			break;
+		}
+		
+		if ((_es_check_option_utf8_string(argv_wcbuf.buf,"n")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"count")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"max-results")))
+		{
+			_es_expect_command_argv_int(&argv_wcbuf);
+			
+			_es_max_results = wchar_string_to_uint64(argv_wcbuf.buf);
+			
+			continue;
+		}
+		
+		if ((_es_check_option_utf8_string(argv_wcbuf.buf,"o")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"offset")))
+		{
+			_es_expect_command_argv_int(&argv_wcbuf);
+			
+			_es_offset = wchar_string_to_uint64(argv_wcbuf.buf);
+			
+			continue;
+		}
+		
+		if (_es_check_option_utf8_string(argv_wcbuf.buf,"sort-ascending"))
+		{
+			_es_primary_sort_ascending = 1;
+			
+			continue;
+		}
+		
+		if (_es_check_option_utf8_string(argv_wcbuf.buf,"sort-descending"))
+		{
+			_es_primary_sort_ascending = -1;
+			
+			continue;
+		}
+		
+		if (_es_check_option_utf8_string(argv_wcbuf.buf,"sort"))
+		{
+			_es_expect_command_argv(&argv_wcbuf);
+			
+			_es_set_sort_list(argv_wcbuf.buf,0,1);
+			
+			continue;
+		}
+		
+		if ((_es_check_option_utf8_string(argv_wcbuf.buf,"columns")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"set-columns")))
+		{
+			_es_expect_command_argv(&argv_wcbuf);
+			
+			_es_set_columns(argv_wcbuf.buf,0,0,TRUE);
+			
+			continue;
+		}
+		
+		if ((_es_check_option_utf8_string(argv_wcbuf.buf,"add-columns")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"add-column")))
+		{
+			_es_expect_command_argv(&argv_wcbuf);
+			
+			_es_set_columns(argv_wcbuf.buf,1,0,TRUE);
+			
+			continue;
+		}
+		
+		if ((_es_check_option_utf8_string(argv_wcbuf.buf,"remove-columns")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"remove-column")))
+		{
+			_es_expect_command_argv(&argv_wcbuf);
+			
+			_es_set_columns(argv_wcbuf.buf,2,0,TRUE);
+			
+			continue;
+		}
+		
+		if ((argv_wcbuf.length_in_wchars) && (argv_wcbuf.buf[0] == '-') && (argv_wcbuf.buf[1] == '-'))
+		{
+			// no more switches.
+			// treat the rest as a search.
+			for(;;)
+			{
+				_es_get_argv(&argv_wcbuf);
+				if (!_es_command_line)
+				{
+					break;
+				}
+
+				if (out_search_wcbuf->length_in_wchars)
+				{
+					wchar_buf_cat_wchar(out_search_wcbuf,' ');
+				}
+
+				wchar_buf_cat_wchar_string(out_search_wcbuf,argv_wcbuf.buf);
+			}
+			
+			break;
+		}
+
+		if ((argv_wcbuf.buf[0] == '-') && (!_es_is_literal_switch(argv_wcbuf.buf)))
+		{
+			// unknown or unsupported per query switch.
+			es_fatal(ES_ERROR_UNKNOWN_SWITCH);
+		}
+		
+		if (out_search_wcbuf->length_in_wchars)
+		{
+			wchar_buf_cat_wchar(out_search_wcbuf,' ');
+		}
+
+		wchar_buf_cat_wchar_string(out_search_wcbuf,argv_wcbuf.buf);
+	}
+	
+	_es_command_line = NULL;
+	_es_command_line_was_eq = 0;
+
+	wchar_buf_kill(&argv_wcbuf);
+}
+
+// read the next query from the -batch file.
+// blank lines and lines starting with # are ignored.
+// the global viewport, sort and columns are set for the query and stored in out_state.
+// returns TRUE if a query was read.
+// returns FALSE if there are no more queries.
+static BOOL _es_batch_read_query(_es_line_reader_t *reader,const _es_batch_state_t *base_state,const wchar_t *base_search,wchar_buf_t *out_line_wcbuf,wchar_buf_t *out_query_wcbuf,_es_batch_state_t *out_state)
+{
+	BOOL ret;
+	wchar_buf_t line_search_wcbuf;
+	
+	ret = FALSE;
+	wchar_buf_init(&line_search_wcbuf);
+	
+	while(_es_line_reader_read_line(reader,out_line_wcbuf))
+	{
+		const wchar_t *line_p;
+		
+		line_p = wchar_string_skip_ws(out_line_wcbuf->buf);
+		
+		if ((!*line_p) || (*line_p == '#'))
+		{
+			continue;
+		}
+		
+		// each line starts from the command line state.
+		_es_batch_state_restore(base_state);
+		
+		_es_batch_parse_line(line_p,&line_search_wcbuf);
+		
+		if (_es_get_total_size)
+		{
+			// we only need the total size.
+			_es_max_results = 0;
+			column_clear_all();
+		}
+		
+		// combine with the search from the command line.
+		if ((*base_search) && (line_search_wcbuf.length_in_wchars))
+		{
+			wchar_buf_copy_utf8_string(out_query_wcbuf,"< ");
+			wchar_buf_cat_wchar_string(out_query_wcbuf,base_search);
+			wchar_buf_cat_utf8_string(out_query_wcbuf," > < ");
+			wchar_buf_cat_wchar_string_n(out_query_wcbuf,line_search_wcbuf.buf,line_search_wcbuf.length_in_wchars);
+			
+			if (_es_is_unbalanced_quotes(out_query_wcbuf->buf))
+			{
+				// don't make the trailing > literal.
+				wchar_buf_cat_utf8_string(out_query_wcbuf,"\"");
+			}
+			
+			wchar_buf_cat_utf8_string(out_query_wcbuf," >");
+		}
+		else
+		if (line_search_wcbuf.length_in_wchars)
+		{
+			wchar_buf_copy_wchar_string_n(out_query_wcbuf,line_search_wcbuf.buf,line_search_wcbuf.length_in_wchars);
+		}
+		else
+		{
+			wchar_buf_copy_wchar_string(out_query_wcbuf,base_search);
+		}
+		
+		_es_batch_state_save(out_state);
+		
+		ret = TRUE;
+		
+		break;
+	}
+	
+	wchar_buf_kill(&line_search_wcbuf);
+	
+	return ret;
+}
+
+// build the search request packet for the current viewport, sort and columns.
+// returns the size of the packet in bytes.
+static SIZE_T _es_batch_build_search_packet(DWORD search_flags,wchar_buf_t *query_wcbuf,utf8_buf_t *out_packet_cbuf)
+{
+	SIZE_T packet_size;
+	wchar_buf_t *old_search_wcbuf;
+	ipc3_search_property_request_t *property_request_array;
+	SIZE_T property_request_count;
+	
+	property_request_array = _es_ipc3_alloc_property_request_array(&property_request_count);
+	
+	// _es_ipc3_build_search_packet uses _es_search_wcbuf
+	old_search_wcbuf = _es_search_wcbuf;
+	_es_search_wcbuf = query_wcbuf;
+	
+	packet_size = _es_ipc3_build_search_packet(search_flags,safe_size_from_uint64(_es_offset),safe_size_from_uint64(_es_max_results),property_request_array,property_request_count,out_packet_cbuf);
+	
+	_es_search_wcbuf = old_search_wcbuf;
+	
+	if (property_request_array)
+	{
+		mem_free(property_request_array);
+	}
+	
+	return packet_size;
+}
+
+// read the next query from the -batch file and build the search request.
+// out_state is set to the viewport, sort and columns used for the query.
+// returns TRUE if a request was built.
+// returns FALSE if there are no more queries.
+static BOOL _es_ipc3_batch_read_next(DWORD search_flags,_es_line_reader_t *reader,const _es_batch_state_t *base_state,const wchar_t *base_search,wchar_buf_t *out_line_wcbuf,utf8_buf_t *out_packet_cbuf,SIZE_T *out_packet_size,_es_batch_state_t *out_state)
+{
+	BOOL ret;
+	wchar_buf_t query_wcbuf;
+	
+	ret = FALSE;
+	wchar_buf_init(&query_wcbuf);
+	
+	if (_es_batch_read_query(reader,base_state,base_search,out_line_wcbuf,&query_wcbuf,out_state))
+	{
+		*out_packet_size = _es_batch_build_search_packet(search_flags,&query_wcbuf,out_packet_cbuf);
+		
+		ret = TRUE;
+	}
+	
+	wchar_buf_kill(&query_wcbuf);
+	
+	return ret;
+}
+
+// output the results for a single -batch query.
+// JSON exports are wrapped in a {"query":...,"results":[...]} envelope, one query per line.
+// other exports output a delimiter line before the results.
+// latency is in milliseconds and is only shown if is_latency is set.
+static void _es_batch_output_result_list(ipc3_result_list_t *result_list,const wchar_t *line,const wchar_t *delimiter,int is_latency,DWORD latency)
+{
+	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+	{
+		wchar_buf_t escaped_line_wcbuf;
+		
+		wchar_buf_init(&escaped_line_wcbuf);
+		
+		_es_escape_json_wchar_string(line,&escaped_line_wcbuf);
+		
+		_es_output_noncell_utf8_string("{\"query\":\"");
+		_es_output_noncell_wchar_string(escaped_line_wcbuf.buf);
+		_es_output_noncell_utf8_string("\",");
+		
+		if (is_latency)
+		{
+			_es_output_noncell_printf("\"latency_ms\":%u,",latency);
+		}
+
+		_es_output_noncell_utf8_string("\"results\":");
+		
+		wchar_buf_kill(&escaped_line_wcbuf);
+	}
+	else
+	if (*delimiter)
+	{
+		_es_output_noncell_wchar_string(delimiter);
+		_es_output_noncell_utf8_string(" ");
+		_es_output_noncell_wchar_string(line);
+		
+		if (is_latency)
+		{
+			_es_output_noncell_printf(" (%u ms)",latency);
+		}
+		
+		_es_output_noncell_newline();
+	}
+	
+	if (_es_no_result_error)
+	{
+		if (result_list->folder_result_count + result_list->file_result_count == 0)
+		{
+			_es_ret = ES_ERROR_NO_RESULTS;
+		}
+	}
+	
+	if (_es_get_result_count)
+	{
+		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+		{
+			_es_output_noncell_printf("%I64u",(ES_UINT64)(result_list->folder_result_count + result_list->file_result_count));
+		}
+		else
+		{
+			_es_output_noncell_result_count(result_list->folder_result_count + result_list->file_result_count);
+		}
+	}
+	else
+	if (_es_get_total_size)
+	{
+		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+		{
+			_es_output_noncell_printf("%I64u",result_list->total_result_size);
+		}
+		else
+		{
+			_es_output_noncell_total_size(result_list->total_result_size);
+		}
+	}
+	else
+	{
+		SIZE_T total_item_count;
+		
+		total_item_count = result_list->viewport_count;
+		if (_es_header > 0)
+		{
+			total_item_count = safe_size_add_one(total_item_count);
+		}
+		
+		if (_es_footer > 0)
+		{
+			total_item_count = safe_size_add_one(total_item_count);
+		}
+		
+		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+		{
+			char old_newline_type;
+			
+			// keep the whole envelope on one line.
+			old_newline_type = _es_newline_type;
+			_es_newline_type = 3;
+			
+			if (total_item_count)
+			{
+				_es_output_ipc3_results(result_list,0,total_item_count);
+			}
+			else
+			{
+				_es_output_noncell_utf8_string("[]");
+			}
+			
+			_es_newline_type = old_newline_type;
+		}
+		else
+		{
+			_es_output_ipc3_results(result_list,0,total_item_count);
+		}
+	}
+
+	if (result_list->stream->is_error)
+	{
+		_es_ret = ES_ERROR_IPC_ERROR;
+	}
+	
+	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+	{
+		_es_output_noncell_utf8_string("}");
+		_es_output_noncell_newline();
+	}
+}
+
+// read and output the reply for a single -batch query from the pipe.
+// the latency is the time from sending the request until the reply header is read.
+// returns TRUE if the pipe is ready for the next reply.
+// returns FALSE on a pipe error.
+static BOOL _es_ipc3_batch_output(HANDLE pipe_handle,const wchar_t *line,const wchar_t *delimiter,int is_latency,DWORD send_tick)
+{
+	BOOL ret;
+	ipc3_stream_pipe_t pipe_stream;
+	ipc3_result_list_t result_list;
+	DWORD latency;
+	
+	ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+	
+	ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+	
+	latency = GetTickCount() - send_tick;
+	
+	_es_batch_output_result_list(&result_list,line,delimiter,is_latency,latency);
+	
+	// skip anything we didn't read so the next reply starts at a message header.
+	ret = ipc3_stream_pipe_skip_reply(&pipe_stream);
+
+	ipc3_result_list_kill(&result_list);
+	ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+	
+	return ret;
+}
+
+// run each query from a file over a single pipe connection.
+// the next request is sent before reading the current reply,
+// so Everything can start on the next search while we output the current results.
+// the next request is only sent early if it fits in the pipe buffer.
+// otherwise, Everything could block writing the current reply while we block writing the next request.
+// returns TRUE if connected to the pipe.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_batch(const wchar_t *filename,const wchar_t *delimiter,int is_latency)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		_es_line_reader_t reader;
+		DWORD search_flags;
+		wchar_buf_t base_search_wcbuf;
+		wchar_buf_t current_line_wcbuf;
+		wchar_buf_t next_line_wcbuf;
+		utf8_buf_t packet_cbuf;
+		SIZE_T packet_size;
+		SIZE_T pipe_buffer_size;
+		_es_batch_state_t base_state;
+		_es_batch_state_t current_state;
+		_es_batch_state_t next_state;
+		DWORD current_send_tick;
+		int is_current;
+		
+		if (!_es_line_reader_open(&reader,filename))
+		{
+			_es_bad_switch_param("Unable to open batch file: %S\n",filename);
+		}
+		
+		wchar_buf_init(&base_search_wcbuf);
+		wchar_buf_init(&current_line_wcbuf);
+		wchar_buf_init(&next_line_wcbuf);
+		utf8_buf_init(&packet_cbuf);
+		
+		search_flags = _es_batch_get_search_flags();
+		pipe_buffer_size = ipc3_get_pipe_buffer_size(pipe_handle);
+		
+		wchar_buf_copy_wchar_string_n(&base_search_wcbuf,_es_search_wcbuf->buf,_es_search_wcbuf->length_in_wchars);
+
+		_es_batch_state_save(&base_state);
+		
+		is_current = _es_ipc3_batch_read_next(search_flags,&reader,&base_state,base_search_wcbuf.buf,&current_line_wcbuf,&packet_cbuf,&packet_size,&current_state);
+		
+		if (is_current)
+		{
+			current_send_tick = GetTickCount();
+			
+			if (!ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+				
+				_es_batch_state_kill(&current_state);
+				
+				is_current = 0;
+			}
+		}
+		
+		while(is_current)
+		{
+			int is_next;
+			int is_next_sent;
+			DWORD next_send_tick;
+			
+			is_next = _es_ipc3_batch_read_next(search_flags,&reader,&base_state,base_search_wcbuf.buf,&next_line_wcbuf,&packet_cbuf,&packet_size,&next_state);
+			is_next_sent = 0;
+			next_send_tick = 0;
+			
+			// pipeline the next request if it will not block.
+			if ((is_next) && (sizeof(ipc3_message_t) + packet_size <= pipe_buffer_size))
+			{
+				next_send_tick = GetTickCount();
+				
+				if (!ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
+				{
+					_es_ret = ES_ERROR_IPC_ERROR;
+					
+					_es_batch_state_kill(&next_state);
+					_es_batch_state_kill(&current_state);
+					
+					break;
+				}
+				
+				is_next_sent = 1;
+			}
+			
+			// output with the columns used for the current query.
+			_es_batch_state_restore(&current_state);
+			
+			if (!_es_ipc3_batch_output(pipe_handle,current_line_wcbuf.buf,delimiter,is_latency,current_send_tick))
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+
+				if (is_next)
+				{
+					_es_batch_state_kill(&next_state);
+				}
+				
+				_es_batch_state_kill(&current_state);
+				
+				break;
+			}
+			
+			_es_batch_state_kill(&current_state);
+			
+			// send the next request now that the current reply has been read.
+			if ((is_next) && (!is_next_sent))
+			{
+				next_send_tick = GetTickCount();
+				
+				if (!ipc3_write_pipe_message(pipe_handle,IPC3_COMMAND_SEARCH,packet_cbuf.buf,packet_size))
+				{
+					_es_ret = ES_ERROR_IPC_ERROR;
+					
+					_es_batch_state_kill(&next_state);
+					
+					break;
+				}
+			}
+			
+			// the next query is now the current query.
+			if (is_next)
+			{
+				wchar_buf_copy_wchar_string_n(&current_line_wcbuf,next_line_wcbuf.buf,next_line_wcbuf.length_in_wchars);
+				current_state = next_state;
+				current_send_tick = next_send_tick;
+			}
+			
+			is_current = is_next;
+		}
+		
+		_es_batch_state_restore(&base_state);
+		_es_batch_state_kill(&base_state);
+		
+		utf8_buf_kill(&packet_cbuf);
+		wchar_buf_kill(&next_line_wcbuf);
+		wchar_buf_kill(&current_line_wcbuf);
+		wchar_buf_kill(&base_search_wcbuf);
+		
+		_es_line_reader_close(&reader);
+		
+		ret = TRUE;
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// get the search flags used for every -batch query.
+static DWORD _es_batch_get_search_flags(void)
+{
+	DWORD search_flags;
+	
+	search_flags = _es_ipc3_get_search_flags();
+
+	if ((_es_get_total_size) || (_es_footer > 0))
+	{
+		// request total size for output or footer.
+		search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
+	}
+	
+	return search_flags;
+}
+
+// read the next -batch query and build its search request.
+// returns NULL if there are no more queries.
+// the query should be freed with _es_batch_query_free.
+static _es_batch_query_t *_es_batch_query_alloc(_es_line_reader_t *reader,DWORD search_flags,const _es_batch_state_t *base_state,const wchar_t *base_search)
+{
+	_es_batch_query_t *query;
+	wchar_buf_t line_wcbuf;
+	wchar_buf_t query_wcbuf;
+	_es_batch_state_t state;
+	
+	query = NULL;
+	wchar_buf_init(&line_wcbuf);
+	wchar_buf_init(&query_wcbuf);
+	
+	if (_es_batch_read_query(reader,base_state,base_search,&line_wcbuf,&query_wcbuf,&state))
+	{
+		query = mem_alloc(sizeof(_es_batch_query_t));
+		
+		query->next = NULL;
+		query->index = 0;
+		query->line = wchar_string_alloc_wchar_string_n(line_wcbuf.buf,line_wcbuf.length_in_wchars);
+		query->state = state;
+		query->latency = 0;
+		
+		utf8_buf_init(&query->packet_cbuf);
+		
+		query->packet_size = _es_batch_build_search_packet(search_flags,&query_wcbuf,&query->packet_cbuf);
+	}
+	
+	wchar_buf_kill(&query_wcbuf);
+	wchar_buf_kill(&line_wcbuf);
+	
+	return query;
+}
+
+static void _es_batch_query_free(_es_batch_query_t *query)
+{
+	ipc3_stream_close((ipc3_stream_t *)&query->pool_stream);
+	utf8_buf_kill(&query->packet_cbuf);
+	_es_batch_state_kill(&query->state);
+	
+	if (query->line)
+	{
+		mem_free(query->line);
+	}
+	
+	mem_free(query);
+}
+
+// output a -batch query that has completed on a connection.
+static void _es_batch_query_output(_es_batch_query_t *query,const wchar_t *delimiter,int is_latency)
+{
+	ipc3_result_list_t result_list;
+	
+	// output with the columns used for this query.
+	_es_batch_state_restore(&query->state);
+	
+	ipc3_result_list_init(&result_list,(ipc3_stream_t *)&query->pool_stream);
+
+	_es_batch_output_result_list(&result_list,query->line,delimiter,is_latency,query->latency);
+	
+	ipc3_result_list_kill(&result_list);
+}
+
+// a connection thread.
+// sends queued queries on its own pipe and reads the entire reply into memory.
+// a NULL query tells the thread to exit.
+static DWORD WINAPI _es_batch_connection_thread_proc(void *param)
+{
+	_es_batch_connection_t *connection;
+	_es_batch_pool_t *pool;
+	
+	connection = param;
+	pool = connection->pool;
+	
+	for(;;)
+	{
+		_es_batch_query_t *query;
+		ipc3_stream_pipe_t pipe_stream;
+		DWORD send_tick;
+		
+		WaitForSingleObject(pool->work_semaphore,INFINITE);
+		
+		EnterCriticalSection(&pool->cs);
+		
+		query = pool->work_start;
+		if (query)
+		{
+			pool->work_start = query->next;
+			if (!pool->work_start)
+			{
+				pool->work_last = NULL;
+			}
+		}
+		
+		LeaveCriticalSection(&pool->cs);
+		
+		if (!query)
+		{
+			break;
+		}
+		
+		send_tick = GetTickCount();
+		
+		ipc3_stream_pipe_init(&pipe_stream,connection->pipe_handle);
+		ipc3_stream_pool_init(&query->pool_stream,(ipc3_stream_t *)&pipe_stream);
+		
+		if ((!connection->is_broken) && (ipc3_write_pipe_message(connection->pipe_handle,IPC3_COMMAND_SEARCH,query->packet_cbuf.buf,query->packet_size)))
+		{
+			ipc3_stream_pool_read_all(&query->pool_stream);
+			
+			// keep the pipe in sync after an error reply.
+			if (!ipc3_stream_pipe_skip_reply(&pipe_stream))
+			{
+				connection->is_broken = 1;
+			}
+		}
+		else
+		{
+			connection->is_broken = 1;
+			query->pool_stream.base.is_error = 1;
+		}
+		
+		query->latency = GetTickCount() - send_tick;
+		
+		// the pool stream no longer needs the pipe stream.
+		ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		
+		EnterCriticalSection(&pool->cs);
+		
+		query->next = NULL;
+		
+		if (pool->done_start)
+		{
+			pool->done_last->next = query;
+		}
+		else
+		{
+			pool->done_start = query;
+		}
+		
+		pool->done_last = query;
+		
+		LeaveCriticalSection(&pool->cs);
+
+		ReleaseSemaphore(pool->done_semaphore,1,NULL);
+	}
+	
+	return 0;
+}
+
+// connect up to connection_count pipes.
+// connecting is done on this thread as ipc3_connect_pipe can wait for Everything.
+// *out_connected_count is set to the number of connected pipes, which can be zero.
+// the connections should be closed with _es_batch_disconnect.
+static _es_batch_connection_t *_es_batch_connect(SIZE_T connection_count,SIZE_T *out_connected_count)
+{
+	_es_batch_connection_t *connection_array;
+	SIZE_T connected_count;
+	
+	connection_array = mem_alloc(safe_size_mul(connection_count,sizeof(_es_batch_connection_t)));
+	
+	for(connected_count=0;connected_count<connection_count;connected_count++)
+	{
+		connection_array[connected_count].pipe_handle = ipc3_connect_pipe();
+		if (connection_array[connected_count].pipe_handle == INVALID_HANDLE_VALUE)
+		{
+			// use the connections we have.
+			break;
+		}
+		
+		connection_array[connected_count].pool = NULL;
+		connection_array[connected_count].thread_handle = NULL;
+		connection_array[connected_count].is_broken = 0;
+	}
+	
+	*out_connected_count = connected_count;
+	
+	return connection_array;
+}
+
+static void _es_batch_disconnect(_es_batch_connection_t *connection_array,SIZE_T connected_count)
+{
+	SIZE_T connection_index;
+	
+	for(connection_index=0;connection_index<connected_count;connection_index++)
+	{
+		CloseHandle(connection_array[connection_index].pipe_handle);
+	}
+	
+	mem_free(connection_array);
+}
+
+// run queries on a pool of connections, one thread per connection.
+// next_query_proc is called to get the next query, it returns NULL when there are no more queries.
+// output_query_proc is called for each completed query, the query is freed after it returns.
+// up to in_flight_count queries are searched or waiting to be output at once.
+// queries are output in the order they are returned from next_query_proc, or in the order they complete if is_as_completed is set.
+// the callbacks are only called from this thread.
+static void _es_batch_run(_es_batch_connection_t *connection_array,SIZE_T connected_count,SIZE_T in_flight_count,int is_as_completed,_es_batch_query_t *(*next_query_proc)(void *user_data),void (*output_query_proc)(void *user_data,_es_batch_query_t *query),void *user_data)
+{
+	_es_batch_pool_t pool;
+	_es_batch_query_t **pending_array;
+	SIZE_T connection_index;
+	SIZE_T next_index;
+	SIZE_T output_index;
+	SIZE_T active_count;
+	int is_eof;
+	
+	InitializeCriticalSection(&pool.cs);
+	pool.work_semaphore = CreateSemaphore(NULL,0,0x7fffffff,NULL);
+	pool.done_semaphore = CreateSemaphore(NULL,0,0x7fffffff,NULL);
+	pool.work_start = NULL;
+	pool.work_last = NULL;
+	pool.done_start = NULL;
+	pool.done_last = NULL;
+	
+	for(connection_index=0;connection_index<connected_count;connection_index++)
+	{
+		DWORD thread_id;
+		
+		connection_array[connection_index].pool = &pool;
+		connection_array[connection_index].thread_handle = CreateThread(NULL,0,_es_batch_connection_thread_proc,&connection_array[connection_index],0,&thread_id);
+		if (!connection_array[connection_index].thread_handle)
+		{
+			es_fatal(ES_ERROR_OUT_OF_MEMORY);
+		}
+	}
+	
+	// completed queries waiting for earlier queries to be output.
+	// a query is stored at index % in_flight_count.
+	pending_array = mem_alloc(safe_size_mul(in_flight_count,sizeof(_es_batch_query_t *)));
+	os_zero_memory(pending_array,safe_size_mul(in_flight_count,sizeof(_es_batch_query_t *)));
+	
+	next_index = 0;
+	output_index = 0;
+	active_count = 0;
+	is_eof = 0;
+	
+	for(;;)
+	{
+		_es_batch_query_t *query;
+		
+		// queue more queries.
+		while((!is_eof) && (active_count < in_flight_count))
+		{
+			query = next_query_proc(user_data);
+			if (!query)
+			{
+				is_eof = 1;
+				
+				break;
+			}
+			
+			query->index = next_index++;
+			
+			EnterCriticalSection(&pool.cs);
+			
+			if (pool.work_start)
+			{
+				pool.work_last->next = query;
+			}
+			else
+			{
+				pool.work_start = query;
+			}
+			
+			pool.work_last = query;
+			
+			LeaveCriticalSection(&pool.cs);
+			
+			ReleaseSemaphore(pool.work_semaphore,1,NULL);
+			
+			active_count++;
+		}
+		
+		if (!active_count)
+		{
+			break;
+		}
+		
+		// wait for a query to complete.
+		WaitForSingleObject(pool.done_semaphore,INFINITE);
+		
+		EnterCriticalSection(&pool.cs);
+		
+		query = pool.done_start;
+		pool.done_start = query->next;
+		if (!pool.done_start)
+		{
+			pool.done_last = NULL;
+		}
+		
+		LeaveCriticalSection(&pool.cs);
+		
+		if (is_as_completed)
+		{
+			output_query_proc(user_data,query);
+			_es_batch_query_free(query);
+			
+			active_count--;
+		}
+		else
+		{
+			pending_array[query->index % in_flight_count] = query;
+			
+			// output the completed queries in order.
+			while(pending_array[output_index % in_flight_count])
+			{
+				query = pending_array[output_index % in_flight_count];
+				pending_array[output_index % in_flight_count] = NULL;
+				
+				output_query_proc(user_data,query);
+				_es_batch_query_free(query);
+				
+				output_index++;
+				active_count--;
+			}
+		}
+	}
+	
+	// the work queue is empty, so each thread will get a NULL query and exit.
+	ReleaseSemaphore(pool.work_semaphore,(LONG)connected_count,NULL);
+	
+	for(connection_index=0;connection_index<connected_count;connection_index++)
+	{
+		WaitForSingleObject(connection_array[connection_index].thread_handle,INFINITE);
+		CloseHandle(connection_array[connection_index].thread_handle);
+		
+		connection_array[connection_index].thread_handle = NULL;
+		connection_array[connection_index].pool = NULL;
+	}
+	
+	mem_free(pending_array);
+	
+	CloseHandle(pool.done_semaphore);
+	CloseHandle(pool.work_semaphore);
+	DeleteCriticalSection(&pool.cs);
+}
+
+// get the next query from the -batch file.
+static _es_batch_query_t *_es_batch_file_next_query_proc(void *user_data)
+{
+	_es_batch_file_t *batch_file;
+	
+	batch_file = user_data;
+	
+	return _es_batch_query_alloc(&batch_file->reader,batch_file->search_flags,&batch_file->base_state,batch_file->base_search_wcbuf.buf);
+}
+
+static void _es_batch_file_output_query_proc(void *user_data,_es_batch_query_t *query)
+{
+	_es_batch_file_t *batch_file;
+	
+	batch_file = user_data;
+	
+	_es_batch_query_output(query,batch_file->delimiter,batch_file->is_latency);
+}
+
+// run each query from a file on a pool of pipe connections.
+// up to in_flight_count queries are searched or waiting to be output at once.
+// results are output in input order, or in the order they complete if is_as_completed is set.
+// returns TRUE if connected to at least one pipe.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_batch_concurrent(const wchar_t *filename,const wchar_t *delimiter,int is_latency,SIZE_T connection_count,SIZE_T in_flight_count,int is_as_completed)
+{
+	BOOL ret;
+	_es_batch_connection_t *connection_array;
+	SIZE_T connected_count;
+	
+	ret = FALSE;
+	
+	connection_array = _es_batch_connect(connection_count,&connected_count);
+	
+	if (connected_count)
+	{
+		_es_batch_file_t batch_file;
+		
+		if (!_es_line_reader_open(&batch_file.reader,filename))
+		{
+			_es_bad_switch_param("Unable to open batch file: %S\n",filename);
+		}
+		
+		wchar_buf_init(&batch_file.base_search_wcbuf);
+		
+		batch_file.search_flags = _es_batch_get_search_flags();
+		batch_file.delimiter = delimiter;
+		batch_file.is_latency = is_latency;
+		
+		wchar_buf_copy_wchar_string_n(&batch_file.base_search_wcbuf,_es_search_wcbuf->buf,_es_search_wcbuf->length_in_wchars);
+
+		_es_batch_state_save(&batch_file.base_state);
+		
+		_es_batch_run(connection_array,connected_count,in_flight_count,is_as_completed,_es_batch_file_next_query_proc,_es_batch_file_output_query_proc,&batch_file);
+		
+		_es_batch_state_restore(&batch_file.base_state);
+		_es_batch_state_kill(&batch_file.base_state);
+		
+		wchar_buf_kill(&batch_file.base_search_wcbuf);
+		
+		_es_line_reader_close(&batch_file.reader);
+		
+		ret = TRUE;
+	}
+	
+	_es_batch_disconnect(connection_array,connected_count);
+
+	return ret;
+}
+
+// get the next range of results for a -partitions query.
+// returns NULL if there are no more ranges.
+static _es_batch_query_t *_es_partition_next_query_proc(void *user_data)
+{
+	_es_partition_t *partition;
+	_es_batch_query_t *query;
+	SIZE_T count;
+	
+	partition = user_data;
+	
+	if (partition->next_offset >= partition->end_offset)
+	{
+		return NULL;
+	}
+	
+	count = partition->end_offset - partition->next_offset;
+	if (count > _ES_PARTITION_MAX_RESULTS)
+	{
+		count = _ES_PARTITION_MAX_RESULTS;
+	}
+	
+	query = mem_alloc(sizeof(_es_batch_query_t));
+	
+	query->next = NULL;
+	query->index = 0;
+	query->line = NULL;
+	query->latency = 0;
+	
+	// ranges are output with the command line state.
+	os_zero_memory(&query->state,sizeof(_es_batch_state_t));
+	
+	utf8_buf_init(&query->packet_cbuf);
+	
+	query->packet_size = _es_ipc3_build_search_packet(partition->search_flags,partition->next_offset,count,partition->property_request_array,partition->property_request_count,&query->packet_cbuf);
+	
+	partition->next_offset += count;
+	
+	return query;
+}
+
+// output a range of results from a -partitions query.
+// ranges are output in order.
+static void _es_partition_output_query_proc(void *user_data,_es_batch_query_t *query)
+{
+	_es_partition_t *partition;
+	ipc3_result_list_t result_list;
+	SIZE_T result_run;
+	
+	partition = user_data;
+	
+	ipc3_result_list_init(&result_list,(ipc3_stream_t *)&query->pool_stream);
+	
+	if (result_list.stream->is_error)
+	{
+		_es_ret = ES_ERROR_IPC_ERROR;
+	}
+	else
+	{
+		// each range should see the same result list as the count query.
+		if (result_list.folder_result_count + result_list.file_result_count != partition->result_count)
+		{
+			partition->is_changed = 1;
+		}
+	}
+	
+	result_run = result_list.viewport_count;
+	if (result_run > partition->output_count)
+	{
+		result_run = partition->output_count;
+	}
+	
+	while(result_run)
+	{
+		result_run--;
+		partition->output_count--;
+		
+		_es_output_ipc3_result(&result_list,&partition->property_text_cbuf,partition->is_first_line,partition->output_count ? 1 : 0);
+		
+		partition->is_first_line = 0;
+	}
+	
+	ipc3_result_list_kill(&result_list);
+}
+
+// fetch one sorted result list on several connections.
+// the result list is split into ranges and each range is searched on the next free connection.
+// transfers happen in parallel, ranges are decoded and output in order on this thread.
+// the journal is checked before and after to detect if the index changed.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_partitioned_query(SIZE_T connection_count)
+{
+	BOOL ret;
+	_es_batch_connection_t *connection_array;
+	SIZE_T connected_count;
+	
+	ret = FALSE;
+	
+	connection_array = _es_batch_connect(connection_count,&connected_count);
+	
+	if (connected_count)
+	{
+		HANDLE pipe_handle;
+		_es_partition_t partition;
+		ipc3_journal_info_t start_journal_info;
+		int got_start_journal_info;
+		
+		// the first connection is also used for the count query and journal.
+		pipe_handle = connection_array[0].pipe_handle;
+		
+		partition.search_flags = _es_ipc3_get_search_flags();
+		
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			int is_size_indexed;
+			int is_date_modified_indexed;
+			int is_date_created_indexed;
+			int is_attributes_indexed;
+			
+			is_size_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_SIZE);
+			is_date_modified_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_MODIFIED);
+			is_date_created_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_CREATED);
+			is_attributes_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_ATTRIBUTES);
+			
+			_es_add_standard_efu_columns(is_size_indexed,is_date_modified_indexed,is_date_created_indexed,is_attributes_indexed,1);
+		}
+		
+		if (_es_footer > 0)
+		{
+			// request total size for footer.
+			partition.search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
+		}
+		
+		// the journal is optional, we still check the result counts without it.
+		got_start_journal_info = ipc3_ioctl_expect_output_size(pipe_handle,IPC3_COMMAND_GET_JOURNAL_INFO,NULL,0,&start_journal_info,sizeof(ipc3_journal_info_t));
+		
+		partition.property_request_array = _es_ipc3_alloc_property_request_array(&partition.property_request_count);
+		
+		// get the result count without any results.
+		if (_es_ipc3_write_search(pipe_handle,partition.search_flags,0,0,NULL,0))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			ES_UINT64 total_result_size;
+			ES_UINT64 start_offset;
+			ES_UINT64 end_offset;
+			
+			// we are committed to ipc3
+			if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+			{
+				_es_add_standard_efu_columns(0,0,0,1,0);
+			}
+			
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			partition.result_count = result_list.folder_result_count + result_list.file_result_count;
+			total_result_size = result_list.total_result_size;
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			ipc3_result_list_kill(&result_list);
+			
+			// keep the pipe in sync for the ranges.
+			if (!ipc3_stream_pipe_skip_reply(&pipe_stream))
+			{
+				connection_array[0].is_broken = 1;
+			}
+			
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+			
+			if (_es_no_result_error)
+			{
+				if (partition.result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			// clip the viewport to the result count.
+			start_offset = _es_offset;
+			if (start_offset > partition.result_count)
+			{
+				start_offset = partition.result_count;
+			}
+			
+			end_offset = partition.result_count;
+			if (_es_max_results < end_offset - start_offset)
+			{
+				end_offset = start_offset + _es_max_results;
+			}
+			
+			partition.next_offset = safe_size_from_uint64(start_offset);
+			partition.end_offset = safe_size_from_uint64(end_offset);
+			partition.output_count = partition.end_offset - partition.next_offset;
+			partition.is_first_line = 1;
+			partition.is_changed = 0;
+			
+			utf8_buf_init(&partition.property_text_cbuf);
+			
+			_es_output_page_begin();
+			
+			if (_es_header > 0)
+			{
+				_es_output_header();
+			}
+			
+			// keep a range waiting on each connection while we output.
+			_es_batch_run(connection_array,connected_count,safe_size_mul(connected_count,2),0,_es_partition_next_query_proc,_es_partition_output_query_proc,&partition);
+			
+			if (partition.output_count)
+			{
+				// a range returned fewer results than expected.
+				partition.is_changed = 1;
+			}
+			
+			if (_es_footer > 0)
+			{
+				_es_output_footer(partition.result_count,total_result_size);
+			}
+			
+			_es_output_page_end();
+			
+			utf8_buf_kill(&partition.property_text_cbuf);
+			
+			if ((got_start_journal_info) && (!connection_array[0].is_broken))
+			{
+				ipc3_journal_info_t end_journal_info;
+				
+				if (ipc3_ioctl_expect_output_size(pipe_handle,IPC3_COMMAND_GET_JOURNAL_INFO,NULL,0,&end_journal_info,sizeof(ipc3_journal_info_t)))
+				{
+					if ((end_journal_info.journal_id != start_journal_info.journal_id) || (end_journal_info.next_change_id != start_journal_info.next_change_id))
+					{
+						partition.is_changed = 1;
+					}
+				}
+			}
+			
+			if (partition.is_changed)
+			{
+				os_error_printf("Error %d: %s",ES_ERROR_RESULTS_CHANGED,"The index changed while reading results.\r\n");
+				
+				_es_ret = ES_ERROR_RESULTS_CHANGED;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+		}
+		
+		if (partition.property_request_array)
+		{
+			mem_free(partition.property_request_array);
+		}
+	}
+	
+	_es_batch_disconnect(connection_array,connected_count);
+
+	return ret;
+}
+
+// read the next item from an instance reply.
+// the item is recorded so it can be output later.
+// the sort key values are stored in the instance key array.
+// the merge fails if the item sorts before the previous item from the same instance.
+// returns TRUE if an item was read.
+// returns FALSE if there are no more items or on error.
+static BOOL _es_instance_read_item(_es_merge_t *merge,_es_instance_t *instance)
+{
+	ipc3_stream_t *stream;
+	SIZE_T property_request_run;
+	const ipc3_result_list_property_request_t *property_request_p;
+	const SIZE_T *property_key_index_p;
+	_es_instance_key_t *swap_key_array;
+	
+	if (!instance->result_run)
+	{
+		return FALSE;
+	}
+	
+	instance->result_run--;
+	
+	// keep the sort values of the current item.
+	// the text buffers are reused.
+	swap_key_array = instance->prev_key_array;
+	instance->prev_key_array = instance->key_array;
+	instance->key_array = swap_key_array;
+	instance->prev_item_flags = instance->item_flags;
+	
+	stream = (ipc3_stream_t *)&instance->record_stream;
+	
+	ipc3_stream_record_clear(&instance->record_stream);
+	
+	instance->item_flags = ipc3_stream_read_byte(stream);
+	
+	property_request_run = instance->result_list.property_request_count;
+	property_request_p = (const ipc3_result_list_property_request_t *)instance->result_list.property_request_cbuf.buf;
+	property_key_index_p = instance->property_key_index_array;
+	
+	while(property_request_run)
+	{
+		if (*property_key_index_p != SIZE_MAX)
+		{
+			_es_instance_key_t *key;
+			
+			key = &instance->key_array[*property_key_index_p];
+			
+			switch(property_request_p->value_type)
+			{
+				case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+				case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+				case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+				case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+				case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+				
+					ipc3_result_list_read_property_text(stream,property_request_p,&merge->key_text_cbuf);
+					
+					wchar_buf_copy_utf8_string(&key->text_wcbuf,merge->key_text_cbuf.buf);
+					
+					key->is_text = 1;
+					
+					break;
+					
+				default:
+				
+					// ES_UINT64_MAX if the value is not an integer.
+					key->value = ipc3_result_list_read_property_uint64(stream,property_request_p);
+					
+					break;
+			}
+		}
+		else
+		{
+			ipc3_result_list_skip_property_value(stream,property_request_p);
+		}
+		
+		property_request_p++;
+		property_key_index_p++;
+		property_request_run--;
+	}
+	
+	if (stream->is_error)
+	{
+		_es_ret = ES_ERROR_IPC_ERROR;
+		
+		instance->result_run = 0;
+		
+		return FALSE;
+	}
+	
+	// our compare must agree with the sort Everything used.
+	// Otherwise, the merged results would be silently out of order.
+	if (instance->is_prev_item)
+	{
+		if (_es_instance_compare_keys(merge,instance->item_flags,instance->key_array,instance->prev_item_flags,instance->prev_key_array) < 0)
+		{
+			debug_error_printf("instance %S results are not in the merge order\n",instance->name_wcbuf.buf);
+			
+			merge->is_out_of_order = 1;
+			
+			instance->result_run = 0;
+			
+			return FALSE;
+		}
+	}
+	
+	instance->is_prev_item = 1;
+	
+	return TRUE;
+}
+
+// compare the sort values of two items.
+// uses the same order as the search sort.
+// folders are shown first.
+// returns 0 if the items have the same sort values.
+static int _es_instance_compare_keys(const _es_merge_t *merge,BYTE a_item_flags,const _es_instance_key_t *a_key_array,BYTE b_item_flags,const _es_instance_key_t *b_key_array)
+{
+	SIZE_T key_index;
+	
+	// folders first.
+	if ((a_item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER) != (b_item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER))
+	{
+		if (a_item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
+		{
+			return -1;
+		}
+		
+		return 1;
+	}
+	
+	for(key_index=0;key_index<merge->sort_count;key_index++)
+	{
+		const _es_instance_key_t *a_key;
+		const _es_instance_key_t *b_key;
+		int cmp;
+		
+		a_key = &a_key_array[key_index];
+		b_key = &b_key_array[key_index];
+		
+		cmp = 0;
+		
+		if ((a_key->is_text) && (b_key->is_text))
+		{
+			int cmp_ret;
+			
+			cmp_ret = CompareString(LOCALE_USER_DEFAULT,NORM_IGNORECASE,a_key->text_wcbuf.buf,-1,b_key->text_wcbuf.buf,-1);
+			
+			if (cmp_ret == CSTR_LESS_THAN)
+			{
+				cmp = -1;
+			}
+			else
+			if (cmp_ret == CSTR_GREATER_THAN)
+			{
+				cmp = 1;
+			}
+		}
+		else
+		{
+			if (a_key->value < b_key->value)
+			{
+				cmp = -1;
+			}
+			else
+			if (a_key->value > b_key->value)
+			{
+				cmp = 1;
+			}
+		}
+		
+		if (cmp)
+		{
+			if (!merge->sort_array[key_index].is_ascending)
+			{
+				cmp = -cmp;
+			}
+			
+			return cmp;
+		}
+	}
+	
+	return 0;
+}
+
+// compare the current items from two instances.
+// items that compare equal keep the -instances order.
+static int _es_instance_compare(const _es_merge_t *merge,const _es_instance_t *a,const _es_instance_t *b)
+{
+	int cmp;
+	
+	cmp = _es_instance_compare_keys(merge,a->item_flags,a->key_array,b->item_flags,b->key_array);
+	if (cmp)
+	{
+		return cmp;
+	}
+	
+	if (a->index < b->index)
+	{
+		return -1;
+	}
+	
+	if (a->index > b->index)
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+// move a heap item up until its parent is smaller.
+static void _es_merge_heap_sift_up(_es_merge_t *merge,SIZE_T index)
+{
+	while(index)
+	{
+		SIZE_T parent_index;
+		_es_instance_t *swap_instance;
+		
+		parent_index = (index - 1) / 2;
+		
+		if (_es_instance_compare(merge,merge->heap_array[index],merge->heap_array[parent_index]) >= 0)
+		{
+			break;
+		}
+		
+		swap_instance = merge->heap_array[index];
+		merge->heap_array[index] = merge->heap_array[parent_index];
+		merge->heap_array[parent_index] = swap_instance;
+		
+		index = parent_index;
+	}
+}
+
+// move a heap item down until its children are larger.
+static void _es_merge_heap_sift_down(_es_merge_t *merge,SIZE_T index)
+{
+	for(;;)
+	{
+		SIZE_T smallest_index;
+		SIZE_T child_index;
+		_es_instance_t *swap_instance;
+		
+		smallest_index = index;
+		
+		child_index = (index * 2) + 1;
+		
+		if ((child_index < merge->heap_count) && (_es_instance_compare(merge,merge->heap_array[child_index],merge->heap_array[smallest_index]) < 0))
+		{
+			smallest_index = child_index;
+		}
+		
+		child_index++;
+		
+		if ((child_index < merge->heap_count) && (_es_instance_compare(merge,merge->heap_array[child_index],merge->heap_array[smallest_index]) < 0))
+		{
+			smallest_index = child_index;
+		}
+		
+		if (smallest_index == index)
+		{
+			break;
+		}
+		
+		swap_instance = merge->heap_array[index];
+		merge->heap_array[index] = merge->heap_array[smallest_index];
+		merge->heap_array[smallest_index] = swap_instance;
+		
+		index = smallest_index;
+	}
+}
+
+// output the merged results from all instances.
+// only the current item from each instance is kept in memory.
+// -offset and -max-results apply to the merged results.
+static void _es_output_merged_results(_es_merge_t *merge,SIZE_T result_count,ES_UINT64 total_result_size)
+{
+	SIZE_T instance_index;
+	ES_UINT64 skip_count;
+	ES_UINT64 output_count;
+	int is_first_line;
+	utf8_buf_t property_text_cbuf;
+	
+	utf8_buf_init(&property_text_cbuf);
+	
+	_es_output_page_begin();
+	
+	if (_es_header > 0)
+	{
+		_es_output_header();
+	}
+	
+	// fill the heap with the first item from each instance.
+	merge->heap_count = 0;
+	
+	for(instance_index=0;instance_index<merge->instance_count;instance_index++)
+	{
+		if (_es_instance_read_item(merge,&merge->instance_array[instance_index]))
+		{
+			merge->heap_array[merge->heap_count] = &merge->instance_array[instance_index];
+			merge->heap_count++;
+			
+			_es_merge_heap_sift_up(merge,merge->heap_count - 1);
+		}
+	}
+	
+	skip_count = _es_offset;
+	output_count = _es_max_results;
+	is_first_line = 1;
+	
+	while((merge->heap_count) && (output_count) && (!merge->is_out_of_order))
+	{
+		_es_instance_t *instance;
+		
+		instance = merge->heap_array[0];
+		
+		if (skip_count)
+		{
+			skip_count--;
+		}
+		else
+		{
+			ipc3_stream_memory_t memory_stream;
+			int is_more;
+			
+			output_count--;
+			
+			is_more = 0;
+			
+			if ((output_count) && ((merge->heap_count > 1) || (instance->result_run)))
+			{
+				is_more = 1;
+			}
+			
+			// read the recorded item.
+			ipc3_stream_memory_init(&memory_stream,instance->record_stream.buf,instance->record_stream.size,instance->record_stream.base.is_64bit);
+			
+			instance->result_list.stream = (ipc3_stream_t *)&memory_stream;
+			
+			_es_output_ipc3_result(&instance->result_list,&property_text_cbuf,is_first_line,is_more);
+			
+			instance->result_list.stream = (ipc3_stream_t *)&instance->pipe_stream;
+			
+			ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+			
+			is_first_line = 0;
+		}
+		
+		// replace the item with the next item from the same instance.
+		if (!_es_instance_read_item(merge,instance))
+		{
+			merge->heap_count--;
+			merge->heap_array[0] = merge->heap_array[merge->heap_count];
+		}
+		
+		_es_merge_heap_sift_down(merge,0);
+	}
+	
+	if (merge->is_out_of_order)
+	{
+		os_error_printf("Error %d: %s",ES_ERROR_IPC_ERROR,"An instance returned results in a different sort order.\r\n");
+		
+		_es_ret = ES_ERROR_IPC_ERROR;
+	}
+	
+	if (_es_footer > 0)
+	{
+		_es_output_footer(result_count,total_result_size);
+	}
+	
+	_es_output_page_end();
+	
+	utf8_buf_kill(&property_text_cbuf);
+}
+
+// search multiple Everything instances at the same time and merge the results.
+// instance_list is a comma delimited list of instance names.
+// an empty name is the default instance.
+// each instance is asked for the first offset + max-results items with the same sort.
+// the sort values are requested as extra properties so the sorted replies can be merged.
+// the replies are read one item at a time with a k-way merge.
+// returns TRUE if the search was sent to all instances.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_federated_query(const wchar_t *instance_list)
+{
+	BOOL ret;
+	_es_merge_t merge;
+	SIZE_T instance_index;
+	SIZE_T connected_count;
+	
+	ret = FALSE;
+	
+	utf8_buf_init(&merge.key_text_cbuf);
+	merge.is_out_of_order = 0;
+	
+	// count the instances.
+	{
+		const wchar_t *p;
+		
+		merge.instance_count = 1;
+		
+		p = instance_list;
+		
+		while(*p)
+		{
+			if (*p == ',')
+			{
+				merge.instance_count = safe_size_add_one(merge.instance_count);
+			}
+			
+			p++;
+		}
+	}
+	
+	// sort keys.
+	merge.sort_count = 1 + secondary_sort_array->count;
+	merge.sort_array = mem_alloc(safe_size_mul(merge.sort_count,sizeof(_es_merge_sort_t)));
+	
+	merge.sort_array[0].property_id = _es_primary_sort_property_id;
+	merge.sort_array[0].is_ascending = _es_resolve_sort_ascending(_es_primary_sort_property_id,_es_primary_sort_ascending);
+	
+	{
+		secondary_sort_t *secondary_sort;
+		_es_merge_sort_t *sort_d;
+		
+		secondary_sort = secondary_sort_start;
+		sort_d = merge.sort_array + 1;
+		
+		while(secondary_sort)
+		{
+			sort_d->property_id = secondary_sort->property_id;
+			sort_d->is_ascending = _es_resolve_sort_ascending(secondary_sort->property_id,secondary_sort->ascending);
+			
+			sort_d++;
+			secondary_sort = secondary_sort->next;
+		}
+	}
+	
+	merge.instance_array = mem_alloc(safe_size_mul(merge.instance_count,sizeof(_es_instance_t)));
+	merge.heap_array = mem_alloc(safe_size_mul_sizeof_pointer(merge.instance_count));
+	merge.heap_count = 0;
+	
+	// connect to each instance.
+	{
+		const wchar_t *p;
+		wchar_buf_t *old_instance_name_wcbuf;
+		
+		old_instance_name_wcbuf = es_instance_name_wcbuf;
+		
+		p = instance_list;
+		connected_count = 0;
+		
+		for(instance_index=0;instance_index<merge.instance_count;instance_index++)
+		{
+			_es_instance_t *instance;
+			const wchar_t *start;
+			SIZE_T key_index;
+			
+			instance = &merge.instance_array[instance_index];
+			
+			start = p;
+			
+			while((*p) && (*p != ','))
+			{
+				p++;
+			}
+			
+			wchar_buf_init(&instance->name_wcbuf);
+			wchar_buf_copy_wchar_string_n(&instance->name_wcbuf,start,p - start);
+			
+			if (*p)
+			{
+				// skip the comma.
+				p++;
+			}
+			
+			instance->index = instance_index;
+			instance->result_run = 0;
+			instance->property_key_index_array = NULL;
+			instance->is_reply = 0;
+			
+			instance->key_array = mem_alloc(safe_size_mul(merge.sort_count,sizeof(_es_instance_key_t)));
+			instance->prev_key_array = mem_alloc(safe_size_mul(merge.sort_count,sizeof(_es_instance_key_t)));
+			instance->item_flags = 0;
+			instance->is_prev_item = 0;
+			
+			for(key_index=0;key_index<merge.sort_count;key_index++)
+			{
+				// keys missing from the reply compare equal.
+				instance->key_array[key_index].is_text = 0;
+				instance->key_array[key_index].value = ES_UINT64_MAX;
+				instance->prev_key_array[key_index].is_text = 0;
+				instance->prev_key_array[key_index].value = ES_UINT64_MAX;
+				
+				wchar_buf_init(&instance->key_array[key_index].text_wcbuf);
+				wchar_buf_init(&instance->prev_key_array[key_index].text_wcbuf);
+			}
+			
+			// the pipe name is built from the global instance name.
+			es_instance_name_wcbuf = &instance->name_wcbuf;
+			
+			instance->pipe_handle = ipc3_connect_pipe();
+			
+			es_instance_name_wcbuf = old_instance_name_wcbuf;
+			
+			if (instance->pipe_handle != INVALID_HANDLE_VALUE)
+			{
+				connected_count++;
+			}
+			else
+			{
+				debug_error_printf("instance %S not found\n",instance->name_wcbuf.buf);
+			}
+		}
+	}
+	
+	// all instances are required to merge the results.
+	if (connected_count == merge.instance_count)
+	{
+		DWORD search_flags;
+		ipc3_search_property_request_t *property_request_array;
+		SIZE_T property_request_count;
+		SIZE_T column_property_request_count;
+		SIZE_T viewport_count;
+		SIZE_T sent_count;
+		
+		search_flags = _es_ipc3_get_search_flags();
+		
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			int is_size_indexed;
+			int is_date_modified_indexed;
+			int is_date_created_indexed;
+			int is_attributes_indexed;
+			HANDLE pipe_handle;
+			
+			// assume the instances index the same properties.
+			pipe_handle = merge.instance_array[0].pipe_handle;
+			
+			is_size_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_SIZE);
+			is_date_modified_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_MODIFIED);
+			is_date_created_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_CREATED);
+			is_attributes_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_ATTRIBUTES);
+			
+			_es_add_standard_efu_columns(is_size_indexed,is_date_modified_indexed,is_date_created_indexed,is_attributes_indexed,1);
+		}
+		
+		if (_es_get_total_size)
+		{
+			// request total size for output.
+			search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
+
+			// we don't need any results.
+			_es_max_results = 0;
+			
+			// we don't need any columns
+			column_clear_all();
+		}
+		
+		if (_es_footer > 0)
+		{
+			// request total size for footer.
+			search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
+		}
+		
+		// request the raw sort values after the columns.
+		{
+			ipc3_search_property_request_t *column_property_request_array;
+			SIZE_T key_index;
+			
+			column_property_request_array = _es_ipc3_alloc_property_request_array(&column_property_request_count);
+			
+			property_request_count = safe_size_add(column_property_request_count,merge.sort_count);
+			property_request_array = mem_alloc(safe_size_mul(property_request_count,sizeof(ipc3_search_property_request_t)));
+			
+			if (column_property_request_array)
+			{
+				os_copy_memory(property_request_array,column_property_request_array,column_property_request_count * sizeof(ipc3_search_property_request_t));
+				
+				mem_free(column_property_request_array);
+			}
+			
+			for(key_index=0;key_index<merge.sort_count;key_index++)
+			{
+				property_request_array[column_property_request_count + key_index].property_id = merge.sort_array[key_index].property_id;
+				property_request_array[column_property_request_count + key_index].flags = 0;
+			}
+		}
+		
+		// every instance could have the whole viewport.
+		viewport_count = 0;
+		
+		if (_es_max_results)
+		{
+			viewport_count = safe_size_add(safe_size_from_uint64(_es_offset),safe_size_from_uint64(_es_max_results));
+		}
+		
+		// send the search to every instance before reading any replies.
+		// so the instances search at the same time.
+		sent_count = 0;
+		
+		for(instance_index=0;instance_index<merge.instance_count;instance_index++)
+		{
+			if (!_es_ipc3_write_search(merge.instance_array[instance_index].pipe_handle,search_flags,0,viewport_count,property_request_array,property_request_count))
+			{
+				break;
+			}
+			
+			sent_count++;
+		}
+		
+		if (sent_count == merge.instance_count)
+		{
+			SIZE_T result_count;
+			ES_UINT64 total_result_size;
+			
+			// we are committed to ipc3
+			if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+			{
+				_es_add_standard_efu_columns(0,0,0,1,0);
+			}
+			
+			result_count = 0;
+			total_result_size = 0;
+			
+			for(instance_index=0;instance_index<merge.instance_count;instance_index++)
+			{
+				_es_instance_t *instance;
+				
+				instance = &merge.instance_array[instance_index];
+				
+				// setup our initial result list from the stream.
+				// don't read any items yet.
+				ipc3_stream_pipe_init(&instance->pipe_stream,instance->pipe_handle);
+				ipc3_result_list_init(&instance->result_list,(ipc3_stream_t *)&instance->pipe_stream);
+				ipc3_stream_record_init(&instance->record_stream,(ipc3_stream_t *)&instance->pipe_stream);
+				
+				instance->is_reply = 1;
+				
+				if (instance->result_list.stream->is_error)
+				{
+					_es_ret = ES_ERROR_IPC_ERROR;
+				}
+				else
+				{
+					instance->result_run = instance->result_list.viewport_count;
+				}
+				
+				result_count = safe_size_add(result_count,instance->result_list.folder_result_count + instance->result_list.file_result_count);
+				
+				if ((instance->result_list.total_result_size == ES_UINT64_MAX) || (total_result_size == ES_UINT64_MAX))
+				{
+					total_result_size = ES_UINT64_MAX;
+				}
+				else
+				{
+					total_result_size += instance->result_list.total_result_size;
+				}
+				
+				// find the sort values in the reply.
+				// the sort values are the last properties with a matching property id.
+				if (instance->result_list.property_request_count)
+				{
+					const ipc3_result_list_property_request_t *reply_property_request_array;
+					SIZE_T key_index;
+					SIZE_T property_request_index;
+					
+					reply_property_request_array = (const ipc3_result_list_property_request_t *)instance->result_list.property_request_cbuf.buf;
+					
+					instance->property_key_index_array = mem_alloc(safe_size_mul(instance->result_list.property_request_count,sizeof(SIZE_T)));
+					
+					for(property_request_index=0;property_request_index<instance->result_list.property_request_count;property_request_index++)
+					{
+						instance->property_key_index_array[property_request_index] = SIZE_MAX;
+					}
+					
+					for(key_index=0;key_index<merge.sort_count;key_index++)
+					{
+						property_request_index = instance->result_list.property_request_count;
+						
+						while(property_request_index)
+						{
+							property_request_index--;
+							
+							if ((reply_property_request_array[property_request_index].property_id == merge.sort_array[key_index].property_id) && (!(reply_property_request_array[property_request_index].flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))) && (instance->property_key_index_array[property_request_index] == SIZE_MAX))
+							{
+								instance->property_key_index_array[property_request_index] = key_index;
+								
+								break;
+							}
+						}
+					}
+				}
+			}
+			
+			if (_es_no_result_error)
+			{
+				if (result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (_es_get_result_count)
+			{
+				_es_output_noncell_result_count(result_count);
+			}
+			else
+			if (_es_get_total_size)
+			{
+				_es_output_noncell_total_size(total_result_size);
+			}
+			else
+			{
+				_es_output_merged_results(&merge,result_count,total_result_size);
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+		}
+		
+		mem_free(property_request_array);
+	}
+	
+	for(instance_index=0;instance_index<merge.instance_count;instance_index++)
+	{
+		_es_instance_t *instance;
+		SIZE_T key_index;
+		
+		instance = &merge.instance_array[instance_index];
+		
+		if (instance->is_reply)
+		{
+			ipc3_stream_close((ipc3_stream_t *)&instance->record_stream);
+			ipc3_result_list_kill(&instance->result_list);
+			ipc3_stream_close((ipc3_stream_t *)&instance->pipe_stream);
+		}
+		
+		if (instance->property_key_index_array)
+		{
+			mem_free(instance->property_key_index_array);
+		}
+		
+		for(key_index=0;key_index<merge.sort_count;key_index++)
+		{
+			wchar_buf_kill(&instance->prev_key_array[key_index].text_wcbuf);
+			wchar_buf_kill(&instance->key_array[key_index].text_wcbuf);
+		}
+		
+		mem_free(instance->prev_key_array);
+		mem_free(instance->key_array);
+		
+		if (instance->pipe_handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(instance->pipe_handle);
+		}
+		
+		wchar_buf_kill(&instance->name_wcbuf);
+	}
+	
+	mem_free(merge.heap_array);
+	mem_free(merge.instance_array);
+	mem_free(merge.sort_array);
+	utf8_buf_kill(&merge.key_text_cbuf);
+	
+	return ret;
+}
+
+// parse a function call, eg: sum(size)
+// returns TRUE if s is a call to function_name and stores the argument in out_argument_wcbuf.
+// Otherwise, returns FALSE.
+static BOOL _es_group_parse_function(const wchar_t *s,const char *function_name,wchar_buf_t *out_argument_wcbuf)
+{
+	const wchar_t *p;
+	
+	p = wchar_string_parse_nocase_lowercase_ascii_string(s,function_name);
+	
+	if ((p) && (*p == '('))
+	{
+		SIZE_T argument_length;
+		
+		p++;
+		
+		argument_length = wchar_string_get_length_in_wchars(p);
+		
+		if ((argument_length) && (p[argument_length - 1] == ')'))
+		{
+			wchar_buf_copy_wchar_string_n(out_argument_wcbuf,p,argument_length - 1);
+			
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+static DWORD _es_group_find_property(const wchar_t *property_name)
+{
+	DWORD property_id;
+	
+	property_id = property_find(property_name,_es_should_allow_property_system(property_name));
+	
+	if (property_id == EVERYTHING3_INVALID_PROPERTY_ID)
+	{
+		_es_bad_switch_param("Unknown property: %S\n",property_name);
+	}
+	
+	return property_id;
+}
+
+static const ES_UTF8 *_es_group_get_agg_name(BYTE agg_type)
+{
+	switch(agg_type)
+	{
+		case GROUP_AGG_TYPE_SUM:
+			return "sum";
+			
+		case GROUP_AGG_TYPE_MIN:
+			return "min";
+			
+		case GROUP_AGG_TYPE_MAX:
+			return "max";
+			
+		case GROUP_AGG_TYPE_AVG:
+			return "avg";
+	}
+	
+	return "count";
+}
+
+// parse the -group-by key and the -agg list.
+// key can be a property or year(property), month(property) or day(property) for dates.
+// agg_list is a comma delimited list of count, sum(property), min(property), max(property) and avg(property).
+// agg_list can be NULL to count each group.
+// exits with an error for an unknown property or aggregate.
+static void _es_group_by_init(_es_group_by_t *group_by,const wchar_t *key,const wchar_t *agg_list,SIZE_T key_depth)
+{
+	wchar_buf_t item_wcbuf;
+	wchar_buf_t argument_wcbuf;
+	
+	wchar_buf_init(&item_wcbuf);
+	wchar_buf_init(&argument_wcbuf);
+	
+	group_by->key_depth = key_depth;
+	group_by->key_date_part = _ES_GROUP_KEY_DATE_PART_NONE;
+	
+	if (_es_group_parse_function(key,"year",&argument_wcbuf))
+	{
+		group_by->key_date_part = _ES_GROUP_KEY_DATE_PART_YEAR;
+	}
+	else
+	if (_es_group_parse_function(key,"month",&argument_wcbuf))
+	{
+		group_by->key_date_part = _ES_GROUP_KEY_DATE_PART_MONTH;
+	}
+	else
+	if (_es_group_parse_function(key,"day",&argument_wcbuf))
+	{
+		group_by->key_date_part = _ES_GROUP_KEY_DATE_PART_DAY;
+	}
+	else
+	{
+		wchar_buf_copy_wchar_string(&argument_wcbuf,key);
+	}
+	
+	group_by->key_property_id = _es_group_find_property(argument_wcbuf.buf);
+	
+	if (group_by->key_date_part != _ES_GROUP_KEY_DATE_PART_NONE)
+	{
+		if (property_get_format(group_by->key_property_id) != PROPERTY_FORMAT_FILETIME)
+		{
+			_es_bad_switch_param("Not a date property: %S\n",argument_wcbuf.buf);
+		}
+	}
+	
+	// count the aggregates.
+	group_by->agg_count = 1;
+	
+	if (agg_list)
+	{
+		const wchar_t *p;
+		
+		p = agg_list;
+		
+		while(*p)
+		{
+			if (*p == ',')
+			{
+				group_by->agg_count = safe_size_add_one(group_by->agg_count);
+			}
+			
+			p++;
+		}
+	}
+	
+	group_by->agg_array = mem_alloc(safe_size_mul(group_by->agg_count,sizeof(_es_group_agg_t)));
+	group_by->agg_type_array = mem_alloc(group_by->agg_count);
+	
+	if (agg_list)
+	{
+		const wchar_t *agg_list_p;
+		SIZE_T agg_count;
+		
+		agg_list_p = agg_list;
+		agg_count = 0;
+		
+		for(;;)
+		{
+			_es_group_agg_t *agg;
+			
+			agg_list_p = wchar_string_parse_list_item(agg_list_p,&item_wcbuf);
+			if (!agg_list_p)
+			{
+				break;
+			}
+			
+			if (!item_wcbuf.length_in_wchars)
+			{
+				continue;
+			}
+			
+			agg = &group_by->agg_array[agg_count];
+			
+			agg->property_id = EVERYTHING3_INVALID_PROPERTY_ID;
+			
+			if (wchar_string_compare(item_wcbuf.buf,L"count") == 0)
+			{
+				agg->agg_type = GROUP_AGG_TYPE_COUNT;
+			}
+			else
+			{
+				BYTE agg_type;
+				
+				for(agg_type=GROUP_AGG_TYPE_SUM;agg_type<=GROUP_AGG_TYPE_AVG;agg_type++)
+				{
+					if (_es_group_parse_function(item_wcbuf.buf,_es_group_get_agg_name(agg_type),&argument_wcbuf))
+					{
+						break;
+					}
+				}
+				
+				if (agg_type > GROUP_AGG_TYPE_AVG)
+				{
+					_es_bad_switch_param("Unknown aggregate: %S\n",item_wcbuf.buf);
+				}
+				
+				agg->agg_type = agg_type;
+				agg->property_id = _es_group_find_property(argument_wcbuf.buf);
+			}
+			
+			agg_count++;
+		}
+		
+		group_by->agg_count = agg_count;
+	}
+	
+	if (!group_by->agg_count)
+	{
+		// default to count.
+		group_by->agg_array[0].agg_type = GROUP_AGG_TYPE_COUNT;
+		group_by->agg_array[0].property_id = EVERYTHING3_INVALID_PROPERTY_ID;
+		group_by->agg_count = 1;
+	}
+	
+	{
+		SIZE_T agg_index;
+		
+		for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+		{
+			group_by->agg_type_array[agg_index] = group_by->agg_array[agg_index].agg_type;
+			group_by->agg_array[agg_index].property_request_index = SIZE_MAX;
+		}
+	}
+	
+	wchar_buf_kill(&argument_wcbuf);
+	wchar_buf_kill(&item_wcbuf);
+}
+
+static void _es_group_by_kill(_es_group_by_t *group_by)
+{
+	mem_free(group_by->agg_type_array);
+	mem_free(group_by->agg_array);
+}
+
+// find a raw property value in a reply.
+// returns the index of the property in the reply.
+// returns SIZE_MAX if the property is not in the reply.
+static SIZE_T _es_group_find_reply_property(const ipc3_result_list_t *result_list,DWORD property_id)
+{
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	SIZE_T property_request_index;
+	
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	if (property_id != EVERYTHING3_INVALID_PROPERTY_ID)
+	{
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			if ((reply_property_request_array[property_request_index].property_id == property_id) && (!(reply_property_request_array[property_request_index].flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))))
+			{
+				return property_request_index;
+			}
+		}
+	}
+	
+	return SIZE_MAX;
+}
+
+// convert a filetime to a local yyyy, yyyymm or yyyymmdd key.
+// returns ES_UINT64_MAX if the date is unknown.
+static ES_UINT64 _es_group_get_date_key(ES_UINT64 filetime,int date_part)
+{
+	SYSTEMTIME st;
+	
+	if (filetime == ES_UINT64_MAX)
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	if (!os_filetime_to_localtime(filetime,&st))
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	switch(date_part)
+	{
+		case _ES_GROUP_KEY_DATE_PART_YEAR:
+			return st.wYear;
+			
+		case _ES_GROUP_KEY_DATE_PART_MONTH:
+			return (st.wYear * 100) + st.wMonth;
+	}
+	
+	return (st.wYear * 10000) + (st.wMonth * 100) + st.wDay;
+}
+
+// get the length of the first key_depth path parts of key.
+static SIZE_T _es_group_get_key_depth_length(const ES_UTF8 *key,SIZE_T key_len,SIZE_T key_depth)
+{
+	SIZE_T index;
+	
+	for(index=0;index<key_len;index++)
+	{
+		if ((key[index] == '\\') || (key[index] == '/'))
+		{
+			key_depth--;
+			
+			if (!key_depth)
+			{
+				return index;
+			}
+		}
+	}
+	
+	return key_len;
+}
+
+// read each item from the reply and add it to its group.
+// only one item is kept in memory.
+// the groups are output once the whole reply is read.
+static void _es_group_read_results(_es_group_by_t *group_by,ipc3_result_list_t *result_list)
+{
+	group_list_t group_list;
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	SIZE_T key_property_request_index;
+	ES_UINT64 *property_value_array;
+	ES_UINT64 *agg_value_array;
+	utf8_buf_t key_cbuf;
+	int key_type;
+	SIZE_T agg_index;
+	SIZE_T result_run;
+	
+	utf8_buf_init(&key_cbuf);
+	
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	key_property_request_index = _es_group_find_reply_property(result_list,group_by->key_property_id);
+	
+	for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+	{
+		group_by->agg_array[agg_index].property_request_index = _es_group_find_reply_property(result_list,group_by->agg_array[agg_index].property_id);
+	}
+	
+	// text values are grouped by text.
+	// everything else is grouped by value.
+	key_type = GROUP_KEY_TYPE_NUMBER;
+	
+	if (key_property_request_index != SIZE_MAX)
+	{
+		switch(reply_property_request_array[key_property_request_index].value_type)
+		{
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+				key_type = GROUP_KEY_TYPE_TEXT;
+				break;
+		}
+	}
+	
+	group_list_init(&group_list,key_type,group_by->agg_type_array,group_by->agg_count);
+	
+	property_value_array = mem_alloc(safe_size_mul(safe_size_add_one(result_list->property_request_count),sizeof(ES_UINT64)));
+	agg_value_array = mem_alloc(safe_size_mul(group_by->agg_count,sizeof(ES_UINT64)));
+	
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		SIZE_T property_request_index;
+		group_t *group;
+		
+		// item flags.
+		ipc3_stream_read_byte(result_list->stream);
+		
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			if ((property_request_index == key_property_request_index) && (key_type == GROUP_KEY_TYPE_TEXT))
+			{
+				ipc3_result_list_read_property_text(result_list->stream,&reply_property_request_array[property_request_index],&key_cbuf);
+				
+				property_value_array[property_request_index] = ES_UINT64_MAX;
+			}
+			else
+			{
+				// ES_UINT64_MAX if the value is not an integer.
+				property_value_array[property_request_index] = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+		}
+		
+		if (result_list->stream->is_error)
+		{
+			break;
+		}
+		
+		if (key_type == GROUP_KEY_TYPE_TEXT)
+		{
+			SIZE_T key_len;
+			
+			key_len = key_cbuf.length_in_bytes;
+			
+			if (group_by->key_depth)
+			{
+				key_len = _es_group_get_key_depth_length(key_cbuf.buf,key_len,group_by->key_depth);
+			}
+			
+			group = group_list_add_text(&group_list,key_cbuf.buf,key_len);
+		}
+		else
+		{
+			ES_UINT64 key_value;
+			
+			key_value = ES_UINT64_MAX;
+			
+			if (key_property_request_index != SIZE_MAX)
+			{
+				key_value = property_value_array[key_property_request_index];
+			}
+			
+			if (group_by->key_date_part != _ES_GROUP_KEY_DATE_PART_NONE)
+			{
+				key_value = _es_group_get_date_key(key_value,group_by->key_date_part);
+			}
+			
+			group = group_list_add_number(&group_list,key_value);
+		}
+		
+		for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+		{
+			agg_value_array[agg_index] = ES_UINT64_MAX;
+			
+			if (group_by->agg_array[agg_index].property_request_index != SIZE_MAX)
+			{
+				agg_value_array[agg_index] = property_value_array[group_by->agg_array[agg_index].property_request_index];
+			}
+		}
+		
+		group_add_values(&group_list,group,agg_value_array);
+		
+		result_run--;
+	}
+	
+	if (!result_list->stream->is_error)
+	{
+		group_list_sort(&group_list);
+		
+		_es_output_groups(group_by,&group_list);
+	}
+	
+	mem_free(agg_value_array);
+	mem_free(property_value_array);
+	group_list_kill(&group_list);
+	utf8_buf_kill(&key_cbuf);
+}
+
+// write one group field.
+// text values are quoted when needed.
+// json_name is only used for JSON.
+static void _es_output_group_field(int is_first,const wchar_t *json_name,const wchar_t *value,int is_text)
+{
+	wchar_buf_t wcbuf;
+	int separator_ch;
+	int is_quote;
+	
+	wchar_buf_init(&wcbuf);
+	
+	switch(_es_export_type)
+	{
+		case _ES_EXPORT_TYPE_CSV:
+		case _ES_EXPORT_TYPE_JSON:
+			separator_ch = ',';
+			is_quote = _es_csv_double_quote;
+			break;
+			
+		case _ES_EXPORT_TYPE_TSV:
+			separator_ch = '\t';
+			is_quote = _es_double_quote;
+			break;
+			
+		default:
+			separator_ch = ' ';
+			is_quote = _es_double_quote;
+			break;
+	}
+	
+	if (!is_first)
+	{
+		wchar_buf_cat_wchar(&wcbuf,separator_ch);
+	}
+	
+	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+	{
+		wchar_buf_t json_string_wcbuf;
+		
+		wchar_buf_init(&json_string_wcbuf);
+		
+		_es_escape_json_wchar_string(value,&json_string_wcbuf);
+		
+		if (is_text)
+		{
+			wchar_buf_cat_printf(&wcbuf,"\"%S\":\"%S\"",json_name,json_string_wcbuf.buf);
+		}
+		else
+		{
+			wchar_buf_cat_printf(&wcbuf,"\"%S\":%S",json_name,(*json_string_wcbuf.buf) ? json_string_wcbuf.buf : L"null");
+		}
+		
+		wchar_buf_kill(&json_string_wcbuf);
+	}
+	else
+	if ((is_text) && ((is_quote) || (_es_should_quote(separator_ch,value))))
+	{
+		const wchar_t *p;
+		
+		wchar_buf_cat_wchar(&wcbuf,'"');
+		
+		p = value;
+		
+		while(*p)
+		{
+			// escape double quotes with double double quotes.
+			if (*p == '"')
+			{
+				wchar_buf_cat_wchar(&wcbuf,'"');
+			}
+			
+			wchar_buf_cat_wchar(&wcbuf,*p);
+			
+			p++;
+		}
+		
+		wchar_buf_cat_wchar(&wcbuf,'"');
+	}
+	else
+	{
+		wchar_buf_cat_wchar_string(&wcbuf,value);
+	}
+	
+	_es_output_noncell_wchar_string(wcbuf.buf);
+	
+	wchar_buf_kill(&wcbuf);
+}
+
+// output the groups from a -group-by search.
+// -offset and -max-results apply to the groups.
+static void _es_output_groups(const _es_group_by_t *group_by,const group_list_t *group_list)
+{
+	SIZE_T index;
+	SIZE_T run;
+	SIZE_T agg_index;
+	int is_first_line;
+	BYTE key_format;
+	wchar_buf_t property_name_wcbuf;
+	wchar_buf_t key_json_name_wcbuf;
+	wchar_buf_t *agg_json_name_wcbuf_array;
+	wchar_buf_t value_wcbuf;
+	
+	wchar_buf_init(&property_name_wcbuf);
+	wchar_buf_init(&key_json_name_wcbuf);
+	wchar_buf_init(&value_wcbuf);
+	
+	key_format = property_get_format(group_by->key_property_id);
+	
+	// field names.
+	_es_get_nice_json_property_name(group_by->key_property_id,&property_name_wcbuf);
+	
+	if (group_by->key_date_part != _ES_GROUP_KEY_DATE_PART_NONE)
+	{
+		wchar_buf_printf(&key_json_name_wcbuf,"%s_%S",(group_by->key_date_part == _ES_GROUP_KEY_DATE_PART_YEAR) ? "year" : (group_by->key_date_part == _ES_GROUP_KEY_DATE_PART_MONTH) ? "month" : "day",property_name_wcbuf.buf);
+	}
+	else
+	{
+		wchar_buf_copy_wchar_string(&key_json_name_wcbuf,property_name_wcbuf.buf);
+	}
+	
+	agg_json_name_wcbuf_array = mem_alloc(safe_size_mul(group_by->agg_count,sizeof(wchar_buf_t)));
+	
+	for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+	{
+		wchar_buf_init(&agg_json_name_wcbuf_array[agg_index]);
+		
+		if (group_by->agg_array[agg_index].agg_type == GROUP_AGG_TYPE_COUNT)
+		{
+			wchar_buf_copy_utf8_string(&agg_json_name_wcbuf_array[agg_index],"count");
+		}
+		else
+		{
+			_es_get_nice_json_property_name(group_by->agg_array[agg_index].property_id,&property_name_wcbuf);
+			
+			wchar_buf_printf(&agg_json_name_wcbuf_array[agg_index],"%s_%S",_es_group_get_agg_name(group_by->agg_array[agg_index].agg_type),property_name_wcbuf.buf);
+		}
+	}
+	
+	_es_output_page_begin();
+	
+	if ((_es_header > 0) && (_es_export_type != _ES_EXPORT_TYPE_JSON))
+	{
+		_es_output_line_begin(0);
+		
+		_es_get_localized_property_name(group_by->key_property_id,&property_name_wcbuf);
+		
+		if (group_by->key_date_part != _ES_GROUP_KEY_DATE_PART_NONE)
+		{
+			wchar_buf_printf(&value_wcbuf,"%s(%S)",(group_by->key_date_part == _ES_GROUP_KEY_DATE_PART_YEAR) ? "year" : (group_by->key_date_part == _ES_GROUP_KEY_DATE_PART_MONTH) ? "month" : "day",property_name_wcbuf.buf);
+		}
+		else
+		{
+			wchar_buf_copy_wchar_string(&value_wcbuf,property_name_wcbuf.buf);
+		}
+		
+		_es_output_group_field(1,NULL,value_wcbuf.buf,1);
+		
+		for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+		{
+			if (group_by->agg_array[agg_index].agg_type == GROUP_AGG_TYPE_COUNT)
+			{
+				wchar_buf_copy_utf8_string(&value_wcbuf,"count");
+			}
+			else
+			{
+				_es_get_localized_property_name(group_by->agg_array[agg_index].property_id,&property_name_wcbuf);
+				
+				wchar_buf_printf(&value_wcbuf,"%s(%S)",_es_group_get_agg_name(group_by->agg_array[agg_index].agg_type),property_name_wcbuf.buf);
+			}
+			
+			_es_output_group_field(0,NULL,value_wcbuf.buf,1);
+		}
+		
+		_es_output_line_end(0);
+	}
+	
+	index = safe_size_from_uint64(_es_offset);
+	if (index > group_list->array.count)
+	{
+		index = group_list->array.count;
+	}
+	
+	run = group_list->array.count - index;
+	if (run > safe_size_from_uint64(_es_max_results))
+	{
+		run = safe_size_from_uint64(_es_max_results);
+	}
+	
+	is_first_line = 1;
+	
+	while(run)
+	{
+		const group_t *group;
+		const group_value_t *group_value;
+		int is_text;
+		
+		group = group_list->array.indexes[index];
+		
+		_es_output_line_begin(is_first_line);
+		
+		// key
+		wchar_buf_empty(&value_wcbuf);
+		is_text = 1;
+		
+		if (group_list->key_type == GROUP_KEY_TYPE_TEXT)
+		{
+			wchar_buf_copy_utf8_string_n(&value_wcbuf,group->key,group->key_len);
+		}
+		else
+		if (group->key_value != ES_UINT64_MAX)
+		{
+			switch(group_by->key_date_part)
+			{
+				case _ES_GROUP_KEY_DATE_PART_YEAR:
+					wchar_buf_printf(&value_wcbuf,"%04I64u",group->key_value);
+					break;
+					
+				case _ES_GROUP_KEY_DATE_PART_MONTH:
+					wchar_buf_printf(&value_wcbuf,"%04I64u-%02I64u",group->key_value / 100,group->key_value % 100);
+					break;
+					
+				case _ES_GROUP_KEY_DATE_PART_DAY:
+					wchar_buf_printf(&value_wcbuf,"%04I64u-%02I64u-%02I64u",group->key_value / 10000,(group->key_value / 100) % 100,group->key_value % 100);
+					break;
+					
+				default:
+				
+					if (key_format == PROPERTY_FORMAT_FILETIME)
+					{
+						_es_format_filetime(group->key_value,&value_wcbuf);
+					}
+					else
+					{
+						wchar_buf_printf(&value_wcbuf,"%I64u",group->key_value);
+						
+						is_text = 0;
+					}
+					
+					break;
+			}
+		}
+		
+		_es_output_group_field(1,key_json_name_wcbuf.buf,value_wcbuf.buf,is_text);
+		
+		// aggregates
+		group_value = GROUP_VALUE_ARRAY(group);
+		
+		for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+		{
+			const _es_group_agg_t *agg;
+			
+			agg = &group_by->agg_array[agg_index];
+			
+			wchar_buf_empty(&value_wcbuf);
+			is_text = 0;
+			
+			switch(agg->agg_type)
+			{
+				case GROUP_AGG_TYPE_COUNT:
+					wchar_buf_printf(&value_wcbuf,"%I64u",group->count);
+					break;
+					
+				case GROUP_AGG_TYPE_SUM:
+					wchar_buf_printf(&value_wcbuf,"%I64u",group_value->value);
+					break;
+					
+				case GROUP_AGG_TYPE_MIN:
+				case GROUP_AGG_TYPE_MAX:
+				
+					// no min or max without a value.
+					if (group_value->count)
+					{
+						if (property_get_format(agg->property_id) == PROPERTY_FORMAT_FILETIME)
+						{
+							_es_format_filetime(group_value->value,&value_wcbuf);
+							
+							is_text = 1;
+						}
+						else
+						{
+							wchar_buf_printf(&value_wcbuf,"%I64u",group_value->value);
+						}
+					}
+					
+					break;
+					
+				case GROUP_AGG_TYPE_AVG:
+				
+					if (group_value->count)
+					{
+						wchar_buf_printf(&value_wcbuf,"%I64u",group_value->value / group_value->count);
+					}
+					
+					break;
+			}
+			
+			_es_output_group_field(0,agg_json_name_wcbuf_array[agg_index].buf,value_wcbuf.buf,is_text);
+			
+			group_value++;
+		}
+		
+		_es_output_line_end(run > 1);
+		
+		is_first_line = 0;
+		index++;
+		run--;
+	}
+	
+	_es_output_page_end();
+	
+	for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+	{
+		wchar_buf_kill(&agg_json_name_wcbuf_array[agg_index]);
+	}
+	
+	mem_free(agg_json_name_wcbuf_array);
+	
+	wchar_buf_kill(&value_wcbuf);
+	wchar_buf_kill(&key_json_name_wcbuf);
+	wchar_buf_kill(&property_name_wcbuf);
+}
+
+// search and aggregate the results into groups while reading the reply.
+// only the key and the aggregated properties are requested.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_group_query(_es_group_by_t *group_by)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_search_property_request_t *property_request_array;
+		SIZE_T property_request_count;
+		SIZE_T agg_index;
+		
+		// request the key and each aggregated property once.
+		property_request_array = mem_alloc(safe_size_mul(safe_size_add_one(group_by->agg_count),sizeof(ipc3_search_property_request_t)));
+		
+		property_request_array[0].property_id = group_by->key_property_id;
+		property_request_array[0].flags = 0;
+		property_request_count = 1;
+		
+		for(agg_index=0;agg_index<group_by->agg_count;agg_index++)
+		{
+			DWORD property_id;
+			
+			property_id = group_by->agg_array[agg_index].property_id;
+			
+			if (property_id != EVERYTHING3_INVALID_PROPERTY_ID)
+			{
+				SIZE_T property_request_index;
+				
+				for(property_request_index=0;property_request_index<property_request_count;property_request_index++)
+				{
+					if (property_request_array[property_request_index].property_id == property_id)
+					{
+						break;
+					}
+				}
+				
+				if (property_request_index == property_request_count)
+				{
+					property_request_array[property_request_count].property_id = property_id;
+					property_request_array[property_request_count].flags = 0;
+					property_request_count++;
+				}
+			}
+		}
+		
+		// aggregate all results.
+		if (_es_ipc3_write_search(pipe_handle,_es_ipc3_get_search_flags(),0,SIZE_MAX,property_request_array,property_request_count))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			if (_es_no_result_error)
+			{
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (!result_list.stream->is_error)
+			{
+				_es_group_read_results(group_by,&result_list);
+			}
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		}
+		
+		mem_free(property_request_array);
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// read each item from the reply and add each value to its column sketches.
+// memory does not grow with the number of results.
+static void _es_approx_read_results(ipc3_result_list_t *result_list)
+{
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	_es_approx_column_t *approx_column_array;
+	SIZE_T column_count;
+	SIZE_T column_index;
+	SIZE_T result_run;
+	utf8_buf_t text_cbuf;
+	
+	utf8_buf_init(&text_cbuf);
+	
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	column_count = result_list->property_request_count;
+	
+	// one column for each property in the reply.
+	approx_column_array = mem_alloc(safe_size_mul(safe_size_add_one(column_count),sizeof(_es_approx_column_t)));
+	
+	for(column_index=0;column_index<column_count;column_index++)
+	{
+		_es_approx_column_t *approx_column;
+		
+		approx_column = &approx_column_array[column_index];
+		
+		approx_column->property_id = reply_property_request_array[column_index].property_id;
+		approx_column->is_text = 0;
+		approx_column->count = 0;
+		
+		switch(reply_property_request_array[column_index].value_type)
+		{
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+				approx_column->is_text = 1;
+				break;
+		}
+		
+		sketch_hll_init(&approx_column->hll);
+		sketch_quantile_init(&approx_column->quantile);
+	}
+	
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		// item flags.
+		ipc3_stream_read_byte(result_list->stream);
+		
+		for(column_index=0;column_index<column_count;column_index++)
+		{
+			_es_approx_column_t *approx_column;
+			
+			approx_column = &approx_column_array[column_index];
+			
+			if (approx_column->is_text)
+			{
+				ipc3_result_list_read_property_text(result_list->stream,&reply_property_request_array[column_index],&text_cbuf);
+				
+				sketch_hll_add_text(&approx_column->hll,text_cbuf.buf,text_cbuf.length_in_bytes);
+				
+				approx_column->count++;
+			}
+			else
+			{
+				ES_UINT64 value;
+				
+				// ES_UINT64_MAX if the value is not an integer.
+				value = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[column_index]);
+				
+				if (value != ES_UINT64_MAX)
+				{
+					sketch_hll_add_number(&approx_column->hll,value);
+					sketch_quantile_add(&approx_column->quantile,value);
+					
+					approx_column->count++;
+				}
+			}
+		}
+		
+		if (result_list->stream->is_error)
+		{
+			break;
+		}
+		
+		result_run--;
+	}
+	
+	if (!result_list->stream->is_error)
+	{
+		_es_output_approx_columns(approx_column_array,column_count);
+	}
+	
+	for(column_index=0;column_index<column_count;column_index++)
+	{
+		sketch_quantile_kill(&approx_column_array[column_index].quantile);
+	}
+	
+	mem_free(approx_column_array);
+	utf8_buf_kill(&text_cbuf);
+}
+
+// output one line for each -approx column.
+// text columns only have a count and a distinct count.
+static void _es_output_approx_columns(_es_approx_column_t *approx_column_array,SIZE_T column_count)
+{
+	SIZE_T column_index;
+	SIZE_T percent_index;
+	wchar_buf_t value_wcbuf;
+	int is_first_line;
+	DWORD percent_array[5] = {0,50,90,99,100};
+	const wchar_t *percent_name_array[5] = {L"min",L"p50",L"p90",L"p99",L"max"};
+	
+	wchar_buf_init(&value_wcbuf);
+	
+	_es_output_page_begin();
+	
+	if ((_es_header > 0) && (_es_export_type != _ES_EXPORT_TYPE_JSON))
+	{
+		_es_output_line_begin(0);
+		
+		_es_output_group_field(1,NULL,L"property",1);
+		_es_output_group_field(0,NULL,L"count",1);
+		_es_output_group_field(0,NULL,L"distinct",1);
+		
+		for(percent_index=0;percent_index<5;percent_index++)
+		{
+			_es_output_group_field(0,NULL,percent_name_array[percent_index],1);
+		}
+		
+		_es_output_line_end(0);
+	}
+	
+	is_first_line = 1;
+	
+	for(column_index=0;column_index<column_count;column_index++)
+	{
+		_es_approx_column_t *approx_column;
+		
+		approx_column = &approx_column_array[column_index];
+		
+		_es_output_line_begin(is_first_line);
+		
+		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+		{
+			_es_get_nice_json_property_name(approx_column->property_id,&value_wcbuf);
+		}
+		else
+		{
+			_es_get_localized_property_name(approx_column->property_id,&value_wcbuf);
+		}
+		
+		_es_output_group_field(1,L"property",value_wcbuf.buf,1);
+		
+		wchar_buf_printf(&value_wcbuf,"%I64u",approx_column->count);
+		_es_output_group_field(0,L"count",value_wcbuf.buf,0);
+		
+		wchar_buf_printf(&value_wcbuf,"%I64u",approx_column->count ? sketch_hll_get_estimate(&approx_column->hll) : 0);
+		_es_output_group_field(0,L"distinct",value_wcbuf.buf,0);
+		
+		// min, p50, p90, p99 and max.
+		for(percent_index=0;percent_index<5;percent_index++)
+		{
+			int is_text;
+			
+			wchar_buf_empty(&value_wcbuf);
+			is_text = 0;
+			
+			if (!approx_column->is_text)
+			{
+				ES_UINT64 value;
+				
+				value = sketch_quantile_get(&approx_column->quantile,percent_array[percent_index]);
+				
+				if (value != ES_UINT64_MAX)
+				{
+					if (property_get_format(approx_column->property_id) == PROPERTY_FORMAT_FILETIME)
+					{
+						_es_format_filetime(value,&value_wcbuf);
+						
+						is_text = 1;
+					}
+					else
+					{
+						wchar_buf_printf(&value_wcbuf,"%I64u",value);
+					}
+				}
+			}
+			
+			_es_output_group_field(0,percent_name_array[percent_index],value_wcbuf.buf,is_text);
+		}
+		
+		_es_output_line_end(column_index + 1 < column_count);
+		
+		is_first_line = 0;
+	}
+	
+	_es_output_page_end();
+	
+	wchar_buf_kill(&value_wcbuf);
+}
+
+// search and estimate the distinct count and quantiles of each column.
+// the raw column values are read straight from the reply and are never formatted.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_approx_query(void)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_search_property_request_t *property_request_array;
+		SIZE_T property_request_count;
+		SIZE_T property_request_index;
+		
+		property_request_array = _es_ipc3_alloc_property_request_array(&property_request_count);
+		
+		// we want the raw values.
+		for(property_request_index=0;property_request_index<property_request_count;property_request_index++)
+		{
+			property_request_array[property_request_index].flags = 0;
+		}
+		
+		// read all results.
+		if (_es_ipc3_write_search(pipe_handle,_es_ipc3_get_search_flags(),0,SIZE_MAX,property_request_array,property_request_count))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			if (_es_no_result_error)
+			{
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (!result_list.stream->is_error)
+			{
+				_es_approx_read_results(&result_list);
+			}
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		}
+		
+		if (property_request_array)
+		{
+			mem_free(property_request_array);
+		}
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// read each file from the reply and add its size to its parent folders.
+// folder results are ignored so sizes are not counted twice.
+static void _es_rollup_read_results(ipc3_result_list_t *result_list,SIZE_T rollup_depth)
+{
+	rollup_tree_t tree;
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	SIZE_T path_property_request_index;
+	SIZE_T size_property_request_index;
+	SIZE_T result_run;
+	utf8_buf_t path_cbuf;
+	
+	utf8_buf_init(&path_cbuf);
+	rollup_tree_init(&tree,rollup_depth);
+	
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	path_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_FULL_PATH);
+	size_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_SIZE);
+	
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		BYTE item_flags;
+		ES_UINT64 size;
+		SIZE_T property_request_index;
+		
+		item_flags = ipc3_stream_read_byte(result_list->stream);
+		
+		utf8_buf_empty(&path_cbuf);
+		size = ES_UINT64_MAX;
+		
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			if (property_request_index == path_property_request_index)
+			{
+				ipc3_result_list_read_property_text(result_list->stream,&reply_property_request_array[property_request_index],&path_cbuf);
+			}
+			else
+			if (property_request_index == size_property_request_index)
+			{
+				// ES_UINT64_MAX if the size is unknown.
+				size = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+			else
+			{
+				ipc3_result_list_skip_property_value(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+		}
+		
+		if (result_list->stream->is_error)
+		{
+			break;
+		}
+		
+		if (!(item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER))
+		{
+			rollup_tree_add_file(&tree,path_cbuf.buf,path_cbuf.length_in_bytes,(size == ES_UINT64_MAX) ? 0 : size);
+		}
+		
+		result_run--;
+	}
+	
+	if (!result_list->stream->is_error)
+	{
+		rollup_tree_sort(&tree);
+		
+		_es_output_rollup(&tree);
+	}
+	
+	rollup_tree_kill(&tree);
+	utf8_buf_kill(&path_cbuf);
+}
+
+// output the folders from a -rollup-depth search, largest first.
+// -offset and -max-results pick the top folders.
+static void _es_output_rollup(const rollup_tree_t *tree)
+{
+	SIZE_T index;
+	SIZE_T run;
+	int is_first_line;
+	utf8_buf_t path_cbuf;
+	wchar_buf_t value_wcbuf;
+	wchar_buf_t path_json_name_wcbuf;
+	wchar_buf_t size_json_name_wcbuf;
+	
+	utf8_buf_init(&path_cbuf);
+	wchar_buf_init(&value_wcbuf);
+	wchar_buf_init(&path_json_name_wcbuf);
+	wchar_buf_init(&size_json_name_wcbuf);
+	
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_FULL_PATH,&path_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&size_json_name_wcbuf);
+	
+	_es_output_page_begin();
+	
+	if ((_es_header > 0) && (_es_export_type != _ES_EXPORT_TYPE_JSON))
+	{
+		_es_output_line_begin(0);
+		
+		_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_FULL_PATH,&value_wcbuf);
+		_es_output_group_field(1,NULL,value_wcbuf.buf,1);
+		
+		_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&value_wcbuf);
+		_es_output_group_field(0,NULL,value_wcbuf.buf,1);
+		
+		_es_output_group_field(0,NULL,L"count",1);
+		
+		_es_output_line_end(0);
+	}
+	
+	index = safe_size_from_uint64(_es_offset);
+	if (index > tree->array.count)
+	{
+		index = tree->array.count;
+	}
+	
+	run = tree->array.count - index;
+	if (run > safe_size_from_uint64(_es_max_results))
+	{
+		run = safe_size_from_uint64(_es_max_results);
+	}
+	
+	is_first_line = 1;
+	
+	while(run)
+	{
+		const rollup_node_t *node;
+		
+		node = tree->array.indexes[index];
+		
+		_es_output_line_begin(is_first_line);
+		
+		rollup_node_get_path(node,&path_cbuf);
+		
+		// append slash
+		if (_es_folder_append_path_separator)
+		{
+			utf8_buf_cat_path_separator(&path_cbuf);
+		}
+		
+		wchar_buf_copy_utf8_string_n(&value_wcbuf,path_cbuf.buf,path_cbuf.length_in_bytes);
+		_es_output_group_field(1,path_json_name_wcbuf.buf,value_wcbuf.buf,1);
+		
+		wchar_buf_printf(&value_wcbuf,"%I64u",node->size);
+		_es_output_group_field(0,size_json_name_wcbuf.buf,value_wcbuf.buf,0);
+		
+		wchar_buf_printf(&value_wcbuf,"%I64u",node->count);
+		_es_output_group_field(0,L"count",value_wcbuf.buf,0);
+		
+		_es_output_line_end(run > 1);
+		
+		is_first_line = 0;
+		index++;
+		run--;
+	}
+	
+	_es_output_page_end();
+	
+	wchar_buf_kill(&size_json_name_wcbuf);
+	wchar_buf_kill(&path_json_name_wcbuf);
+	wchar_buf_kill(&value_wcbuf);
+	utf8_buf_kill(&path_cbuf);
+}
+
+// search and total the file sizes under each folder, up to rollup_depth folders deep.
+// only the full path and size are requested.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_rollup_query(SIZE_T rollup_depth)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_search_property_request_t property_request_array[2];
+		
+		property_request_array[0].property_id = EVERYTHING3_PROPERTY_ID_FULL_PATH;
+		property_request_array[0].flags = 0;
+		property_request_array[1].property_id = EVERYTHING3_PROPERTY_ID_SIZE;
+		property_request_array[1].flags = 0;
+		
+		// read all results.
+		if (_es_ipc3_write_search(pipe_handle,_es_ipc3_get_search_flags(),0,SIZE_MAX,property_request_array,2))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			if (_es_no_result_error)
+			{
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (!result_list.stream->is_error)
+			{
+				_es_rollup_read_results(&result_list,rollup_depth);
+			}
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		}
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// order kept items by their position in the results.
+static int _es_sample_item_compare(const _es_sample_item_t *a,const _es_sample_item_t *b)
+{
+	if (a->index < b->index)
+	{
+		return -1;
+	}
+	
+	if (a->index > b->index)
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+// read every item from the reply and keep a random sample of sample_size items.
+// items that are not kept are skipped without being decoded or formatted.
+// the kept items are output in result order.
+static void _es_sample_read_results(ipc3_result_list_t *result_list,ipc3_stream_record_t *record_stream,ES_UINT64 sample_size,ES_UINT64 seed)
+{
+	sample_t sample;
+	_es_sample_item_t *item_array;
+	_es_sample_item_t **item_index_array;
+	ipc3_stream_t *pipe_stream;
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	SIZE_T item_count;
+	SIZE_T item_index;
+	SIZE_T result_run;
+	
+	pipe_stream = result_list->stream;
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	// no need for more slots than results.
+	item_count = safe_size_from_uint64(sample_size);
+	
+	if (item_count > result_list->viewport_count)
+	{
+		item_count = result_list->viewport_count;
+	}
+	
+	item_array = mem_alloc(safe_size_mul(safe_size_add_one(item_count),sizeof(_es_sample_item_t)));
+	
+	for(item_index=0;item_index<item_count;item_index++)
+	{
+		item_array[item_index].buf = NULL;
+	}
+	
+	sample_init(&sample,item_count,seed);
+	
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		ES_UINT64 slot;
+		ipc3_stream_t *stream;
+		SIZE_T property_request_index;
+		
+		slot = sample_next(&sample);
+		
+		if (slot != ES_UINT64_MAX)
+		{
+			// record the item so it can be output later.
+			ipc3_stream_record_clear(record_stream);
+			
+			stream = (ipc3_stream_t *)record_stream;
+		}
+		else
+		{
+			stream = pipe_stream;
+		}
+		
+		// item flags.
+		ipc3_stream_read_byte(stream);
+		
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			ipc3_result_list_skip_property_value(stream,&reply_property_request_array[property_request_index]);
+		}
+		
+		if ((stream->is_error) || (pipe_stream->is_error))
+		{
+			pipe_stream->is_error = 1;
+			
+			break;
+		}
+		
+		if (slot != ES_UINT64_MAX)
+		{
+			_es_sample_item_t *item;
+			
+			item = &item_array[(SIZE_T)slot];
+			
+			if (item->buf)
+			{
+				mem_free(item->buf);
+			}
+			
+			item->index = sample.count - 1;
+			item->size = record_stream->size;
+			item->buf = mem_alloc(record_stream->size);
+			
+			os_copy_memory(item->buf,record_stream->buf,record_stream->size);
+		}
+		
+		result_run--;
+	}
+	
+	if (!pipe_stream->is_error)
+	{
+		utf8_buf_t property_text_cbuf;
+		
+		utf8_buf_init(&property_text_cbuf);
+		
+		item_index_array = mem_alloc(safe_size_mul_sizeof_pointer(safe_size_add_one(item_count)));
+		
+		for(item_index=0;item_index<item_count;item_index++)
+		{
+			item_index_array[item_index] = &item_array[item_index];
+		}
+		
+		os_sort(item_index_array,item_count,_es_sample_item_compare);
+		
+		_es_output_page_begin();
+		
+		if (_es_header > 0)
+		{
+			_es_output_header();
+		}
+		
+		for(item_index=0;item_index<item_count;item_index++)
+		{
+			ipc3_stream_memory_t memory_stream;
+			
+			// read the recorded item.
+			ipc3_stream_memory_init(&memory_stream,item_index_array[item_index]->buf,item_index_array[item_index]->size,record_stream->base.is_64bit);
+			
+			result_list->stream = (ipc3_stream_t *)&memory_stream;
+			
+			_es_output_ipc3_result(result_list,&property_text_cbuf,item_index == 0,item_index + 1 < item_count);
+			
+			result_list->stream = pipe_stream;
+			
+			ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+		}
+		
+		if (_es_footer > 0)
+		{
+			_es_output_footer(result_list->folder_result_count + result_list->file_result_count,result_list->total_result_size);
+		}
+		
+		_es_output_page_end();
+		
+		mem_free(item_index_array);
+		utf8_buf_kill(&property_text_cbuf);
+	}
+	
+	for(item_index=0;item_index<item_count;item_index++)
+	{
+		if (item_array[item_index].buf)
+		{
+			mem_free(item_array[item_index].buf);
+		}
+	}
+	
+	mem_free(item_array);
+}
+
+// search and output a uniform random sample of sample_size results.
+// the whole reply is read, but only the kept results are formatted.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_sample_query(ES_UINT64 sample_size,ES_UINT64 seed)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		DWORD search_flags;
+		ipc3_search_property_request_t *property_request_array;
+		SIZE_T property_request_count;
+
+		search_flags = _es_ipc3_get_search_flags();
+
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			int is_size_indexed;
+			int is_date_modified_indexed;
+			int is_date_created_indexed;
+			int is_attributes_indexed;
+			
+			is_size_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_SIZE);
+			is_date_modified_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_MODIFIED);
+			is_date_created_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_DATE_CREATED);
+			is_attributes_indexed = ipc3_is_property_indexed(pipe_handle,EVERYTHING3_PROPERTY_ID_ATTRIBUTES);
+			
+			_es_add_standard_efu_columns(is_size_indexed,is_date_modified_indexed,is_date_created_indexed,is_attributes_indexed,1);
+		}
+
+		if (_es_footer > 0)
+		{
+			// request total size for footer.
+			search_flags |= IPC3_SEARCH_FLAG_TOTAL_SIZE;
+		}
+		
+		property_request_array = _es_ipc3_alloc_property_request_array(&property_request_count);
+		
+		// sample from the -offset and -max-results range.
+		if (_es_ipc3_write_search(pipe_handle,search_flags,safe_size_from_uint64(_es_offset),safe_size_from_uint64(_es_max_results),property_request_array,property_request_count))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_stream_record_t record_stream;
+			ipc3_result_list_t result_list;
+			
+			// we are committed to ipc3
+			if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+			{
+				_es_add_standard_efu_columns(0,0,0,1,0);
+			}
+
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			ipc3_stream_record_init(&record_stream,(ipc3_stream_t *)&pipe_stream);
+			
+			if (_es_no_result_error)
+			{
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (!result_list.stream->is_error)
+			{
+				_es_sample_read_results(&result_list,&record_stream,sample_size,seed);
+			}
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&record_stream);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+		}
+		
+		if (property_request_array)
+		{
+			mem_free(property_request_array);
+		}
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// initialize pipelined lookups.
+// the caller sets path_list or opens reader.
+// reply_size is the size of a single reply, including the message header.
+// max_in_flight is reduced so all unread replies fit in the pipe buffer.
+// this ensures Everything never blocks writing a reply while we are blocked writing a request.
+static void _es_stat_init(_es_stat_t *stat,HANDLE pipe_handle,int command,SIZE_T max_in_flight,SIZE_T reply_size)
+{
+	SIZE_T pipe_buffer_max_in_flight;
+	
+	pipe_buffer_max_in_flight = ipc3_get_pipe_buffer_size(pipe_handle) / reply_size;
+	
+	if (max_in_flight > pipe_buffer_max_in_flight)
+	{
+		max_in_flight = pipe_buffer_max_in_flight;
+	}
+	
+	// always allow one lookup.
+	// a single request and reply never deadlock.
+	if (!max_in_flight)
+	{
+		max_in_flight = 1;
+	}
+	
+	stat->path_list = NULL;
+	stat->path_list_index = 0;
+	stat->is_reader = 0;
+	stat->command = command;
+	stat->max_in_flight = max_in_flight;
+	stat->path_array = mem_alloc(safe_size_mul_sizeof_pointer(max_in_flight));
+	stat->first_index = 0;
+	stat->in_flight_count = 0;
+	stat->is_eof = 0;
+	
+	wchar_buf_init(&stat->path_json_name_wcbuf);
+	wchar_buf_init(&stat->size_json_name_wcbuf);
+	wchar_buf_init(&stat->date_modified_json_name_wcbuf);
+	wchar_buf_init(&stat->date_created_json_name_wcbuf);
+	wchar_buf_init(&stat->attributes_json_name_wcbuf);
+	
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_FULL_PATH,&stat->path_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&stat->size_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_DATE_MODIFIED,&stat->date_modified_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_DATE_CREATED,&stat->date_created_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_ATTRIBUTES,&stat->attributes_json_name_wcbuf);
+}
+
+// free any paths left after an error and close the reader.
+static void _es_stat_kill(_es_stat_t *stat)
+{
+	while(stat->in_flight_count)
+	{
+		mem_free(stat->path_array[stat->first_index]);
+		
+		stat->first_index = (stat->first_index + 1) % stat->max_in_flight;
+		stat->in_flight_count--;
+	}
+	
+	wchar_buf_kill(&stat->attributes_json_name_wcbuf);
+	wchar_buf_kill(&stat->date_created_json_name_wcbuf);
+	wchar_buf_kill(&stat->date_modified_json_name_wcbuf);
+	wchar_buf_kill(&stat->size_json_name_wcbuf);
+	wchar_buf_kill(&stat->path_json_name_wcbuf);
+	
+	mem_free(stat->path_array);
+	
+	if (stat->is_reader)
+	{
+		_es_line_reader_close(&stat->reader);
+	}
+}
+
+// get the next path from the command line, then from the reader.
+// returns TRUE if a path was read.
+// returns FALSE when there are no more paths.
+static BOOL _es_stat_get_next_path(_es_stat_t *stat,wchar_buf_t *out_wcbuf)
+{
+	if ((stat->path_list) && (stat->path_list_index < stat->path_list->count))
+	{
+		wchar_buf_copy_wchar_string(out_wcbuf,stat->path_list->indexes[stat->path_list_index]);
+		
+		stat->path_list_index++;
+		
+		return TRUE;
+	}
+	
+	if (stat->is_reader)
+	{
+		return _es_line_reader_read_line(&stat->reader,out_wcbuf);
+	}
+	
+	return FALSE;
+}
+
+// read the reply to a GET_FILE_ATTRIBUTES_EX request.
+// out_data is zeroed and *out_is_found is cleared if the path is not in the index.
+// returns TRUE if successful.
+// returns FALSE on a pipe error.
+static BOOL _es_stat_read_reply(HANDLE pipe_handle,WIN32_FILE_ATTRIBUTE_DATA *out_data,int *out_is_found)
+{
+	ipc3_message_t recv_header;
+	DWORD read_size;
+	
+	os_zero_memory(out_data,sizeof(WIN32_FILE_ATTRIBUTE_DATA));
+	*out_is_found = 0;
+	
+	if (!ipc3_read_pipe(pipe_handle,&recv_header,sizeof(ipc3_message_t)))
+	{
+		return FALSE;
+	}
+	
+	read_size = 0;
+	
+	// IPC3_RESPONSE_ERROR_NOT_FOUND if the path is not indexed.
+	if ((recv_header.code == IPC3_RESPONSE_OK) && (recv_header.size >= sizeof(WIN32_FILE_ATTRIBUTE_DATA)))
+	{
+		read_size = sizeof(WIN32_FILE_ATTRIBUTE_DATA);
+		
+		if (!ipc3_read_pipe(pipe_handle,out_data,read_size))
+		{
+			return FALSE;
+		}
+		
+		*out_is_found = 1;
+	}
+	
+	// keep the pipe in sync for the next reply.
+	return ipc3_skip_pipe(pipe_handle,recv_header.size - read_size);
+}
+
+// output a date from a -stat-from-stdin lookup.
+static void _es_output_stat_filetime(const wchar_t *json_name,const FILETIME *ft,int is_found)
+{
+	wchar_buf_t value_wcbuf;
+	ES_UINT64 filetime;
+	
+	wchar_buf_init(&value_wcbuf);
+	
+	filetime = ((ES_UINT64)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+	
+	if (!is_found)
+	{
+		// empty or null.
+		_es_output_group_field(0,json_name,L"",0);
+	}
+	else
+	if ((_es_export_type == _ES_EXPORT_TYPE_JSON) && ((!_es_date_format) || (_es_date_format == 2)))
+	{
+		wchar_buf_printf(&value_wcbuf,"%I64u",filetime);
+		_es_output_group_field(0,json_name,value_wcbuf.buf,0);
+	}
+	else
+	{
+		_es_format_filetime(filetime,&value_wcbuf);
+		_es_output_group_field(0,json_name,value_wcbuf.buf,1);
+	}
+	
+	wchar_buf_kill(&value_wcbuf);
+}
+
+// output the size, dates and attributes of a path from a -stat-from-stdin lookup.
+// the path is always shown, the other values are empty if the path is not in the index.
+static void _es_output_stat(const _es_stat_t *stat,const wchar_t *path,const WIN32_FILE_ATTRIBUTE_DATA *data,int is_found,int is_first_line,int is_more)
+{
+	wchar_buf_t value_wcbuf;
+	
+	wchar_buf_init(&value_wcbuf);
+	
+	_es_output_line_begin(is_first_line);
+	
+	_es_output_group_field(1,stat->path_json_name_wcbuf.buf,path,1);
+	
+	if (is_found)
+	{
+		wchar_buf_printf(&value_wcbuf,"%I64u",((ES_UINT64)data->nFileSizeHigh << 32) | data->nFileSizeLow);
+	}
+	
+	_es_output_group_field(0,stat->size_json_name_wcbuf.buf,value_wcbuf.buf,0);
+	
+	_es_output_stat_filetime(stat->date_modified_json_name_wcbuf.buf,&data->ftLastWriteTime,is_found);
+	_es_output_stat_filetime(stat->date_created_json_name_wcbuf.buf,&data->ftCreationTime,is_found);
+	
+	wchar_buf_empty(&value_wcbuf);
+	
+	if (is_found)
+	{
+		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+		{
+			// JSON doesn't support hex.
+			wchar_buf_printf(&value_wcbuf,"%u",data->dwFileAttributes);
+		}
+		else
+		{
+			_es_format_attributes(data->dwFileAttributes,&value_wcbuf);
+		}
+	}
+	
+	_es_output_group_field(0,stat->attributes_json_name_wcbuf.buf,value_wcbuf.buf,(is_found) && (_es_export_type != _ES_EXPORT_TYPE_JSON));
+	
+	_es_output_line_end(is_more);
+	
+	wchar_buf_kill(&value_wcbuf);
+}
+
+// read more paths and send a lookup for each path, up to max_in_flight lookups.
+// the requests are written to the pipe at once.
+// returns TRUE if successful.
+// returns FALSE on a pipe error.
+static BOOL _es_stat_send_more(_es_stat_t *stat,HANDLE pipe_handle)
+{
+	utf8_buf_t path_cbuf;
+	utf8_buf_t packet_cbuf;
+	SIZE_T packet_size;
+	BOOL ret;
+	
+	utf8_buf_init(&path_cbuf);
+	utf8_buf_init(&packet_cbuf);
+	
+	packet_size = 0;
+	
+	while((!stat->is_eof) && (stat->in_flight_count < stat->max_in_flight))
+	{
+		wchar_buf_t line_wcbuf;
+		
+		wchar_buf_init(&line_wcbuf);
+		
+		if (_es_stat_get_next_path(stat,&line_wcbuf))
+		{
+			// ignore blank lines.
+			if (line_wcbuf.length_in_wchars)
+			{
+				ipc3_message_t send_message;
+				SIZE_T slot;
+				
+				utf8_buf_copy_wchar_string(&path_cbuf,line_wcbuf.buf);
+				
+				if (path_cbuf.length_in_bytes <= ES_DWORD_MAX)
+				{
+					send_message.code = stat->command;
+					send_message.size = (DWORD)path_cbuf.length_in_bytes;
+					
+					utf8_buf_grow_size(&packet_cbuf,safe_size_add(safe_size_add(packet_size,sizeof(ipc3_message_t)),path_cbuf.length_in_bytes));
+					
+					os_copy_memory(packet_cbuf.buf + packet_size,&send_message,sizeof(ipc3_message_t));
+					packet_size += sizeof(ipc3_message_t);
+					
+					os_copy_memory(packet_cbuf.buf + packet_size,path_cbuf.buf,path_cbuf.length_in_bytes);
+					packet_size += path_cbuf.length_in_bytes;
+					
+					// remember the path for the output.
+					slot = (stat->first_index + stat->in_flight_count) % stat->max_in_flight;
+					
+					stat->path_array[slot] = wchar_string_alloc_wchar_string_n(line_wcbuf.buf,line_wcbuf.length_in_wchars);
+					stat->in_flight_count++;
+				}
+			}
+		}
+		else
+		{
+			stat->is_eof = 1;
+		}
+		
+		wchar_buf_kill(&line_wcbuf);
+	}
+	
+	ret = TRUE;
+	
+	if (packet_size)
+	{
+		ret = ipc3_write_pipe_data(pipe_handle,packet_cbuf.buf,packet_size);
+	}
+	
+	utf8_buf_kill(&packet_cbuf);
+	utf8_buf_kill(&path_cbuf);
+	
+	return ret;
+}
+
+// look up the size, dates and attributes of each path from stdin in the index.
+// the disk is never accessed.
+// lookups are pipelined on one connection, with up to _ES_STAT_MAX_IN_FLIGHT lookups in flight.
+// fewer lookups are in flight if the replies would not fit in the pipe buffer.
+// returns TRUE if connected.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_stat_from_stdin(void)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		_es_stat_t stat;
+		wchar_buf_t property_name_wcbuf;
+		int is_first_line;
+		SIZE_T found_count;
+		
+		_es_stat_init(&stat,pipe_handle,IPC3_COMMAND_GET_FILE_ATTRIBUTES_EX,_ES_STAT_MAX_IN_FLIGHT,sizeof(ipc3_message_t) + sizeof(WIN32_FILE_ATTRIBUTE_DATA));
+		
+		if (!_es_line_reader_open(&stat.reader,L"-"))
+		{
+			_es_bad_switch_param("Unable to read stdin.\n");
+		}
+		
+		stat.is_reader = 1;
+		
+		wchar_buf_init(&property_name_wcbuf);
+		
+		_es_output_page_begin();
+		
+		if ((_es_header > 0) && (_es_export_type != _ES_EXPORT_TYPE_JSON))
+		{
+			_es_output_line_begin(0);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_FULL_PATH,&property_name_wcbuf);
+			_es_output_group_field(1,NULL,property_name_wcbuf.buf,1);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&property_name_wcbuf);
+			_es_output_group_field(0,NULL,property_name_wcbuf.buf,1);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_DATE_MODIFIED,&property_name_wcbuf);
+			_es_output_group_field(0,NULL,property_name_wcbuf.buf,1);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_DATE_CREATED,&property_name_wcbuf);
+			_es_output_group_field(0,NULL,property_name_wcbuf.buf,1);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_ATTRIBUTES,&property_name_wcbuf);
+			_es_output_group_field(0,NULL,property_name_wcbuf.buf,1);
+			
+			_es_output_line_end(0);
+		}
+		
+		is_first_line = 1;
+		found_count = 0;
+		
+		if (_es_stat_send_more(&stat,pipe_handle))
+		{
+			while(stat.in_flight_count)
+			{
+				WIN32_FILE_ATTRIBUTE_DATA data;
+				int is_found;
+				wchar_t *path;
+				
+				// replies are in the same order as the requests.
+				if (!_es_stat_read_reply(pipe_handle,&data,&is_found))
+				{
+					_es_ret = ES_ERROR_IPC_ERROR;
+					
+					break;
+				}
+				
+				path = stat.path_array[stat.first_index];
+				
+				stat.first_index = (stat.first_index + 1) % stat.max_in_flight;
+				stat.in_flight_count--;
+				
+				// keep Everything busy while we output.
+				// send lookups in large groups to reduce the number of pipe writes.
+				if (stat.in_flight_count <= stat.max_in_flight / 2)
+				{
+					if (!_es_stat_send_more(&stat,pipe_handle))
+					{
+						_es_ret = ES_ERROR_IPC_ERROR;
+						
+						mem_free(path);
+						
+						break;
+					}
+				}
+				
+				_es_output_stat(&stat,path,&data,is_found,is_first_line,stat.in_flight_count ? 1 : 0);
+				
+				if (is_found)
+				{
+					found_count++;
+				}
+				
+				is_first_line = 0;
+				
+				mem_free(path);
+			}
+		}
+		else
+		{
+			_es_ret = ES_ERROR_IPC_ERROR;
+		}
+		
+		_es_output_page_end();
+		
+		if (_es_no_result_error)
+		{
+			if ((!found_count) && (_es_ret == ES_ERROR_SUCCESS))
+			{
+				_es_ret = ES_ERROR_NO_RESULTS;
+			}
+		}
+		
+		wchar_buf_kill(&property_name_wcbuf);
+		
+		_es_stat_kill(&stat);
+		
+		// don't try to process ipc2 or ipc1 if we connected successfully.
+		ret = TRUE;
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// read the reply to a GET_FOLDER_SIZE request.
+// out_size is ES_UINT64_MAX if the folder is not in the index.
+// returns TRUE if successful.
+// returns FALSE on a pipe error.
+static BOOL _es_folder_size_read_reply(HANDLE pipe_handle,ES_UINT64 *out_size)
+{
+	ipc3_message_t recv_header;
+	DWORD read_size;
+	
+	*out_size = ES_UINT64_MAX;
+	
+	if (!ipc3_read_pipe(pipe_handle,&recv_header,sizeof(ipc3_message_t)))
+	{
+		return FALSE;
+	}
+	
+	read_size = 0;
+	
+	if ((recv_header.code == IPC3_RESPONSE_OK) && (recv_header.size >= sizeof(ES_UINT64)))
+	{
+		read_size = sizeof(ES_UINT64);
+		
+		if (!ipc3_read_pipe(pipe_handle,out_size,read_size))
+		{
+			return FALSE;
+		}
+	}
+	
+	// keep the pipe in sync for the next reply.
+	return ipc3_skip_pipe(pipe_handle,recv_header.size - read_size);
+}
+
+// get the size of each folder from the command line and then from folder_list_filename, one per line.
+// folder_list_filename can be - for stdin, or NULL.
+// lookups are pipelined on one connection, with up to max_in_flight lookups in flight.
+// fewer lookups are in flight if the replies would not fit in the pipe buffer.
+// returns TRUE if connected.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_get_folder_sizes(const array_t *folder_list,const wchar_t *folder_list_filename,SIZE_T max_in_flight)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		_es_stat_t stat;
+		wchar_buf_t property_name_wcbuf;
+		wchar_buf_t value_wcbuf;
+		int is_first_line;
+		SIZE_T found_count;
+		
+		_es_stat_init(&stat,pipe_handle,IPC3_COMMAND_GET_FOLDER_SIZE,max_in_flight,sizeof(ipc3_message_t) + sizeof(ES_UINT64));
+		
+		stat.path_list = folder_list;
+		
+		if (folder_list_filename)
+		{
+			if (!_es_line_reader_open(&stat.reader,folder_list_filename))
+			{
+				_es_bad_switch_param("Unable to open folder list: %S\n",folder_list_filename);
+			}
+			
+			stat.is_reader = 1;
+		}
+		
+		wchar_buf_init(&property_name_wcbuf);
+		wchar_buf_init(&value_wcbuf);
+		
+		_es_output_page_begin();
+		
+		if ((_es_header > 0) && (_es_export_type != _ES_EXPORT_TYPE_JSON))
+		{
+			_es_output_line_begin(0);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_FULL_PATH,&property_name_wcbuf);
+			_es_output_group_field(1,NULL,property_name_wcbuf.buf,1);
+			
+			_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&property_name_wcbuf);
+			_es_output_group_field(0,NULL,property_name_wcbuf.buf,1);
+			
+			_es_output_line_end(0);
+		}
+		
+		is_first_line = 1;
+		found_count = 0;
+		
+		if (_es_stat_send_more(&stat,pipe_handle))
+		{
+			while(stat.in_flight_count)
+			{
+				ES_UINT64 folder_size;
+				wchar_t *path;
+				
+				// replies are in the same order as the requests.
+				if (!_es_folder_size_read_reply(pipe_handle,&folder_size))
+				{
+					_es_ret = ES_ERROR_IPC_ERROR;
+					
+					break;
+				}
+				
+				path = stat.path_array[stat.first_index];
+				
+				stat.first_index = (stat.first_index + 1) % stat.max_in_flight;
+				stat.in_flight_count--;
+				
+				// keep Everything busy while we output.
+				if (stat.in_flight_count <= stat.max_in_flight / 2)
+				{
+					if (!_es_stat_send_more(&stat,pipe_handle))
+					{
+						_es_ret = ES_ERROR_IPC_ERROR;
+						
+						mem_free(path);
+						
+						break;
+					}
+				}
+				
+				_es_output_line_begin(is_first_line);
+				
+				_es_output_group_field(1,stat.path_json_name_wcbuf.buf,path,1);
+				
+				// empty or null if unknown.
+				wchar_buf_empty(&value_wcbuf);
+				
+				if (folder_size != ES_UINT64_MAX)
+				{
+					wchar_buf_printf(&value_wcbuf,"%I64u",folder_size);
+					
+					found_count++;
+				}
+				
+				_es_output_group_field(0,stat.size_json_name_wcbuf.buf,value_wcbuf.buf,0);
+				
+				_es_output_line_end(stat.in_flight_count ? 1 : 0);
+				
+				is_first_line = 0;
+				
+				mem_free(path);
+			}
+		}
+		else
+		{
+			_es_ret = ES_ERROR_IPC_ERROR;
+		}
+		
+		_es_output_page_end();
+		
+		if (_es_no_result_error)
+		{
+			if ((!found_count) && (_es_ret == ES_ERROR_SUCCESS))
+			{
+				_es_ret = ES_ERROR_NO_RESULTS;
+			}
+		}
+		
+		wchar_buf_kill(&value_wcbuf);
+		wchar_buf_kill(&property_name_wcbuf);
+		
+		_es_stat_kill(&stat);
+		
+		// don't try to process ipc2 or ipc1 if we connected successfully.
+		ret = TRUE;
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+// output a folder listing from a -ls search.
+// names are shown relative to the listed folder.
+// an EFU export is written in the same format as -create-file-list.
+static void _es_ls_read_results(ipc3_result_list_t *result_list,SIZE_T prefix_len)
+{
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	SIZE_T path_property_request_index;
+	SIZE_T size_property_request_index;
+	SIZE_T date_modified_property_request_index;
+	SIZE_T date_created_property_request_index;
+	SIZE_T attributes_property_request_index;
+	SIZE_T result_run;
+	int is_first_line;
+	utf8_buf_t path_cbuf;
+	utf8_buf_t row_cbuf;
+	wchar_buf_t name_wcbuf;
+	wchar_buf_t value_wcbuf;
+	wchar_buf_t line_wcbuf;
+	wchar_buf_t name_json_name_wcbuf;
+	wchar_buf_t size_json_name_wcbuf;
+	wchar_buf_t date_modified_json_name_wcbuf;
+	
+	utf8_buf_init(&path_cbuf);
+	utf8_buf_init(&row_cbuf);
+	wchar_buf_init(&name_wcbuf);
+	wchar_buf_init(&value_wcbuf);
+	wchar_buf_init(&line_wcbuf);
+	wchar_buf_init(&name_json_name_wcbuf);
+	wchar_buf_init(&size_json_name_wcbuf);
+	wchar_buf_init(&date_modified_json_name_wcbuf);
+	
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_NAME,&name_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&size_json_name_wcbuf);
+	_es_get_nice_json_property_name(EVERYTHING3_PROPERTY_ID_DATE_MODIFIED,&date_modified_json_name_wcbuf);
+	
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	path_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_FULL_PATH);
+	size_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_SIZE);
+	date_modified_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_DATE_MODIFIED);
+	date_created_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_DATE_CREATED);
+	attributes_property_request_index = _es_group_find_reply_property(result_list,EVERYTHING3_PROPERTY_ID_ATTRIBUTES);
+	
+	_es_output_page_begin();
+	
+	if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+	{
+		// file lists always start with a UTF-8 BOM.
+		if ((!_es_utf8_bom) && ((_es_export_file != INVALID_HANDLE_VALUE) || (!_es_output_is_char)))
+		{
+			if (_es_export_file != INVALID_HANDLE_VALUE)
+			{
+				_es_export_write_data((const BYTE *)"\xEF\xBB\xBF",3);
+			}
+			else
+			{
+				_es_write_output(_es_output_handle,"\xEF\xBB\xBF",3);
+			}
+		}
+		
+		if (_es_header > 0)
+		{
+			_es_output_noncell_utf8_string(FILELIST_HEADER);
+		}
+	}
+	else
+	if ((_es_header > 0) && ((_es_export_type == _ES_EXPORT_TYPE_CSV) || (_es_export_type == _ES_EXPORT_TYPE_TSV)))
+	{
+		_es_output_line_begin(0);
+		
+		_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_NAME,&value_wcbuf);
+		_es_output_group_field(1,NULL,value_wcbuf.buf,1);
+		
+		_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_SIZE,&value_wcbuf);
+		_es_output_group_field(0,NULL,value_wcbuf.buf,1);
+		
+		_es_get_localized_property_name(EVERYTHING3_PROPERTY_ID_DATE_MODIFIED,&value_wcbuf);
+		_es_output_group_field(0,NULL,value_wcbuf.buf,1);
+		
+		_es_output_line_end(0);
+	}
+	
+	is_first_line = 1;
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		BYTE item_flags;
+		ES_UINT64 size;
+		ES_UINT64 date_modified;
+		ES_UINT64 date_created;
+		ES_UINT64 attributes;
+		SIZE_T property_request_index;
+		
+		item_flags = ipc3_stream_read_byte(result_list->stream);
+		
+		utf8_buf_empty(&path_cbuf);
+		size = ES_UINT64_MAX;
+		date_modified = ES_UINT64_MAX;
+		date_created = ES_UINT64_MAX;
+		attributes = ES_UINT64_MAX;
+		
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			if (property_request_index == path_property_request_index)
+			{
+				ipc3_result_list_read_property_text(result_list->stream,&reply_property_request_array[property_request_index],&path_cbuf);
+			}
+			else
+			if (property_request_index == size_property_request_index)
+			{
+				size = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+			else
+			if (property_request_index == date_modified_property_request_index)
+			{
+				date_modified = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+			else
+			if (property_request_index == date_created_property_request_index)
+			{
+				date_created = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+			else
+			if (property_request_index == attributes_property_request_index)
+			{
+				attributes = ipc3_result_list_read_property_uint64(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+			else
+			{
+				ipc3_result_list_skip_property_value(result_list->stream,&reply_property_request_array[property_request_index]);
+			}
+		}
+		
+		if (result_list->stream->is_error)
+		{
+			break;
+		}
+		
+		// unknown attributes.
+		if (attributes == ES_UINT64_MAX)
+		{
+			attributes = 0;
+		}
+		
+		if (item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
+		{
+			attributes |= FILE_ATTRIBUTE_DIRECTORY;
+			
+			// folders have no size in a file list.
+			size = ES_UINT64_MAX;
+		}
+		
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			// full paths, like -create-file-list.
+			utf8_buf_empty(&row_cbuf);
+			
+			filelist_cat_item(&row_cbuf,path_cbuf.buf,(DWORD)attributes,size,date_modified,date_created,_es_folder_append_path_separator);
+			
+			_es_output_noncell_utf8_string(row_cbuf.buf);
+		}
+		else
+		{
+			// the search only matches items under the listed folder.
+			if (path_cbuf.length_in_bytes > prefix_len)
+			{
+				wchar_buf_copy_utf8_string_n(&name_wcbuf,path_cbuf.buf + prefix_len,path_cbuf.length_in_bytes - prefix_len);
+			}
+			else
+			{
+				wchar_buf_copy_utf8_string_n(&name_wcbuf,path_cbuf.buf,path_cbuf.length_in_bytes);
+			}
+			
+			// append slash
+			if ((_es_folder_append_path_separator) && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				wchar_buf_cat_path_separator(&name_wcbuf);
+			}
+			
+			_es_output_line_begin(is_first_line);
+			
+			if (_es_export_type == _ES_EXPORT_TYPE_NONE)
+			{
+				// dir like columns.
+				_es_format_filetime(date_modified,&line_wcbuf);
+				wchar_buf_cat_utf8_string(&line_wcbuf,"  ");
+				
+				if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+				{
+					wchar_buf_cat_utf8_string(&line_wcbuf,"<DIR>         ");
+				}
+				else
+				if (size != ES_UINT64_MAX)
+				{
+					wchar_buf_cat_printf(&line_wcbuf,"%14I64u",size);
+				}
+				else
+				{
+					wchar_buf_cat_utf8_string(&line_wcbuf,"              ");
+				}
+				
+				wchar_buf_cat_utf8_string(&line_wcbuf," ");
+				wchar_buf_cat_wchar_string(&line_wcbuf,name_wcbuf.buf);
+				
+				_es_output_noncell_wchar_string(line_wcbuf.buf);
+			}
+			else
+			{
+				FILETIME ft;
+				
+				_es_output_group_field(1,name_json_name_wcbuf.buf,name_wcbuf.buf,1);
+				
+				wchar_buf_empty(&value_wcbuf);
+				
+				if (size != ES_UINT64_MAX)
+				{
+					wchar_buf_printf(&value_wcbuf,"%I64u",size);
+				}
+				
+				_es_output_group_field(0,size_json_name_wcbuf.buf,value_wcbuf.buf,0);
+				
+				ft.dwLowDateTime = (DWORD)date_modified;
+				ft.dwHighDateTime = (DWORD)(date_modified >> 32);
+				
+				_es_output_stat_filetime(date_modified_json_name_wcbuf.buf,&ft,date_modified != ES_UINT64_MAX);
+			}
+			
+			_es_output_line_end(result_run > 1);
+		}
+		
+		is_first_line = 0;
+		result_run--;
+	}
+	
+	_es_output_page_end();
+	
+	wchar_buf_kill(&date_modified_json_name_wcbuf);
+	wchar_buf_kill(&size_json_name_wcbuf);
+	wchar_buf_kill(&name_json_name_wcbuf);
+	wchar_buf_kill(&line_wcbuf);
+	wchar_buf_kill(&value_wcbuf);
+	wchar_buf_kill(&name_wcbuf);
+	utf8_buf_kill(&row_cbuf);
+	utf8_buf_kill(&path_cbuf);
+}
+
+// list the items in a folder from the index.
+// the folder filter has already been added to the search.
+// returns TRUE if the search was sent.
+// Otherwise, returns FALSE.
+static BOOL _es_ipc3_ls_query(const wchar_t *path)
+{
+	BOOL ret;
+	HANDLE pipe_handle;
+	
+	ret = FALSE;
+
+	pipe_handle = ipc3_connect_pipe();
+	if (pipe_handle != INVALID_HANDLE_VALUE)
+	{
+		ipc3_search_property_request_t property_request_array[5];
+		
+		// the columns of a file list.
+		property_request_array[0].property_id = EVERYTHING3_PROPERTY_ID_FULL_PATH;
+		property_request_array[0].flags = 0;
+		property_request_array[1].property_id = EVERYTHING3_PROPERTY_ID_SIZE;
+		property_request_array[1].flags = 0;
+		property_request_array[2].property_id = EVERYTHING3_PROPERTY_ID_DATE_MODIFIED;
+		property_request_array[2].flags = 0;
+		property_request_array[3].property_id = EVERYTHING3_PROPERTY_ID_DATE_CREATED;
+		property_request_array[3].flags = 0;
+		property_request_array[4].property_id = EVERYTHING3_PROPERTY_ID_ATTRIBUTES;
+		property_request_array[4].flags = 0;
+		
+		if (_es_ipc3_write_search(pipe_handle,_es_ipc3_get_search_flags(),safe_size_from_uint64(_es_offset),safe_size_from_uint64(_es_max_results),property_request_array,5))
+		{
+			ipc3_stream_pipe_t pipe_stream;
+			ipc3_result_list_t result_list;
+			utf8_buf_t prefix_cbuf;
+			
+			utf8_buf_init(&prefix_cbuf);
+			
+			ipc3_stream_pipe_init(&pipe_stream,pipe_handle);
+			ipc3_result_list_init(&result_list,(ipc3_stream_t *)&pipe_stream);
+			
+			// names are relative to the folder, including the trailing path separator.
+			utf8_buf_copy_wchar_string(&prefix_cbuf,path);
+			utf8_buf_cat_path_separator(&prefix_cbuf);
+			
+			if (_es_no_result_error)
+			{
+				if (result_list.folder_result_count + result_list.file_result_count == 0)
+				{
+					_es_ret = ES_ERROR_NO_RESULTS;
+				}
+			}
+			
+			if (!result_list.stream->is_error)
+			{
+				_es_ls_read_results(&result_list,prefix_cbuf.length_in_bytes);
+			}
+			
+			if (result_list.stream->is_error)
+			{
+				_es_ret = ES_ERROR_IPC_ERROR;
+			}
+			
+			// don't try to process ipc2 or ipc1 if we sent the request successfully.
+			ret = TRUE;
+			
+			ipc3_result_list_kill(&result_list);
+			ipc3_stream_close((ipc3_stream_t *)&pipe_stream);
+			
+			utf8_buf_kill(&prefix_cbuf);
+		}
+		
+		CloseHandle(pipe_handle);
+	}
+
+	return ret;
+}
+
+static int _es_compare_list_items(const EVERYTHING_IPC_ITEM *a,const EVERYTHING_IPC_ITEM *b)
+{
+	int cmp_ret;
+
+	// folders first.
+	if (a->flags & EVERYTHING_IPC_FOLDER)
+	{
+		if (b->flags & EVERYTHING_IPC_FOLDER)
+		{
+			// both folders.
+			// fall through.
+		}
+		else
+		{
+			// A<B
+			return -1;
+		}
+	}
+	else
+	{
+		if (b->flags & EVERYTHING_IPC_FOLDER)
+		{
+			// A>B
+			return 1;
+		}
+		else
+		{
+			// both files
+			// fall through.
+		}
+	}
+	
+	cmp_ret = CompareString(LOCALE_USER_DEFAULT,NORM_IGNORECASE,EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),-1,EVERYTHING_IPC_ITEMPATH(_es_sort_list,b),-1);
+	
+//debug_printf("cmp %S %S %d\n",EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),EVERYTHING_IPC_ITEMPATH(_es_sort_list,b),cmp_ret)	;
+
+	if (cmp_ret)
+	{
+		if (cmp_ret == CSTR_LESS_THAN)
+		{
+			return -1;
+		}
+		else
+		if (cmp_ret == CSTR_GREATER_THAN)
+		{
+			return 1;
+		}
+	}
+
+	return wchar_string_compare(EVERYTHING_IPC_ITEMPATH(_es_sort_list,a),EVERYTHING_IPC_ITEMPATH(_es_sort_list,b));
+}
+
+void DECLSPEC_NORETURN es_fatal(int error_code)
+{
+	const char *msg;
+	int show_help;
+	
+	_es_flush_export_buffer();
+	
+	_es_compress_finish();
+
+	if (_es_export_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_es_export_file);
+		
+		_es_export_file = INVALID_HANDLE_VALUE;
+	}
+	
+	_es_tee_close_all();
+	
+	msg = 0;
+	show_help = 0;
+
+	switch(error_code)
+	{
+		case ES_ERROR_REGISTER_WINDOW_CLASS:
+			msg = "Failed to register window class.\r\n";
+			break;
+			
+		case ES_ERROR_CREATE_WINDOW:
+			msg = "Failed to create window.\r\n";
+			break;
+			
+		case ES_ERROR_OUT_OF_MEMORY:
+			msg = "Out of memory.\r\n";
+			break;
+			
+		case ES_ERROR_EXPECTED_SWITCH_PARAMETER:
+			msg = "Expected switch parameter.\r\n";
+			// this error is permanent, show help:
+			show_help = 1;
+			break;
+			
+		case ES_ERROR_CREATE_FILE:
+			msg = "Failed to create output file.\r\n";
+			break;
+			
+		case ES_ERROR_UNKNOWN_SWITCH:
+			msg = "Unknown switch.\r\n";
+			// this error is permanent, show help:
+			show_help = 1;
+			break;
+			
+		case ES_ERROR_IPC_ERROR:
+			msg = "Unable to send IPC message or bad IPC reply.\r\n";
+			break;
+			
+		case ES_ERROR_NO_IPC:
+			msg = "Everything IPC not found. Please make sure Everything is running.\r\n";
+			break;
+			
+		case ES_ERROR_NO_RESULTS:
+			msg = "No results found.\r\n";
+			break;
+			
+		case ES_ERROR_DEADLINE_EXPIRED:
+			msg = "The deadline expired before all results were read.\r\n";
+			break;
+	}
+	
+	if (msg)
+	{
+		os_error_printf("Error %d: %s",error_code,msg);
+	}
+	
+	if (show_help)
+	{
+		_es_help();
+	}
+
+	ExitProcess(error_code);
+}
+
+// the output could not be written, the reader has most likely exited, eg: es | more
+// there's no point reading any more results.
+// exiting closes the Everything pipe, so Everything cancels the search instead of
+// sending results nobody will read.
+static void DECLSPEC_NORETURN _es_write_output_failed(void)
+{
+	DWORD last_error;
+	
+	last_error = GetLastError();
+	
+	// a closed pipe is expected, only report other errors, eg: disk full.
+	if ((last_error != ERROR_NO_DATA) && (last_error != ERROR_BROKEN_PIPE))
+	{
+		os_error_printf("Error %d: %s",ES_ERROR_WRITE_OUTPUT,"Failed to write output.\r\n");
+	}
+	
+	es_fatal(ES_ERROR_WRITE_OUTPUT);
+}
+
+// write to stdout or the export file.
+// returns TRUE if all the data was written.
+// returns FALSE on error. Call GetLastError() for more information.
+// safe to call from the compress thread.
+static BOOL _es_try_write_output(HANDLE file_handle,const void *data,SIZE_T size)
+{
+	const BYTE *p;
+	SIZE_T run;
+	
+	p = (const BYTE *)data;
+	run = size;
+	
+	while(run)
+	{
+		DWORD write_size;
+		DWORD numwritten;
+		
+		if (run <= ES_DWORD_MAX)
+		{
+			write_size = (DWORD)run;
+		}
+		else
+		{
+			write_size = ES_DWORD_MAX;
+		}
+		
+		if (!WriteFile(file_handle,p,write_size,&numwritten,0))
+		{
+			return FALSE;
+		}
+		
+		if (numwritten != write_size)
+		{
+			return FALSE;
+		}
+		
+		p += write_size;
+		run -= write_size;
+	}
+	
+	return TRUE;
+}
+
+// write to stdout or the export file.
+// doesn't return if the write fails.
+static void _es_write_output(HANDLE file_handle,const void *data,DWORD size)
+{
+	if (!_es_try_write_output(file_handle,data,size))
+	{
+		_es_write_output_failed();
+	}
+}
+
+static void DECLSPEC_NORETURN _es_bad_switch_param(const char *format,...)
+{
+	va_list argptr;
+	utf8_buf_t cbuf;
+
+	va_start(argptr,format);
+	utf8_buf_init(&cbuf);
+
+	utf8_buf_vprintf(&cbuf,format,argptr);
+
+	os_error_printf("Error %d: %s",ES_ERROR_EXPECTED_SWITCH_PARAMETER,cbuf.buf);
+
+	utf8_buf_kill(&cbuf);
+	va_end(argptr);
+
+	ExitProcess(ES_ERROR_EXPECTED_SWITCH_PARAMETER);
+}
+
+static void _es_console_fill(SIZE_T count,int ascii_ch)
+{
+	if (_es_output_cibuf)
+	{
+		SIZE_T i;
+		
+		for(i=0;i<count;i++)
+		{
+			if ((int)i + _es_output_cibuf_x >= _es_console_window_wide)
+			{
+				break;
+			}
+
+			if ((int)i + _es_output_cibuf_x >= 0)
+			{
+				_es_output_cibuf[(int)i+_es_output_cibuf_x].Attributes = _es_output_color;
+				_es_output_cibuf[(int)i+_es_output_cibuf_x].Char.UnicodeChar = ascii_ch;
+			}
+		}
+		
+		_es_output_cibuf_x += (int)count;
+	}
+	else
+	if (_es_output_is_char)
+	{
+		wchar_buf_t wcbuf;
+		wchar_t *d;
+		DWORD numwritten;
+		SIZE_T i;
+		
+		wchar_buf_init(&wcbuf);
+
+		wchar_buf_grow_size(&wcbuf,count);
+
+		d = wcbuf.buf;
+		
+		for(i=0;i<count;i++)
+		{
+			*d++ = ascii_ch;
+		}
+
+		if (count <= ES_DWORD_MAX)
+		{
+			WriteConsole(_es_output_handle,wcbuf.buf,(DWORD)count,&numwritten,0);
+		}
+		
+		wchar_buf_kill(&wcbuf);
+	}
+	else
+	{
+		utf8_buf_t cbuf;
+		BYTE *d;
+		SIZE_T i;
+		
+		utf8_buf_init(&cbuf);
+
+		utf8_buf_grow_size(&cbuf,count);
+
+		d = cbuf.buf;
+		
+		for(i=0;i<count;i++)
+		{
+			*d++ = ascii_ch;
+		}
+
+		if (count <= ES_DWORD_MAX)
+		{
+			_es_write_output(_es_output_handle,cbuf.buf,(DWORD)count);
+		}
+		
+		utf8_buf_kill(&cbuf);
+	}
+}
+
+// get the length in wchars from a wchar string.
+static SIZE_T _es_highlighted_wchar_string_get_length_in_wchars(const wchar_t *s)
+{
+	const wchar_t *p;
+	SIZE_T len;
+	
+	len = 0;
+	p = s;
+	while(*p)
+	{
+		if (*p == '*')
+		{
+			if (p[1] == '*')
+			{
+				len++;
+				p += 2;
+				continue;	
+			}
+			
+			p++;
+			continue;
+		}
+		
+		len++;
+		p++;
 	}
 	
 	return len;
@@ -1337,7 +7993,6 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 	SIZE_T length_in_wchars;
 	int is_right_aligned;
 	SIZE_T column_width;
-	column_color_t *column_color;
 	int did_set_color;
 
 	if ((is_highlighted) && (_es_output_is_char))
@@ -1349,9 +8004,8 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 		length_in_wchars = wchar_string_get_length_in_wchars(text);
 	}
 	
-	is_right_aligned = property_is_right_aligned(_es_output_column->property_id);
-	column_width = column_width_get(_es_output_column->property_id);
-	column_color = column_color_find(_es_output_column->property_id);
+	is_right_aligned = _es_output_column_attribute->is_right_aligned;
+	column_width = _es_output_column_attribute->width;
 	_es_output_color = _es_default_attributes;
 	did_set_color = 0;
 	
@@ -1359,15 +8013,15 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 	// pipe? console? cibuf?
 	if (_es_output_cibuf)
 	{
-		_es_output_color = column_color ? column_color->color : _es_default_attributes;
+		_es_output_color = _es_output_column_attribute->has_color ? _es_output_column_attribute->color : _es_default_attributes;
 	}
 	else
 	if (_es_output_is_char)
 	{
-		if (column_color)
+		if (_es_output_column_attribute->has_color)
 		{
-			_es_output_color = column_color->color;
-			SetConsoleTextAttribute(_es_output_handle,column_color->color);
+			_es_output_color = _es_output_column_attribute->color;
+			SetConsoleTextAttribute(_es_output_handle,_es_output_column_attribute->color);
 
 			did_set_color = 1;
 		}
@@ -1615,7 +8269,6 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 			len = WideCharToMultiByte(_es_cp,0,text,(int)length_in_wchars,0,0,0,0);
 			if (len)
 			{
-				DWORD numwritten;
 				utf8_buf_t cbuf;
 
 				utf8_buf_init(&cbuf);
@@ -1624,7 +8277,7 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 
 				WideCharToMultiByte(_es_cp,0,text,(int)length_in_wchars,cbuf.buf,len,0,0);
 				
-				WriteFile(_es_output_handle,cbuf.buf,len,&numwritten,0);
+				_es_write_output(_es_output_handle,cbuf.buf,len);
 				
 				utf8_buf_kill(&cbuf);
 			}
@@ -1661,237 +8314,820 @@ static void _es_output_cell_write_console_wchar_string(const wchar_t *text,int i
 					_es_console_fill(fill_length,' ');
 				}
 			}
-		}
-	
-		if (length_in_wchars > column_width)
-		{
-			_es_output_cell_overflow += length_in_wchars - column_width;
-		}
+		}
+	
+		if (length_in_wchars > column_width)
+		{
+			_es_output_cell_overflow += length_in_wchars - column_width;
+		}
+	}
+	
+	// restore color
+	if (did_set_color)
+	{
+		SetConsoleTextAttribute(_es_output_handle,_es_default_attributes);
+	}
+}
+
+// write to the export buffer.
+static void _es_export_write_data(const BYTE *data,SIZE_T length_in_bytes)
+{
+	const BYTE *p;
+	SIZE_T run;
+	
+	p = data;
+	run = length_in_bytes;
+	
+	while(run)
+	{
+		DWORD copy_size;
+		
+		if (!_es_export_avail)
+		{
+			if (!_es_flush_export_buffer())
+			{
+				break;
+			}
+		}
+		
+		if (run <= _es_export_avail)
+		{
+			copy_size = (DWORD)run;
+		}
+		else
+		{
+			copy_size = _es_export_avail;
+		}
+
+		os_copy_memory(_es_export_p,p,copy_size);
+		_es_export_avail -= copy_size;
+		_es_export_p += copy_size;
+		
+		p += copy_size;
+		run -= copy_size;
+	}
+}
+
+// write a wchar string to the export buffer.
+static void _es_export_write_wchar_string_n(const wchar_t *text,SIZE_T wlen)
+{
+	if (wlen <= ES_DWORD_MAX)
+	{
+		int len;
+		int cp;
+		utf8_buf_t cbuf;
+		
+		cp = CP_UTF8;
+		utf8_buf_init(&cbuf);
+
+		if (_es_export_type == _ES_EXPORT_TYPE_M3U)		
+		{
+			cp = CP_ACP;
+		}
+		
+		len = WideCharToMultiByte(cp,0,text,(DWORD)wlen,0,0,0,0);
+		
+		utf8_buf_grow_size(&cbuf,len);
+
+		len = WideCharToMultiByte(cp,0,text,(DWORD)wlen,cbuf.buf,len,0,0);
+		
+		if (wlen < 0)
+		{
+			// remove null from len.
+			if (len) 
+			{
+				len--;
+			}
+		}
+		
+		_es_export_write_data(cbuf.buf,len);
+
+		utf8_buf_kill(&cbuf);
+	}
+}
+
+// write out a wchar string to an entire cell.
+static void _es_output_cell_wchar_string(const wchar_t *text,int is_highlighted)
+{
+	if (_es_export_file != INVALID_HANDLE_VALUE)
+	{
+		_es_export_write_wchar_string_n(text,wchar_string_get_length_in_wchars(text));
+	}
+	else
+	{
+		_es_output_cell_write_console_wchar_string(text,is_highlighted);
+	}
+}
+
+// write out a UTF-8 string to an entire cell.
+static void _es_output_cell_utf8_string(const ES_UTF8 *text,int is_highlighted)
+{
+	wchar_buf_t wcbuf;
+
+	wchar_buf_init(&wcbuf);
+
+	wchar_buf_copy_utf8_string(&wcbuf,text);
+	
+	if (wcbuf.length_in_wchars <= INT_MAX)
+	{
+		_es_output_cell_wchar_string(wcbuf.buf,is_highlighted);
+	}
+
+	wchar_buf_kill(&wcbuf);
+}
+
+// write out a CSV wchar string to an entire cell.
+static void _es_output_cell_csv_wchar_string(const wchar_t *s,int is_highlighted)
+{
+	wchar_buf_t wcbuf;
+	const wchar_t *start;
+	const wchar_t *p;
+	
+	wchar_buf_init(&wcbuf);
+
+	wchar_buf_cat_wchar(&wcbuf,'"');
+	
+	start = s;
+	p = s;
+	
+	while(*p)
+	{
+		if (*p == '"')
+		{
+			wchar_buf_cat_wchar_string_n(&wcbuf,start,p-start);
+
+			// escape double quotes with double double quotes.
+			wchar_buf_cat_wchar(&wcbuf,'"');
+			wchar_buf_cat_wchar(&wcbuf,'"');
+			
+			start = p + 1;
+		}
+		
+		p++;
+	}
+
+	wchar_buf_cat_wchar_string_n(&wcbuf,start,p-start);
+
+	wchar_buf_cat_wchar(&wcbuf,'"');
+	
+	_es_output_cell_wchar_string(wcbuf.buf,is_highlighted);
+
+	wchar_buf_kill(&wcbuf);
+}
+
+// should a TSV/CSV string value be quoted.
+static BOOL _es_should_quote(int separator_ch,const wchar_t *s)
+{
+	const wchar_t *p;
+	
+	p = s;
+	
+	while(*p)
+	{
+		if ((*p == separator_ch) || (*p == '"') || (*p == '\r') || (*p == '\n'))
+		{
+			return TRUE;
+		}
+		
+		p++;
+	}
+	
+	return FALSE;
+}
+
+// write out a CSV wchar string to an entire cell.
+// same as _es_output_cell_csv_wchar_string.
+// but this version will only use double quotes if the text contains a separator or double quotes.
+static void _es_output_cell_csv_wchar_string_with_optional_quotes(int is_always_double_quote,int separator_ch,const wchar_t *s,int is_highlighted)
+{
+	if (!is_always_double_quote)
+	{
+		if (!_es_should_quote(separator_ch,s))
+		{
+			// no quotes required..
+			_es_output_cell_wchar_string(s,is_highlighted);
+			
+			return;
+		}
+	}
+
+	// write with quotes..
+	_es_output_cell_csv_wchar_string(s,is_highlighted);
+}
+
+// flush any unwritten data in the export buffer to disk.
+static BOOL _es_flush_export_buffer(void)
+{
+	BOOL ret;
+	
+	ret = FALSE;
+	
+	if (_es_export_file != INVALID_HANDLE_VALUE)
+	{
+		if (_es_export_avail != _ES_EXPORT_BUF_SIZE)
+		{
+			if (_es_export_buf)
+			{
+				DWORD size;
+				
+				size = _ES_EXPORT_BUF_SIZE - _es_export_avail;
+				
+				// reset first, so the buffer is not written again if the write fails.
+				_es_export_p = _es_export_buf;
+				_es_export_avail = _ES_EXPORT_BUF_SIZE;
+				
+				if (_es_compress_thread_handle)
+				{
+					_es_compress_export_buffer(size);
+				}
+				else
+				{
+					_es_write_output(_es_export_file,_es_export_buf,size);
+				}
+				
+				ret = TRUE;
+			}
+		}	
 	}
 	
-	// restore color
-	if (did_set_color)
-	{
-		SetConsoleTextAttribute(_es_output_handle,_es_default_attributes);
-	}
+	return ret;
 }
 
-// write to the export buffer.
-static void _es_export_write_data(const BYTE *data,SIZE_T length_in_bytes)
+// open an -export-* file.
+// an earlier -export-* file is kept as an extra export of the same results.
+static void _es_set_export_file(const wchar_t *filename,BYTE export_type)
 {
-	const BYTE *p;
-	SIZE_T run;
+	HANDLE file_handle;
 	
-	p = data;
-	run = length_in_bytes;
+	file_handle = os_create_file(filename);
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		es_fatal(ES_ERROR_CREATE_FILE);
+	}
 	
-	while(run)
+	if (_es_export_file != INVALID_HANDLE_VALUE)
 	{
-		DWORD copy_size;
+		_es_tee_t *tee;
 		
-		if (!_es_export_avail)
+		// txt and m3u exports replace the columns with the full path.
+		if ((!_es_is_tee_export_type(_es_export_type)) || (!_es_is_tee_export_type(export_type)))
 		{
-			if (!_es_flush_export_buffer())
-			{
-				break;
-			}
+			CloseHandle(file_handle);
+			
+			_es_bad_switch_param("Only -export-csv, -export-tsv, -export-efu and -export-json can be used together.\n");
 		}
 		
-		if (run <= _es_export_avail)
+		tee = mem_alloc(sizeof(_es_tee_t));
+		
+		// keep an EFU export as the main export, so the standard EFU columns are added.
+		if (export_type == _ES_EXPORT_TYPE_EFU)
 		{
-			copy_size = (DWORD)run;
+			tee->export_type = _es_export_type;
+			tee->export_file = _es_export_file;
+			
+			_es_export_type = export_type;
+			_es_export_file = file_handle;
+			
+			wchar_buf_copy_wchar_string(_es_export_filename_wcbuf,filename);
 		}
 		else
 		{
-			copy_size = _es_export_avail;
+			tee->export_type = export_type;
+			tee->export_file = file_handle;
 		}
-
-		os_copy_memory(_es_export_p,p,copy_size);
-		_es_export_avail -= copy_size;
-		_es_export_p += copy_size;
 		
-		p += copy_size;
-		run -= copy_size;
+		tee->export_buf = NULL;
+		tee->export_p = NULL;
+		tee->export_avail = 0;
+		tee->header = 0;
+		tee->footer = 0;
+		tee->next = NULL;
+		
+		if (_es_tee_start)
+		{
+			_es_tee_last->next = tee;
+		}
+		else
+		{
+			_es_tee_start = tee;
+		}
+		
+		_es_tee_last = tee;
+	}
+	else
+	{
+		_es_export_file = file_handle;
+		_es_export_type = export_type;
+		
+		wchar_buf_copy_wchar_string(_es_export_filename_wcbuf,filename);
 	}
 }
 
-// write a wchar string to the export buffer.
-static void _es_export_write_wchar_string_n(const wchar_t *text,SIZE_T wlen)
+// returns TRUE if the export type can be used with other exports.
+static BOOL _es_is_tee_export_type(BYTE export_type)
 {
-	if (wlen <= ES_DWORD_MAX)
+	switch(export_type)
 	{
-		int len;
-		int cp;
-		utf8_buf_t cbuf;
-		
-		cp = CP_UTF8;
-		utf8_buf_init(&cbuf);
+		case _ES_EXPORT_TYPE_CSV:
+		case _ES_EXPORT_TYPE_TSV:
+		case _ES_EXPORT_TYPE_EFU:
+		case _ES_EXPORT_TYPE_JSON:
+			return TRUE;
+	}
+	
+	return FALSE;
+}
 
-		if (_es_export_type == _ES_EXPORT_TYPE_M3U)		
-		{
-			cp = CP_ACP;
-		}
+// swap the main export with an extra export.
+// call again to swap back.
+static void _es_tee_swap(_es_tee_t *tee)
+{
+	BYTE export_type;
+	HANDLE export_file;
+	BYTE *export_buf;
+	BYTE *export_p;
+	DWORD export_avail;
+	int header;
+	int footer;
+	
+	export_type = _es_export_type;
+	export_file = _es_export_file;
+	export_buf = _es_export_buf;
+	export_p = _es_export_p;
+	export_avail = _es_export_avail;
+	header = _es_header;
+	footer = _es_footer;
+	
+	_es_export_type = tee->export_type;
+	_es_export_file = tee->export_file;
+	_es_export_buf = tee->export_buf;
+	_es_export_p = tee->export_p;
+	_es_export_avail = tee->export_avail;
+	_es_header = tee->header;
+	_es_footer = tee->footer;
+	
+	tee->export_type = export_type;
+	tee->export_file = export_file;
+	tee->export_buf = export_buf;
+	tee->export_p = export_p;
+	tee->export_avail = export_avail;
+	tee->header = header;
+	tee->footer = footer;
+}
+
+// flush and close the extra exports.
+static void _es_tee_close_all(void)
+{
+	while(_es_tee_start)
+	{
+		_es_tee_t *tee;
 		
-		len = WideCharToMultiByte(cp,0,text,(DWORD)wlen,0,0,0,0);
+		// unlink first, in case the write fails.
+		tee = _es_tee_start;
+		_es_tee_start = tee->next;
 		
-		utf8_buf_grow_size(&cbuf,len);
-
-		len = WideCharToMultiByte(cp,0,text,(DWORD)wlen,cbuf.buf,len,0,0);
+		if ((tee->export_buf) && (tee->export_avail != _ES_EXPORT_BUF_SIZE))
+		{
+			DWORD size;
+			
+			size = _ES_EXPORT_BUF_SIZE - tee->export_avail;
+			
+			tee->export_avail = _ES_EXPORT_BUF_SIZE;
+			
+			_es_write_output(tee->export_file,tee->export_buf,size);
+		}
 		
-		if (wlen < 0)
+		if (tee->export_buf)
 		{
-			// remove null from len.
-			if (len) 
-			{
-				len--;
-			}
+			mem_free(tee->export_buf);
 		}
 		
-		_es_export_write_data(cbuf.buf,len);
-
-		utf8_buf_kill(&cbuf);
+		CloseHandle(tee->export_file);
+		
+		mem_free(tee);
 	}
+	
+	_es_tee_last = NULL;
 }
 
-// write out a wchar string to an entire cell.
-static void _es_output_cell_wchar_string(const wchar_t *text,int is_highlighted)
+// get the filename of a -export-shard file.
+// the shard number is inserted before the extension, eg: out.0001.csv
+static void _es_shard_get_filename(DWORD shard_index,wchar_buf_t *out_wcbuf)
 {
-	if (_es_export_file != INVALID_HANDLE_VALUE)
+	const wchar_t *p;
+	const wchar_t *extension_p;
+	
+	p = _es_export_filename_wcbuf->buf;
+	extension_p = NULL;
+	
+	while(*p)
 	{
-		_es_export_write_wchar_string_n(text,wchar_string_get_length_in_wchars(text));
+		if ((*p == '\\') || (*p == '/'))
+		{
+			extension_p = NULL;
+		}
+		else
+		if (*p == '.')
+		{
+			extension_p = p;
+		}
+		
+		p++;
 	}
-	else
+	
+	if (!extension_p)
 	{
-		_es_output_cell_write_console_wchar_string(text,is_highlighted);
+		extension_p = p;
 	}
+	
+	wchar_buf_copy_wchar_string_n(out_wcbuf,_es_export_filename_wcbuf->buf,extension_p - _es_export_filename_wcbuf->buf);
+	wchar_buf_cat_printf(out_wcbuf,".%04u",shard_index);
+	wchar_buf_cat_wchar_string_n(out_wcbuf,extension_p,p - extension_p);
 }
 
-// write out a UTF-8 string to an entire cell.
-static void _es_output_cell_utf8_string(const ES_UTF8 *text,int is_highlighted)
+// create the next -export-shard file.
+static void _es_shard_open(void)
 {
-	wchar_buf_t wcbuf;
+	wchar_buf_t filename_wcbuf;
+	
+	wchar_buf_init(&filename_wcbuf);
+	
+	_es_shard_index++;
+	_es_shard_row_count = 0;
+	
+	_es_shard_get_filename(_es_shard_index,&filename_wcbuf);
+	
+	_es_export_file = os_create_file(filename_wcbuf.buf);
+	if (_es_export_file == INVALID_HANDLE_VALUE)
+	{
+		es_fatal(ES_ERROR_CREATE_FILE);
+	}
 
-	wchar_buf_init(&wcbuf);
+	wchar_buf_kill(&filename_wcbuf);
+}
 
-	wchar_buf_copy_utf8_string(&wcbuf,text);
+// replace the -export-* file with the first -export-shard file.
+static void _es_shard_start(void)
+{
+	if ((_es_export_file == INVALID_HANDLE_VALUE) || (!_es_export_filename_wcbuf->length_in_wchars))
+	{
+		_es_bad_switch_param("-export-shard requires an -export-* file.\n");
+	}
 	
-	if (wcbuf.length_in_wchars <= INT_MAX)
+	if (_es_tee_start)
 	{
-		_es_output_cell_wchar_string(wcbuf.buf,is_highlighted);
+		_es_bad_switch_param("-export-shard can only be used with one -export-* file.\n");
 	}
 
-	wchar_buf_kill(&wcbuf);
+	// the shards are written instead.
+	CloseHandle(_es_export_file);
+	DeleteFile(_es_export_filename_wcbuf->buf);
+	
+	_es_shard_open();
 }
 
-// write out a CSV wchar string to an entire cell.
-static void _es_output_cell_csv_wchar_string(const wchar_t *s,int is_highlighted)
+// finish the open -export-shard file and start the next one.
+// the finished file is closed so it can be used straight away.
+static void _es_shard_next(void)
 {
-	wchar_buf_t wcbuf;
-	const wchar_t *start;
-	const wchar_t *p;
+	_es_output_page_end();
 	
-	wchar_buf_init(&wcbuf);
+	_es_flush_export_buffer();
+	
+	_es_compress_finish();
+	
+	CloseHandle(_es_export_file);
+	
+	_es_shard_open();
+	
+	if (_es_compress_type != COMPRESS_TYPE_NONE)
+	{
+		_es_compress_start();
+	}
+	
+	// the first shard gets the BOM from the export setup.
+	if (_es_utf8_bom)
+	{
+		_es_export_write_data((const BYTE *)"\xEF\xBB\xBF",3);
+	}
+	
+	_es_output_page_begin();
 
-	wchar_buf_cat_wchar(&wcbuf,'"');
+	if (_es_header > 0)
+	{
+		_es_output_header();
+	}
+}
+
+// find the -export-shard by=<property> value in a recorded result.
+// the key is returned as an offset and size in bytes into buf.
+// returns FALSE if the property was not returned.
+static BOOL _es_shard_get_key(ipc3_result_list_t *result_list,const void *buf,SIZE_T size,int is_64bit,SIZE_T *out_key_offset,SIZE_T *out_key_size)
+{
+	ipc3_stream_memory_t memory_stream;
+	const ipc3_result_list_property_request_t *property_request_array;
+	SIZE_T property_request_index;
+	BOOL ret;
 	
-	start = s;
-	p = s;
+	ret = FALSE;
+	property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
 	
-	while(*p)
+	ipc3_stream_memory_init(&memory_stream,buf,size,is_64bit);
+	
+	// item flags.
+	ipc3_stream_read_byte((ipc3_stream_t *)&memory_stream);
+	
+	for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
 	{
-		if (*p == '"')
+		SIZE_T key_offset;
+		
+		key_offset = memory_stream.pos;
+		
+		ipc3_result_list_skip_property_value((ipc3_stream_t *)&memory_stream,&property_request_array[property_request_index]);
+		
+		if (memory_stream.base.is_error)
 		{
-			wchar_buf_cat_wchar_string_n(&wcbuf,start,p-start);
-
-			// escape double quotes with double double quotes.
-			wchar_buf_cat_wchar(&wcbuf,'"');
-			wchar_buf_cat_wchar(&wcbuf,'"');
-			
-			start = p + 1;
+			break;
 		}
 		
-		p++;
+		if (property_request_array[property_request_index].property_id == _es_shard_property_id)
+		{
+			*out_key_offset = key_offset;
+			*out_key_size = memory_stream.pos - key_offset;
+			
+			ret = TRUE;
+			
+			break;
+		}
 	}
-
-	wchar_buf_cat_wchar_string_n(&wcbuf,start,p-start);
-
-	wchar_buf_cat_wchar(&wcbuf,'"');
 	
-	_es_output_cell_wchar_string(wcbuf.buf,is_highlighted);
+	ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+	
+	return ret;
+}
 
-	wchar_buf_kill(&wcbuf);
+// returns TRUE if the pending result is the last row in the open -export-shard file.
+// next_buf is the result after the pending result.
+static BOOL _es_shard_is_last_row(ipc3_result_list_t *result_list,const void *pending_buf,SIZE_T pending_size,const void *next_buf,SIZE_T next_size,int is_64bit)
+{
+	switch(_es_shard_type)
+	{
+		case _ES_SHARD_TYPE_ROWS:
+		
+			_es_shard_row_count++;
+			
+			if (_es_shard_row_count >= _es_shard_limit)
+			{
+				return TRUE;
+			}
+			
+			break;
+			
+		case _ES_SHARD_TYPE_BYTES:
+		
+			{
+				DWORD size_lo;
+				DWORD size_hi;
+				
+				// the file is only written to, so the file size is the write position.
+				size_lo = GetFileSize(_es_export_file,&size_hi);
+				
+				if (size_lo != INVALID_FILE_SIZE)
+				{
+					ES_UINT64 size;
+					
+					size = ((ES_UINT64)size_hi << 32) | size_lo;
+					size += _ES_EXPORT_BUF_SIZE - _es_export_avail;
+					
+					if (size >= _es_shard_limit)
+					{
+						return TRUE;
+					}
+				}
+			}
+			
+			break;
+			
+		case _ES_SHARD_TYPE_BY:
+		
+			{
+				SIZE_T pending_key_offset;
+				SIZE_T pending_key_size;
+				SIZE_T next_key_offset;
+				SIZE_T next_key_size;
+				
+				if ((_es_shard_get_key(result_list,pending_buf,pending_size,is_64bit,&pending_key_offset,&pending_key_size)) && (_es_shard_get_key(result_list,next_buf,next_size,is_64bit,&next_key_offset,&next_key_size)))
+				{
+					const BYTE *pending_key_p;
+					const BYTE *next_key_p;
+					SIZE_T run;
+					
+					if (pending_key_size != next_key_size)
+					{
+						return TRUE;
+					}
+					
+					pending_key_p = (const BYTE *)pending_buf + pending_key_offset;
+					next_key_p = (const BYTE *)next_buf + next_key_offset;
+					run = pending_key_size;
+					
+					while(run)
+					{
+						if (*pending_key_p != *next_key_p)
+						{
+							return TRUE;
+						}
+						
+						pending_key_p++;
+						next_key_p++;
+						run--;
+					}
+				}
+			}
+			
+			break;
+	}
+	
+	return FALSE;
 }
 
-// should a TSV/CSV string value be quoted.
-static BOOL _es_should_quote(int separator_ch,const wchar_t *s)
+// get the -export-compress format from a name.
+// returns COMPRESS_TYPE_NONE if the name is unknown.
+static BYTE _es_compress_type_from_name(const wchar_t *name)
 {
 	const wchar_t *p;
 	
-	p = s;
+	p = wchar_string_parse_nocase_lowercase_ascii_string(name,"gzip");
+	if ((p) && (!*p))
+	{
+		return COMPRESS_TYPE_GZIP;
+	}
 	
-	while(*p)
+	p = wchar_string_parse_nocase_lowercase_ascii_string(name,"zlib");
+	if ((p) && (!*p))
 	{
-		if ((*p == separator_ch) || (*p == '"') || (*p == '\r') || (*p == '\n'))
-		{
-			return TRUE;
-		}
-		
-		p++;
+		return COMPRESS_TYPE_ZLIB;
 	}
 	
-	return FALSE;
+	p = wchar_string_parse_nocase_lowercase_ascii_string(name,"deflate");
+	if ((p) && (!*p))
+	{
+		return COMPRESS_TYPE_DEFLATE;
+	}
+	
+	return COMPRESS_TYPE_NONE;
 }
 
-// write out a CSV wchar string to an entire cell.
-// same as _es_output_cell_csv_wchar_string.
-// but this version will only use double quotes if the text contains a separator or double quotes.
-static void _es_output_cell_csv_wchar_string_with_optional_quotes(int is_always_double_quote,int separator_ch,const wchar_t *s,int is_highlighted)
+// write compressed data to the export file.
+// user_data is the export file handle.
+// called from the compress thread, so a failed write is reported later by the main thread with _es_write_output_failed.
+static BOOL _es_compress_write_proc(void *user_data,const void *data,SIZE_T size)
 {
-	if (!is_always_double_quote)
+	return _es_try_write_output((HANDLE)user_data,data,size);
+}
+
+// compress full export buffers while the main thread fills the other export buffer.
+// a failed write is reported by the main thread.
+static DWORD WINAPI _es_compress_thread_proc(void *param)
+{
+	for(;;)
 	{
-		if (!_es_should_quote(separator_ch,s))
+		WaitForSingleObject(_es_compress_ready_event,INFINITE);
+		
+		if (_es_compress_is_stop)
 		{
-			// no quotes required..
-			_es_output_cell_wchar_string(s,is_highlighted);
-			
-			return;
+			break;
+		}
+		
+		if (!_es_compress_is_error)
+		{
+			if (!compress_write(_es_compress,_es_compress_buf,_es_compress_size))
+			{
+				_es_compress_last_error = GetLastError();
+				_es_compress_is_error = 1;
+			}
 		}
+		
+		SetEvent(_es_compress_idle_event);
 	}
+	
+	return 0;
+}
 
-	// write with quotes..
-	_es_output_cell_csv_wchar_string(s,is_highlighted);
+// start compressing the export file.
+// the export buffer must be empty.
+static void _es_compress_start(void)
+{
+	DWORD thread_id;
+	
+	_es_compress = mem_alloc(sizeof(compress_t));
+	_es_compress_buf = mem_alloc(_ES_EXPORT_BUF_SIZE);
+	_es_compress_size = 0;
+	_es_compress_is_stop = 0;
+	_es_compress_is_error = 0;
+	
+	// writes the header.
+	compress_init(_es_compress,_es_compress_type,_es_compress_level,_es_compress_write_proc,_es_export_file);
+	
+	if (_es_compress->deflate.is_error)
+	{
+		_es_compress_last_error = GetLastError();
+		_es_compress_is_error = 1;
+	}
+	
+	_es_compress_ready_event = CreateEvent(NULL,FALSE,FALSE,NULL);
+	_es_compress_idle_event = CreateEvent(NULL,FALSE,TRUE,NULL);
+	
+	if ((!_es_compress_ready_event) || (!_es_compress_idle_event))
+	{
+		es_fatal(ES_ERROR_OUT_OF_MEMORY);
+	}
+	
+	_es_compress_thread_handle = CreateThread(NULL,0,_es_compress_thread_proc,NULL,0,&thread_id);
+	if (!_es_compress_thread_handle)
+	{
+		es_fatal(ES_ERROR_OUT_OF_MEMORY);
+	}
 }
 
-// flush any unwritten data in the export buffer to disk.
-static BOOL _es_flush_export_buffer(void)
+// pass the export buffer to the compress thread and swap in the idle buffer.
+// size is the number of bytes in the export buffer.
+static void _es_compress_export_buffer(DWORD size)
 {
-	BOOL ret;
+	BYTE *buf;
 	
-	ret = FALSE;
+	WaitForSingleObject(_es_compress_idle_event,INFINITE);
 	
-	if (_es_export_file != INVALID_HANDLE_VALUE)
+	if (_es_compress_is_error)
 	{
-		if (_es_export_avail != _ES_EXPORT_BUF_SIZE)
+		// reports the error.
+		_es_compress_finish();
+	}
+	
+	buf = _es_compress_buf;
+	
+	_es_compress_buf = _es_export_buf;
+	_es_compress_size = size;
+	
+	_es_export_buf = buf;
+	_es_export_p = buf;
+	_es_export_avail = _ES_EXPORT_BUF_SIZE;
+	
+	SetEvent(_es_compress_ready_event);
+}
+
+// wait for the compress thread to finish and write the trailer.
+// the export buffer must already be flushed.
+// doesn't return if a write failed.
+static void _es_compress_finish(void)
+{
+	if (_es_compress_thread_handle)
+	{
+		HANDLE thread_handle;
+		int is_error;
+		DWORD last_error;
+		
+		// clear first, so we don't finish again from es_fatal.
+		thread_handle = _es_compress_thread_handle;
+		_es_compress_thread_handle = NULL;
+		
+		WaitForSingleObject(_es_compress_idle_event,INFINITE);
+		
+		_es_compress_is_stop = 1;
+		SetEvent(_es_compress_ready_event);
+		
+		WaitForSingleObject(thread_handle,INFINITE);
+		
+		CloseHandle(thread_handle);
+		CloseHandle(_es_compress_idle_event);
+		CloseHandle(_es_compress_ready_event);
+		
+		is_error = _es_compress_is_error;
+		last_error = _es_compress_last_error;
+		
+		if (!is_error)
 		{
-			if (_es_export_buf)
+			if (!compress_finish(_es_compress))
 			{
-				DWORD numwritten;
-				
-				if (WriteFile(_es_export_file,_es_export_buf,_ES_EXPORT_BUF_SIZE - _es_export_avail,&numwritten,0))
-				{
-					if (_ES_EXPORT_BUF_SIZE - _es_export_avail == numwritten)
-					{
-						ret = TRUE;
-					}
-				}
-				
-				_es_export_p = _es_export_buf;
-				_es_export_avail = _ES_EXPORT_BUF_SIZE;
+				last_error = GetLastError();
+				is_error = 1;
 			}
-		}	
+		}
+		
+		compress_kill(_es_compress);
+		mem_free(_es_compress);
+		mem_free(_es_compress_buf);
+		
+		_es_compress = NULL;
+		_es_compress_buf = NULL;
+		
+		if (is_error)
+		{
+			SetLastError(last_error);
+			
+			_es_write_output_failed();
+		}
 	}
-	
-	return ret;
 }
 
 static void _es_output_cell_text_property_wchar_string(const wchar_t *value)
@@ -3644,29 +10880,29 @@ static void _es_output_cell_separator(void)
 {
 	if (_es_output_column != column_order_start)
 	{
-		const ES_UTF8 *separator_text;
+		_es_output_noncell_utf8_string(_es_get_cell_separator_text());
+	}
+}
+
+// get the text between two cells for the current export type.
+static const ES_UTF8 *_es_get_cell_separator_text(void)
+{
+	if ((_es_export_type == _ES_EXPORT_TYPE_CSV) || (_es_export_type == _ES_EXPORT_TYPE_TSV))
+	{
+		return (_es_export_type == _ES_EXPORT_TYPE_CSV) ? "," : "\t";
+	}
 	
-		if ((_es_export_type == _ES_EXPORT_TYPE_CSV) || (_es_export_type == _ES_EXPORT_TYPE_TSV))
-		{
-			separator_text = (_es_export_type == _ES_EXPORT_TYPE_CSV) ? "," : "\t";
-		}
-		else
-		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
-		{
-			separator_text = ",";
-		}
-		else
-		if (_es_export_type == _ES_EXPORT_TYPE_JSON)
-		{
-			separator_text = ",";
-		}
-		else
-		{
-			separator_text = " ";
-		}
-		
-		_es_output_noncell_utf8_string(separator_text);
+	if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+	{
+		return ",";
+	}
+	
+	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
+	{
+		return ",";
 	}
+	
+	return " ";
 }
 
 static void _es_output_noncell_wchar_string(const wchar_t *text)
@@ -3755,7 +10991,6 @@ static void _es_output_noncell_wchar_string_n(const wchar_t *text,SIZE_T length_
 					len = WideCharToMultiByte(_es_cp,0,text,(int)length_in_wchars,0,0,0,0);
 					if (len)
 					{
-						DWORD numwritten;
 						utf8_buf_t cbuf;
 
 						utf8_buf_init(&cbuf);
@@ -3764,7 +10999,7 @@ static void _es_output_noncell_wchar_string_n(const wchar_t *text,SIZE_T length_
 
 						WideCharToMultiByte(_es_cp,0,text,(int)length_in_wchars,cbuf.buf,len,0,0);
 						
-						WriteFile(_es_output_handle,cbuf.buf,len,&numwritten,0);
+						_es_write_output(_es_output_handle,cbuf.buf,len);
 						
 						utf8_buf_kill(&cbuf);
 					}
@@ -3813,7 +11048,13 @@ static void _es_output_header(void)
 	
 	_es_output_line_begin(0);
 	
+	if (_es_is_diff_output)
+	{
+		_es_output_change_field("Change");
+	}
+	
 	_es_output_column = column_order_start;
+	_es_output_column_attribute = column_attribute_array;
 	
 	while(_es_output_column)
 	{
@@ -3826,6 +11067,7 @@ static void _es_output_header(void)
 		_es_output_cell_wchar_string(property_name_wcbuf.buf,0);
 
 		_es_output_column = _es_output_column->order_next;
+		_es_output_column_attribute++;
 	}
 
 	_es_output_line_end(0);
@@ -3838,6 +11080,9 @@ static void _es_output_header(void)
 static void _es_output_page_begin(void)
 {
 	_es_output_cibuf_y = 0;	
+
+	// resolve column colors, widths and formats once for the whole page.
+	column_attribute_update();
 }
 
 static void _es_output_page_end(void)
@@ -3849,6 +11094,7 @@ static void _es_output_line_begin(int is_first)
 	_es_output_cibuf_x = -_es_output_cibuf_hscroll;
 
 	_es_output_column = column_order_start;
+	_es_output_column_attribute = column_attribute_array;
 	
 	if (_es_export_type == _ES_EXPORT_TYPE_JSON)
 	{
@@ -3958,29 +11204,35 @@ static void _es_output_line_end(int is_more)
 			FillConsoleOutputAttribute(_es_output_handle,_es_default_attributes,count,pos,&written);
 		}
 
-		switch(_es_newline_type)
-		{
-			case 0:
-				_es_output_noncell_printf("\r\n");
-				break;
-				
-			case 1:
-				_es_output_noncell_printf("\n");
-				break;
-				
-			case 2:
-				_es_output_noncell_wchar_string_n(L"\0",1);
-				break;
-				
-			case 3:
-				// nothing.
-				break;
-		}
+		_es_output_noncell_newline();
 	}
 	
 	_es_output_cell_overflow = 0;
 }
 
+// output a newline for -crlf, -lf or -nul.
+static void _es_output_noncell_newline(void)
+{
+	switch(_es_newline_type)
+	{
+		case 0:
+			_es_output_noncell_printf("\r\n");
+			break;
+			
+		case 1:
+			_es_output_noncell_printf("\n");
+			break;
+			
+		case 2:
+			_es_output_noncell_wchar_string_n(L"\0",1);
+			break;
+			
+		case 3:
+			// nothing.
+			break;
+	}
+}
+
 // output a cell with formatting.
 static void _es_output_cell_printf(int is_highlighted,ES_UTF8 *format,...)
 {
@@ -4084,6 +11336,7 @@ static void _es_output_ipc1_results(EVERYTHING_IPC_LIST *list,SIZE_T index_start
 			}
 			
 			_es_output_column = _es_output_column->order_next;
+			_es_output_column_attribute++;
 		}									
 		
 		everything_ipc_item++;
@@ -4311,6 +11564,7 @@ static void _es_output_ipc2_results(EVERYTHING_IPC_LIST2 *list,SIZE_T index_star
 			}
 			
 			_es_output_column = _es_output_column->order_next;
+			_es_output_column_attribute++;
 		}
 
 		result_run--;
@@ -4337,1256 +11591,1458 @@ static void _es_output_ipc2_results(EVERYTHING_IPC_LIST2 *list,SIZE_T index_star
 
 // output a ipc2 list 
 // count should include the header if shown
-static void	_es_output_ipc3_results(ipc3_result_list_t *result_list,SIZE_T index_start,SIZE_T count)
+// output a single result from an ipc3 result list.
+// is_first_line is set for the first result.
+// is_more is set if more results will follow.
+static void _es_output_ipc3_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,int is_first_line,int is_more)
 {
-	SIZE_T run;
-	utf8_buf_t property_text_cbuf;
-	int is_first_line;
+	BYTE item_flags;
 	ipc3_stream_t *stream;
 	SIZE_T property_request_count;
 	ipc3_result_list_property_request_t *property_request_array;
-	SIZE_T result_run;
-
-	utf8_buf_init(&property_text_cbuf);
 	
-	run = count;
 	stream = result_list->stream;
 	property_request_count = result_list->property_request_count;
 	property_request_array = (ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
 	
-	_es_output_page_begin();
-
-	if (run)
-	{
-		// output header.
-		if (_es_header > 0)
-		{
-			_es_output_header();
-
-			// don't inc i.
-			run--;
-		}
-	}
-	
-	result_run = run;
-
-	if (_es_footer > 0)
-	{
-		if (result_run)
-		{
-			result_run--;
-		}
-	}
-		
-	// clip run.
-	if (result_run > result_list->viewport_count - index_start)
-	{
-		result_run = result_list->viewport_count - index_start;
-	}
-	
-	run -= result_run;
+	_es_output_line_begin(is_first_line);
 	
-	is_first_line = 1;
+	item_flags = ipc3_stream_read_byte(stream);
 	
-	while(result_run)
+	// read properties..
+	// they will be in the same order as requested.
+	// some could be missing if they don't exist.
+	// so we might have more column_order_start than property_request_array.
+
 	{
-		BYTE item_flags;
+		SIZE_T property_request_run;
+		const ipc3_result_list_property_request_t *property_request_p;
 		
-		_es_output_line_begin(is_first_line);
+		_es_output_column = column_order_start;
+		_es_output_column_attribute = column_attribute_array;
 		
-		item_flags = ipc3_stream_read_byte(stream);
+		property_request_run = property_request_count;
+		property_request_p = property_request_array;
 		
-		// read properties..
-		// they will be in the same order as requested.
-		// some could be missing if they don't exist.
-		// so we might have more column_order_start than property_request_array.
-
+		while(_es_output_column)
 		{
-			SIZE_T property_request_run;
-			const ipc3_result_list_property_request_t *property_request_p;
-			
-			_es_output_column = column_order_start;
-			
-			property_request_run = property_request_count;
-			property_request_p = property_request_array;
+			_es_output_cell_separator();
 			
-			while(_es_output_column)
+			if ((property_request_run) && (_es_output_column->property_id == property_request_p->property_id))
 			{
-				_es_output_cell_separator();
-				
-				if ((property_request_run) && (_es_output_column->property_id == property_request_p->property_id))
+				if (property_request_p->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
 				{
-					if (property_request_p->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
-					{
-						SIZE_T len;
-						
-						len = ipc3_stream_read_len_vlq(stream);
-						
-						utf8_buf_grow_length(&property_text_cbuf,len);
-						
-						ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
-						
-						property_text_cbuf.buf[len] = 0;
+					SIZE_T len;
+					
+					len = ipc3_stream_read_len_vlq(stream);
+					
+					utf8_buf_grow_length(property_text_cbuf,len);
+					
+					ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+					
+					property_text_cbuf->buf[len] = 0;
 
-						if (_es_folder_append_path_separator)
+					if (_es_folder_append_path_separator)
+					{
+						if (property_request_p->property_id == EVERYTHING3_PROPERTY_ID_FULL_PATH)
 						{
-							if (property_request_p->property_id == EVERYTHING3_PROPERTY_ID_FULL_PATH)
+							if (item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
 							{
-								if (item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
-								{
-									utf8_buf_cat_path_separator(&property_text_cbuf);
-								}
+								utf8_buf_cat_path_separator(property_text_cbuf);
 							}
 						}
-						
-						_es_output_cell_highlighted_text_property_utf8_string(property_text_cbuf.buf);
 					}
-					else
+					
+					_es_output_cell_highlighted_text_property_utf8_string(property_text_cbuf->buf);
+				}
+				else
+				{
+					// add to total item size.
+					switch(property_request_p->value_type)
 					{
-						// add to total item size.
-						switch(property_request_p->value_type)
-						{
-							case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
-							case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
-							case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
-							case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
-							case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+						case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
 
-								{
-									SIZE_T len;
-									
-									len = ipc3_stream_read_len_vlq(stream);
-									
-									utf8_buf_grow_length(&property_text_cbuf,len);
-									
-									ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
-									
-									property_text_cbuf.buf[len] = 0;
-									
-									if (_es_folder_append_path_separator)
+							{
+								SIZE_T len;
+								
+								len = ipc3_stream_read_len_vlq(stream);
+								
+								utf8_buf_grow_length(property_text_cbuf,len);
+								
+								ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+								
+								property_text_cbuf->buf[len] = 0;
+								
+								if (_es_folder_append_path_separator)
+								{
+									if (property_request_p->property_id == EVERYTHING3_PROPERTY_ID_FULL_PATH)
 									{
-										if (property_request_p->property_id == EVERYTHING3_PROPERTY_ID_FULL_PATH)
+										if (item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
 										{
-											if (item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER)
-											{
-												utf8_buf_cat_path_separator(&property_text_cbuf);
-											}
+											utf8_buf_cat_path_separator(property_text_cbuf);
 										}
 									}
 								}
-								
-								switch(property_get_format(_es_output_column->property_id))
+							}
+							
+							switch(_es_output_column_attribute->format)
+							{
+								case PROPERTY_FORMAT_TEXT8:
+								case PROPERTY_FORMAT_TEXT10:
+								case PROPERTY_FORMAT_TEXT12:
+								case PROPERTY_FORMAT_TEXT16:
+								case PROPERTY_FORMAT_TEXT24:
+								case PROPERTY_FORMAT_TEXT30:
+								case PROPERTY_FORMAT_TEXT32:
+								case PROPERTY_FORMAT_TEXT47:
+								case PROPERTY_FORMAT_TEXT48:
+								case PROPERTY_FORMAT_TEXT64:
+								case PROPERTY_FORMAT_EXTENSION:
+									_es_output_cell_text_property_utf8_string_n(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+									break;
+									
+								default:
+									debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+									_es_output_cell_unknown_property();
+									break;
+
+							}
+
+							break;
+
+						case IPC3_PROPERTY_VALUE_TYPE_BYTE:
+						case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
+
+							{
+								BYTE byte_value;
+
+								ipc3_stream_read_data(stream,&byte_value,sizeof(BYTE));
+							
+								switch(_es_output_column_attribute->format)
 								{
-									case PROPERTY_FORMAT_TEXT8:
-									case PROPERTY_FORMAT_TEXT10:
-									case PROPERTY_FORMAT_TEXT12:
-									case PROPERTY_FORMAT_TEXT16:
-									case PROPERTY_FORMAT_TEXT24:
-									case PROPERTY_FORMAT_TEXT30:
-									case PROPERTY_FORMAT_TEXT32:
-									case PROPERTY_FORMAT_TEXT47:
-									case PROPERTY_FORMAT_TEXT48:
-									case PROPERTY_FORMAT_TEXT64:
-									case PROPERTY_FORMAT_EXTENSION:
-										_es_output_cell_text_property_utf8_string_n(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
+										_es_output_cell_number_property(byte_value,ES_BYTE_MAX,FALSE);
+										break;
+
+									case PROPERTY_FORMAT_GROUPING_NUMBER2:
+									case PROPERTY_FORMAT_GROUPING_NUMBER3:
+									case PROPERTY_FORMAT_GROUPING_NUMBER4:
+									case PROPERTY_FORMAT_GROUPING_NUMBER5:
+									case PROPERTY_FORMAT_GROUPING_NUMBER6:
+									case PROPERTY_FORMAT_GROUPING_NUMBER7:
+										_es_output_cell_number_property(byte_value,ES_BYTE_MAX,TRUE);
+										break;
+										
+									case PROPERTY_FORMAT_RATING:
+										_es_output_cell_rating_property(byte_value);
+										break;
+											
+									case PROPERTY_FORMAT_YESNO:
+										_es_output_cell_yesno_property(byte_value);
+										break;
+										
+									case PROPERTY_FORMAT_PERCENT:
+										_es_output_cell_percent_property(byte_value);
 										break;
 										
 									default:
-										debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
 										_es_output_cell_unknown_property();
 										break;
 
 								}
+							}
 
-								break;
+							break;
+
+						case IPC3_PROPERTY_VALUE_TYPE_WORD:
+						case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
 
-							case IPC3_PROPERTY_VALUE_TYPE_BYTE:
-							case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
+							{
+								WORD word_value;
 
+								ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
+								
+								switch(_es_output_column_attribute->format)
 								{
-									BYTE byte_value;
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
+										_es_output_cell_number_property(word_value,ES_WORD_MAX,FALSE);
+										break;
 
-									ipc3_stream_read_data(stream,&byte_value,sizeof(BYTE));
-								
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
-											_es_output_cell_number_property(byte_value,ES_BYTE_MAX,FALSE);
-											break;
-
-										case PROPERTY_FORMAT_GROUPING_NUMBER2:
-										case PROPERTY_FORMAT_GROUPING_NUMBER3:
-										case PROPERTY_FORMAT_GROUPING_NUMBER4:
-										case PROPERTY_FORMAT_GROUPING_NUMBER5:
-										case PROPERTY_FORMAT_GROUPING_NUMBER6:
-										case PROPERTY_FORMAT_GROUPING_NUMBER7:
-											_es_output_cell_number_property(byte_value,ES_BYTE_MAX,TRUE);
-											break;
-											
-										case PROPERTY_FORMAT_RATING:
-											_es_output_cell_rating_property(byte_value);
-											break;
-												
-										case PROPERTY_FORMAT_YESNO:
-											_es_output_cell_yesno_property(byte_value);
-											break;
-											
-										case PROPERTY_FORMAT_PERCENT:
-											_es_output_cell_percent_property(byte_value);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
+									case PROPERTY_FORMAT_GROUPING_NUMBER2:
+									case PROPERTY_FORMAT_GROUPING_NUMBER3:
+									case PROPERTY_FORMAT_GROUPING_NUMBER4:
+									case PROPERTY_FORMAT_GROUPING_NUMBER5:
+									case PROPERTY_FORMAT_GROUPING_NUMBER6:
+									case PROPERTY_FORMAT_GROUPING_NUMBER7:
+										_es_output_cell_number_property(word_value,ES_WORD_MAX,TRUE);
+										break;
+										
+									case PROPERTY_FORMAT_ISO_SPEED:
+										_es_output_cell_iso_speed_property(word_value);
+										break;
+										
+									case PROPERTY_FORMAT_35MM_FOCAL_LENGTH:
+										_es_output_cell_small_number_property_with_suffix(word_value,ES_WORD_MAX,"mm");
+										break;
+										
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 
-									}
 								}
+							}
+							
+							break;
 
-								break;
+						case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
+						case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
+						case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
 
-							case IPC3_PROPERTY_VALUE_TYPE_WORD:
-							case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
+							{
+								DWORD dword_value;
+								ES_UINT64 unknown_value;
 
+								ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
+								
+								if (_es_output_column->property_id == EVERYTHING3_PROPERTY_ID_RUN_COUNT)
 								{
-									WORD word_value;
-
-									ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
-									
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
-											_es_output_cell_number_property(word_value,ES_WORD_MAX,FALSE);
-											break;
-
-										case PROPERTY_FORMAT_GROUPING_NUMBER2:
-										case PROPERTY_FORMAT_GROUPING_NUMBER3:
-										case PROPERTY_FORMAT_GROUPING_NUMBER4:
-										case PROPERTY_FORMAT_GROUPING_NUMBER5:
-										case PROPERTY_FORMAT_GROUPING_NUMBER6:
-										case PROPERTY_FORMAT_GROUPING_NUMBER7:
-											_es_output_cell_number_property(word_value,ES_WORD_MAX,TRUE);
-											break;
-											
-										case PROPERTY_FORMAT_ISO_SPEED:
-											_es_output_cell_iso_speed_property(word_value);
-											break;
-											
-										case PROPERTY_FORMAT_35MM_FOCAL_LENGTH:
-											_es_output_cell_small_number_property_with_suffix(word_value,ES_WORD_MAX,"mm");
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-
-									}
+									// run count doesn't have an unknown value.
+									// use ES_UINT64_MAX which will never match a DWORD.
+									unknown_value = ES_UINT64_MAX;
+								}
+								else
+								{
+									unknown_value = ES_DWORD_MAX;
 								}
 								
-								break;
-
-							case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
-							case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
-							case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
-
+								switch(_es_output_column_attribute->format)
 								{
-									DWORD dword_value;
-									ES_UINT64 unknown_value;
+									case PROPERTY_FORMAT_ATTRIBUTES:
+										_es_output_cell_attribute_property(dword_value);
+										break;
 
-									ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
+										_es_output_cell_number_property(dword_value,unknown_value,FALSE);
+										break;
+
+									case PROPERTY_FORMAT_GROUPING_NUMBER2:
+									case PROPERTY_FORMAT_GROUPING_NUMBER3:
+									case PROPERTY_FORMAT_GROUPING_NUMBER4:
+									case PROPERTY_FORMAT_GROUPING_NUMBER5:
+									case PROPERTY_FORMAT_GROUPING_NUMBER6:
+									case PROPERTY_FORMAT_GROUPING_NUMBER7:
+										
+										_es_output_cell_number_property(dword_value,unknown_value,TRUE);
+										break;
 									
-									if (_es_output_column->property_id == EVERYTHING3_PROPERTY_ID_RUN_COUNT)
-									{
-										// run count doesn't have an unknown value.
-										// use ES_UINT64_MAX which will never match a DWORD.
-										unknown_value = ES_UINT64_MAX;
-									}
-									else
-									{
-										unknown_value = ES_DWORD_MAX;
-									}
+									case PROPERTY_FORMAT_HEX_NUMBER8:
+										_es_output_cell_hex_number8_property(dword_value);
+										break;
+										
+									case PROPERTY_FORMAT_KBPS:
+										_es_output_cell_kbps_property(dword_value,unknown_value);
+										break;
+										
+									case PROPERTY_FORMAT_KHZ:
+										_es_output_cell_khz_property(dword_value,unknown_value);
+										break;
+										
+									case PROPERTY_FORMAT_FIXED_Q1K:
+										_es_output_cell_fixed_q1k_property(dword_value,unknown_value,0);
+										break;
+										
+									case PROPERTY_FORMAT_TIME:
+										_es_output_cell_time_property(dword_value);
+										break;
 									
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_ATTRIBUTES:
-											_es_output_cell_attribute_property(dword_value);
-											break;
-
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
-											_es_output_cell_number_property(dword_value,unknown_value,FALSE);
-											break;
-
-										case PROPERTY_FORMAT_GROUPING_NUMBER2:
-										case PROPERTY_FORMAT_GROUPING_NUMBER3:
-										case PROPERTY_FORMAT_GROUPING_NUMBER4:
-										case PROPERTY_FORMAT_GROUPING_NUMBER5:
-										case PROPERTY_FORMAT_GROUPING_NUMBER6:
-										case PROPERTY_FORMAT_GROUPING_NUMBER7:
-											
-											_es_output_cell_number_property(dword_value,unknown_value,TRUE);
-											break;
+									case PROPERTY_FORMAT_DATE:
+										_es_output_cell_date_property(dword_value);
+										break;
 										
-										case PROPERTY_FORMAT_HEX_NUMBER8:
-											_es_output_cell_hex_number8_property(dword_value);
-											break;
-											
-										case PROPERTY_FORMAT_KBPS:
-											_es_output_cell_kbps_property(dword_value,unknown_value);
-											break;
-											
-										case PROPERTY_FORMAT_KHZ:
-											_es_output_cell_khz_property(dword_value,unknown_value);
-											break;
-											
-										case PROPERTY_FORMAT_FIXED_Q1K:
-											_es_output_cell_fixed_q1k_property(dword_value,unknown_value,0);
-											break;
-											
-										case PROPERTY_FORMAT_TIME:
-											_es_output_cell_time_property(dword_value);
-											break;
+									case PROPERTY_FORMAT_ASPECT_RATIO:
+										_es_output_cell_aspect_ratio_property(dword_value);
+										break;
 										
-										case PROPERTY_FORMAT_DATE:
-											_es_output_cell_date_property(dword_value);
-											break;
-											
-										case PROPERTY_FORMAT_ASPECT_RATIO:
-											_es_output_cell_aspect_ratio_property(dword_value);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
-								
-								break;
-								
-							case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
+							}
+							
+							break;
+							
+						case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
+
+							{
+								ES_UINT64 uint64_value;
+
+								ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
 
+								switch(_es_output_column_attribute->format)
 								{
-									ES_UINT64 uint64_value;
+									case PROPERTY_FORMAT_SIZE:
+									case PROPERTY_FORMAT_VOLUME_SIZE:
+										_es_output_cell_size_property(uint64_value);
+										break;
 
-									ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
+									case PROPERTY_FORMAT_FILETIME:
+										_es_output_cell_filetime_property(uint64_value);
+										break;
+										
+									case PROPERTY_FORMAT_DURATION:
+										_es_output_cell_duration_property(uint64_value);
+										break;
+										
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
+										_es_output_cell_number_property(uint64_value,ES_UINT64_MAX,FALSE);
+										break;
 
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_SIZE:
-										case PROPERTY_FORMAT_VOLUME_SIZE:
-											_es_output_cell_size_property(uint64_value);
-											break;
-
-										case PROPERTY_FORMAT_FILETIME:
-											_es_output_cell_filetime_property(uint64_value);
-											break;
-											
-										case PROPERTY_FORMAT_DURATION:
-											_es_output_cell_duration_property(uint64_value);
-											break;
-											
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
-											_es_output_cell_number_property(uint64_value,ES_UINT64_MAX,FALSE);
-											break;
-
-										case PROPERTY_FORMAT_GROUPING_NUMBER2:
-										case PROPERTY_FORMAT_GROUPING_NUMBER3:
-										case PROPERTY_FORMAT_GROUPING_NUMBER4:
-										case PROPERTY_FORMAT_GROUPING_NUMBER5:
-										case PROPERTY_FORMAT_GROUPING_NUMBER6:
-										case PROPERTY_FORMAT_GROUPING_NUMBER7:
-											_es_output_cell_number_property(uint64_value,ES_UINT64_MAX,TRUE);
-											break;
-											
-										case PROPERTY_FORMAT_HEX_NUMBER16:
-											_es_output_cell_hex_number16_property(uint64_value,ES_UINT64_MAX);
-											break;
-
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+									case PROPERTY_FORMAT_GROUPING_NUMBER2:
+									case PROPERTY_FORMAT_GROUPING_NUMBER3:
+									case PROPERTY_FORMAT_GROUPING_NUMBER4:
+									case PROPERTY_FORMAT_GROUPING_NUMBER5:
+									case PROPERTY_FORMAT_GROUPING_NUMBER6:
+									case PROPERTY_FORMAT_GROUPING_NUMBER7:
+										_es_output_cell_number_property(uint64_value,ES_UINT64_MAX,TRUE);
+										break;
+										
+									case PROPERTY_FORMAT_HEX_NUMBER16:
+										_es_output_cell_hex_number16_property(uint64_value,ES_UINT64_MAX);
+										break;
+
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
-								
-								break;
-								
-							case IPC3_PROPERTY_VALUE_TYPE_UINT128: 
+							}
+							
+							break;
+							
+						case IPC3_PROPERTY_VALUE_TYPE_UINT128: 
 
-								{
-									EVERYTHING3_UINT128 uint128_value;
+							{
+								EVERYTHING3_UINT128 uint128_value;
 
-									ipc3_stream_read_data(stream,&uint128_value,sizeof(EVERYTHING3_UINT128));
-									
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_HEX_NUMBER32:
-											_es_output_cell_hex_number32_property(&uint128_value);
-											break;
-
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
-								}
-								
-								break;
+								ipc3_stream_read_data(stream,&uint128_value,sizeof(EVERYTHING3_UINT128));
 								
-							case IPC3_PROPERTY_VALUE_TYPE_DIMENSIONS: 
-
+								switch(_es_output_column_attribute->format)
 								{
-									EVERYTHING3_DIMENSIONS dimensions_value;
-
-									ipc3_stream_read_data(stream,&dimensions_value,sizeof(EVERYTHING3_DIMENSIONS));
+									case PROPERTY_FORMAT_HEX_NUMBER32:
+										_es_output_cell_hex_number32_property(&uint128_value);
+										break;
 
-									switch(property_get_format(_es_output_column->property_id))
-									{
-										case PROPERTY_FORMAT_DIMENSIONS:
-											_es_output_cell_dimensions_property(&dimensions_value);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
-								
-								break;
-								
-							case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
+							}
+							
+							break;
 							
+						case IPC3_PROPERTY_VALUE_TYPE_DIMENSIONS: 
+
+							{
+								EVERYTHING3_DIMENSIONS dimensions_value;
+
+								ipc3_stream_read_data(stream,&dimensions_value,sizeof(EVERYTHING3_DIMENSIONS));
+
+								switch(_es_output_column_attribute->format)
 								{
-									SIZE_T size_t_value;
-									
-									size_t_value = ipc3_stream_read_size_t(stream);
-
-									switch(property_get_format(_es_output_column->property_id))
-									{	
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
-										case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
-											_es_output_cell_number_property(size_t_value,SIZE_MAX,FALSE);
-											break;
-											
-										case PROPERTY_FORMAT_GROUPING_NUMBER2:
-										case PROPERTY_FORMAT_GROUPING_NUMBER3:
-										case PROPERTY_FORMAT_GROUPING_NUMBER4:
-										case PROPERTY_FORMAT_GROUPING_NUMBER5:
-										case PROPERTY_FORMAT_GROUPING_NUMBER6:
-										case PROPERTY_FORMAT_GROUPING_NUMBER7:
-											_es_output_cell_number_property(size_t_value,SIZE_MAX,TRUE);
-											break;
-
-										case PROPERTY_FORMAT_HEX_NUMBER16:
-											_es_output_cell_hex_number16_property(size_t_value,SIZE_MAX);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+									case PROPERTY_FORMAT_DIMENSIONS:
+										_es_output_cell_dimensions_property(&dimensions_value);
+										break;
+										
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
-								break;
+							}
+							
+							break;
+							
+						case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
+						
+							{
+								SIZE_T size_t_value;
 								
-							case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1K: 
-							case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1M: 
+								size_t_value = ipc3_stream_read_size_t(stream);
+
+								switch(_es_output_column_attribute->format)
+								{	
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER1:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER2:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER3:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER4:
+									case PROPERTY_FORMAT_NOGROUPING_NUMBER5:
+										_es_output_cell_number_property(size_t_value,SIZE_MAX,FALSE);
+										break;
+										
+									case PROPERTY_FORMAT_GROUPING_NUMBER2:
+									case PROPERTY_FORMAT_GROUPING_NUMBER3:
+									case PROPERTY_FORMAT_GROUPING_NUMBER4:
+									case PROPERTY_FORMAT_GROUPING_NUMBER5:
+									case PROPERTY_FORMAT_GROUPING_NUMBER6:
+									case PROPERTY_FORMAT_GROUPING_NUMBER7:
+										_es_output_cell_number_property(size_t_value,SIZE_MAX,TRUE);
+										break;
 
-								{
-									__int32 int32_value;
+									case PROPERTY_FORMAT_HEX_NUMBER16:
+										_es_output_cell_hex_number16_property(size_t_value,SIZE_MAX);
+										break;
+										
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
+								}
+							}
+							break;
+							
+						case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1K: 
+						case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1M: 
 
-									ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
-									
-									switch(property_get_format(_es_output_column->property_id))
-									{	
-										case PROPERTY_FORMAT_FIXED_Q1K:
-											_es_output_cell_fixed_q1k_property(int32_value,INT_MIN,1);
-											break;
-											
-										case PROPERTY_FORMAT_FIXED_Q1M:
-											_es_output_cell_fixed_q1m_property(int32_value,INT_MIN,1);
-											break;
-											
-										case PROPERTY_FORMAT_F_STOP:
-											_es_output_cell_f_stop_property(int32_value);
-											break;
-											
-										case PROPERTY_FORMAT_EXPOSURE_TIME:
-											_es_output_cell_exposure_time_property(int32_value);
-											break;
+							{
+								__int32 int32_value;
 
-										case PROPERTY_FORMAT_EXPOSURE_BIAS:
-											_es_output_cell_exposure_bias_property(int32_value);
-											break;
-											
-										case PROPERTY_FORMAT_FOCAL_LENGTH:
-											_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"mm");
-											break;
-											
-										case PROPERTY_FORMAT_SUBJECT_DISTANCE:
-											_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"m");
-											break;
-											
-										case PROPERTY_FORMAT_BCPS:	
-											_es_output_cell_bcps_property(int32_value);
-											break;
-													
-										case PROPERTY_FORMAT_ALTITUDE:
-											_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"m");
-											break;
+								ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
+								
+								switch(_es_output_column_attribute->format)
+								{	
+									case PROPERTY_FORMAT_FIXED_Q1K:
+										_es_output_cell_fixed_q1k_property(int32_value,INT_MIN,1);
+										break;
+										
+									case PROPERTY_FORMAT_FIXED_Q1M:
+										_es_output_cell_fixed_q1m_property(int32_value,INT_MIN,1);
+										break;
 										
-										case PROPERTY_FORMAT_SEC:
-											_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"sec");
-											break;
+									case PROPERTY_FORMAT_F_STOP:
+										_es_output_cell_f_stop_property(int32_value);
+										break;
 										
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+									case PROPERTY_FORMAT_EXPOSURE_TIME:
+										_es_output_cell_exposure_time_property(int32_value);
+										break;
+
+									case PROPERTY_FORMAT_EXPOSURE_BIAS:
+										_es_output_cell_exposure_bias_property(int32_value);
+										break;
+										
+									case PROPERTY_FORMAT_FOCAL_LENGTH:
+										_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"mm");
+										break;
+										
+									case PROPERTY_FORMAT_SUBJECT_DISTANCE:
+										_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"m");
+										break;
+										
+									case PROPERTY_FORMAT_BCPS:	
+										_es_output_cell_bcps_property(int32_value);
+										break;
+												
+									case PROPERTY_FORMAT_ALTITUDE:
+										_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"m");
+										break;
+									
+									case PROPERTY_FORMAT_SEC:
+										_es_output_cell_fixed_q1k_property_with_suffix(int32_value,"sec");
+										break;
+									
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
+							}
+							
+							break;
+
+						case IPC3_PROPERTY_VALUE_TYPE_BLOB8:
+
+							{
+								BYTE len;
 								
-								break;
+								len = ipc3_stream_read_byte(stream);
+								
+								utf8_buf_grow_length(property_text_cbuf,len);
+								
+								ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+								
+								property_text_cbuf->buf[len] = 0;
+							
+								switch(_es_output_column_attribute->format)
+								{	
+									case PROPERTY_FORMAT_DATA1:
+									case PROPERTY_FORMAT_DATA2:
+									case PROPERTY_FORMAT_DATA4:
+									case PROPERTY_FORMAT_DATA8:
+									case PROPERTY_FORMAT_DATA16:
+									case PROPERTY_FORMAT_DATA20:
+									case PROPERTY_FORMAT_DATA32:
+									case PROPERTY_FORMAT_DATA48:
+									case PROPERTY_FORMAT_DATA64:
+									case PROPERTY_FORMAT_DATA128:
+									case PROPERTY_FORMAT_DATA256:
+									case PROPERTY_FORMAT_DATA512:
+										_es_output_cell_data_property(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+										break;
+										
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
+								}
+							}
 
-							case IPC3_PROPERTY_VALUE_TYPE_BLOB8:
+							break;
 
-								{
-									BYTE len;
-									
-									len = ipc3_stream_read_byte(stream);
-									
-									utf8_buf_grow_length(&property_text_cbuf,len);
-									
-									ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
-									
-									property_text_cbuf.buf[len] = 0;
+						case IPC3_PROPERTY_VALUE_TYPE_BLOB16:
+
+							{
+								WORD len;
 								
-									switch(property_get_format(_es_output_column->property_id))
-									{	
-										case PROPERTY_FORMAT_DATA1:
-										case PROPERTY_FORMAT_DATA2:
-										case PROPERTY_FORMAT_DATA4:
-										case PROPERTY_FORMAT_DATA8:
-										case PROPERTY_FORMAT_DATA16:
-										case PROPERTY_FORMAT_DATA20:
-										case PROPERTY_FORMAT_DATA32:
-										case PROPERTY_FORMAT_DATA48:
-										case PROPERTY_FORMAT_DATA64:
-										case PROPERTY_FORMAT_DATA128:
-										case PROPERTY_FORMAT_DATA256:
-										case PROPERTY_FORMAT_DATA512:
-											_es_output_cell_data_property(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
+								len = ipc3_stream_read_word(stream);
+								
+								utf8_buf_grow_length(property_text_cbuf,len);
+								
+								ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+								
+								property_text_cbuf->buf[len] = 0;
+								
+								switch(_es_output_column_attribute->format)
+								{	
+									case PROPERTY_FORMAT_DATA1:
+									case PROPERTY_FORMAT_DATA2:
+									case PROPERTY_FORMAT_DATA4:
+									case PROPERTY_FORMAT_DATA8:
+									case PROPERTY_FORMAT_DATA16:
+									case PROPERTY_FORMAT_DATA20:
+									case PROPERTY_FORMAT_DATA32:
+									case PROPERTY_FORMAT_DATA48:
+									case PROPERTY_FORMAT_DATA64:
+									case PROPERTY_FORMAT_DATA128:
+									case PROPERTY_FORMAT_DATA256:
+									case PROPERTY_FORMAT_DATA512:
+										_es_output_cell_data_property(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+										break;
+										
+									default:
+										debug_error_printf("unhandled format %d for %d\n",_es_output_column_attribute->format,property_request_p->value_type);
+										_es_output_cell_unknown_property();
+										break;
 								}
+							}
 
-								break;
+							break;
 
-							case IPC3_PROPERTY_VALUE_TYPE_BLOB16:
+						case IPC3_PROPERTY_VALUE_TYPE_PROPVARIANT:
+		
+							{
+								BYTE propvariant_type;
 
+								propvariant_type =  ipc3_stream_read_byte(stream);
+								
+								switch(propvariant_type)
 								{
-									WORD len;
-									
-									len = ipc3_stream_read_word(stream);
-									
-									utf8_buf_grow_length(&property_text_cbuf,len);
-									
-									ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_EMPTY:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_NULL:
+										_es_output_cell_unknown_property();
+										break;
 									
-									property_text_cbuf.buf[len] = 0;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_BYTE_UI1:
 									
-									switch(property_get_format(_es_output_column->property_id))
-									{	
-										case PROPERTY_FORMAT_DATA1:
-										case PROPERTY_FORMAT_DATA2:
-										case PROPERTY_FORMAT_DATA4:
-										case PROPERTY_FORMAT_DATA8:
-										case PROPERTY_FORMAT_DATA16:
-										case PROPERTY_FORMAT_DATA20:
-										case PROPERTY_FORMAT_DATA32:
-										case PROPERTY_FORMAT_DATA48:
-										case PROPERTY_FORMAT_DATA64:
-										case PROPERTY_FORMAT_DATA128:
-										case PROPERTY_FORMAT_DATA256:
-										case PROPERTY_FORMAT_DATA512:
-											_es_output_cell_data_property(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
-											break;
-											
-										default:
-											debug_error_printf("unhandled format %d for %d\n",property_get_format(_es_output_column->property_id),property_request_p->value_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
-								}
-
-								break;
+										{
+											BYTE byte_value;
 
-							case IPC3_PROPERTY_VALUE_TYPE_PROPVARIANT:
-			
-								{
-									BYTE propvariant_type;
+											ipc3_stream_read_data(stream,&byte_value,sizeof(BYTE));
 
-									propvariant_type =  ipc3_stream_read_byte(stream);
-									
-									switch(propvariant_type)
-									{
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_EMPTY:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_NULL:
-											_es_output_cell_unknown_property();
-											break;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%u",byte_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
 										
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_BYTE_UI1:
+										break;
 										
-											{
-												BYTE byte_value;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_WORD_UI2:
 
-												ipc3_stream_read_data(stream,&byte_value,sizeof(BYTE));
+										{
+											WORD word_value;
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%u",byte_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											
-											break;
-											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_WORD_UI2:
+											ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
 
-											{
-												WORD word_value;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%u",word_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										
+										break;
+										
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_DWORD_UI4:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_DWORD_UINT:
+										
+										{
+											DWORD dword_value;
 
-												ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
+											ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%u",word_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											
-											break;
-											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_DWORD_UI4:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_DWORD_UINT:
-											
-											{
-												DWORD dword_value;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%u",dword_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										
+										break;
 
-												ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_UI8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_FILETIME:
+									
+										{
+											ES_UINT64 uint64_value;
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%u",dword_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											
-											break;
+											ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_UI8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_FILETIME:
-										
+											if (propvariant_type == EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_FILETIME)
 											{
-												ES_UINT64 uint64_value;
-
-												ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
-
-												if (propvariant_type == EVERYTHING3_PROPERTY_VARIANT_TYPE_UINT64_FILETIME)
-												{
-													_es_output_cell_filetime_property(uint64_value);
-												}
-												else
-												{
-													utf8_buf_printf(&property_text_cbuf,"%I64u",uint64_value);
-													_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-												}
+												_es_output_cell_filetime_property(uint64_value);
 											}
-											
-											break;
-											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_CHAR_I1:
+											else
 											{
-												char char_value;
+												utf8_buf_printf(property_text_cbuf,"%I64u",uint64_value);
+												_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+											}
+										}
+										
+										break;
+										
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_CHAR_I1:
+										{
+											char char_value;
 
-												ipc3_stream_read_data(stream,&char_value,sizeof(char));
+											ipc3_stream_read_data(stream,&char_value,sizeof(char));
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%d",char_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											break;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%d",char_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										break;
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT16_I2:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT16_BOOL:
-											{
-												__int16 int16_value;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT16_I2:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT16_BOOL:
+										{
+											__int16 int16_value;
 
-												ipc3_stream_read_data(stream,&int16_value,sizeof(__int16));
+											ipc3_stream_read_data(stream,&int16_value,sizeof(__int16));
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%d",int16_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											break;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%d",int16_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										break;
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_I4:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_INT:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_ERROR:
-											{
-												__int32 int32_value;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_I4:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_INT:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT32_ERROR:
+										{
+											__int32 int32_value;
 
-												ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
+											ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%d",int32_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											break;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%d",int32_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										break;
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT64_I8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT64_CY:
-											{
-												__int64 int64_value;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT64_I8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_INT64_CY:
+										{
+											__int64 int64_value;
 
-												ipc3_stream_read_data(stream,&int64_value,sizeof(__int64));
+											ipc3_stream_read_data(stream,&int64_value,sizeof(__int64));
 
-												// there's no empty value.
-												utf8_buf_printf(&property_text_cbuf,"%I64d",int64_value);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
-											}
-											break;
+											// there's no empty value.
+											utf8_buf_printf(property_text_cbuf,"%I64d",int64_value);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
+										}
+										break;
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_FLOAT_R4:
-											{
-												float float_value;
-												__int64 fixed_q1m_value;
-												wchar_buf_t fixed_wcbuf;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_FLOAT_R4:
+										{
+											float float_value;
+											__int64 fixed_q1m_value;
+											wchar_buf_t fixed_wcbuf;
 
-												wchar_buf_init(&fixed_wcbuf);
+											wchar_buf_init(&fixed_wcbuf);
 
-												ipc3_stream_read_data(stream,&float_value,sizeof(float));
+											ipc3_stream_read_data(stream,&float_value,sizeof(float));
 
-												fixed_q1m_value = (__int64)(float_value * 1000000);
+											fixed_q1m_value = (__int64)(float_value * 1000000);
 
-												// there's no empty value.
-												_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
-												utf8_buf_copy_wchar_string(&property_text_cbuf,fixed_wcbuf.buf);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
+											// there's no empty value.
+											_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
+											utf8_buf_copy_wchar_string(property_text_cbuf,fixed_wcbuf.buf);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
 
-												wchar_buf_kill(&fixed_wcbuf);
-											}
-											break;
-											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_DOUBLE_R8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_DOUBLE_DATE:
+											wchar_buf_kill(&fixed_wcbuf);
+										}
+										break;
 										
-											{
-												double double_value;
-												__int64 fixed_q1m_value;
-												wchar_buf_t fixed_wcbuf;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_DOUBLE_R8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_DOUBLE_DATE:
+									
+										{
+											double double_value;
+											__int64 fixed_q1m_value;
+											wchar_buf_t fixed_wcbuf;
 
-												wchar_buf_init(&fixed_wcbuf);
+											wchar_buf_init(&fixed_wcbuf);
 
-												ipc3_stream_read_data(stream,&double_value,sizeof(double));
+											ipc3_stream_read_data(stream,&double_value,sizeof(double));
 
-												fixed_q1m_value = (__int64)(double_value * 1000000);
+											fixed_q1m_value = (__int64)(double_value * 1000000);
 
-												// there's no empty value.
-												_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
-												utf8_buf_copy_wchar_string(&property_text_cbuf,fixed_wcbuf.buf);
-												_es_output_cell_formatted_number_property(property_text_cbuf.buf);
+											// there's no empty value.
+											_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
+											utf8_buf_copy_wchar_string(property_text_cbuf,fixed_wcbuf.buf);
+											_es_output_cell_formatted_number_property(property_text_cbuf->buf);
 
-												wchar_buf_kill(&fixed_wcbuf);
-											}
-											break;
+											wchar_buf_kill(&fixed_wcbuf);
+										}
+										break;
 
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_POINTER_CLSID:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_POINTER_CLSID:
 
-											{
-												CLSID clsid_value;
+										{
+											CLSID clsid_value;
 
-												ipc3_stream_read_data(stream,&clsid_value,sizeof(CLSID));
+											ipc3_stream_read_data(stream,&clsid_value,sizeof(CLSID));
 
-												// there's no empty value.
-												_es_format_clsid(&clsid_value,&property_text_cbuf);
-												_es_output_cell_text_property_utf8_string_n(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
-											}
-											break;
+											// there's no empty value.
+											_es_format_clsid(&clsid_value,property_text_cbuf);
+											_es_output_cell_text_property_utf8_string_n(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+										}
+										break;
+										
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_BLOB:
+										
+										{
+											SIZE_T len;
 											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_BLOB:
+											len = ipc3_stream_read_len_vlq(stream);
 											
-											{
-												SIZE_T len;
-												
-												len = ipc3_stream_read_len_vlq(stream);
-												
-												utf8_buf_grow_length(&property_text_cbuf,len);
-												
-												ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
-												
-												property_text_cbuf.buf[len] = 0;
-
-												_es_output_cell_data_property(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
-											}
-											break;
+											utf8_buf_grow_length(property_text_cbuf,len);
 											
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_BSTR:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_LPWSTR:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_LPSTR:
+											ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+											
+											property_text_cbuf->buf[len] = 0;
+
+											_es_output_cell_data_property(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+										}
+										break;
 										
-											{
-												SIZE_T len;
-												
-												len = ipc3_stream_read_len_vlq(stream);
-												
-												utf8_buf_grow_length(&property_text_cbuf,len);
-												
-												ipc3_stream_read_data(stream,property_text_cbuf.buf,len);
-												
-												property_text_cbuf.buf[len] = 0;
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_BSTR:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_LPWSTR:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_STRING_LPSTR:
+									
+										{
+											SIZE_T len;
+											
+											len = ipc3_stream_read_len_vlq(stream);
+											
+											utf8_buf_grow_length(property_text_cbuf,len);
+											
+											ipc3_stream_read_data(stream,property_text_cbuf->buf,len);
+											
+											property_text_cbuf->buf[len] = 0;
 
-												_es_output_cell_text_property_utf8_string_n(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
-											}
+											_es_output_cell_text_property_utf8_string_n(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
+										}
+
+										break;
+
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_BYTE_UI1:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_WORD_UI2:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DWORD_UI4:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_UI8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CHAR_I1:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_I2:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_BOOL:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_I4:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_ERROR:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_I8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_CY:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_FLOAT_R4:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_R8:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_DATE:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CLSID:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_BSTR:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPWSTR:
+									case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPSTR:
+										
+										{
+											SIZE_T array_count;
+											utf8_buf_t string_cbuf;
 
-											break;
-
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_BYTE_UI1:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_WORD_UI2:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DWORD_UI4:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_UI8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CHAR_I1:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_I2:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_BOOL:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_I4:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_ERROR:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_I8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_CY:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_FLOAT_R4:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_R8:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_DATE:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CLSID:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_BSTR:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPWSTR:
-										case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPSTR:
+											utf8_buf_init(&string_cbuf);
 											
+											array_count = ipc3_stream_read_len_vlq(stream);
+											
+											utf8_buf_empty(property_text_cbuf);
+											
+											while(array_count)
 											{
-												SIZE_T array_count;
-												utf8_buf_t string_cbuf;
-
-												utf8_buf_init(&string_cbuf);
-												
-												array_count = ipc3_stream_read_len_vlq(stream);
-												
-												utf8_buf_empty(&property_text_cbuf);
+												if (property_text_cbuf->length_in_bytes)
+												{
+													utf8_buf_cat_byte(property_text_cbuf,';');
+												}
 												
-												while(array_count)
+												switch(propvariant_type)
 												{
-													if (property_text_cbuf.length_in_bytes)
-													{
-														utf8_buf_cat_byte(&property_text_cbuf,';');
-													}
-													
-													switch(propvariant_type)
-													{
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_BYTE_UI1:
-															
-															{
-																BYTE byte_value;
-																byte_value = ipc3_stream_read_byte(stream);
-																utf8_buf_printf(&string_cbuf,"%u",byte_value);
-															}
-															
-															break;
-															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_WORD_UI2:
-															
-															{
-																WORD word_value;
-	
-																ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_BYTE_UI1:
+														
+														{
+															BYTE byte_value;
+															byte_value = ipc3_stream_read_byte(stream);
+															utf8_buf_printf(&string_cbuf,"%u",byte_value);
+														}
+														
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_WORD_UI2:
+														
+														{
+															WORD word_value;
 
-																// there's no empty value.
-																utf8_buf_printf(&string_cbuf,"%u",word_value);
-															}
-															
-															break;
-															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DWORD_UI4:
+															ipc3_stream_read_data(stream,&word_value,sizeof(WORD));
+
+															// there's no empty value.
+															utf8_buf_printf(&string_cbuf,"%u",word_value);
+														}
 														
-															{
-																DWORD dword_value;
-			
-																ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DWORD_UI4:
+													
+														{
+															DWORD dword_value;
+		
+															ipc3_stream_read_data(stream,&dword_value,sizeof(DWORD));
 
-																// there's no empty value.
-																utf8_buf_printf(&string_cbuf,"%u",dword_value);
-															}
-															
-															break;
-															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_UI8:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME:
+															// there's no empty value.
+															utf8_buf_printf(&string_cbuf,"%u",dword_value);
+														}
 														
-															{
-																ES_UINT64 uint64_value;
-	
-																ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_UI8:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME:
+													
+														{
+															ES_UINT64 uint64_value;
 
-																if ((propvariant_type == EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME) && (_es_date_format))
-																{
-																	wchar_buf_t string_wcbuf;
+															ipc3_stream_read_data(stream,&uint64_value,sizeof(ES_UINT64));
 
-																	wchar_buf_init(&string_wcbuf);
+															if ((propvariant_type == EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_UINT64_FILETIME) && (_es_date_format))
+															{
+																wchar_buf_t string_wcbuf;
 
-																	_es_format_filetime(uint64_value,&string_wcbuf);
-																	utf8_buf_copy_wchar_string(&string_cbuf,string_wcbuf.buf);
+																wchar_buf_init(&string_wcbuf);
 
-																	wchar_buf_kill(&string_wcbuf);
-																}
-																else
-																{
-																	// there's no empty value.
-																	utf8_buf_printf(&string_cbuf,"%I64u",uint64_value);
-																}
-															}
-															
-															break;
+																_es_format_filetime(uint64_value,&string_wcbuf);
+																utf8_buf_copy_wchar_string(&string_cbuf,string_wcbuf.buf);
 
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CHAR_I1:
-														
+																wchar_buf_kill(&string_wcbuf);
+															}
+															else
 															{
-																char char_value;
-																
-																ipc3_stream_read_data(stream,&char_value,sizeof(char));
-																
-																utf8_buf_printf(&string_cbuf,"%d",char_value);
+																// there's no empty value.
+																utf8_buf_printf(&string_cbuf,"%I64u",uint64_value);
 															}
+														}
+														
+														break;
+
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CHAR_I1:
+													
+														{
+															char char_value;
+															
+															ipc3_stream_read_data(stream,&char_value,sizeof(char));
 															
-															break;	
+															utf8_buf_printf(&string_cbuf,"%d",char_value);
+														}
+														
+														break;	
 
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_I2:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_BOOL:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_I2:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT16_BOOL:
 
-															{
-																__int16 int16_value;
-																
-																ipc3_stream_read_data(stream,&int16_value,sizeof(__int16));
-																
-																utf8_buf_printf(&string_cbuf,"%d",int16_value);
-															}
+														{
+															__int16 int16_value;
 															
-															break;
+															ipc3_stream_read_data(stream,&int16_value,sizeof(__int16));
 															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_I4:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_ERROR:
+															utf8_buf_printf(&string_cbuf,"%d",int16_value);
+														}
+														
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_I4:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT32_ERROR:
 
-															{
-																__int32 int32_value;
-																
-																ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
-																
-																utf8_buf_printf(&string_cbuf,"%d",int32_value);
-															}
-															
-															break;
-											
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_I8:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_CY:
+														{
+															__int32 int32_value;
 															
-															{
-																__int64 int64_value;
-																
-																ipc3_stream_read_data(stream,&int64_value,sizeof(__int64));
-																
-																utf8_buf_printf(&string_cbuf,"%I64d",int64_value);
-															}
+															ipc3_stream_read_data(stream,&int32_value,sizeof(__int32));
 															
-															break;
+															utf8_buf_printf(&string_cbuf,"%d",int32_value);
+														}
+														
+														break;
+										
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_I8:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_INT64_CY:
+														
+														{
+															__int64 int64_value;
 															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_FLOAT_R4:
+															ipc3_stream_read_data(stream,&int64_value,sizeof(__int64));
 															
-															{
-																float float_value;
-																__int64 fixed_q1m_value;
-																wchar_buf_t fixed_wcbuf;
-
-																wchar_buf_init(&fixed_wcbuf);
-
-																ipc3_stream_read_data(stream,&float_value,sizeof(float));
+															utf8_buf_printf(&string_cbuf,"%I64d",int64_value);
+														}
+														
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_FLOAT_R4:
+														
+														{
+															float float_value;
+															__int64 fixed_q1m_value;
+															wchar_buf_t fixed_wcbuf;
 
-																fixed_q1m_value = (__int64)(float_value * 1000000);
+															wchar_buf_init(&fixed_wcbuf);
 
-																// there's no empty value.
-																_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
-																utf8_buf_copy_wchar_string(&string_cbuf,fixed_wcbuf.buf);
+															ipc3_stream_read_data(stream,&float_value,sizeof(float));
 
-																wchar_buf_kill(&fixed_wcbuf);
-															}
-															
-															break;
-															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_R8:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_DATE:
-															
-															{
-																double double_value;
-																__int64 fixed_q1m_value;
-																wchar_buf_t fixed_wcbuf;
+															fixed_q1m_value = (__int64)(float_value * 1000000);
 
-																wchar_buf_init(&fixed_wcbuf);
+															// there's no empty value.
+															_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
+															utf8_buf_copy_wchar_string(&string_cbuf,fixed_wcbuf.buf);
 
-																ipc3_stream_read_data(stream,&double_value,sizeof(double));
+															wchar_buf_kill(&fixed_wcbuf);
+														}
+														
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_R8:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_DOUBLE_DATE:
+														
+														{
+															double double_value;
+															__int64 fixed_q1m_value;
+															wchar_buf_t fixed_wcbuf;
 
-																fixed_q1m_value = (__int64)(double_value * 1000000);
+															wchar_buf_init(&fixed_wcbuf);
 
-																// there's no empty value.
-																_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
-																utf8_buf_copy_wchar_string(&string_cbuf,fixed_wcbuf.buf);
+															ipc3_stream_read_data(stream,&double_value,sizeof(double));
 
-																wchar_buf_kill(&fixed_wcbuf);
-															}
-															
-															break;
-															
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CLSID:
-															
-															{
-																CLSID clsid_value;
+															fixed_q1m_value = (__int64)(double_value * 1000000);
 
-																ipc3_stream_read_data(stream,&clsid_value,sizeof(CLSID));
+															// there's no empty value.
+															_es_format_fixed_q1m(fixed_q1m_value,0,0,1,&fixed_wcbuf);
+															utf8_buf_copy_wchar_string(&string_cbuf,fixed_wcbuf.buf);
 
-																// there's no empty value.
-																_es_format_clsid(&clsid_value,&string_cbuf);
-															}
-															
-															break;
-																		
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_BSTR:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPWSTR:
-														case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPSTR:
+															wchar_buf_kill(&fixed_wcbuf);
+														}
+														
+														break;
+														
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_CLSID:
+														
+														{
+															CLSID clsid_value;
 
-															{
-																SIZE_T len;
-																
-																len = ipc3_stream_read_len_vlq(stream);
-																	
-																utf8_buf_grow_length(&string_cbuf,len);
-																	
-																ipc3_stream_read_data(stream,string_cbuf.buf,len);
-																string_cbuf.buf[len] = 0;
-															}
-															
-															break;
-															
-													}
+															ipc3_stream_read_data(stream,&clsid_value,sizeof(CLSID));
 
-													utf8_buf_cat_utf8_string_n(&property_text_cbuf,string_cbuf.buf,string_cbuf.length_in_bytes);
+															// there's no empty value.
+															_es_format_clsid(&clsid_value,&string_cbuf);
+														}
+														
+														break;
+																	
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_BSTR:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPWSTR:
+													case EVERYTHING3_PROPERTY_VARIANT_TYPE_ARRAY_STRING_LPSTR:
 
-													array_count--;
+														{
+															SIZE_T len;
+															
+															len = ipc3_stream_read_len_vlq(stream);
+																
+															utf8_buf_grow_length(&string_cbuf,len);
+																
+															ipc3_stream_read_data(stream,string_cbuf.buf,len);
+															string_cbuf.buf[len] = 0;
+														}
+														
+														break;
+														
 												}
-												
-												_es_output_cell_text_property_utf8_string_n(property_text_cbuf.buf,property_text_cbuf.length_in_bytes);
 
-												utf8_buf_kill(&string_cbuf);
+												utf8_buf_cat_utf8_string_n(property_text_cbuf,string_cbuf.buf,string_cbuf.length_in_bytes);
+
+												array_count--;
 											}
 											
-											break;
-									
-										default:
-											// bad type;
-											debug_error_printf("unhandled propvariant type %d\n",propvariant_type);
-											_es_output_cell_unknown_property();
-											break;
-									}
-								}
-	
-								break;
+											_es_output_cell_text_property_utf8_string_n(property_text_cbuf->buf,property_text_cbuf->length_in_bytes);
 
+											utf8_buf_kill(&string_cbuf);
+										}
+										
+										break;
 								
-							default:
-								debug_error_printf("bad property value type %d\n",property_request_p->value_type);
-								es_fatal(ES_ERROR_IPC_ERROR);
-								break;
-						}
-					}
+									default:
+										// bad type;
+										debug_error_printf("unhandled propvariant type %d\n",propvariant_type);
+										_es_output_cell_unknown_property();
+										break;
+								}
+							}
 
-					property_request_p++;
-					property_request_run--;
-				}
-				else
-				{
-					// empty
-					if (_es_output_column->property_id == EVERYTHING3_PROPERTY_ID_ATTRIBUTES)
-					{
-						// always output known attributes. (EFU export)
-						_es_output_cell_attribute_property(item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER ? FILE_ATTRIBUTE_DIRECTORY : 0);
-					}
-					else
-					{
-						_es_output_cell_unknown_property();
+							break;
+
+							
+						default:
+							debug_error_printf("bad property value type %d\n",property_request_p->value_type);
+							es_fatal(ES_ERROR_IPC_ERROR);
+							break;
 					}
 				}
-				
-				_es_output_column = _es_output_column->order_next;
+
+				property_request_p++;
+				property_request_run--;
 			}
-			
-			// read remaining pipe data.
-			// we shouldn't have any remaining data.
-			// this should really be an error.
-			while(property_request_run)
+			else
 			{
-				// skip it.
-				if (property_request_p->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
+				// empty
+				if (_es_output_column->property_id == EVERYTHING3_PROPERTY_ID_ATTRIBUTES)
 				{
-					SIZE_T len;
-					
-					len = ipc3_stream_read_len_vlq(stream);
-					
-					ipc3_stream_skip(stream,len);
+					// always output known attributes. (EFU export)
+					_es_output_cell_attribute_property(item_flags & IPC3_RESULT_LIST_ITEM_FLAG_FOLDER ? FILE_ATTRIBUTE_DIRECTORY : 0);
 				}
 				else
 				{
-					// add to total item size.
-					switch(property_request_p->value_type)
-					{
-						case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
-						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
-						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
-						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
-						case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+					_es_output_cell_unknown_property();
+				}
+			}
+			
+			_es_output_column = _es_output_column->order_next;
+			_es_output_column_attribute++;
+		}
+		
+		// read remaining pipe data.
+		// we shouldn't have any remaining data.
+		// this should really be an error.
+		while(property_request_run)
+		{
+			ipc3_result_list_skip_property_value(stream,property_request_p);
+			
+			property_request_p++;
+			property_request_run--;
+		}
+	}
 
-							{
-								SIZE_T len;
-								
-								len = ipc3_stream_read_len_vlq(stream);
-								
-								ipc3_stream_skip(stream,len);
-							}
+	_es_output_line_end(is_more);
+}
 
-							break;
+static void	_es_output_ipc3_results(ipc3_result_list_t *result_list,SIZE_T index_start,SIZE_T count)
+{
+	SIZE_T run;
+	utf8_buf_t property_text_cbuf;
+	int is_first_line;
+	SIZE_T result_run;
 
-						case IPC3_PROPERTY_VALUE_TYPE_BYTE:
-						case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
+	utf8_buf_init(&property_text_cbuf);
+	
+	run = count;
+	
+	_es_output_page_begin();
 
-							ipc3_stream_skip(stream,sizeof(BYTE));
+	if (run)
+	{
+		// output header.
+		if (_es_header > 0)
+		{
+			_es_output_header();
 
-							break;
+			// don't inc i.
+			run--;
+		}
+	}
+	
+	result_run = run;
 
-						case IPC3_PROPERTY_VALUE_TYPE_WORD:
-						case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
+	if (_es_footer > 0)
+	{
+		if (result_run)
+		{
+			result_run--;
+		}
+	}
+		
+	// clip run.
+	if (result_run > result_list->viewport_count - index_start)
+	{
+		result_run = result_list->viewport_count - index_start;
+	}
+	
+	run -= result_run;
+	
+	is_first_line = 1;
+	
+	while(result_run)
+	{
+		result_run--;
 
-							ipc3_stream_skip(stream,sizeof(WORD));
-							
-							break;
+		_es_output_ipc3_result(result_list,&property_text_cbuf,is_first_line,result_run ? 1 : 0);
 
-						case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
-						case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
-						case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
+		is_first_line = 0;
+	}
+	
+	if ((run) && (_es_footer > 0))
+	{
+		_es_output_footer(result_list->file_result_count+result_list->folder_result_count,result_list->total_result_size);
 
-							ipc3_stream_skip(stream,sizeof(DWORD));
-							
-							break;
-							
-						case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
+		run--;
+	}
 
-							ipc3_stream_skip(stream,sizeof(ES_UINT64));
-							
-							break;
-							
-						case IPC3_PROPERTY_VALUE_TYPE_UINT128: 
+	_es_output_page_end();
 
-							ipc3_stream_skip(stream,sizeof(EVERYTHING3_UINT128));
-							
-							break;
-							
-						case IPC3_PROPERTY_VALUE_TYPE_DIMENSIONS: 
+	utf8_buf_kill(&property_text_cbuf);
+}
 
-							ipc3_stream_skip(stream,sizeof(EVERYTHING3_DIMENSIONS));
-							
-							break;
-							
-						case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
-						
-							ipc3_stream_read_size_t(stream);
-							break;
-							
-						case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1K: 
-						case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1M: 
+// cancel the main thread's pipe reads once the deadline expires.
+// keep cancelling until the main thread stops reading, in case it starts another read.
+static DWORD WINAPI _es_deadline_thread_proc(void *param)
+{
+	DWORD elapsed;
+	DWORD wait_time;
+	
+	elapsed = GetTickCount() - _es_deadline_tickstart;
+	
+	wait_time = 0;
+	
+	if (elapsed < _es_deadline)
+	{
+		wait_time = _es_deadline - elapsed;
+	}
+	
+	while(WaitForSingleObject(_es_deadline_stop_event,wait_time) == WAIT_TIMEOUT)
+	{
+		InterlockedExchange(&_es_deadline_is_expired,1);
+		
+		// never cancel writes to stdout or the export file.
+		EnterCriticalSection(&_es_deadline_cs);
+		
+		if (_es_deadline_is_reading)
+		{
+			os_cancel_synchronous_io(_es_deadline_main_thread_handle);
+		}
+		
+		LeaveCriticalSection(&_es_deadline_cs);
+		
+		wait_time = _ES_DEADLINE_CANCEL_INTERVAL;
+	}
+	
+	return 0;
+}
 
-							ipc3_stream_skip(stream,sizeof(__int32));
-							
-							break;
+// start the -deadline timer thread.
+// does nothing if there's no deadline.
+static void _es_deadline_start(void)
+{
+	if (_es_deadline)
+	{
+		DWORD thread_id;
+		
+		InitializeCriticalSection(&_es_deadline_cs);
+		
+		_es_deadline_stop_event = CreateEvent(NULL,TRUE,FALSE,NULL);
+		if (!_es_deadline_stop_event)
+		{
+			es_fatal(ES_ERROR_OUT_OF_MEMORY);
+		}
+		
+		// GetCurrentThread() is a pseudo handle that would refer to the timer thread.
+		if (!DuplicateHandle(GetCurrentProcess(),GetCurrentThread(),GetCurrentProcess(),&_es_deadline_main_thread_handle,0,FALSE,DUPLICATE_SAME_ACCESS))
+		{
+			es_fatal(ES_ERROR_OUT_OF_MEMORY);
+		}
+		
+		_es_deadline_thread_handle = CreateThread(NULL,0,_es_deadline_thread_proc,NULL,0,&thread_id);
+		if (!_es_deadline_thread_handle)
+		{
+			es_fatal(ES_ERROR_OUT_OF_MEMORY);
+		}
+	}
+}
 
-						case IPC3_PROPERTY_VALUE_TYPE_BLOB8:
+// stop the -deadline timer thread.
+static void _es_deadline_stop(void)
+{
+	if (_es_deadline_thread_handle)
+	{
+		SetEvent(_es_deadline_stop_event);
+		
+		WaitForSingleObject(_es_deadline_thread_handle,INFINITE);
+		
+		CloseHandle(_es_deadline_thread_handle);
+		CloseHandle(_es_deadline_main_thread_handle);
+		CloseHandle(_es_deadline_stop_event);
+		
+		DeleteCriticalSection(&_es_deadline_cs);
+		
+		_es_deadline_thread_handle = NULL;
+	}
+}
 
-							{
-								BYTE len;
-								
-								len = ipc3_stream_read_byte(stream);
-								
-								ipc3_stream_skip(stream,len);
-							}
+// set when the main thread is reading from Everything and the read can be cancelled.
+// clear before writing any output.
+static void _es_deadline_set_is_reading(int is_reading)
+{
+	if (_es_deadline_thread_handle)
+	{
+		EnterCriticalSection(&_es_deadline_cs);
+		
+		_es_deadline_is_reading = is_reading;
+		
+		LeaveCriticalSection(&_es_deadline_cs);
+	}
+}
 
-							break;
+// output a recorded result.
+static void _es_output_ipc3_recorded_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,const void *buf,SIZE_T size,int is_64bit,int is_first_line,int is_more)
+{
+	ipc3_stream_t *reply_stream;
+	ipc3_stream_memory_t memory_stream;
+	
+	reply_stream = result_list->stream;
+	
+	ipc3_stream_memory_init(&memory_stream,buf,size,is_64bit);
+	
+	result_list->stream = (ipc3_stream_t *)&memory_stream;
+	
+	_es_output_ipc3_result(result_list,property_text_cbuf,is_first_line,is_more);
+	
+	result_list->stream = reply_stream;
+	
+	ipc3_stream_close((ipc3_stream_t *)&memory_stream);
+}
 
-						case IPC3_PROPERTY_VALUE_TYPE_BLOB16:
+// output a recorded result to the main output and each extra export.
+static void _es_tee_output_ipc3_recorded_result(ipc3_result_list_t *result_list,utf8_buf_t *property_text_cbuf,const void *buf,SIZE_T size,int is_64bit,int is_first_line,int is_more)
+{
+	_es_tee_t *tee;
+	
+	_es_output_ipc3_recorded_result(result_list,property_text_cbuf,buf,size,is_64bit,is_first_line,is_more);
+	
+	tee = _es_tee_start;
+	
+	while(tee)
+	{
+		_es_tee_swap(tee);
+		
+		_es_output_ipc3_recorded_result(result_list,property_text_cbuf,buf,size,is_64bit,is_first_line,is_more);
+		
+		_es_tee_swap(tee);
+		
+		tee = tee->next;
+	}
+}
 
-							{
-								WORD len;
-								
-								len = ipc3_stream_read_word(stream);
-								
-								ipc3_stream_skip(stream,len);
-							}
+// output results until the deadline expires.
+// each result is read in full before the previous result is output, so a result cut off by the
+// deadline is never shown and the last line is known for JSON.
+// sets the error level if the deadline expired before all results were read.
+// each result is also written to every extra export.
+// starts the next -export-shard file when the open one is full.
+static void _es_output_ipc3_results_before_deadline(ipc3_result_list_t *result_list)
+{
+	ipc3_stream_t *reply_stream;
+	ipc3_stream_record_t record_stream;
+	const ipc3_result_list_property_request_t *reply_property_request_array;
+	utf8_buf_t property_text_cbuf;
+	utf8_buf_t pending_cbuf;
+	SIZE_T pending_size;
+	int has_pending;
+	int is_first_line;
+	SIZE_T result_run;
+	_es_tee_t *tee;
+	
+	reply_stream = result_list->stream;
+	reply_property_request_array = (const ipc3_result_list_property_request_t *)result_list->property_request_cbuf.buf;
+	
+	utf8_buf_init(&property_text_cbuf);
+	utf8_buf_init(&pending_cbuf);
+	ipc3_stream_record_init(&record_stream,reply_stream);
+	
+	pending_size = 0;
+	has_pending = 0;
+	is_first_line = 1;
+	
+	_es_output_page_begin();
 
-							break;
+	if (_es_header > 0)
+	{
+		_es_output_header();
+	}
+	
+	tee = _es_tee_start;
+	
+	while(tee)
+	{
+		_es_tee_swap(tee);
+		
+		_es_output_page_begin();
 
-					}
-				}
+		if (_es_header > 0)
+		{
+			_es_output_header();
+		}
+		
+		_es_tee_swap(tee);
+		
+		tee = tee->next;
+	}
+	
+	result_run = result_list->viewport_count;
+	
+	while(result_run)
+	{
+		SIZE_T property_request_index;
+		
+		if (_es_deadline_is_expired)
+		{
+			break;
+		}
+		
+		// read the next result.
+		ipc3_stream_record_clear(&record_stream);
+		
+		_es_deadline_set_is_reading(1);
+		
+		ipc3_stream_read_byte((ipc3_stream_t *)&record_stream);
+		
+		for(property_request_index=0;property_request_index<result_list->property_request_count;property_request_index++)
+		{
+			ipc3_result_list_skip_property_value((ipc3_stream_t *)&record_stream,&reply_property_request_array[property_request_index]);
+		}
+		
+		_es_deadline_set_is_reading(0);
+		
+		if (record_stream.base.is_error)
+		{
+			break;
+		}
+		
+		// there's another result, output the pending result.
+		if (has_pending)
+		{
+			int is_last_in_shard;
+			
+			is_last_in_shard = 0;
+			
+			if (_es_shard_type != _ES_SHARD_TYPE_NONE)
+			{
+				is_last_in_shard = _es_shard_is_last_row(result_list,pending_cbuf.buf,pending_size,record_stream.buf,record_stream.size,record_stream.base.is_64bit);
+			}
+			
+			_es_tee_output_ipc3_recorded_result(result_list,&property_text_cbuf,pending_cbuf.buf,pending_size,record_stream.base.is_64bit,is_first_line,!is_last_in_shard);
+			
+			is_first_line = 0;
+			
+			if (is_last_in_shard)
+			{
+				_es_shard_next();
 				
-				property_request_p++;
-				property_request_run--;
+				is_first_line = 1;
 			}
 		}
-
+		
+		utf8_buf_grow_size(&pending_cbuf,record_stream.size);
+		os_copy_memory(pending_cbuf.buf,record_stream.buf,record_stream.size);
+		
+		pending_size = record_stream.size;
+		has_pending = 1;
+		
 		result_run--;
-
-		_es_output_line_end(result_run ? 1 : 0);
-
-		is_first_line = 0;
 	}
 	
-	if ((run) && (_es_footer > 0))
+	// output the last result.
+	if (has_pending)
+	{
+		_es_tee_output_ipc3_recorded_result(result_list,&property_text_cbuf,pending_cbuf.buf,pending_size,record_stream.base.is_64bit,is_first_line,0);
+	}
+	
+	if ((result_run) && (_es_deadline_is_expired))
+	{
+		_es_ret = ES_ERROR_DEADLINE_EXPIRED;
+	}
+	
+	if (_es_footer > 0)
 	{
 		_es_output_footer(result_list->file_result_count+result_list->folder_result_count,result_list->total_result_size);
-
-		run--;
 	}
 
 	_es_output_page_end();
+	
+	tee = _es_tee_start;
+	
+	while(tee)
+	{
+		_es_tee_swap(tee);
+		
+		if (_es_footer > 0)
+		{
+			_es_output_footer(result_list->file_result_count+result_list->folder_result_count,result_list->total_result_size);
+		}
 
+		_es_output_page_end();
+		
+		_es_tee_swap(tee);
+		
+		tee = tee->next;
+	}
+
+	ipc3_stream_close((ipc3_stream_t *)&record_stream);
+	utf8_buf_kill(&pending_cbuf);
 	utf8_buf_kill(&property_text_cbuf);
 }
 
@@ -5633,6 +13089,15 @@ static ES_UINT64 _es_ipc2_calculate_total_size(EVERYTHING_IPC_LIST2 *list)
 // custom window proc
 static LRESULT __stdcall _es_window_proc(HWND hwnd,UINT msg,WPARAM wParam,LPARAM lParam)
 {
+	// Everything was started.
+	// the message id is registered at runtime, so we can't use it as a case label.
+	if ((_es_ipc_created_message) && (msg == _es_ipc_created_message))
+	{
+		_es_ipc_created = 1;
+		
+		return 0;
+	}
+	
 	switch(msg)
 	{
 		case WM_COPYDATA:
@@ -6054,6 +13519,16 @@ static void _es_help(void)
 		"   -export-tsv <out.txt>\r\n"
 		"   -export-txt <out.txt>\r\n"
 		"        Export to a file using the specified layout.\r\n"
+		"        Use -export-csv, -export-efu, -export-json and -export-tsv more\r\n"
+		"        than once to export the same results to each file.\r\n"
+		"   -export-shard <rows=count|bytes=size|by=property>\r\n"
+		"        Split the export into numbered files, eg: out.0001.csv\r\n"
+		"        Each file has its own header and is closed before the next file\r\n"
+		"        is started.\r\n"
+		"   -export-compress <gzip|zlib|deflate>\r\n"
+		"        Compress the export file while it is written.\r\n"
+		"   -export-compress-level <1-9>\r\n"
+		"        1 is fastest, 9 is smallest. The default is 6.\r\n"
 		"   -no-header\r\n"
 		"        Do not output a column header for CSV, EFU and TSV files.\r\n"
 		"   -no-folder-append-path-separator\r\n"
@@ -6068,6 +13543,9 @@ static void _es_help(void)
 		"\r\n"
 		"   -instance <name>\r\n"
 		"        Connect to the unique Everything instance name.\r\n"
+		"   -instances <name1,name2,...>\r\n"
+		"        Search multiple Everything instances at the same time and merge\r\n"
+		"        the sorted results. Use an empty name for the default instance.\r\n"
 		"   -ipc1, -ipc2, -ipc3\r\n"
 		"        Use IPC version 1, 2 or 3.\r\n"
 		"   -pause, -more\r\n"
@@ -6075,6 +13553,9 @@ static void _es_help(void)
 		"   -timeout <milliseconds>\r\n"
 		"        Timeout after the specified number of milliseconds to wait for\r\n"
 		"        the Everything database to load before sending a query.\r\n"
+		"   -deadline <milliseconds>\r\n"
+		"        Stop the search after the specified number of milliseconds and\r\n"
+		"        show the results read so far. Sets error level 12 if stopped.\r\n"
 		"\r\n"
 		"   -set-run-count <filename> <count>\r\n"
 		"        Set the run count for the specified filename.\r\n"
@@ -6089,6 +13570,79 @@ static void _es_help(void)
 		"        Display the total result size for the specified search.\r\n"
 		"   -get-folder-size <filename>\r\n"
 		"        Display the total folder size for the specified filename.\r\n"
+		"        Use more than once to display path,size rows.\r\n"
+		"   -get-folder-size-from-file <filename>\r\n"
+		"        Display the total folder size of each folder from the file, or - for\r\n"
+		"        stdin, one per line.\r\n"
+		"   -folder-size-in-flight <count>\r\n"
+		"        The number of folder size lookups sent before waiting for a reply,\r\n"
+		"        1 to 512, default is 256.\r\n"
+		"   -diff-since <state-file>\r\n"
+		"        Display the results added, removed or modified since the last\r\n"
+		"        search with the same state file and update the state file.\r\n"
+		"   -view <state-file>\r\n"
+		"        Display the results of a saved search, kept up to date with the\r\n"
+		"        changes since the last use. The first use saves the search.\r\n"
+		"   -group-by <property>\r\n"
+		"        Display one line for each value of the property instead of the\r\n"
+		"        results. Use year(date), month(date) or day(date) to group dates.\r\n"
+		"   -agg <count,sum(property),min(property),max(property),avg(property)>\r\n"
+		"        The comma delimited values to show for each group, default is count.\r\n"
+		"   -group-depth <n>\r\n"
+		"        Group paths by the first n path parts.\r\n"
+		"   -rollup-depth <n>\r\n"
+		"        Display the total size and file count of each folder up to n\r\n"
+		"        folders deep, largest first. Use -n to show the top folders.\r\n"
+		"   -approx\r\n"
+		"        Display the approximate distinct count and the min, p50, p90, p99\r\n"
+		"        and max of each column instead of the results.\r\n"
+		"   -sample <n>\r\n"
+		"        Display a random sample of n results. -offset and -n limit the\r\n"
+		"        results to sample from.\r\n"
+		"   -seed <n>\r\n"
+		"        The seed for -sample, use the same seed to get the same sample.\r\n"
+		"   -stat-from-stdin\r\n"
+		"        Display the size, dates and attributes of each path from stdin, one\r\n"
+		"        per line, from the index without accessing the disk.\r\n"
+		"   -ls <folder>\r\n"
+		"        List the folder from the index, like dir. Use with -export-efu to\r\n"
+		"        write a file list without accessing the disk.\r\n"
+		"   -recurse\r\n"
+		"        List subfolders too with -ls.\r\n"
+		"   -batch <filename>\r\n"
+		"        Run each line from the file, or - for stdin, as a separate search.\r\n"
+		"        Lines can use -n, -o, -sort and -columns.\r\n"
+		"   -batch-delimiter <text>\r\n"
+		"        The text to show before each batch search, default is #.\r\n"
+		"   -batch-connections <count>\r\n"
+		"        Run batch searches at the same time on multiple connections.\r\n"
+		"   -batch-in-flight <count>\r\n"
+		"        The maximum number of batch searches running or waiting to be\r\n"
+		"        shown, default is the connection count.\r\n"
+		"   -batch-as-completed\r\n"
+		"        Show batch results as searches complete instead of in order.\r\n"
+		"   -batch-latency\r\n"
+		"        Show the time taken for each batch search in milliseconds.\r\n"
+		"   -partitions <count>\r\n"
+		"        Read the results in ranges on multiple connections at the same\r\n"
+		"        time. Sets error level 10 if the index changed while reading.\r\n"
+		"   -result-cache <folder>\r\n"
+		"        Save search results in the folder and reuse them for the same\r\n"
+		"        search until the index changes.\r\n"
+		"   -create-file-list <filename> <path-list>\r\n"
+		"        Create an EFU file list from the semicolon delimited list of\r\n"
+		"        folders on disk.\r\n"
+		"   -file-list-relative-paths\r\n"
+		"        Store paths relative to the file list location when possible.\r\n"
+		"   -file-list-include-only-files <list>\r\n"
+		"   -file-list-exclude-files <list>\r\n"
+		"   -file-list-include-only-folders <list>\r\n"
+		"   -file-list-exclude-folders <list>\r\n"
+		"        Filter the file list with a semicolon delimited list of\r\n"
+		"        wildcards, excluded folders are not read from disk.\r\n"
+		"   -file-list-incremental\r\n"
+		"        Update an existing file list, only folders with a changed date\r\n"
+		"        modified are read from disk.\r\n"
 		"\r\n"
 		"   -save-settings\r\n"
 		"        Save settings to %APPDATA%\\voidtools\\es\\es.ini\r\n"
@@ -6133,7 +13687,40 @@ static int _es_main(void)
 	wchar_buf_t local_instance_name_wcbuf;
 	wchar_buf_t local_locale_thousand_wcbuf;
 	wchar_buf_t local_locale_decimal_wcbuf;
-	wchar_t *get_folder_size_filename;
+	wchar_buf_t local_export_filename_wcbuf;
+	array_t get_folder_size_array;
+	wchar_t *get_folder_size_list_filename;
+	SIZE_T get_folder_size_in_flight;
+	wchar_t *diff_since_filename;
+	wchar_t *view_filename;
+	wchar_t *instance_list;
+	wchar_t *group_by_key;
+	wchar_t *group_by_agg_list;
+	SIZE_T group_by_depth;
+	int is_approx;
+	SIZE_T rollup_depth;
+	ES_UINT64 sample_size;
+	ES_UINT64 sample_seed;
+	int is_sample_seed;
+	int is_stat_from_stdin;
+	wchar_t *ls_path;
+	int is_ls_recurse;
+	wchar_t *batch_filename;
+	wchar_t *batch_delimiter;
+	SIZE_T batch_connection_count;
+	SIZE_T batch_in_flight_count;
+	int batch_as_completed;
+	int batch_latency;
+	SIZE_T partition_count;
+	wchar_t *result_cache_path;
+	wchar_t *create_file_list_filename;
+	wchar_t *create_file_list_path_list;
+	int file_list_relative_paths;
+	int file_list_incremental;
+	wchar_t *file_list_include_only_files;
+	wchar_t *file_list_exclude_files;
+	wchar_t *file_list_include_only_folders;
+	wchar_t *file_list_exclude_folders;
 	pool_t local_column_color_pool;
 	pool_t local_column_width_pool;
 	pool_t local_column_pool;
@@ -6153,6 +13740,7 @@ static int _es_main(void)
 	wchar_buf_init(&local_instance_name_wcbuf);
 	wchar_buf_init(&local_locale_thousand_wcbuf);
 	wchar_buf_init(&local_locale_decimal_wcbuf);
+	wchar_buf_init(&local_export_filename_wcbuf);
 	pool_init(&local_column_color_pool);
 	pool_init(&local_column_width_pool);
 	pool_init(&local_column_pool);
@@ -6163,11 +13751,44 @@ static int _es_main(void)
 	array_init(&local_column_array);
 	array_init(&local_secondary_sort_array);
 	array_init(&local_property_unknown_array);
-	
-	get_folder_size_filename = NULL;
+	array_init(&get_folder_size_array);
+	
+	get_folder_size_list_filename = NULL;
+	get_folder_size_in_flight = _ES_FOLDER_SIZE_DEFAULT_IN_FLIGHT;
+	diff_since_filename = NULL;
+	view_filename = NULL;
+	instance_list = NULL;
+	group_by_key = NULL;
+	group_by_agg_list = NULL;
+	group_by_depth = 0;
+	is_approx = 0;
+	rollup_depth = 0;
+	sample_size = 0;
+	sample_seed = 0;
+	is_sample_seed = 0;
+	is_stat_from_stdin = 0;
+	ls_path = NULL;
+	is_ls_recurse = 0;
+	batch_filename = NULL;
+	batch_delimiter = NULL;
+	batch_connection_count = 1;
+	batch_in_flight_count = 0;
+	batch_as_completed = 0;
+	batch_latency = 0;
+	partition_count = 1;
+	result_cache_path = NULL;
+	create_file_list_filename = NULL;
+	create_file_list_path_list = NULL;
+	file_list_relative_paths = 0;
+	file_list_incremental = 0;
+	file_list_include_only_files = NULL;
+	file_list_exclude_files = NULL;
+	file_list_include_only_folders = NULL;
+	file_list_exclude_folders = NULL;
 	es_instance_name_wcbuf = &local_instance_name_wcbuf;
 	_es_locale_thousand_wcbuf = &local_locale_thousand_wcbuf;
 	_es_locale_decimal_wcbuf = &local_locale_decimal_wcbuf;
+	_es_export_filename_wcbuf = &local_export_filename_wcbuf;
 	_es_search_wcbuf = &search_wcbuf;
 	
 	// I am trying to avoid bloating the exe size by using large global varibales.
@@ -6385,11 +14006,258 @@ static int _es_main(void)
 					goto next_argv;
 				}
 
-				if (_es_check_option_utf8_string(argv_wcbuf.buf,"get-folder-size"))
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"get-folder-size"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					// can be used more than once.
+					array_insert(&get_folder_size_array,get_folder_size_array.count,wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars));
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"get-folder-size-from-file"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (get_folder_size_list_filename)
+					{
+						mem_free(get_folder_size_list_filename);
+					}
+					
+					get_folder_size_list_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"folder-size-in-flight"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					get_folder_size_in_flight = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+					
+					if (!get_folder_size_in_flight)
+					{
+						_es_bad_switch_param("Invalid in-flight count: 0\n");
+					}
+					
+					if (get_folder_size_in_flight > _ES_FOLDER_SIZE_MAX_IN_FLIGHT)
+					{
+						get_folder_size_in_flight = _ES_FOLDER_SIZE_MAX_IN_FLIGHT;
+					}
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"diff-since"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (diff_since_filename)
+					{
+						mem_free(diff_since_filename);
+					}
+					
+					diff_since_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"view"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (view_filename)
+					{
+						mem_free(view_filename);
+					}
+					
+					view_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (batch_filename)
+					{
+						mem_free(batch_filename);
+					}
+					
+					batch_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch-delimiter"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (batch_delimiter)
+					{
+						mem_free(batch_delimiter);
+					}
+					
+					batch_delimiter = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch-connections"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					batch_connection_count = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch-in-flight"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					batch_in_flight_count = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch-as-completed"))
+				{
+					batch_as_completed = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"batch-latency"))
+				{
+					batch_latency = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"partitions"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					partition_count = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"result-cache"))
+				{
+					wchar_buf_t full_path_wcbuf;
+					
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					wchar_buf_init(&full_path_wcbuf);
+					
+					os_get_expanded_full_path_name(argv_wcbuf.buf,&full_path_wcbuf);
+					
+					if (result_cache_path)
+					{
+						mem_free(result_cache_path);
+					}
+					
+					result_cache_path = wchar_string_alloc_wchar_string_n(full_path_wcbuf.buf,full_path_wcbuf.length_in_wchars);
+					_es_result_cache_path = result_cache_path;
+					
+					wchar_buf_kill(&full_path_wcbuf);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"create-file-list"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (create_file_list_filename)
+					{
+						mem_free(create_file_list_filename);
+					}
+					
+					create_file_list_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (create_file_list_path_list)
+					{
+						mem_free(create_file_list_path_list);
+					}
+					
+					create_file_list_path_list = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-relative-paths"))
+				{
+					file_list_relative_paths = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-incremental"))
+				{
+					file_list_incremental = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-include-only-files"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (file_list_include_only_files)
+					{
+						mem_free(file_list_include_only_files);
+					}
+					
+					file_list_include_only_files = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-exclude-files"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (file_list_exclude_files)
+					{
+						mem_free(file_list_exclude_files);
+					}
+					
+					file_list_exclude_files = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-include-only-folders"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (file_list_include_only_folders)
+					{
+						mem_free(file_list_include_only_folders);
+					}
+					
+					file_list_include_only_folders = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"file-list-exclude-folders"))
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					get_folder_size_filename = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+					if (file_list_exclude_folders)
+					{
+						mem_free(file_list_exclude_folders);
+					}
+					
+					file_list_exclude_folders = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
 
 					goto next_argv;
 				}
@@ -6505,6 +14373,139 @@ static int _es_main(void)
 					goto next_argv;
 				}
 
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"instances"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (instance_list)
+					{
+						mem_free(instance_list);
+					}
+					
+					instance_list = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"group-by"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (group_by_key)
+					{
+						mem_free(group_by_key);
+					}
+					
+					group_by_key = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"agg"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					if (group_by_agg_list)
+					{
+						mem_free(group_by_agg_list);
+					}
+					
+					group_by_agg_list = wchar_string_alloc_wchar_string_n(argv_wcbuf.buf,argv_wcbuf.length_in_wchars);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"approx"))
+				{
+					is_approx = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"rollup-depth"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					rollup_depth = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+					
+					if (!rollup_depth)
+					{
+						_es_bad_switch_param("Invalid rollup depth: 0\n");
+					}
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"sample"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					sample_size = wchar_string_to_uint64(argv_wcbuf.buf);
+					
+					if (!sample_size)
+					{
+						_es_bad_switch_param("Invalid sample size: 0\n");
+					}
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"seed"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					sample_seed = wchar_string_to_uint64(argv_wcbuf.buf);
+					is_sample_seed = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"stat-from-stdin"))
+				{
+					is_stat_from_stdin = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"ls"))
+				{
+					wchar_buf_t path_wcbuf;
+
+					wchar_buf_init(&path_wcbuf);
+				
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					// relative path.
+					os_get_expanded_full_path_name(argv_wcbuf.buf,&path_wcbuf);
+					
+					if (ls_path)
+					{
+						mem_free(ls_path);
+					}
+					
+					ls_path = wchar_string_alloc_wchar_string_n(path_wcbuf.buf,path_wcbuf.length_in_wchars);
+
+					wchar_buf_kill(&path_wcbuf);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"recurse"))
+				{
+					is_ls_recurse = 1;
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"group-depth"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					group_by_depth = safe_size_from_uint64(wchar_string_to_uint64(argv_wcbuf.buf));
+
+					goto next_argv;
+				}
+
 				if ((_es_check_option_utf8_string(argv_wcbuf.buf,"exit")) || (_es_check_option_utf8_string(argv_wcbuf.buf,"quit")))
 				{
 					_es_exit_everything = 1;
@@ -6560,15 +14561,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_M3U;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_M3U);
 
 					goto next_argv;
 				}
@@ -6584,15 +14577,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_M3U8;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_M3U8);
 
 					goto next_argv;
 				}
@@ -6629,15 +14614,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_CSV;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_CSV);
 
 					goto next_argv;
 				}
@@ -6646,15 +14623,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_TSV;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_TSV);
 
 					goto next_argv;
 				}
@@ -6663,15 +14632,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_JSON;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_JSON);
 
 					goto next_argv;
 				}
@@ -6687,15 +14648,7 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
-					{
-						_es_export_type = _ES_EXPORT_TYPE_EFU;
-					}
-					else
-					{
-						es_fatal(ES_ERROR_CREATE_FILE);
-					}
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_EFU);
 
 					goto next_argv;
 				}
@@ -6711,14 +14664,82 @@ static int _es_main(void)
 				{
 					_es_expect_command_argv(&argv_wcbuf);
 					
-					_es_export_file = os_create_file(argv_wcbuf.buf);
-					if (_es_export_file != INVALID_HANDLE_VALUE)
+					_es_set_export_file(argv_wcbuf.buf,_ES_EXPORT_TYPE_TXT);
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"export-shard"))
+				{
+					const wchar_t *value_p;
+					
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					value_p = wchar_string_parse_utf8_string(argv_wcbuf.buf,"rows=");
+					if (value_p)
 					{
-						_es_export_type = _ES_EXPORT_TYPE_TXT;
+						_es_shard_type = _ES_SHARD_TYPE_ROWS;
+						_es_shard_limit = wchar_string_to_uint64(value_p);
 					}
 					else
 					{
-						es_fatal(ES_ERROR_CREATE_FILE);
+						value_p = wchar_string_parse_utf8_string(argv_wcbuf.buf,"bytes=");
+						if (value_p)
+						{
+							_es_shard_type = _ES_SHARD_TYPE_BYTES;
+							_es_shard_limit = wchar_string_to_uint64(value_p);
+						}
+						else
+						{
+							value_p = wchar_string_parse_utf8_string(argv_wcbuf.buf,"by=");
+							if (value_p)
+							{
+								_es_shard_type = _ES_SHARD_TYPE_BY;
+								_es_shard_property_id = property_find(value_p,_es_should_allow_property_system(value_p));
+								
+								if (_es_shard_property_id == EVERYTHING3_INVALID_PROPERTY_ID)
+								{
+									_es_bad_switch_param("Unknown property: %S\n",value_p);
+								}
+							}
+							else
+							{
+								_es_bad_switch_param("-export-shard expects rows=<count>, bytes=<size> or by=<property>.\n");
+							}
+						}
+					}
+					
+					if ((_es_shard_type != _ES_SHARD_TYPE_BY) && (!_es_shard_limit))
+					{
+						_es_bad_switch_param("-export-shard expects a count or size greater than 0.\n");
+					}
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"export-compress"))
+				{
+					_es_expect_command_argv(&argv_wcbuf);
+					
+					_es_compress_type = _es_compress_type_from_name(argv_wcbuf.buf);
+					
+					if (_es_compress_type == COMPRESS_TYPE_NONE)
+					{
+						_es_bad_switch_param("Unknown compression format: %S\n",argv_wcbuf.buf);
+					}
+
+					goto next_argv;
+				}
+
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"export-compress-level"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					_es_compress_level = wchar_string_to_int(argv_wcbuf.buf);
+					
+					if ((_es_compress_level < DEFLATE_MIN_LEVEL) || (_es_compress_level > DEFLATE_MAX_LEVEL))
+					{
+						_es_bad_switch_param("Invalid compression level: %d\n",_es_compress_level);
 					}
 
 					goto next_argv;
@@ -7833,6 +15854,16 @@ static int _es_main(void)
 
 					goto next_argv;
 				}
+				
+				if (_es_check_option_utf8_string(argv_wcbuf.buf,"deadline"))
+				{
+					_es_expect_command_argv_int(&argv_wcbuf);
+					
+					_es_deadline = wchar_string_to_dword(argv_wcbuf.buf);
+					_es_deadline_tickstart = GetTickCount();
+
+					goto next_argv;
+				}
 			
 				if (_es_check_option_utf8_string(argv_wcbuf.buf,"debug"))
 				{
@@ -8508,6 +16539,24 @@ next_argv:
 		_es_pause = 0;
 		_es_highlight = 0;
 	}
+	
+	// there's no key to wait for if stdin is not a console.
+	// show everything without paging, like more.
+	if (_es_pause)
+	{
+		DWORD console_mode;
+		
+		if (!GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE),&console_mode))
+		{
+			_es_pause = 0;
+		}
+	}
+
+	// -export-shard writes numbered files instead of the export file.
+	if (_es_shard_type != _ES_SHARD_TYPE_NONE)
+	{
+		_es_shard_start();
+	}
 
 	// using a separate date format for display and export is too confusing for the end users.
 	// if we redirect output to a file, disable pause.
@@ -8518,20 +16567,43 @@ next_argv:
 		_es_export_avail = _ES_EXPORT_BUF_SIZE;
 	}
 	
+	// -export-compress compresses the export file on another thread.
+	if (_es_compress_type != COMPRESS_TYPE_NONE)
+	{
+		if ((_es_export_file == INVALID_HANDLE_VALUE) || (!_es_export_filename_wcbuf->length_in_wchars))
+		{
+			_es_bad_switch_param("-export-compress requires an -export-* file.\n");
+		}
+		
+		if (_es_tee_start)
+		{
+			_es_bad_switch_param("-export-compress can only be used with one -export-* file.\n");
+		}
+		
+		_es_compress_start();
+	}
+	
 	// export BOM
 	if (_es_utf8_bom)
 	{
 		if ((_es_export_file != INVALID_HANDLE_VALUE) || (!_es_output_is_char))
 		{
 			BYTE bom[3];
-			DWORD numwritten;
 			
 			// 0xEF,0xBB,0xBF.
 			bom[0] = 0xEF;
 			bom[1] = 0xBB;
 			bom[2] = 0xBF;
 			
-			WriteFile(_es_export_file != INVALID_HANDLE_VALUE ? _es_export_file : _es_output_handle,bom,3,&numwritten,0);
+			// the export file BOM goes through the export buffer, so it's compressed with everything else.
+			if (_es_export_file != INVALID_HANDLE_VALUE)
+			{
+				_es_export_write_data(bom,3);
+			}
+			else
+			{
+				_es_write_output(_es_output_handle,bom,3);
+			}
 		}
 	}
 
@@ -8543,16 +16615,49 @@ next_argv:
 		{
 			if (_es_export_type != _ES_EXPORT_TYPE_NOFORMAT)
 			{
-				// export should use trailing '\\'.
-				_es_folder_append_path_separator = 1;
+				// export should use trailing '\\'.
+				_es_folder_append_path_separator = 1;
+			}
+		}
+	}
+	else
+	if (_es_folder_append_path_separator < 0)
+	{	
+		_es_folder_append_path_separator = 0;
+	}
+		
+	// setup extra exports.
+	// use the same header and footer rules as the main export.
+	{
+		_es_tee_t *tee;
+		
+		tee = _es_tee_start;
+		
+		while(tee)
+		{
+			tee->export_buf = mem_alloc(_ES_EXPORT_BUF_SIZE);
+			tee->export_p = tee->export_buf;
+			tee->export_avail = _ES_EXPORT_BUF_SIZE;
+			
+			if (_es_utf8_bom)
+			{
+				_es_write_output(tee->export_file,"\xEF\xBB\xBF",3);
+			}
+			
+			if (tee->export_type == _ES_EXPORT_TYPE_JSON)
+			{
+				tee->header = -1;
+			}
+			else
+			{
+				tee->header = _es_header ? _es_header : 1;
 			}
+			
+			tee->footer = -1;
+			
+			tee = tee->next;
 		}
 	}
-	else
-	if (_es_folder_append_path_separator < 0)
-	{	
-		_es_folder_append_path_separator = 0;
-	}
 		
 	// apply export formatting.
 	if ((_es_export_type == _ES_EXPORT_TYPE_CSV) || (_es_export_type == _ES_EXPORT_TYPE_TSV))
@@ -9036,11 +17141,35 @@ retry_read_journal:
 		perform_search = 0;
 	}
 	
-	if (get_folder_size_filename)
+	if ((get_folder_size_array.count) || (get_folder_size_list_filename))
+	{
+		if ((get_folder_size_array.count == 1) && (!get_folder_size_list_filename) && (_es_export_type == _ES_EXPORT_TYPE_NONE))
+		{
+			// a single folder only shows the size.
+			_es_get_folder_size(get_folder_size_array.indexes[0]);
+		}
+		else
+		{
+			// path,size rows.
+			if (!_es_ipc3_get_folder_sizes(&get_folder_size_array,get_folder_size_list_filename,get_folder_size_in_flight))
+			{
+				// no IPC
+				es_fatal(ES_ERROR_NO_IPC);
+			}
+		}
+
+		perform_search = 0;
+	}
+	
+	if (create_file_list_filename)
 	{
-		_es_get_folder_size(get_folder_size_filename);
+		if (!filelist_create(create_file_list_filename,create_file_list_path_list,file_list_include_only_files,file_list_exclude_files,file_list_include_only_folders,file_list_exclude_folders,(_es_folder_append_path_separator > 0) ? 1 : 0,file_list_relative_paths,file_list_incremental))
+		{
+			es_fatal(ES_ERROR_CREATE_FILE);
+		}
 		
-		mem_free(get_folder_size_filename);
+		mem_free(create_file_list_path_list);
+		mem_free(create_file_list_filename);
 
 		perform_search = 0;
 	}
@@ -9099,129 +17228,382 @@ retry_read_journal:
 				es_fatal(ES_ERROR_IPC_ERROR);
 			}
 		}
-		else
+		else
+		{
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		perform_search = 0;
+	}
+	
+	if (perform_search)
+	{
+		if (ls_path)
+		{
+			// -recurse can follow -ls.
+			if (filter_wcbuf.length_in_wchars)
+			{
+				wchar_buf_cat_wchar(&filter_wcbuf,' ');
+			}
+			
+			if (is_ls_recurse)
+			{
+				// anchor the path to the start of the full path.
+				// a plain substring would also match the path deeper in another folder.
+				wchar_buf_cat_utf8_string(&filter_wcbuf,"path:startwith:\"");
+			}
+			else
+			{
+				wchar_buf_cat_utf8_string(&filter_wcbuf,"parent:\"");
+			}
+			
+			wchar_buf_cat_wchar_string(&filter_wcbuf,ls_path);
+
+			if (!wchar_string_is_trailing_path_separator_n(ls_path,wchar_string_get_length_in_wchars(ls_path)))
+			{
+				wchar_buf_cat_wchar(&filter_wcbuf,wchar_string_get_path_separator_from_root(ls_path));
+			}
+			
+			wchar_buf_cat_utf8_string(&filter_wcbuf,"\"");
+		}
+		
+		// empty search?
+		// if max results is set, treat the search as non-empty.
+		// -useful if you want to see the top ten largest files etc..
+		if ((!search_wcbuf.length_in_wchars) && (!filter_wcbuf.length_in_wchars) && (_es_max_results == ES_UINT64_MAX) && (!_es_get_result_count) && (!_es_get_total_size) && (!diff_since_filename) && (!view_filename) && (!batch_filename) && (!group_by_key) && (!is_approx) && (!rollup_depth) && (!sample_size) && (!is_stat_from_stdin) && (!ls_path))
+		{
+			if ((_es_empty_search_help) && (_es_output_is_char))
+			{
+				// don't show help if we are redirecting to a file.
+				_es_help();
+				
+				goto exit;
+			}
+
+			if (_es_hide_empty_search_results)
+			{
+				goto exit;
+			}
+		}
+		
+		// waiting for Everything counts towards the deadline.
+		if (_es_deadline)
+		{
+			if ((!es_timeout) || (es_timeout > _es_deadline))
+			{
+				es_timeout = _es_deadline;
+			}
+		}
+			
+		// efu doesn't want name or path columns.
+		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
+		{
+			column_remove(EVERYTHING3_PROPERTY_ID_NAME);
+			column_remove(EVERYTHING3_PROPERTY_ID_PATH);
+		}
+		
+		if (diff_since_filename)
+		{
+			// if no columns are specified, add the columns we compare.
+			if (!column_array->count)
+			{
+				column_add(EVERYTHING3_PROPERTY_ID_FULL_PATH);
+				column_add(EVERYTHING3_PROPERTY_ID_SIZE);
+				column_add(EVERYTHING3_PROPERTY_ID_DATE_MODIFIED);
+			}
+		}
+		
+		// -approx only needs the requested columns.
+		if ((is_approx) && (column_array->count))
+		{
+			_es_no_default_filename_column = 1;
+		}
+		
+		// add filename column
+		if (!_es_no_default_filename_column)
+		{
+			if (!column_find(EVERYTHING3_PROPERTY_ID_FULL_PATH))
+			{
+				if (!column_find(EVERYTHING3_PROPERTY_ID_NAME))
+				{
+					if (!column_find(EVERYTHING3_PROPERTY_ID_PATH))
+					{
+						column_t *filename_column;
+						
+						filename_column = column_add(EVERYTHING3_PROPERTY_ID_FULL_PATH);
+						
+						if (_es_export_type != _ES_EXPORT_TYPE_NONE)
+						{
+							if (_es_export_type != _ES_EXPORT_TYPE_NOFORMAT)
+							{
+								// move KEY to first column.
+								column_remove_order(filename_column);
+								column_insert_order_at_start(filename_column);
+							}
+						}
+					}
+				}
+			}
+		}
+		
+		// -diff-since and -view only keep the path, size, date modified and folder attribute of each result.
+		if ((diff_since_filename) || (view_filename))
+		{
+			column_t *column;
+			
+			column = column_order_start;
+			
+			while(column)
+			{
+				if (!_es_is_diff_item_property(column->property_id))
+				{
+					wchar_buf_t property_name_wcbuf;
+					
+					wchar_buf_init(&property_name_wcbuf);
+					
+					_es_get_localized_property_name(column->property_id,&property_name_wcbuf);
+
+					_es_bad_switch_param("%s doesn't support the %S column, use Name, Path, Full Path, Size, Date Modified or Attributes.\n",diff_since_filename ? "-diff-since" : "-view",property_name_wcbuf.buf);
+				}
+				
+				column = column->order_next;
+			}
+		}
+
+		// fix search filter
+		if (filter_wcbuf.length_in_wchars)
+		{
+			wchar_buf_t new_search_wcbuf;
+
+			wchar_buf_init(&new_search_wcbuf);
+			
+			wchar_buf_cat_utf8_string(&new_search_wcbuf,"< ");
+
+			wchar_buf_cat_wchar_string_n(&new_search_wcbuf,filter_wcbuf.buf,filter_wcbuf.length_in_wchars);
+			wchar_buf_cat_utf8_string(&new_search_wcbuf," > < ");
+			wchar_buf_cat_wchar_string_n(&new_search_wcbuf,search_wcbuf.buf,search_wcbuf.length_in_wchars);
+			if (_es_is_unbalanced_quotes(new_search_wcbuf.buf))
+			{
+				// using a filter and a search without a trailing quote breaks the search
+				// as it makes the trailing > literal.
+				// add a terminating quote:
+				wchar_buf_cat_utf8_string(&new_search_wcbuf,"\"");
+			}
+
+			wchar_buf_cat_utf8_string(&new_search_wcbuf," >");
+
+			wchar_buf_copy_wchar_string_n(&search_wcbuf,new_search_wcbuf.buf,new_search_wcbuf.length_in_wchars);
+			
+			wchar_buf_kill(&new_search_wcbuf);
+		}
+		
+		if (_es_get_result_count)
+		{
+			// no columns.
+			column_clear_all();
+
+			// don't show any results.
+			_es_max_results = 0;
+			
+			// reset sort to name ascending.
+			secondary_sort_clear_all();
+			_es_primary_sort_property_id = EVERYTHING3_PROPERTY_ID_NAME;
+			_es_primary_sort_ascending = 1;
+		}
+
+		if (_es_get_total_size)
+		{
+			// just request size column.
+			column_clear_all();
+			column_add(EVERYTHING3_PROPERTY_ID_SIZE);
+			
+			// reset sort to name ascending.
+			secondary_sort_clear_all();
+			_es_primary_sort_property_id = EVERYTHING3_PROPERTY_ID_NAME;
+			_es_primary_sort_ascending = 1;
+		}
+		
+		// -export-shard by=<property> needs the property value.
+		if (_es_shard_type == _ES_SHARD_TYPE_BY)
+		{
+			if (!column_find(_es_shard_property_id))
+			{
+				column_add(_es_shard_property_id);
+			}
+		}
+
+		// get the everything window.
+		// this will handle timeouts.
+		_es_everything_hwnd = _es_find_ipc_window();
+		
+		// try IPC3, ipc3 query will not block and
+		// will fail immediately.
+		// we don't need the ipc window for ipc3.
+		if (diff_since_filename)
+		{
+			// snapshots need raw values from the pipe.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_diff_since(diff_since_filename)))
+			{
+				goto exit;
+			}
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (view_filename)
+		{
+			// views need the journal.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_view(view_filename)))
+			{
+				goto exit;
+			}
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (batch_filename)
+		{
+			const wchar_t *delimiter;
+			
+			delimiter = batch_delimiter ? batch_delimiter : L"#";
+			
+			// batches need a kept-alive pipe.
+			if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
+			{
+				if (batch_connection_count > 1)
+				{
+					if (!batch_in_flight_count)
+					{
+						batch_in_flight_count = batch_connection_count;
+					}
+					
+					if (_es_ipc3_batch_concurrent(batch_filename,delimiter,batch_latency,batch_connection_count,batch_in_flight_count,batch_as_completed))
+					{
+						goto exit;
+					}
+				}
+				else
+				{
+					if (_es_ipc3_batch(batch_filename,delimiter,batch_latency))
+					{
+						goto exit;
+					}
+				}
+			}
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (instance_list)
+		{
+			// merging needs a pipe to every instance.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_federated_query(instance_list)))
+			{
+				goto exit;
+			}
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (group_by_key)
+		{
+			_es_group_by_t group_by;
+			BOOL is_group_query;
+			
+			_es_group_by_init(&group_by,group_by_key,group_by_agg_list,group_by_depth);
+			
+			// groups are only built while reading an ipc3 reply.
+			is_group_query = FALSE;
+			
+			if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
+			{
+				is_group_query = _es_ipc3_group_query(&group_by);
+			}
+			
+			_es_group_by_kill(&group_by);
+			
+			if (is_group_query)
+			{
+				goto exit;
+			}
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (rollup_depth)
 		{
+			// folder sizes are only built while reading an ipc3 reply.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_rollup_query(rollup_depth)))
+			{
+				goto exit;
+			}
+			
 			es_fatal(ES_ERROR_NO_IPC);
 		}
 		
-		perform_search = 0;
-	}
-	
-	if (perform_search)
-	{
-		// empty search?
-		// if max results is set, treat the search as non-empty.
-		// -useful if you want to see the top ten largest files etc..
-		if ((!search_wcbuf.length_in_wchars) && (!filter_wcbuf.length_in_wchars) && (_es_max_results == ES_UINT64_MAX) && (!_es_get_result_count) && (!_es_get_total_size))
+		if (is_approx)
 		{
-			if ((_es_empty_search_help) && (_es_output_is_char))
+			// sketches are only built while reading an ipc3 reply.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_approx_query()))
 			{
-				// don't show help if we are redirecting to a file.
-				_es_help();
-				
 				goto exit;
 			}
-
-			if (_es_hide_empty_search_results)
+			
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
+		if (is_stat_from_stdin)
+		{
+			// lookups are only pipelined with ipc3.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_stat_from_stdin()))
 			{
 				goto exit;
 			}
-		}
 			
-		// efu doesn't want name or path columns.
-		if (_es_export_type == _ES_EXPORT_TYPE_EFU)
-		{
-			column_remove(EVERYTHING3_PROPERTY_ID_NAME);
-			column_remove(EVERYTHING3_PROPERTY_ID_PATH);
+			es_fatal(ES_ERROR_NO_IPC);
 		}
 		
-		// add filename column
-		if (!_es_no_default_filename_column)
+		if ((ls_path) && (!_es_pause) && (!_es_get_result_count) && (!_es_get_total_size))
 		{
-			if (!column_find(EVERYTHING3_PROPERTY_ID_FULL_PATH))
+			// falls back to a normal search with the folder filter.
+			if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
 			{
-				if (!column_find(EVERYTHING3_PROPERTY_ID_NAME))
+				if (_es_ipc3_ls_query(ls_path))
 				{
-					if (!column_find(EVERYTHING3_PROPERTY_ID_PATH))
-					{
-						column_t *filename_column;
-						
-						filename_column = column_add(EVERYTHING3_PROPERTY_ID_FULL_PATH);
-						
-						if (_es_export_type != _ES_EXPORT_TYPE_NONE)
-						{
-							if (_es_export_type != _ES_EXPORT_TYPE_NOFORMAT)
-							{
-								// move KEY to first column.
-								column_remove_order(filename_column);
-								column_insert_order_at_start(filename_column);
-							}
-						}
-					}
+					goto exit;
 				}
 			}
 		}
-
-		// fix search filter
-		if (filter_wcbuf.length_in_wchars)
+		
+		if ((sample_size) && (!_es_pause) && (!_es_get_result_count) && (!_es_get_total_size))
 		{
-			wchar_buf_t new_search_wcbuf;
-
-			wchar_buf_init(&new_search_wcbuf);
+			if (!is_sample_seed)
+			{
+				// a different sample each run.
+				sample_seed = ((ES_UINT64)GetCurrentProcessId() << 32) | GetTickCount();
+			}
 			
-			wchar_buf_cat_utf8_string(&new_search_wcbuf,"< ");
-
-			wchar_buf_cat_wchar_string_n(&new_search_wcbuf,filter_wcbuf.buf,filter_wcbuf.length_in_wchars);
-			wchar_buf_cat_utf8_string(&new_search_wcbuf," > < ");
-			wchar_buf_cat_wchar_string_n(&new_search_wcbuf,search_wcbuf.buf,search_wcbuf.length_in_wchars);
-			if (_es_is_unbalanced_quotes(new_search_wcbuf.buf))
+			// the sample is only kept while reading an ipc3 reply.
+			if ((es_ipc_version & ES_IPC_VERSION_FLAG_IPC3) && (_es_ipc3_sample_query(sample_size,sample_seed)))
 			{
-				// using a filter and a search without a trailing quote breaks the search
-				// as it makes the trailing > literal.
-				// add a terminating quote:
-				wchar_buf_cat_utf8_string(&new_search_wcbuf,"\"");
+				goto exit;
 			}
-
-			wchar_buf_cat_utf8_string(&new_search_wcbuf," >");
-
-			wchar_buf_copy_wchar_string_n(&search_wcbuf,new_search_wcbuf.buf,new_search_wcbuf.length_in_wchars);
 			
-			wchar_buf_kill(&new_search_wcbuf);
+			es_fatal(ES_ERROR_NO_IPC);
 		}
 		
-		if (_es_get_result_count)
-		{
-			// no columns.
-			column_clear_all();
-
-			// don't show any results.
-			_es_max_results = 0;
-			
-			// reset sort to name ascending.
-			secondary_sort_clear_all();
-			_es_primary_sort_property_id = EVERYTHING3_PROPERTY_ID_NAME;
-			_es_primary_sort_ascending = 1;
-		}
-
-		if (_es_get_total_size)
+		if ((partition_count > 1) && (!_es_pause) && (!_es_get_result_count) && (!_es_get_total_size) && (!_es_tee_start) && (_es_shard_type == _ES_SHARD_TYPE_NONE))
 		{
-			// just request size column.
-			column_clear_all();
-			column_add(EVERYTHING3_PROPERTY_ID_SIZE);
-			
-			// reset sort to name ascending.
-			secondary_sort_clear_all();
-			_es_primary_sort_property_id = EVERYTHING3_PROPERTY_ID_NAME;
-			_es_primary_sort_ascending = 1;
+			// falls back to a single connection.
+			if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
+			{
+				if (_es_ipc3_partitioned_query(partition_count))
+				{
+					goto exit;
+				}
+			}
 		}
-
-		// get the everything window.
-		// this will handle timeouts.
-		_es_everything_hwnd = _es_find_ipc_window();
 		
-		// try IPC3, ipc3 query will not block and
-		// will fail immediately.
-		// we don't need the ipc window for ipc3.
 		if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
 		{
 			// we know if the everything ipc window is created, then the pipe server is also created.
@@ -9236,6 +17618,12 @@ retry_read_journal:
 			}
 		}
 		
+		if ((_es_tee_start) || (_es_shard_type != _ES_SHARD_TYPE_NONE))
+		{
+			// extra exports and shards are only written from an ipc3 reply.
+			es_fatal(ES_ERROR_NO_IPC);
+		}
+		
 		if (_es_everything_hwnd)
 		{
 			if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC2)
@@ -9300,15 +17688,101 @@ exit:
 	column_clear_all();
 	column_color_clear_all();
 	column_width_clear_all();
+	column_attribute_clear_all();
 	property_unknown_clear_all();
+	
+	if (diff_since_filename)
+	{
+		mem_free(diff_since_filename);
+	}
+
+	{
+		SIZE_T folder_index;
+		
+		for(folder_index=0;folder_index<get_folder_size_array.count;folder_index++)
+		{
+			mem_free(get_folder_size_array.indexes[folder_index]);
+		}
+	}
+
+	if (get_folder_size_list_filename)
+	{
+		mem_free(get_folder_size_list_filename);
+	}
+
+	if (view_filename)
+	{
+		mem_free(view_filename);
+	}
+
+	if (ls_path)
+	{
+		mem_free(ls_path);
+	}
+
+	if (instance_list)
+	{
+		mem_free(instance_list);
+	}
+	
+	if (group_by_key)
+	{
+		mem_free(group_by_key);
+	}
+	
+	if (group_by_agg_list)
+	{
+		mem_free(group_by_agg_list);
+	}
+
+	if (batch_filename)
+	{
+		mem_free(batch_filename);
+	}
+
+	if (batch_delimiter)
+	{
+		mem_free(batch_delimiter);
+	}
+
+	if (result_cache_path)
+	{
+		_es_result_cache_path = NULL;
+		
+		mem_free(result_cache_path);
+	}
+
+	if (file_list_include_only_files)
+	{
+		mem_free(file_list_include_only_files);
+	}
+
+	if (file_list_exclude_files)
+	{
+		mem_free(file_list_exclude_files);
+	}
+
+	if (file_list_include_only_folders)
+	{
+		mem_free(file_list_include_only_folders);
+	}
+
+	if (file_list_exclude_folders)
+	{
+		mem_free(file_list_exclude_folders);
+	}
 
 	if (_es_run_history_data)
 	{
 		mem_free(_es_run_history_data);
 	}
 
+	_es_tee_close_all();
+	
 	_es_flush_export_buffer();
 	
+	_es_compress_finish();
+	
 	if (_es_export_buf)
 	{
 		mem_free(_es_export_buf);
@@ -9324,6 +17798,7 @@ exit:
 		es_fatal(_es_ret);
 	}
 
+	array_kill(&get_folder_size_array);
 	array_kill(&local_property_unknown_array);
 	array_kill(&local_secondary_sort_array);
 	array_kill(&local_column_array);
@@ -9335,6 +17810,7 @@ exit:
 	pool_kill(&local_column_width_pool);
 	pool_kill(&local_column_color_pool);
 	wchar_buf_kill(&local_locale_decimal_wcbuf);
+	wchar_buf_kill(&local_export_filename_wcbuf);
 	wchar_buf_kill(&local_locale_thousand_wcbuf);
 	wchar_buf_kill(&local_instance_name_wcbuf);
 	wchar_buf_kill(&filter_wcbuf);
@@ -9368,12 +17844,14 @@ static void _es_get_window_classname(wchar_buf_t *wcbuf)
 static HWND _es_find_ipc_window(void)
 {
 	DWORD tickstart;
+	DWORD backoff;
 	wchar_buf_t window_class_wcbuf;
 	HWND ret;
 
 	wchar_buf_init(&window_class_wcbuf);
 	
 	tickstart = GetTickCount();
+	backoff = _ES_WAIT_MIN_BACKOFF;
 
 	_es_get_window_classname(&window_class_wcbuf);
 
@@ -9432,13 +17910,15 @@ wait:
 			debug_error_printf("FindWindow failed %u\n",GetLastError());
 
 			// the everything window was not found.
-			// we can optionally RegisterWindowMessage("EVERYTHING_IPC_CREATED") and 
-			// wait for Everything to post this message to all top level windows when its up and running.
 			es_fatal(ES_ERROR_NO_IPC);
 		}
 
+		// Everything posts EVERYTHING_IPC_CREATED to all top level windows when its up and running.
+		// this will wake us up as soon as the window is created.
+		_es_register_ipc_created_message();
+
 		// try again..
-		Sleep(10);
+		backoff = _es_wait_backoff(tickstart,backoff);
 	}
 	
 	wchar_buf_kill(&window_class_wcbuf);
@@ -9446,15 +17926,60 @@ wait:
 	return ret;
 }
 
-// find the Everything IPC window
+// wait for the Everything database to load.
 static void _es_wait_for_db_loaded(void)
 {
 	DWORD tickstart;
+	DWORD backoff;
 	wchar_buf_t window_class_wcbuf;
 
 	wchar_buf_init(&window_class_wcbuf);
 	
 	tickstart = GetTickCount();
+	backoff = _ES_WAIT_MIN_BACKOFF;
+	
+	// ask the pipe server first.
+	// we can keep one pipe connection open for the whole wait, 
+	// instead of finding the window and sending three messages every time we check.
+	if (es_ipc_version & ES_IPC_VERSION_FLAG_IPC3)
+	{
+		HANDLE pipe_handle;
+		
+		pipe_handle = ipc3_connect_pipe();
+		if (pipe_handle != INVALID_HANDLE_VALUE)
+		{
+			for(;;)
+			{
+				BOOL is_db_loaded;
+				
+				if (!ipc3_is_db_loaded(pipe_handle,&is_db_loaded))
+				{
+					// Everything 1.4 or the pipe was closed.
+					// fall back to the IPC window.
+					break;
+				}
+				
+				if (is_db_loaded)
+				{
+					CloseHandle(pipe_handle);
+
+					goto exit;
+				}
+				
+				backoff = _es_wait_backoff(tickstart,backoff);
+				
+				if (es_timeout)
+				{
+					if (GetTickCount() - tickstart > es_timeout)
+					{
+						es_fatal(ES_ERROR_NO_IPC);
+					}
+				}
+			}
+			
+			CloseHandle(pipe_handle);
+		}
+	}
 	
 	_es_get_window_classname(&window_class_wcbuf);
 	
@@ -9497,7 +18022,7 @@ static void _es_wait_for_db_loaded(void)
 		}
 		
 		// try again..
-		Sleep(10);
+		backoff = _es_wait_backoff(tickstart,backoff);
 		
 		tick = GetTickCount();
 		
@@ -9506,25 +18031,27 @@ static void _es_wait_for_db_loaded(void)
 			if (tick - tickstart > es_timeout)
 			{
 				// the everything window was not found.
-				// we can optionally RegisterWindowMessage("EVERYTHING_IPC_CREATED") and 
-				// wait for Everything to post this message to all top level windows when its up and running.
 				es_fatal(ES_ERROR_NO_IPC);
 			}
 		}
 	}
+
+exit:
 	
 	wchar_buf_kill(&window_class_wcbuf);
 }
 
-// find the Everything IPC window
+// wait for the Everything database to finish saving.
 static void _es_wait_for_db_not_busy(void)
 {
 	DWORD tickstart;
+	DWORD backoff;
 	wchar_buf_t window_class_wcbuf;
 
 	wchar_buf_init(&window_class_wcbuf);
 	
 	tickstart = GetTickCount();
+	backoff = _ES_WAIT_MIN_BACKOFF;
 	
 	_es_get_window_classname(&window_class_wcbuf);
 	
@@ -9568,7 +18095,8 @@ static void _es_wait_for_db_not_busy(void)
 		}
 		
 		// try again..
-		Sleep(10);
+		// there's no notification when the db is no longer busy.
+		backoff = _es_wait_backoff(tickstart,backoff);
 		
 		tick = GetTickCount();
 		
@@ -9577,8 +18105,6 @@ static void _es_wait_for_db_not_busy(void)
 			if (tick - tickstart > es_timeout)
 			{
 				// the everything window was not found.
-				// we can optionally RegisterWindowMessage("EVERYTHING_IPC_CREATED") and 
-				// wait for Everything to post this message to all top level windows when its up and running.
 				es_fatal(ES_ERROR_NO_IPC);
 			}
 		}
@@ -9587,6 +18113,87 @@ static void _es_wait_for_db_not_busy(void)
 	wchar_buf_kill(&window_class_wcbuf);
 }
 
+// register for the EVERYTHING_IPC_CREATED notification.
+// Everything sends this message to all top level windows when it is up and running.
+// the reply window is a top level window, so we can use it to receive the notification.
+static void _es_register_ipc_created_message(void)
+{
+	if (!_es_ipc_created_message)
+	{
+		_es_get_reply_window();
+		
+		_es_ipc_created_message = RegisterWindowMessage(EVERYTHING_IPC_CREATED);
+		
+		// allow the Everything window to notify us if
+		// the Everything window is running as normal user and we are running as admin.
+		if ((_es_ipc_created_message) && (_es_pChangeWindowMessageFilterEx))
+		{
+			_es_pChangeWindowMessageFilterEx(_es_reply_hwnd,_es_ipc_created_message,_ES_MSGFLT_ALLOW,0);
+		}
+	}
+}
+
+// wait for backoff milliseconds or until a message arrives, whichever comes first.
+// never waits past es_timeout.
+// returns the next backoff, which is doubled up to _ES_WAIT_MAX_BACKOFF.
+// the backoff is reset when Everything tells us it has started.
+static DWORD _es_wait_backoff(DWORD tickstart,DWORD backoff)
+{
+	DWORD wait_time;
+	
+	wait_time = backoff;
+	
+	if (es_timeout)
+	{
+		DWORD elapsed;
+		
+		elapsed = GetTickCount() - tickstart;
+		
+		if (elapsed >= es_timeout)
+		{
+			wait_time = 0;
+		}
+		else
+		if (es_timeout - elapsed < wait_time)
+		{
+			wait_time = es_timeout - elapsed;
+		}
+	}
+	
+	if (_es_reply_hwnd)
+	{
+		MSG msg;
+		
+		MsgWaitForMultipleObjects(0,NULL,FALSE,wait_time,QS_ALLINPUT);
+
+		while(PeekMessage(&msg,NULL,0,0,PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+	}
+	else
+	{
+		Sleep(wait_time);
+	}
+	
+	if (_es_ipc_created)
+	{
+		_es_ipc_created = 0;
+
+		// Everything just started.
+		// check again quickly.
+		return _ES_WAIT_MIN_BACKOFF;
+	}
+	
+	if (backoff < _ES_WAIT_MAX_BACKOFF / 2)
+	{
+		return backoff * 2;
+	}
+	
+	return _ES_WAIT_MAX_BACKOFF;
+}
+
 static const wchar_t *_es_parse_command_line_option_start(const wchar_t *s)
 {
 	const wchar_t *argv_p;
@@ -12912,9 +21519,17 @@ start:
 						}
 					}
 				}
+				else
+				{
+					// the console input handle is signaled when there is unread input.
+					WaitForSingleObject(std_input_handle,INFINITE);
+				}
+			}
+			else
+			{
+				// not a console, there's no key to wait for.
+				goto exit;
 			}
-	
-			Sleep(1);
 		}
 		
 		// clip start index.
@@ -13207,6 +21822,7 @@ static BOOL _es_read_journal_callback_proc(_es_read_journal_t *param,_ipc3_journ
 	_es_output_line_begin(is_first);
 	
 	_es_output_column = column_order_start;
+	_es_output_column_attribute = column_attribute_array;
 	
 	while(_es_output_column)
 	{
@@ -13372,6 +21988,7 @@ static BOOL _es_read_journal_callback_proc(_es_read_journal_t *param,_ipc3_journ
 		}
 
 		_es_output_column = _es_output_column->order_next;
+		_es_output_column_attribute++;
 	}
 
 	param->numitems++;
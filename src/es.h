@@ -35,6 +35,9 @@
 #define ES_ERROR_IPC_ERROR					7 // failed to send Everything IPC a query or bad IPC reply.
 #define ES_ERROR_NO_IPC						8 // NO Everything IPC window or pipe.
 #define ES_ERROR_NO_RESULTS					9 // No results found. Only set if -no-result-error is used
+#define ES_ERROR_RESULTS_CHANGED			10 // The index changed while reading results. Only set if -partitions is used
+#define ES_ERROR_WRITE_OUTPUT				11 // failed to write to stdout or the export file, the reader may have closed the pipe.
+#define ES_ERROR_DEADLINE_EXPIRED			12 // The deadline expired before all results were read. Only set if -deadline is used
 
 #define ES_UINT64_MAX		0xffffffffffffffffUI64
 #define ES_DWORD_MAX		0xffffffff
@@ -65,6 +68,7 @@ typedef BYTE ES_UTF8;
 #include "mem.h"
 #include "pool.h"
 #include "array.h"
+#include "hash.h"
 #include "unicode.h"
 #include "wchar_string.h"
 #include "wchar_buf.h"
@@ -74,12 +78,23 @@ typedef BYTE ES_UTF8;
 #include "property.h"
 #include "property_unknown.h"
 #include "column.h"
+#include "column_attribute.h"
 #include "column_color.h"
 #include "column_width.h"
 #include "secondary_sort.h"
+#include "diff.h"
+#include "filename_filter.h"
+#include "filelist.h"
+#include "group.h"
+#include "rollup.h"
+#include "sample.h"
+#include "sketch.h"
+#include "deflate.h"
+#include "compress.h"
 #include "os.h"
 #include "debug.h"
 #include "ipc3.h"
+#include "result_cache.h"
 
 void DECLSPEC_NORETURN es_fatal(int error_code);
 
@@ -1,401 +1,2029 @@
 
-// TODO
-/*
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// file list
+// walks folders on disk and writes an EFU file list.
+// folders are walked in parallel by a pool of worker threads.
+// each worker owns a deque of pending folders and steals from the other workers when its deque is empty.
+// found items are packed into batches and passed to the writer through a bounded queue.
+// the writer writes and frees each batch as soon as it arrives, so memory use doesn't grow with the size of the tree.
+// an incremental update loads the previous file list and only enumerates folders whose date modified has changed.
+// excluded folders are never opened.
+
 #include "es.h"
 
-#define _FILELIST_ITEM_FILENAME(filelist_item)		((ES_UTF8 *)(((_filelist_item_t *)(filelist_item)) + 1))
+#ifndef FIND_FIRST_EX_LARGE_FETCH
+#define FIND_FIRST_EX_LARGE_FETCH		2
+#endif
 
-#define _FILELIST_MAX_DEPTH		64
-	
-#pragma pack (push,1)
+// FindExInfoBasic is missing from older SDKs.
+// skips the short name lookup.
+#define _FILELIST_FIND_EX_INFO_BASIC	((FINDEX_INFO_LEVELS)1)
+
+#define _FILELIST_MAX_DEPTH				64
+#define _FILELIST_MAX_THREADS			32
+#define _FILELIST_BATCH_SIZE			65536
+#define _FILELIST_MAX_QUEUED_BATCHES	64
+#define _FILELIST_WRITE_BUF_SIZE		65536
+#define _FILELIST_READ_BUF_SIZE			65536
+#define _FILELIST_MAX_FIELD_LEN			131072
 
-// an editor item.
+// _filelist_filter_item flags.
+#define _FILELIST_FILTER_ADD			0x00000001
+#define _FILELIST_FILTER_WALK			0x00000002
+
+#define _FILELIST_ITEM_FILENAME(item)	((ES_UTF8 *)(((_filelist_item_t *)(item)) + 1))
+#define _FILELIST_BATCH_DATA(batch)		((BYTE *)(((_filelist_batch_t *)(batch)) + 1))
+#define _FILELIST_FOLDER_PATH(folder)	((wchar_t *)(((_filelist_folder_t *)(folder)) + 1))
+
+// a found file or folder.
+// packed into a batch.
 typedef struct _filelist_item_s
 {
-	struct _filelist_item_s *next;
-	
 	ES_UINT64 size;
 	ES_UINT64 date_created;
 	ES_UINT64 date_modified;
 	DWORD attributes;
-	BYTE flags;
+	
+	// length of the filename in bytes.
+	DWORD filename_len;
 
-	// NULL terminated filename follows.
+	// UTF-8 full path follows, null terminated and padded to 8 bytes.
+	// ES_UTF8 filename[filename_len+1];
 	
 }_filelist_item_t;
 
-#pragma pack (pop)
+// a block of packed items.
+typedef struct _filelist_batch_s
+{
+	struct _filelist_batch_s *next;
+	
+	// used bytes after the header.
+	SIZE_T used_size;
+	
+	// allocated bytes after the header.
+	SIZE_T allocated_size;
+	
+	// _filelist_item_t items follow.
+	
+}_filelist_batch_t;
+
+// a pending folder.
+typedef struct _filelist_folder_s
+{
+	struct _filelist_folder_s *next;
+	struct _filelist_folder_s *prev;
+	SIZE_T depth;
+	SIZE_T path_len;
+	
+	// non-zero if this folder or a parent matched the include only folders filter.
+	// always non-zero when there is no include only folders filter.
+	int is_included;
+	
+	// the item from the previous file list when the parent folder was reused.
+	// the folder item is added when the folder is checked so its attributes are current.
+	// NULL if the folder item has already been added.
+	const _filelist_item_t *old_item;
+	
+	// wchar full path follows, null terminated.
+	// wchar_t path[path_len+1];
+	
+}_filelist_folder_t;
+
+// a child item of a folder from the previous file list.
+typedef struct _filelist_old_child_s
+{
+	struct _filelist_old_child_s *next;
+	const _filelist_item_t *item;
+	
+}_filelist_old_child_t;
+
+// a folder from the previous file list.
+typedef struct _filelist_old_folder_s
+{
+	// must be first.
+	// the FNV-1a hash of the folder path.
+	hash_entry_t hash_entry;
+	
+	const _filelist_item_t *item;
+	_filelist_old_child_t *child_start;
+	
+}_filelist_old_folder_t;
+
+// the previous file list, indexed by folder path.
+// read only once the walk starts.
+typedef struct _filelist_old_s
+{
+	// the loaded items.
+	_filelist_batch_t *batch_start;
+	
+	// folders and children.
+	pool_t pool;
+	
+	// folders by path.
+	hash_table_t hash_table;
+	
+}_filelist_old_t;
+
+// buffered input file.
+typedef struct _filelist_reader_s
+{
+	HANDLE file_handle;
+	BYTE *buf;
+	BYTE *p;
+	SIZE_T avail;
+	int is_eof;
+	
+	// the last field read, null terminated.
+	ES_UTF8 *field_buf;
+	SIZE_T field_len;
+	
+}_filelist_reader_t;
+
+// a walker thread.
+typedef struct _filelist_worker_s
+{
+	struct _filelist_s *filelist;
+	HANDLE thread_handle;
+	
+	// pending folders.
+	// the owner pushes and pops at the end, thieves take from the start.
+	CRITICAL_SECTION folder_cs;
+	_filelist_folder_t *folder_start;
+	_filelist_folder_t *folder_last;
+	
+	// the batch we are currently filling.
+	_filelist_batch_t *batch;
+	
+	// our index in worker_array.
+	SIZE_T index;
+	
+}_filelist_worker_t;
 
-// a list of filenames.
 typedef struct _filelist_s
 {
-	pool_t data_pool;
-	_filelist_item_t *item_start;
-	_filelist_item_t *item_last;
-//	filename_filter_t include_only_folders_filename_filter;
-//	filename_filter_t exclude_folders_filename_filter;
-//	filename_filter_t include_only_files_filename_filter;
-//	filename_filter_t exclude_files_filename_filter;
-	int no_folders;
-	int no_files;
-	int no_subfolders;
-		
+	_filelist_worker_t *worker_array;
+	SIZE_T worker_count;
+	
+	// the previous file list for incremental updates.
+	// NULL if every folder is enumerated.
+	const _filelist_old_t *old;
+	
+	// read only once the walk starts.
+	filename_filter_t include_only_files_filter;
+	filename_filter_t exclude_files_filter;
+	filename_filter_t include_only_folders_filter;
+	filename_filter_t exclude_folders_filter;
+	
+	// non-zero if any filter is set.
+	int is_filter;
+	
+	// the number of queued or in-progress folders.
+	// the walk is complete when this reaches zero.
+	volatile LONG pending_folder_count;
+	
+	// the number of workers that have not exited.
+	volatile LONG running_worker_count;
+	
+	// non-zero when the walk is complete.
+	volatile LONG is_done;
+	
+	// released once for each queued folder.
+	HANDLE folder_semaphore;
+	
+	// bounded queue of filled batches.
+	CRITICAL_SECTION batch_cs;
+	_filelist_batch_t *batch_start;
+	_filelist_batch_t *batch_last;
+	
+	// released once for each queued batch and once when the last worker exits.
+	HANDLE batch_queued_semaphore;
+	
+	// the number of free slots in the batch queue.
+	HANDLE batch_free_semaphore;
+	
 }_filelist_t;
 
-static void _filelist_add_folder_from_path_recurse(_filelist_t *e,const wchar_t *path,uintptr_t path_len,uintptr_t depth);
-static void _filelist_add_item(_filelist_t *e,const ES_UTF8 *filename,ES_UINT64 size,ES_UINT64 date_created,ES_UINT64 date_modified);
-static int _filelist_startwith(const wchar_t *s,const wchar_t *substring);
+// buffered output file.
+typedef struct _filelist_writer_s
+{
+	HANDLE file_handle;
+	BYTE *buf;
+	BYTE *p;
+	SIZE_T avail;
+	int is_error;
+	
+	// scratch buffer for formatting a row.
+	utf8_buf_t row_cbuf;
+	
+}_filelist_writer_t;
+
+static DWORD __stdcall _filelist_worker_thread_proc(void *param);
+static void _filelist_enum_folder(_filelist_worker_t *worker,_filelist_folder_t *folder);
+static BOOL _filelist_enum_old_folder(_filelist_worker_t *worker,_filelist_folder_t *folder);
+static void _filelist_push_folder(_filelist_worker_t *worker,const wchar_t *path,SIZE_T path_len,SIZE_T depth,int is_included,const _filelist_item_t *old_item);
+static DWORD _filelist_filter_item(const _filelist_t *filelist,const _filelist_folder_t *parent,const wchar_t *filename,SIZE_T filename_len,DWORD attributes,wchar_buf_t *lowercase_wcbuf,int *out_is_included);
+static _filelist_folder_t *_filelist_pop_folder(_filelist_worker_t *worker);
+static _filelist_item_t *_filelist_worker_alloc_item(_filelist_worker_t *worker,SIZE_T filename_len);
+static void _filelist_add_item(_filelist_worker_t *worker,const wchar_t *filename,DWORD attributes,ES_UINT64 size,ES_UINT64 date_created,ES_UINT64 date_modified);
+static void _filelist_add_old_item(_filelist_worker_t *worker,const _filelist_item_t *old_item);
+static _filelist_batch_t *_filelist_batch_alloc(SIZE_T min_size);
+static _filelist_item_t *_filelist_batch_alloc_item(_filelist_batch_t **batch_p,SIZE_T filename_len);
+static void _filelist_batch_add_item(_filelist_batch_t **batch_p,const wchar_t *filename,SIZE_T filename_len,DWORD attributes,ES_UINT64 size,ES_UINT64 date_created,ES_UINT64 date_modified);
+static void _filelist_free_batch_list(_filelist_batch_t *batch_start);
+static void _filelist_queue_batch(_filelist_t *filelist,_filelist_batch_t *batch);
+static _filelist_batch_t *_filelist_dequeue_batch(_filelist_t *filelist);
+static SIZE_T _filelist_get_item_size(SIZE_T filename_len);
+static ES_UINT64 _filelist_filetime_to_uint64(const FILETIME *ft);
+static BOOL _filelist_startwith(const ES_UTF8 *s,const ES_UTF8 *substring);
+static void _filelist_writer_write(_filelist_writer_t *writer,const void *data,SIZE_T size);
+static void _filelist_writer_flush(_filelist_writer_t *writer);
+static void _filelist_writer_write_utf8_string(_filelist_writer_t *writer,const ES_UTF8 *s);
+static void _filelist_writer_write_item(_filelist_writer_t *writer,const _filelist_item_t *item,SIZE_T path_len,int folder_append_path_separator);
+static void _filelist_writer_write_batch(_filelist_writer_t *writer,const _filelist_batch_t *batch,SIZE_T path_len,int folder_append_path_separator);
+static void _filelist_walk(_filelist_t *filelist,_filelist_writer_t *writer,const wchar_t *filename,const wchar_t *path_list,int folder_append_path_separator,int relative_paths);
+static BOOL _filelist_old_load(_filelist_old_t *old,const wchar_t *filename);
+static void _filelist_old_build_index(_filelist_old_t *old);
+static _filelist_old_folder_t *_filelist_old_find_folder(const _filelist_old_t *old,const ES_UTF8 *path,SIZE_T path_len);
+static void _filelist_old_kill(_filelist_old_t *old);
+static int _filelist_reader_getc(_filelist_reader_t *reader);
+static int _filelist_reader_read_field(_filelist_reader_t *reader);
+static ES_UINT64 _filelist_parse_uint64(const ES_UTF8 *s);
+static BOOL _filelist_is_equal_path(const ES_UTF8 *a,const ES_UTF8 *b,SIZE_T len);
+static void _filelist_get_base_path(const wchar_t *filename,utf8_buf_t *out_cbuf);
+static void _filelist_cat_uint64(utf8_buf_t *cbuf,ES_UINT64 value);
+
+// non-zero if FindFirstFileEx doesn't support FindExInfoBasic or FIND_FIRST_EX_LARGE_FETCH (before Windows 7).
+static volatile LONG _filelist_is_find_ex_basic_unsupported = 0;
 
-int filelist_create(const wchar_t *filename,const wchar_t *path,int folder_append_path_separator,int no_folders,int no_files,int no_subfolders,const wchar_t *include_only_folders,const wchar_t *exclude_folders,const wchar_t *include_only_files,const wchar_t *exclude_files)
+// create an EFU file list from the semicolon delimited list of folders in path_list.
+// the filters are semicolon delimited lists of wildcards and can be NULL.
+// set incremental to update an existing file list.
+// items in folders whose date modified has not changed are copied from the existing file list.
+// file size and date changes in these folders are not picked up.
+// returns TRUE if successful.
+// Otherwise, returns FALSE if the file list could not be written.
+BOOL filelist_create(const wchar_t *filename,const wchar_t *path_list,const wchar_t *include_only_files,const wchar_t *exclude_files,const wchar_t *include_only_folders,const wchar_t *exclude_folders,int folder_append_path_separator,int relative_paths,int incremental)
 {
-	int ret;
+	BOOL ret;
 	_filelist_t filelist;
+	_filelist_old_t old;
+	_filelist_writer_t writer;
 	
-	ret = 0;
+	ret = FALSE;
 	os_zero_memory(&filelist,sizeof(_filelist_t));
+	os_zero_memory(&old,sizeof(_filelist_old_t));
+	pool_init(&old.pool);
+	hash_table_init(&old.hash_table,0);
+	
+	filename_filter_init(&filelist.include_only_files_filter);
+	filename_filter_init(&filelist.exclude_files_filter);
+	filename_filter_init(&filelist.include_only_folders_filter);
+	filename_filter_init(&filelist.exclude_folders_filter);
+	
+	filename_filter_compile(&filelist.include_only_files_filter,include_only_files);
+	filename_filter_compile(&filelist.exclude_files_filter,exclude_files);
+	filename_filter_compile(&filelist.include_only_folders_filter,include_only_folders);
+	filename_filter_compile(&filelist.exclude_folders_filter,exclude_folders);
 	
-	pool_init(&filelist.data_pool);
+	if ((filelist.include_only_files_filter.count) || (filelist.exclude_files_filter.count) || (filelist.include_only_folders_filter.count) || (filelist.exclude_folders_filter.count))
+	{
+		filelist.is_filter = 1;
+	}
+	
+	// load the previous file list before starting the walk.
+	// a missing file list is not an error, every folder is enumerated.
+	if (incremental)
+	{
+		if (_filelist_old_load(&old,filename))
+		{
+			filelist.old = &old;
+		}
+	}
 
-//	filename_filter_init(&filelist.include_only_folders_filename_filter);
-//	filename_filter_init(&filelist.exclude_folders_filename_filter);
-//	filename_filter_init(&filelist.include_only_files_filename_filter);
-//	filename_filter_init(&filelist.exclude_files_filename_filter);
+	// open the output before the walk so nothing is walked if it can't be written.
+	writer.file_handle = os_create_file(filename);
 	
-//	filename_filter_compile(&filelist.include_only_folders_filename_filter,include_only_folders ? include_only_folders : "",1);
-//	filename_filter_compile(&filelist.exclude_folders_filename_filter,exclude_folders ? exclude_folders : "",1);
-//	filename_filter_compile(&filelist.include_only_files_filename_filter,include_only_files ? include_only_files : "",0);
-//	filename_filter_compile(&filelist.exclude_files_filename_filter,exclude_files ? exclude_files : "",0);
+	if (writer.file_handle != INVALID_HANDLE_VALUE)
+	{
+		writer.buf = mem_alloc(_FILELIST_WRITE_BUF_SIZE);
+		writer.p = writer.buf;
+		writer.avail = _FILELIST_WRITE_BUF_SIZE;
+		writer.is_error = 0;
+		utf8_buf_init(&writer.row_cbuf);
+		
+		_filelist_walk(&filelist,&writer,filename,path_list,folder_append_path_separator,relative_paths);
+		
+		_filelist_writer_flush(&writer);
+
+		if (!writer.is_error)
+		{
+			ret = TRUE;
+		}
 
-	filelist.no_folders = no_folders;
-	filelist.no_files = no_files;
-	filelist.no_subfolders = no_subfolders;
+		utf8_buf_kill(&writer.row_cbuf);
+		mem_free(writer.buf);
+		
+		CloseHandle(writer.file_handle);
+	}
 
+	_filelist_old_kill(&old);
 	
-	// recurse path
+	filename_filter_kill(&filelist.exclude_folders_filter);
+	filename_filter_kill(&filelist.include_only_folders_filter);
+	filename_filter_kill(&filelist.exclude_files_filter);
+	filename_filter_kill(&filelist.include_only_files_filter);
 	
-	{
-		utf8_buf_t item_cbuf;
-		utf8_buf_t path_cbuf;
-		const wchar_t *path_p;
+	return ret;
+}
 
-		utf8_buf_init(&item_cbuf);
-		utf8_buf_init(&path_cbuf);
+// walk the roots in path_list and write each batch as soon as it is found.
+// the relative path prefix is decided from the roots before any items are written.
+static void _filelist_walk(_filelist_t *filelist,_filelist_writer_t *writer,const wchar_t *filename,const wchar_t *path_list,int folder_append_path_separator,int relative_paths)
+{
+	_filelist_batch_t *root_batch;
+	utf8_buf_t base_cbuf;
+	SIZE_T path_len;
+	
+	InitializeCriticalSection(&filelist->batch_cs);
+	filelist->folder_semaphore = CreateSemaphore(NULL,0,0x7fffffff,NULL);
+	filelist->batch_queued_semaphore = CreateSemaphore(NULL,0,0x7fffffff,NULL);
+	filelist->batch_free_semaphore = CreateSemaphore(NULL,_FILELIST_MAX_QUEUED_BATCHES,_FILELIST_MAX_QUEUED_BATCHES,NULL);
+	
+	if ((!filelist->folder_semaphore) || (!filelist->batch_queued_semaphore) || (!filelist->batch_free_semaphore))
+	{
+		es_fatal(ES_ERROR_OUT_OF_MEMORY);
+	}
+	
+	// the walk is latency bound, so use more threads than processors.
+	{
+		SYSTEM_INFO system_info;
+		
+		GetSystemInfo(&system_info);
 		
-		path_p = path;
+		filelist->worker_count = safe_size_mul(system_info.dwNumberOfProcessors,2);
 		
-		while(*path_p)
+		if (filelist->worker_count < 2)
 		{
-			path_p = utf8_string_parse_c_item(path_p,&item_cbuf);
-			if (!path_p)
-			{
-				break;
-			}
+			filelist->worker_count = 2;
+		}
+		
+		if (filelist->worker_count > _FILELIST_MAX_THREADS)
+		{
+			filelist->worker_count = _FILELIST_MAX_THREADS;
+		}
+	}
+	
+	filelist->worker_array = mem_alloc(safe_size_mul(filelist->worker_count,sizeof(_filelist_worker_t)));
+	
+	// hold a pending reference while we queue the roots.
+	// so the workers can't finish before all the roots are queued.
+	filelist->pending_folder_count = 1;
+	
+	// start workers.
+	{
+		SIZE_T worker_index;
+		SIZE_T started_count;
+		
+		started_count = 0;
+		
+		for(worker_index=0;worker_index<filelist->worker_count;worker_index++)
+		{
+			_filelist_worker_t *worker;
+			DWORD thread_id;
 			
-			// uppercase drive letter
-			if ((item_cbuf.buf[0] >= 'a') && (item_cbuf.buf[0] <= 'z') && (item_cbuf.buf[1] == ':'))
-			{
-				item_cbuf.buf[0] = item_cbuf.buf[0] - 'a' + 'A';
-			}
+			worker = &filelist->worker_array[started_count];
+			
+			os_zero_memory(worker,sizeof(_filelist_worker_t));
+			
+			worker->filelist = filelist;
+			worker->index = started_count;
+			InitializeCriticalSection(&worker->folder_cs);
 			
-			utf8_buf_copy_no_trailing_path_separator(&path_cbuf,item_cbuf.buf);
+			// count before starting the thread, the thread decrements on exit.
+			InterlockedIncrement(&filelist->running_worker_count);
 			
-			utf8_buf_fix_path_separators(&path_cbuf);
+			worker->thread_handle = CreateThread(NULL,0,_filelist_worker_thread_proc,worker,0,&thread_id);
 			
-			// add this path.
-			// this makes it easy to update roots.
-			if (!no_folders)
+			if (!worker->thread_handle)
 			{
-				fileinfo_fd_t fd;
-
-				os_get_fd(path_cbuf.buf,&fd);
+				InterlockedDecrement(&filelist->running_worker_count);
+				DeleteCriticalSection(&worker->folder_cs);
 				
-				_filelist_add_item(&filelist,path_cbuf.buf,&fd);
+				break;
 			}
-
-			_filelist_add_folder_from_path_recurse(&filelist,path_cbuf.buf,path_cbuf.len,0);
+			
+			started_count++;
 		}
 		
-		utf8_buf_kill(&path_cbuf);
-		utf8_buf_kill(&item_cbuf);
+		if (!started_count)
+		{
+			es_fatal(ES_ERROR_OUT_OF_MEMORY);
+		}
+		
+		filelist->worker_count = started_count;
 	}
-
-	// save
+	
+	// add roots.
+	// the roots are added by the main thread before any walked items.
+	root_batch = _filelist_batch_alloc(0);
+	
 	{
-		output_stream_t f;
-
-		// create the file
-		if (output_stream_create_file(&f,filename))
+		wchar_buf_t item_wcbuf;
+		wchar_buf_t path_wcbuf;
+		const wchar_t *path_list_p;
+		SIZE_T root_index;
+		
+		wchar_buf_init(&item_wcbuf);
+		wchar_buf_init(&path_wcbuf);
+		
+		path_list_p = path_list;
+		root_index = 0;
+		
+		for(;;)
 		{
-			utf8_buf_t path_cbuf;
-			uintptr_t path_len;
+			WIN32_FILE_ATTRIBUTE_DATA fad;
+			wchar_buf_t root_wcbuf;
 			
-			output_stream_write_utf8_bom(&f);
+			path_list_p = wchar_string_parse_list_item(path_list_p,&item_wcbuf);
+			if (!path_list_p)
+			{
+				break;
+			}
 			
-			utf8_buf_init(&path_cbuf);
-			path_len = 0;
+			if (!item_wcbuf.length_in_wchars)
+			{
+				continue;
+			}
 			
-			utf8_buf_copy_utf8_string(&path_cbuf,filename);
+			os_get_full_path_name(item_wcbuf.buf,&path_wcbuf);
 			
-			// check filename prefix.
+			// fix path separators.
 			{
 				wchar_t *p;
-				wchar_t *last;
-
-				p = path_cbuf.buf;
-				last = 0;
+				
+				p = path_wcbuf.buf;
 				
 				while(*p)
 				{
-					if (*p == '\\')
-					{
-						// include the backslash.
-						path_len = (p - path_cbuf.buf + 1);
-					}
-					else
 					if (*p == '/')
 					{
-						// include the backslash.
-						path_len = (p - path_cbuf.buf + 1);
+						*p = '\\';
 					}
 					
 					p++;
 				}
-				
-				path_cbuf.buf[path_len] = 0;
 			}
-
-			// make all files relative to filename.
-			if (config_get_int_value(CONFIG_FILE_LIST_RELATIVE_PATHS))
+			
+			// remove trailing path separator.
+			while((path_wcbuf.length_in_wchars) && (path_wcbuf.buf[path_wcbuf.length_in_wchars - 1] == '\\'))
 			{
-				_filelist_item_t *item;
-				
-				item = filelist.item_start;
-				
-				while(item)
-				{
-					// free item
-					if (!_filelist_startwith(_FILELIST_ITEM_FILENAME(item),path_cbuf.buf))
-					{
-						path_len = 0;
-						break;
-					}
-					
-					item = item->next;
-				}
+				path_wcbuf.length_in_wchars--;
+				path_wcbuf.buf[path_wcbuf.length_in_wchars] = 0;
 			}
-			else
+			
+			// uppercase drive letter
+			if ((path_wcbuf.buf[0] >= 'a') && (path_wcbuf.buf[0] <= 'z') && (path_wcbuf.buf[1] == ':'))
 			{
-				path_len = 0;
+				path_wcbuf.buf[0] = path_wcbuf.buf[0] - 'a' + 'A';
 			}
-
-			// write header.
-			output_stream_write_printf(&f,(const utf8_t *)"Filename,Size,Date Modified,Date Created,Attributes\r\n");
-
+			
+			// GetFileAttributesEx needs the trailing path separator for drive roots.
+			wchar_buf_init(&root_wcbuf);
+			wchar_buf_copy_wchar_string_n(&root_wcbuf,path_wcbuf.buf,path_wcbuf.length_in_wchars);
+			wchar_buf_cat_path_separator(&root_wcbuf);
+			
+			if ((GetFileAttributesExW(root_wcbuf.buf,GetFileExInfoStandard,&fad)) && (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
 			{
-				_filelist_item_t *item;
+				// add this path.
+				// this makes it easy to update roots.
+				_filelist_batch_add_item(&root_batch,path_wcbuf.buf,utf8_string_get_length_in_bytes_from_wchar_string(path_wcbuf.buf),fad.dwFileAttributes,ES_UINT64_MAX,_filelist_filetime_to_uint64(&fad.ftCreationTime),_filelist_filetime_to_uint64(&fad.ftLastWriteTime));
 				
-				item = filelist.item_start;
+				// spread the roots over the workers.
+				// the roots are not filtered.
+				_filelist_push_folder(&filelist->worker_array[root_index % filelist->worker_count],path_wcbuf.buf,path_wcbuf.length_in_wchars,0,filelist->include_only_folders_filter.count ? 0 : 1,NULL);
 				
-				while(item)
-				{
-					// filename
-					if ((folder_append_path_separator) && (item->fd.attributes & FILE_ATTRIBUTE_DIRECTORY))
-					{
-						output_stream_write_csv_path_with_trailing_path_separator(&f,_FILELIST_ITEM_FILENAME(item) + path_len);
-					}
-					else
-					{
-						output_stream_write_csv_string(&f,_FILELIST_ITEM_FILENAME(item) + path_len);
-					}
-					
-					output_stream_write_byte(&f,',');
-					
-					// size
-					if (item->fd.size != QWORD_MAX)
-					{
-						output_stream_write_printf(&f,(const utf8_t *)"%I64u",item->fd.size);
-					}
-					output_stream_write_byte(&f,',');
-					
-					// date modified
-					if (item->fd.date_modified & QWORD_MAX)
-					{
-						output_stream_write_printf(&f,(const utf8_t *)"%I64u",item->fd.date_modified);
-					}
-					output_stream_write_byte(&f,',');
-					
-					// date created.
-					if (item->fd.date_created & QWORD_MAX)
-					{
-						output_stream_write_printf(&f,(const utf8_t *)"%I64u",item->fd.date_created);
-					}
-					
-					// attributes
-					output_stream_write_printf(&f,(const utf8_t *)",%u\r\n",item->fd.attributes);
-
-					item = item->next;
-				}
+				root_index++;
 			}
-
-			// close file.		
-			if (output_stream_close(&f))
+			else
 			{
-				ret = 1;
+				debug_error_printf("skipping root %S\n",path_wcbuf.buf);
 			}
-			else
+			
+			wchar_buf_kill(&root_wcbuf);
+		}
+		
+		wchar_buf_kill(&path_wcbuf);
+		wchar_buf_kill(&item_wcbuf);
+	}
+	
+	// release our pending reference.
+	if (InterlockedDecrement(&filelist->pending_folder_count) == 0)
+	{
+		// nothing to walk.
+		filelist->is_done = 1;
+		
+		ReleaseSemaphore(filelist->folder_semaphore,(LONG)filelist->worker_count,NULL);
+	}
+	
+	// make all files relative to filename.
+	// every item is below a root, so every item starts with the path if every root does.
+	utf8_buf_init(&base_cbuf);
+	path_len = 0;
+	
+	if (relative_paths)
+	{
+		BYTE *item_p;
+		BYTE *item_end;
+		
+		_filelist_get_base_path(filename,&base_cbuf);
+		
+		path_len = base_cbuf.length_in_bytes;
+		
+		item_p = _FILELIST_BATCH_DATA(root_batch);
+		item_end = item_p + root_batch->used_size;
+		
+		while(item_p < item_end)
+		{
+			if (!_filelist_startwith(_FILELIST_ITEM_FILENAME(item_p),base_cbuf.buf))
 			{
-				// failed to export
-				ui_task_dialog_show(0,MB_OK|MB_ICONERROR,localization_get_string(LOCALIZATION_EVERYTHING),NULL,localization_get_string(LOCALIZATION_EXPORT_WRITE_FAILED),filename);
+				path_len = 0;
+				
+				break;
 			}
+			
+			item_p += _filelist_get_item_size(((_filelist_item_t *)item_p)->filename_len);
+		}
+	}
+	
+	// UTF-8 BOM
+	_filelist_writer_write(writer,"\xEF\xBB\xBF",3);
 
-			utf8_buf_kill(&path_cbuf);
+	// write header.
+	_filelist_writer_write_utf8_string(writer,FILELIST_HEADER);
+	
+	// the roots are written first.
+	_filelist_writer_write_batch(writer,root_batch,path_len,folder_append_path_separator);
+	
+	mem_free(root_batch);
+	
+	// write batches as they are found.
+	// this frees a slot in the queue for the workers.
+	for(;;)
+	{
+		_filelist_batch_t *batch;
+		
+		batch = _filelist_dequeue_batch(filelist);
+		if (!batch)
+		{
+			// all workers have exited.
+			break;
 		}
-		else
+		
+		_filelist_writer_write_batch(writer,batch,path_len,folder_append_path_separator);
+		
+		mem_free(batch);
+	}
+	
+	// wait for workers.
+	{
+		SIZE_T worker_index;
+		
+		for(worker_index=0;worker_index<filelist->worker_count;worker_index++)
 		{
-			// Message
-			ui_task_dialog_show(0,MB_OK|MB_ICONERROR,localization_get_string(LOCALIZATION_EVERYTHING),NULL,localization_get_string(LOCALIZATION_EXPORT_CREATEFILE_FAILED),filename);
+			WaitForSingleObject(filelist->worker_array[worker_index].thread_handle,INFINITE);
+			
+			CloseHandle(filelist->worker_array[worker_index].thread_handle);
+			DeleteCriticalSection(&filelist->worker_array[worker_index].folder_cs);
 		}
 	}
-
-	filename_filter_kill(&filelist.include_only_folders_filename_filter);
-	filename_filter_kill(&filelist.exclude_folders_filename_filter);
-	filename_filter_kill(&filelist.include_only_files_filename_filter);
-	filename_filter_kill(&filelist.exclude_files_filename_filter);
 	
-	// free items.
-	pool_kill(&filelist.data_pool);
+	utf8_buf_kill(&base_cbuf);
 	
-	return ret;
+	mem_free(filelist->worker_array);
+	
+	CloseHandle(filelist->batch_free_semaphore);
+	CloseHandle(filelist->batch_queued_semaphore);
+	CloseHandle(filelist->folder_semaphore);
+	DeleteCriticalSection(&filelist->batch_cs);
 }
 
-static int _filelist_startwith(const utf8_t *s,const utf8_t *substring)
+// write all the items in a batch.
+static void _filelist_writer_write_batch(_filelist_writer_t *writer,const _filelist_batch_t *batch,SIZE_T path_len,int folder_append_path_separator)
 {
-	const utf8_t *sp;
-	const utf8_t *ssp;
+	const BYTE *item_p;
+	const BYTE *item_end;
 	
-	sp = s;
-	ssp = substring;
+	item_p = _FILELIST_BATCH_DATA(batch);
+	item_end = item_p + batch->used_size;
 	
-	while(*ssp)
+	while(item_p < item_end)
 	{
-		if (*sp != *ssp) return 0;
+		_filelist_writer_write_item(writer,(const _filelist_item_t *)item_p,path_len,folder_append_path_separator);
 
-		sp++;
-		ssp++;
+		item_p += _filelist_get_item_size(((const _filelist_item_t *)item_p)->filename_len);
 	}
-	
-	return 1;
 }
 
-static void _filelist_add_item(_filelist_t *filelist,const utf8_t *filename,fileinfo_fd_t *fd)
+static DWORD __stdcall _filelist_worker_thread_proc(void *param)
 {
-	_filelist_item_t *item;
-	uintptr_t len;
-	uintptr_t item_size;
-
-	len = utf8_string_get_length_in_bytes(filename);
-
-	// alloc
-	item_size = sizeof(_filelist_item_t);
-	item_size = safe_uintptr_add(item_size,len);
-	item_size = safe_uintptr_add_one(item_size);
+	_filelist_worker_t *worker;
+	_filelist_t *filelist;
 	
-	item = pool_alloc(&filelist->data_pool,item_size);
+	worker = param;
+	filelist = worker->filelist;
 	
-	// init
-	os_copy_memory(&item->fd,fd,sizeof(fileinfo_fd_t));
-
-	os_copy_memory(item+1,filename,len+1);
+	for(;;)
+	{
+		_filelist_folder_t *folder;
+		
+		// wait for a folder.
+		WaitForSingleObject(filelist->folder_semaphore,INFINITE);
+		
+		if (filelist->is_done)
+		{
+			break;
+		}
+		
+		folder = _filelist_pop_folder(worker);
+		
+		_filelist_enum_folder(worker,folder);
+		
+		mem_free(folder);
+		
+		if (InterlockedDecrement(&filelist->pending_folder_count) == 0)
+		{
+			// walk complete.
+			// wake up all workers so they can exit.
+			filelist->is_done = 1;
+			
+			ReleaseSemaphore(filelist->folder_semaphore,(LONG)filelist->worker_count,NULL);
+		}
+	}
 	
-	if (filelist->item_start)
+	// flush our last batch.
+	if (worker->batch)
 	{
-		filelist->item_last->next = item;
+		if (worker->batch->used_size)
+		{
+			_filelist_queue_batch(filelist,worker->batch);
+		}
+		else
+		{
+			mem_free(worker->batch);
+		}
+		
+		worker->batch = NULL;
 	}
-	else
+	
+	// the last worker wakes up the writer.
+	if (InterlockedDecrement(&filelist->running_worker_count) == 0)
 	{
-		filelist->item_start = item;
+		ReleaseSemaphore(filelist->batch_queued_semaphore,1,NULL);
 	}
 	
-	filelist->item_last = item;
-	item->next = 0;
+	return 0;
 }
 
-// recursive.
-static void _filelist_add_folder_from_path_recurse(_filelist_t *e,const utf8_t *path,uintptr_t path_len,uintptr_t depth)
+// add all the items in a folder and queue its subfolders.
+static void _filelist_enum_folder(_filelist_worker_t *worker,_filelist_folder_t *folder)
 {
-	if (depth < _FILELIST_MAX_DEPTH)
+	wchar_buf_t search_wcbuf;
+	wchar_buf_t filename_wcbuf;
+	wchar_buf_t lowercase_wcbuf;
+	HANDLE find_handle;
+	WIN32_FIND_DATAW fd;
+	
+	if (worker->filelist->old)
 	{
-		os_find_t find_handle;
-		fileinfo_fd_t fd;
-		utf8_buf_t search_cbuf;
-		utf8_buf_t filename_cbuf;
-		
-		utf8_buf_init(&search_cbuf);
-		utf8_buf_init(&filename_cbuf);
+		if (_filelist_enum_old_folder(worker,folder))
+		{
+			return;
+		}
+	}
+	
+	wchar_buf_init(&search_wcbuf);
+	wchar_buf_init(&filename_wcbuf);
+	wchar_buf_init(&lowercase_wcbuf);
+	
+	wchar_buf_copy_wchar_string_n(&search_wcbuf,_FILELIST_FOLDER_PATH(folder),folder->path_len);
+	wchar_buf_cat_utf8_string(&search_wcbuf,"\\*");
+	
+	find_handle = INVALID_HANDLE_VALUE;
+	
+	if (!_filelist_is_find_ex_basic_unsupported)
+	{
+		// large fetch reduces the number of round trips for network shares.
+		find_handle = FindFirstFileExW(search_wcbuf.buf,_FILELIST_FIND_EX_INFO_BASIC,&fd,FindExSearchNameMatch,NULL,FIND_FIRST_EX_LARGE_FETCH);
 		
-		if (os_find_first_file(&find_handle,path,&filename_cbuf,&fd,0))
+		if (find_handle == INVALID_HANDLE_VALUE)
 		{
+			if (GetLastError() == ERROR_INVALID_PARAMETER)
+			{
+				_filelist_is_find_ex_basic_unsupported = 1;
+			}
+		}
+	}
+	
+	if (_filelist_is_find_ex_basic_unsupported)
+	{
+		find_handle = FindFirstFileW(search_wcbuf.buf,&fd);
+	}
+	
+	if (find_handle != INVALID_HANDLE_VALUE)
+	{
+		for(;;)
+		{
+			// skip . and ..
+			if (!((fd.cFileName[0] == '.') && ((fd.cFileName[1] == 0) || ((fd.cFileName[1] == '.') && (fd.cFileName[2] == 0)))))
+			{
+				wchar_buf_copy_wchar_string_n(&filename_wcbuf,_FILELIST_FOLDER_PATH(folder),folder->path_len);
+				wchar_buf_cat_path_separator(&filename_wcbuf);
+				wchar_buf_cat_wchar_string(&filename_wcbuf,fd.cFileName);
+				
+				if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				{
+					DWORD filter_flags;
+					int is_included;
+					
+					filter_flags = _filelist_filter_item(worker->filelist,folder,filename_wcbuf.buf,filename_wcbuf.length_in_wchars,fd.dwFileAttributes,&lowercase_wcbuf,&is_included);
+					
+					if (filter_flags & _FILELIST_FILTER_ADD)
+					{
+						_filelist_add_item(worker,filename_wcbuf.buf,fd.dwFileAttributes,ES_UINT64_MAX,_filelist_filetime_to_uint64(&fd.ftCreationTime),_filelist_filetime_to_uint64(&fd.ftLastWriteTime));
+					}
+					
+					// don't follow junctions or symbolic links, they can loop.
+					if ((filter_flags & _FILELIST_FILTER_WALK) && (!(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)))
+					{
+						if (folder->depth + 1 < _FILELIST_MAX_DEPTH)
+						{
+							_filelist_push_folder(worker,filename_wcbuf.buf,filename_wcbuf.length_in_wchars,folder->depth + 1,is_included,NULL);
+						}
+					}
+				}
+				else
+				{
+					if (_filelist_filter_item(worker->filelist,folder,filename_wcbuf.buf,filename_wcbuf.length_in_wchars,fd.dwFileAttributes,&lowercase_wcbuf,NULL) & _FILELIST_FILTER_ADD)
+					{
+						_filelist_add_item(worker,filename_wcbuf.buf,fd.dwFileAttributes,((ES_UINT64)fd.nFileSizeHigh << 32) | (ES_UINT64)fd.nFileSizeLow,_filelist_filetime_to_uint64(&fd.ftCreationTime),_filelist_filetime_to_uint64(&fd.ftLastWriteTime));
+					}
+				}
+			}
+			
+			if (!FindNextFileW(find_handle,&fd))
+			{
+				break;
+			}
+		}
+		
+		FindClose(find_handle);
+	}
+	
+	wchar_buf_kill(&lowercase_wcbuf);
+	wchar_buf_kill(&filename_wcbuf);
+	wchar_buf_kill(&search_wcbuf);
+}
+
+// add the pending folder item and reuse the items from the previous file list if the folder is unchanged.
+// returns TRUE if the folder was reused.
+// returns FALSE if the folder needs to be enumerated.
+static BOOL _filelist_enum_old_folder(_filelist_worker_t *worker,_filelist_folder_t *folder)
+{
+	BOOL ret;
+	wchar_buf_t path_wcbuf;
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	BOOL is_fad;
+	
+	ret = FALSE;
+	wchar_buf_init(&path_wcbuf);
+	
+	// GetFileAttributesEx needs the trailing path separator for drive roots.
+	wchar_buf_copy_wchar_string_n(&path_wcbuf,_FILELIST_FOLDER_PATH(folder),folder->path_len);
+	wchar_buf_cat_path_separator(&path_wcbuf);
+	
+	is_fad = GetFileAttributesExW(path_wcbuf.buf,GetFileExInfoStandard,&fad);
+	
+	if (folder->old_item)
+	{
+		// the parent folder was reused.
+		// a missing folder has been deleted.
+		if (is_fad)
+		{
+			_filelist_item_t *item;
+			
+			item = _filelist_worker_alloc_item(worker,folder->old_item->filename_len);
+			
+			os_copy_memory(item,folder->old_item,_filelist_get_item_size(folder->old_item->filename_len));
+			
+			item->attributes = fad.dwFileAttributes;
+			item->date_created = _filelist_filetime_to_uint64(&fad.ftCreationTime);
+			item->date_modified = _filelist_filetime_to_uint64(&fad.ftLastWriteTime);
+			item->size = (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? ES_UINT64_MAX : (((ES_UINT64)fad.nFileSizeHigh << 32) | (ES_UINT64)fad.nFileSizeLow);
+		}
+	}
+	
+	// adding, removing or renaming an item updates the date modified of its folder.
+	if ((is_fad) && (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		utf8_buf_t path_cbuf;
+		const _filelist_old_folder_t *old_folder;
+		
+		utf8_buf_init(&path_cbuf);
+		
+		utf8_buf_copy_wchar_string(&path_cbuf,_FILELIST_FOLDER_PATH(folder));
+		
+		old_folder = _filelist_old_find_folder(worker->filelist->old,path_cbuf.buf,path_cbuf.length_in_bytes);
+		
+		if ((old_folder) && (old_folder->item->date_modified != ES_UINT64_MAX) && (old_folder->item->date_modified == _filelist_filetime_to_uint64(&fad.ftLastWriteTime)))
+		{
+			const _filelist_old_child_t *child;
+			wchar_buf_t child_wcbuf;
+			wchar_buf_t lowercase_wcbuf;
+			
+			wchar_buf_init(&child_wcbuf);
+			wchar_buf_init(&lowercase_wcbuf);
+			
+			child = old_folder->child_start;
+			
+			while(child)
+			{
+				DWORD filter_flags;
+				int is_included;
+				
+				wchar_buf_copy_utf8_string(&child_wcbuf,_FILELIST_ITEM_FILENAME(child->item));
+				
+				// the filters may have changed since the previous file list.
+				filter_flags = _filelist_filter_item(worker->filelist,folder,child_wcbuf.buf,child_wcbuf.length_in_wchars,child->item->attributes,&lowercase_wcbuf,&is_included);
+				
+				if ((filter_flags & _FILELIST_FILTER_WALK) && (!(child->item->attributes & FILE_ATTRIBUTE_REPARSE_POINT)) && (folder->depth + 1 < _FILELIST_MAX_DEPTH))
+				{
+					// the subfolder adds its own item when it is checked.
+					_filelist_push_folder(worker,child_wcbuf.buf,child_wcbuf.length_in_wchars,folder->depth + 1,is_included,(filter_flags & _FILELIST_FILTER_ADD) ? child->item : NULL);
+				}
+				else
+				if (filter_flags & _FILELIST_FILTER_ADD)
+				{
+					_filelist_add_old_item(worker,child->item);
+				}
+				
+				child = child->next;
+			}
+			
+			wchar_buf_kill(&lowercase_wcbuf);
+			wchar_buf_kill(&child_wcbuf);
+			
+			ret = TRUE;
+		}
+		
+		utf8_buf_kill(&path_cbuf);
+	}
+	
+	wchar_buf_kill(&path_wcbuf);
+	
+	return ret;
+}
+
+// check an item against the filters.
+// parent is the folder containing the item.
+// lowercase_wcbuf is a scratch buffer.
+// out_is_included is set for folders and can be NULL for files.
+// returns _FILELIST_FILTER_ADD if the item should be added.
+// returns _FILELIST_FILTER_WALK if the folder should be walked.
+// returns 0 for excluded items.
+static DWORD _filelist_filter_item(const _filelist_t *filelist,const _filelist_folder_t *parent,const wchar_t *filename,SIZE_T filename_len,DWORD attributes,wchar_buf_t *lowercase_wcbuf,int *out_is_included)
+{
+	if (out_is_included)
+	{
+		*out_is_included = parent->is_included;
+	}
+	
+	if (!filelist->is_filter)
+	{
+		return _FILELIST_FILTER_ADD | _FILELIST_FILTER_WALK;
+	}
+	
+	wchar_buf_copy_wchar_string_n(lowercase_wcbuf,filename,filename_len);
+	wchar_string_make_lowercase(lowercase_wcbuf->buf);
+	
+	if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+	{
+		// the whole subtree is skipped.
+		if (filename_filter_exec(&filelist->exclude_folders_filter,lowercase_wcbuf->buf,lowercase_wcbuf->length_in_wchars))
+		{
+			return 0;
+		}
+		
+		if (parent->is_included)
+		{
+			return _FILELIST_FILTER_ADD | _FILELIST_FILTER_WALK;
+		}
+		
+		if (filename_filter_exec(&filelist->include_only_folders_filter,lowercase_wcbuf->buf,lowercase_wcbuf->length_in_wchars))
+		{
+			if (out_is_included)
+			{
+				*out_is_included = 1;
+			}
+			
+			return _FILELIST_FILTER_ADD | _FILELIST_FILTER_WALK;
+		}
+		
+		// an included folder may be further down.
+		return _FILELIST_FILTER_WALK;
+	}
+	
+	if (!parent->is_included)
+	{
+		return 0;
+	}
+	
+	if (filename_filter_exec(&filelist->exclude_files_filter,lowercase_wcbuf->buf,lowercase_wcbuf->length_in_wchars))
+	{
+		return 0;
+	}
+	
+	if (filelist->include_only_files_filter.count)
+	{
+		if (!filename_filter_exec(&filelist->include_only_files_filter,lowercase_wcbuf->buf,lowercase_wcbuf->length_in_wchars))
+		{
+			return 0;
+		}
+	}
+	
+	return _FILELIST_FILTER_ADD;
+}
+
+// queue a folder on the end of the workers deque.
+static void _filelist_push_folder(_filelist_worker_t *worker,const wchar_t *path,SIZE_T path_len,SIZE_T depth,int is_included,const _filelist_item_t *old_item)
+{
+	_filelist_folder_t *folder;
+	
+	folder = mem_alloc(safe_size_add(sizeof(_filelist_folder_t),safe_size_mul(safe_size_add_one(path_len),sizeof(wchar_t))));
+	
+	folder->depth = depth;
+	folder->path_len = path_len;
+	folder->is_included = is_included;
+	folder->old_item = old_item;
+	
+	os_copy_memory(_FILELIST_FOLDER_PATH(folder),path,path_len * sizeof(wchar_t));
+	_FILELIST_FOLDER_PATH(folder)[path_len] = 0;
+	
+	// count before it can be taken.
+	InterlockedIncrement(&worker->filelist->pending_folder_count);
+
+	EnterCriticalSection(&worker->folder_cs);
+	
+	folder->next = NULL;
+	folder->prev = worker->folder_last;
+	
+	if (worker->folder_last)
+	{
+		worker->folder_last->next = folder;
+	}
+	else
+	{
+		worker->folder_start = folder;
+	}
+	
+	worker->folder_last = folder;
+	
+	LeaveCriticalSection(&worker->folder_cs);
+	
+	ReleaseSemaphore(worker->filelist->folder_semaphore,1,NULL);
+}
+
+// take a folder from the end of our deque.
+// otherwise, steal a folder from the start of another workers deque.
+// the start of the deque is closest to the root, so thieves take the largest subtrees.
+// only call after acquiring the folder semaphore.
+static _filelist_folder_t *_filelist_pop_folder(_filelist_worker_t *worker)
+{
+	_filelist_t *filelist;
+	_filelist_folder_t *folder;
+	
+	filelist = worker->filelist;
+	
+	// the semaphore guarantees a folder is queued somewhere.
+	// however, another worker can take it while we are looking, in which case their folder is still queued.
+	// so keep looking until we find one.
+	for(;;)
+	{
+		SIZE_T run;
+		SIZE_T victim_index;
+		
+		EnterCriticalSection(&worker->folder_cs);
+		
+		folder = worker->folder_last;
+		
+		if (folder)
+		{
+			worker->folder_last = folder->prev;
+			
+			if (worker->folder_last)
+			{
+				worker->folder_last->next = NULL;
+			}
+			else
+			{
+				worker->folder_start = NULL;
+			}
+		}
+		
+		LeaveCriticalSection(&worker->folder_cs);
+		
+		if (folder)
+		{
+			return folder;
+		}
+		
+		victim_index = worker->index;
+		run = filelist->worker_count - 1;
+		
+		while(run)
+		{
+			_filelist_worker_t *victim;
+			
+			victim_index++;
+			if (victim_index == filelist->worker_count)
+			{
+				victim_index = 0;
+			}
+			
+			victim = &filelist->worker_array[victim_index];
+			
+			EnterCriticalSection(&victim->folder_cs);
+			
+			folder = victim->folder_start;
+			
+			if (folder)
+			{
+				victim->folder_start = folder->next;
+				
+				if (victim->folder_start)
+				{
+					victim->folder_start->prev = NULL;
+				}
+				else
+				{
+					victim->folder_last = NULL;
+				}
+			}
+			
+			LeaveCriticalSection(&victim->folder_cs);
+			
+			if (folder)
+			{
+				return folder;
+			}
+			
+			run--;
+		}
+	}
+}
+
+// allocate an item in the workers batch.
+// queues the batch for the writer when it's full.
+static _filelist_item_t *_filelist_worker_alloc_item(_filelist_worker_t *worker,SIZE_T filename_len)
+{
+	if (worker->batch)
+	{
+		if (worker->batch->used_size + _filelist_get_item_size(filename_len) > worker->batch->allocated_size)
+		{
+			_filelist_queue_batch(worker->filelist,worker->batch);
+			
+			worker->batch = NULL;
+		}
+	}
+	
+	return _filelist_batch_alloc_item(&worker->batch,filename_len);
+}
+
+// add an item to the workers batch.
+static void _filelist_add_item(_filelist_worker_t *worker,const wchar_t *filename,DWORD attributes,ES_UINT64 size,ES_UINT64 date_created,ES_UINT64 date_modified)
+{
+	_filelist_item_t *item;
+	
+	item = _filelist_worker_alloc_item(worker,utf8_string_get_length_in_bytes_from_wchar_string(filename));
+	
+	item->size = size;
+	item->date_created = date_created;
+	item->date_modified = date_modified;
+	item->attributes = attributes;
+	
+	utf8_string_copy_wchar_string(_FILELIST_ITEM_FILENAME(item),filename);
+}
+
+// copy an item from the previous file list to the workers batch.
+static void _filelist_add_old_item(_filelist_worker_t *worker,const _filelist_item_t *old_item)
+{
+	_filelist_item_t *item;
+	
+	item = _filelist_worker_alloc_item(worker,old_item->filename_len);
+	
+	os_copy_memory(item,old_item,_filelist_get_item_size(old_item->filename_len));
+}
+
+static _filelist_batch_t *_filelist_batch_alloc(SIZE_T min_size)
+{
+	_filelist_batch_t *batch;
+	SIZE_T allocated_size;
+	
+	allocated_size = _FILELIST_BATCH_SIZE;
+	if (allocated_size < min_size)
+	{
+		allocated_size = min_size;
+	}
+	
+	batch = mem_alloc(safe_size_add(sizeof(_filelist_batch_t),allocated_size));
+	
+	batch->next = NULL;
+	batch->used_size = 0;
+	batch->allocated_size = allocated_size;
+	
+	return batch;
+}
+
+// allocate an item in a batch.
+// grows the batch if there's not enough room.
+// the caller fills in the item and filename.
+static _filelist_item_t *_filelist_batch_alloc_item(_filelist_batch_t **batch_p,SIZE_T filename_len)
+{
+	_filelist_batch_t *batch;
+	_filelist_item_t *item;
+	SIZE_T item_size;
+	
+	item_size = _filelist_get_item_size(filename_len);
+	batch = *batch_p;
+	
+	if (!batch)
+	{
+		batch = _filelist_batch_alloc(item_size);
+		
+		*batch_p = batch;
+	}
+	else
+	if (batch->used_size + item_size > batch->allocated_size)
+	{
+		_filelist_batch_t *new_batch;
+		
+		new_batch = _filelist_batch_alloc(safe_size_add(batch->used_size,safe_size_add(item_size,batch->allocated_size)));
+		
+		os_copy_memory(_FILELIST_BATCH_DATA(new_batch),_FILELIST_BATCH_DATA(batch),batch->used_size);
+		new_batch->used_size = batch->used_size;
+		
+		mem_free(batch);
+		
+		batch = new_batch;
+		*batch_p = batch;
+	}
+	
+	item = (_filelist_item_t *)(_FILELIST_BATCH_DATA(batch) + batch->used_size);
+	
+	item->filename_len = (DWORD)filename_len;
+	
+	batch->used_size += item_size;
+	
+	return item;
+}
+
+// pack an item into a batch.
+static void _filelist_batch_add_item(_filelist_batch_t **batch_p,const wchar_t *filename,SIZE_T filename_len,DWORD attributes,ES_UINT64 size,ES_UINT64 date_created,ES_UINT64 date_modified)
+{
+	_filelist_item_t *item;
+	
+	item = _filelist_batch_alloc_item(batch_p,filename_len);
+	
+	item->size = size;
+	item->date_created = date_created;
+	item->date_modified = date_modified;
+	item->attributes = attributes;
+	
+	utf8_string_copy_wchar_string(_FILELIST_ITEM_FILENAME(item),filename);
+}
+
+static void _filelist_free_batch_list(_filelist_batch_t *batch_start)
+{
+	_filelist_batch_t *batch;
+	
+	batch = batch_start;
+	
+	while(batch)
+	{
+		_filelist_batch_t *next_batch;
+		
+		next_batch = batch->next;
+		
+		mem_free(batch);
+		
+		batch = next_batch;
+	}
+}
+
+// add a batch to the end of the writer queue.
+// blocks while the queue is full.
+static void _filelist_queue_batch(_filelist_t *filelist,_filelist_batch_t *batch)
+{
+	WaitForSingleObject(filelist->batch_free_semaphore,INFINITE);
+	
+	batch->next = NULL;
+	
+	EnterCriticalSection(&filelist->batch_cs);
+	
+	if (filelist->batch_last)
+	{
+		filelist->batch_last->next = batch;
+	}
+	else
+	{
+		filelist->batch_start = batch;
+	}
+	
+	filelist->batch_last = batch;
+	
+	LeaveCriticalSection(&filelist->batch_cs);
+	
+	ReleaseSemaphore(filelist->batch_queued_semaphore,1,NULL);
+}
+
+// take a batch from the start of the writer queue.
+// blocks until a batch is available.
+// returns NULL once all workers have exited and the queue is empty.
+static _filelist_batch_t *_filelist_dequeue_batch(_filelist_t *filelist)
+{
+	_filelist_batch_t *batch;
+	
+	WaitForSingleObject(filelist->batch_queued_semaphore,INFINITE);
+	
+	EnterCriticalSection(&filelist->batch_cs);
+	
+	batch = filelist->batch_start;
+	
+	if (batch)
+	{
+		filelist->batch_start = batch->next;
+		
+		if (!filelist->batch_start)
+		{
+			filelist->batch_last = NULL;
+		}
+	}
+	
+	LeaveCriticalSection(&filelist->batch_cs);
+	
+	if (batch)
+	{
+		batch->next = NULL;
+		
+		ReleaseSemaphore(filelist->batch_free_semaphore,1,NULL);
+	}
+	
+	return batch;
+}
+
+// the size of an item in a batch, including the filename and padding.
+static SIZE_T _filelist_get_item_size(SIZE_T filename_len)
+{
+	return (safe_size_add(sizeof(_filelist_item_t),safe_size_add_one(filename_len)) + 7) & (~(SIZE_T)7);
+}
+
+static ES_UINT64 _filelist_filetime_to_uint64(const FILETIME *ft)
+{
+	return ((ES_UINT64)ft->dwHighDateTime << 32) | (ES_UINT64)ft->dwLowDateTime;
+}
+
+static BOOL _filelist_startwith(const ES_UTF8 *s,const ES_UTF8 *substring)
+{
+	const ES_UTF8 *sp;
+	const ES_UTF8 *ssp;
+	
+	sp = s;
+	ssp = substring;
+	
+	while(*ssp)
+	{
+		if (*sp != *ssp) 
+		{
+			return FALSE;
+		}
+
+		sp++;
+		ssp++;
+	}
+	
+	return TRUE;
+}
+
+static void _filelist_writer_flush(_filelist_writer_t *writer)
+{
+	if (writer->p != writer->buf)
+	{
+		DWORD size;
+		DWORD numwritten;
+		
+		size = (DWORD)(writer->p - writer->buf);
+		
+		if ((!writer->is_error) && ((!WriteFile(writer->file_handle,writer->buf,size,&numwritten,NULL)) || (numwritten != size)))
+		{
+			writer->is_error = 1;
+		}
+		
+		writer->p = writer->buf;
+		writer->avail = _FILELIST_WRITE_BUF_SIZE;
+	}
+}
+
+static void _filelist_writer_write(_filelist_writer_t *writer,const void *data,SIZE_T size)
+{
+	const BYTE *s;
+	SIZE_T run;
+	
+	s = data;
+	run = size;
+	
+	while(run)
+	{
+		SIZE_T copy_size;
+		
+		if (!writer->avail)
+		{
+			_filelist_writer_flush(writer);
+		}
+		
+		copy_size = run;
+		if (copy_size > writer->avail)
+		{
+			copy_size = writer->avail;
+		}
+		
+		os_copy_memory(writer->p,s,copy_size);
+		
+		writer->p += copy_size;
+		writer->avail -= copy_size;
+		s += copy_size;
+		run -= copy_size;
+	}
+}
+
+static void _filelist_writer_write_utf8_string(_filelist_writer_t *writer,const ES_UTF8 *s)
+{
+	_filelist_writer_write(writer,s,utf8_string_get_length_in_bytes(s));
+}
+
+static void _filelist_cat_uint64(utf8_buf_t *cbuf,ES_UINT64 value)
+{
+	BYTE buf[32];
+	BYTE *d;
+	
+	d = buf + 32;
+	
+	do
+	{
+		d--;
+		*d = (BYTE)('0' + (value % 10));
+		value /= 10;
+	}
+	while(value);
+	
+	utf8_buf_cat_utf8_string_n(cbuf,d,buf + 32 - d);
+}
+
+// append a CSV row for an item to cbuf.
+// size, date_modified and date_created are left empty when ES_UINT64_MAX.
+void filelist_cat_item(utf8_buf_t *cbuf,const ES_UTF8 *filename,DWORD attributes,ES_UINT64 size,ES_UINT64 date_modified,ES_UINT64 date_created,int folder_append_path_separator)
+{
+	const ES_UTF8 *p;
+	const ES_UTF8 *start;
+	
+	// filename
+	// always quoted, double up any quotes.
+	utf8_buf_cat_byte(cbuf,'"');
+	
+	p = filename;
+	start = p;
+	
+	while(*p)
+	{
+		if (*p == '"')
+		{
+			utf8_buf_cat_utf8_string_n(cbuf,start,p - start + 1);
+			
+			start = p;
+		}
+		
+		p++;
+	}
+	
+	utf8_buf_cat_utf8_string_n(cbuf,start,p - start);
+	
+	if ((folder_append_path_separator) && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		utf8_buf_cat_byte(cbuf,'\\');
+	}
+	
+	utf8_buf_cat_utf8_string_n(cbuf,"\",",2);
+	
+	// size
+	if (size != ES_UINT64_MAX)
+	{
+		_filelist_cat_uint64(cbuf,size);
+	}
+	
+	utf8_buf_cat_byte(cbuf,',');
+	
+	// date modified
+	if (date_modified != ES_UINT64_MAX)
+	{
+		_filelist_cat_uint64(cbuf,date_modified);
+	}
+	
+	utf8_buf_cat_byte(cbuf,',');
+	
+	// date created.
+	if (date_created != ES_UINT64_MAX)
+	{
+		_filelist_cat_uint64(cbuf,date_created);
+	}
+	
+	utf8_buf_cat_byte(cbuf,',');
+	
+	// attributes
+	_filelist_cat_uint64(cbuf,attributes);
+	
+	utf8_buf_cat_utf8_string_n(cbuf,"\r\n",2);
+}
+
+// write a CSV row for an item.
+// skips the first path_len bytes of the filename for relative paths.
+static void _filelist_writer_write_item(_filelist_writer_t *writer,const _filelist_item_t *item,SIZE_T path_len,int folder_append_path_separator)
+{
+	utf8_buf_empty(&writer->row_cbuf);
+	
+	filelist_cat_item(&writer->row_cbuf,_FILELIST_ITEM_FILENAME(item) + path_len,item->attributes,item->size,item->date_modified,item->date_created,folder_append_path_separator);
+	
+	_filelist_writer_write(writer,writer->row_cbuf.buf,writer->row_cbuf.length_in_bytes);
+}
+
+// get the folder of filename, including the trailing path separator.
+// relative filenames in a file list are relative to this path.
+static void _filelist_get_base_path(const wchar_t *filename,utf8_buf_t *out_cbuf)
+{
+	wchar_buf_t full_filename_wcbuf;
+	SIZE_T path_len;
+	ES_UTF8 *p;
+	
+	wchar_buf_init(&full_filename_wcbuf);
+	
+	os_get_full_path_name(filename,&full_filename_wcbuf);
+
+	utf8_buf_copy_wchar_string(out_cbuf,full_filename_wcbuf.buf);
+	
+	wchar_buf_kill(&full_filename_wcbuf);
+	
+	path_len = 0;
+	p = out_cbuf->buf;
+	
+	while(*p)
+	{
+		if ((*p == '\\') || (*p == '/'))
+		{
+			// include the backslash.
+			path_len = (p - out_cbuf->buf + 1);
+		}
+		
+		p++;
+	}
+	
+	out_cbuf->buf[path_len] = 0;
+	out_cbuf->length_in_bytes = path_len;
+}
+
+// load the previous file list and index it by folder path.
+// relative filenames are made absolute.
+// returns TRUE if the file list was loaded.
+// Otherwise, returns FALSE if the file list could not be opened.
+static BOOL _filelist_old_load(_filelist_old_t *old,const wchar_t *filename)
+{
+	_filelist_reader_t reader;
+	utf8_buf_t base_cbuf;
+	utf8_buf_t path_cbuf;
+	_filelist_batch_t *batch_last;
+	SIZE_T filename_column;
+	SIZE_T size_column;
+	SIZE_T date_modified_column;
+	SIZE_T date_created_column;
+	SIZE_T attributes_column;
+	SIZE_T column_index;
+	int ch;
+	
+	reader.file_handle = os_open_file(filename);
+	
+	if (reader.file_handle == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+	
+	utf8_buf_init(&base_cbuf);
+	utf8_buf_init(&path_cbuf);
+
+	reader.buf = mem_alloc(_FILELIST_READ_BUF_SIZE);
+	reader.p = reader.buf;
+	reader.avail = 0;
+	reader.is_eof = 0;
+	reader.field_buf = mem_alloc(_FILELIST_MAX_FIELD_LEN + 1);
+	reader.field_len = 0;
+	
+	_filelist_get_base_path(filename,&base_cbuf);
+	
+	batch_last = NULL;
+	
+	// header
+	filename_column = SIZE_MAX;
+	size_column = SIZE_MAX;
+	date_modified_column = SIZE_MAX;
+	date_created_column = SIZE_MAX;
+	attributes_column = SIZE_MAX;
+	column_index = 0;
+	
+	for(;;)
+	{
+		const ES_UTF8 *field;
+		
+		ch = _filelist_reader_read_field(&reader);
+		
+		field = reader.field_buf;
+		
+		// skip the UTF-8 BOM.
+		if ((!column_index) && (reader.field_len >= 3) && (field[0] == 0xEF) && (field[1] == 0xBB) && (field[2] == 0xBF))
+		{
+			field += 3;
+		}
+		
+		if (utf8_string_compare(field,"Filename") == 0)
+		{
+			filename_column = column_index;
+		}
+		else
+		if (utf8_string_compare(field,"Size") == 0)
+		{
+			size_column = column_index;
+		}
+		else
+		if (utf8_string_compare(field,"Date Modified") == 0)
+		{
+			date_modified_column = column_index;
+		}
+		else
+		if (utf8_string_compare(field,"Date Created") == 0)
+		{
+			date_created_column = column_index;
+		}
+		else
+		if (utf8_string_compare(field,"Attributes") == 0)
+		{
+			attributes_column = column_index;
+		}
+		
+		column_index++;
+		
+		if (ch != ',')
+		{
+			break;
+		}
+	}
+	
+	// rows
+	if (filename_column != SIZE_MAX)
+	{
+		while(ch >= 0)
+		{
+			ES_UINT64 size;
+			ES_UINT64 date_modified;
+			ES_UINT64 date_created;
+			ES_UINT64 attributes;
+			int is_filename;
+			
+			size = ES_UINT64_MAX;
+			date_modified = ES_UINT64_MAX;
+			date_created = ES_UINT64_MAX;
+			attributes = 0;
+			is_filename = 0;
+			column_index = 0;
+			
 			for(;;)
 			{
-				if (fd.attributes & FILE_ATTRIBUTE_DIRECTORY)
+				ch = _filelist_reader_read_field(&reader);
+				
+				if (column_index == filename_column)
 				{
-					// convert to utf8.
-					utf8_buf_path_cat_filename_n(&search_cbuf,path,path_len,filename_cbuf.buf,filename_cbuf.len);
-					
-					if (!filename_filter_exec(&e->exclude_folders_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,1,0))
+					if (reader.field_len)
 					{
-						if (filename_filter_exec(&e->include_only_folders_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,1,1))
+						// make relative paths absolute.
+						if (((reader.field_len >= 2) && (reader.field_buf[1] == ':')) || ((reader.field_buf[0] == '\\') && (reader.field_buf[1] == '\\')))
+						{
+							utf8_buf_copy_utf8_string_n(&path_cbuf,reader.field_buf,reader.field_len);
+						}
+						else
+						{
+							utf8_buf_copy_utf8_string_n(&path_cbuf,base_cbuf.buf,base_cbuf.length_in_bytes);
+							utf8_buf_cat_utf8_string_n(&path_cbuf,reader.field_buf,reader.field_len);
+						}
+						
+						// folders can have a trailing path separator.
+						while((path_cbuf.length_in_bytes) && (path_cbuf.buf[path_cbuf.length_in_bytes - 1] == '\\'))
+						{
+							path_cbuf.length_in_bytes--;
+							path_cbuf.buf[path_cbuf.length_in_bytes] = 0;
+						}
+						
+						if (path_cbuf.length_in_bytes)
 						{
-							// add self
-							if (!e->no_folders)
-							{
-								_filelist_add_item(e,search_cbuf.buf,&fd);
-							}
-							
-							// add sub folders.				
-							if (!e->no_subfolders)
-							{
-								_filelist_add_folder_from_path_recurse(e,search_cbuf.buf,search_cbuf.len,depth+1);
-							}
+							is_filename = 1;
 						}
 					}
 				}
 				else
+				if (column_index == size_column)
 				{
-					// convert to utf8.
-					utf8_buf_path_cat_filename(&search_cbuf,path,filename_cbuf.buf);
-
-					if (!filename_filter_exec(&e->exclude_folders_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,0,0))
+					size = _filelist_parse_uint64(reader.field_buf);
+				}
+				else
+				if (column_index == date_modified_column)
+				{
+					date_modified = _filelist_parse_uint64(reader.field_buf);
+				}
+				else
+				if (column_index == date_created_column)
+				{
+					date_created = _filelist_parse_uint64(reader.field_buf);
+				}
+				else
+				if (column_index == attributes_column)
+				{
+					attributes = _filelist_parse_uint64(reader.field_buf);
+					
+					if (attributes > 0xffffffff)
 					{
-						if (filename_filter_exec(&e->include_only_folders_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,0,1))
-						{
-							if (!filename_filter_exec(&e->exclude_files_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,0,0))
-							{
-								if (filename_filter_exec(&e->include_only_files_filename_filter,search_cbuf.buf,search_cbuf.len,filename_cbuf.buf,filename_cbuf.len,0,1))
-								{
-									if (!e->no_files)
-									{
-										// add it
-										_filelist_add_item(e,search_cbuf.buf,&fd);
-									}
-								}
-							}
-						}
+						attributes = 0;
+					}
+				}
+				
+				column_index++;
+				
+				if (ch != ',')
+				{
+					break;
+				}
+			}
+			
+			if (is_filename)
+			{
+				_filelist_item_t *item;
+				SIZE_T item_size;
+				
+				item_size = _filelist_get_item_size(path_cbuf.length_in_bytes);
+				
+				// start a new batch when the last one is full.
+				// the batches are never grown, so the items don't move.
+				if ((!batch_last) || (batch_last->used_size + item_size > batch_last->allocated_size))
+				{
+					_filelist_batch_t *batch;
+					
+					batch = _filelist_batch_alloc(item_size);
+					
+					if (batch_last)
+					{
+						batch_last->next = batch;
+					}
+					else
+					{
+						old->batch_start = batch;
 					}
+					
+					batch_last = batch;
 				}
+				
+				item = _filelist_batch_alloc_item(&batch_last,path_cbuf.length_in_bytes);
+				
+				item->size = size;
+				item->date_created = date_created;
+				item->date_modified = date_modified;
+				item->attributes = (DWORD)attributes;
+				
+				os_copy_memory(_FILELIST_ITEM_FILENAME(item),path_cbuf.buf,path_cbuf.length_in_bytes + 1);
+			}
+		}
+	}
+	
+	mem_free(reader.field_buf);
+	mem_free(reader.buf);
+	CloseHandle(reader.file_handle);
+	
+	utf8_buf_kill(&path_cbuf);
+	utf8_buf_kill(&base_cbuf);
+	
+	_filelist_old_build_index(old);
+	
+	return TRUE;
+}
+
+// build the folder hash table and link each item to its parent folder.
+static void _filelist_old_build_index(_filelist_old_t *old)
+{
+	_filelist_batch_t *batch;
+	
+	// add folders.
+	batch = old->batch_start;
+	
+	while(batch)
+	{
+		BYTE *item_p;
+		BYTE *item_end;
+		
+		item_p = _FILELIST_BATCH_DATA(batch);
+		item_end = item_p + batch->used_size;
+		
+		while(item_p < item_end)
+		{
+			const _filelist_item_t *item;
+			
+			item = (const _filelist_item_t *)item_p;
+			
+			if (item->attributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				_filelist_old_folder_t *old_folder;
+				
+				old_folder = pool_alloc(&old->pool,sizeof(_filelist_old_folder_t));
+				
+				old_folder->item = item;
+				old_folder->child_start = NULL;
+				
+				hash_table_insert(&old->hash_table,&old_folder->hash_entry,hash_fnv1a_64(_FILELIST_ITEM_FILENAME(item),item->filename_len));
+			}
+			
+			item_p += _filelist_get_item_size(item->filename_len);
+		}
+		
+		batch = batch->next;
+	}
+	
+	// link children.
+	// a child can appear before its parent, so this is done after all the folders are added.
+	batch = old->batch_start;
+	
+	while(batch)
+	{
+		BYTE *item_p;
+		BYTE *item_end;
+		
+		item_p = _FILELIST_BATCH_DATA(batch);
+		item_end = item_p + batch->used_size;
+		
+		while(item_p < item_end)
+		{
+			const _filelist_item_t *item;
+			SIZE_T parent_len;
+			
+			item = (const _filelist_item_t *)item_p;
+			parent_len = item->filename_len;
 			
-				if (!os_find_next_file(&find_handle,&filename_cbuf,&fd)) 
+			while(parent_len)
+			{
+				parent_len--;
+				
+				if (_FILELIST_ITEM_FILENAME(item)[parent_len] == '\\')
 				{
 					break;
 				}
 			}
+			
+			if (parent_len)
+			{
+				_filelist_old_folder_t *parent;
+				
+				parent = _filelist_old_find_folder(old,_FILELIST_ITEM_FILENAME(item),parent_len);
+				
+				if (parent)
+				{
+					_filelist_old_child_t *child;
+					
+					child = pool_alloc(&old->pool,sizeof(_filelist_old_child_t));
+					
+					child->item = item;
+					child->next = parent->child_start;
+					parent->child_start = child;
+				}
+			}
+			
+			item_p += _filelist_get_item_size(item->filename_len);
+		}
+		
+		batch = batch->next;
+	}
+}
+
+// find a folder from the previous file list.
+// path does not need to be null terminated.
+// returns NULL if not found.
+static _filelist_old_folder_t *_filelist_old_find_folder(const _filelist_old_t *old,const ES_UTF8 *path,SIZE_T path_len)
+{
+	_filelist_old_folder_t *old_folder;
+	
+	old_folder = (_filelist_old_folder_t *)hash_table_find_first(&old->hash_table,hash_fnv1a_64(path,path_len));
+	
+	while(old_folder)
+	{
+		if ((old_folder->item->filename_len == path_len) && (_filelist_is_equal_path(_FILELIST_ITEM_FILENAME(old_folder->item),path,path_len)))
+		{
+			return old_folder;
+		}
+		
+		old_folder = (_filelist_old_folder_t *)hash_table_find_next(&old_folder->hash_entry);
+	}
+	
+	return NULL;
+}
+
+static void _filelist_old_kill(_filelist_old_t *old)
+{
+	hash_table_kill(&old->hash_table);
+	pool_kill(&old->pool);
+	
+	_filelist_free_batch_list(old->batch_start);
+}
+
+// returns the next byte.
+// returns -1 at the end of the file.
+static int _filelist_reader_getc(_filelist_reader_t *reader)
+{
+	int ch;
+	
+	if (!reader->avail)
+	{
+		DWORD numread;
+		
+		if (reader->is_eof)
+		{
+			return -1;
+		}
+		
+		if ((!ReadFile(reader->file_handle,reader->buf,_FILELIST_READ_BUF_SIZE,&numread,NULL)) || (!numread))
+		{
+			reader->is_eof = 1;
+			
+			return -1;
+		}
+		
+		reader->p = reader->buf;
+		reader->avail = numread;
+	}
+	
+	ch = *reader->p;
+	
+	reader->p++;
+	reader->avail--;
+	
+	return ch;
+}
 
-			os_find_close(&find_handle);
+// read a CSV field into field_buf.
+// quotes are removed and double quotes are unescaped.
+// fields longer than _FILELIST_MAX_FIELD_LEN are truncated.
+// returns the character that ended the field, either ',' or '\n'.
+// returns -1 at the end of the file.
+static int _filelist_reader_read_field(_filelist_reader_t *reader)
+{
+	int ch;
+	int is_quoted;
+	
+	reader->field_len = 0;
+	is_quoted = 0;
+	
+	ch = _filelist_reader_getc(reader);
+	
+	if (ch == '"')
+	{
+		is_quoted = 1;
+		
+		ch = _filelist_reader_getc(reader);
+	}
+	
+	while(ch >= 0)
+	{
+		if (is_quoted)
+		{
+			if (ch == '"')
+			{
+				ch = _filelist_reader_getc(reader);
+				
+				if (ch != '"')
+				{
+					// closing quote.
+					is_quoted = 0;
+					
+					continue;
+				}
+			}
+		}
+		else
+		{
+			if ((ch == ',') || (ch == '\n'))
+			{
+				break;
+			}
+			
+			if (ch == '\r')
+			{
+				ch = _filelist_reader_getc(reader);
+				
+				continue;
+			}
+		}
+		
+		if (reader->field_len < _FILELIST_MAX_FIELD_LEN)
+		{
+			reader->field_buf[reader->field_len] = (ES_UTF8)ch;
+			reader->field_len++;
 		}
+		
+		ch = _filelist_reader_getc(reader);
+	}
+	
+	reader->field_buf[reader->field_len] = 0;
+	
+	return ch;
+}
 
-		utf8_buf_kill(&filename_cbuf);
-		utf8_buf_kill(&search_cbuf);
+// parse a decimal number.
+// returns ES_UINT64_MAX if the field is empty or not a number.
+static ES_UINT64 _filelist_parse_uint64(const ES_UTF8 *s)
+{
+	const ES_UTF8 *p;
+	ES_UINT64 value;
+	
+	if (!*s)
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	p = s;
+	value = 0;
+	
+	while(*p)
+	{
+		if ((*p < '0') || (*p > '9'))
+		{
+			return ES_UINT64_MAX;
+		}
+		
+		value = (value * 10) + (*p - '0');
+		
+		p++;
 	}
+	
+	return value;
 }
 
-*/
\ No newline at end of file
+static BOOL _filelist_is_equal_path(const ES_UTF8 *a,const ES_UTF8 *b,SIZE_T len)
+{
+	SIZE_T run;
+	
+	run = len;
+	
+	while(run)
+	{
+		if (*a != *b)
+		{
+			return FALSE;
+		}
+		
+		a++;
+		b++;
+		run--;
+	}
+	
+	return TRUE;
+}
@@ -1,13 +1,32 @@
 
-// create a new filelist
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-int filelist_create(const utf8_t *filename,const utf8_t *path,int no_folders,int no_files,int no_subfolders,const utf8_t *include_only_folders,const utf8_t *exclude_folders,const utf8_t *include_only_files,const utf8_t *exclude_files);
-
-#ifdef __cplusplus
-}
-#endif
+// the first line of an EFU file list.
+#define FILELIST_HEADER "Filename,Size,Date Modified,Date Created,Attributes\r\n"
 
+// create an EFU file list from folders on disk.
+BOOL filelist_create(const wchar_t *filename,const wchar_t *path_list,const wchar_t *include_only_files,const wchar_t *exclude_files,const wchar_t *include_only_folders,const wchar_t *exclude_folders,int folder_append_path_separator,int relative_paths,int incremental);
+void filelist_cat_item(utf8_buf_t *cbuf,const ES_UTF8 *filename,DWORD attributes,ES_UINT64 size,ES_UINT64 date_modified,ES_UINT64 date_created,int folder_append_path_separator);
@@ -0,0 +1,294 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// compiled filename filters for -create-file-list
+// plain names and *.ext wildcards are checked with a single hash lookup each.
+// only the remaining wildcards are matched one at a time.
+
+#include "es.h"
+
+static void _filename_filter_add(filename_filter_t *filter,DWORD type,const wchar_t *text,SIZE_T len);
+static const filename_filter_entry_t *_filename_filter_find(const filename_filter_t *filter,DWORD type,const wchar_t *text,SIZE_T len);
+static BOOL _filename_filter_is_wildcard_or_separator(const wchar_t *text);
+
+void filename_filter_init(filename_filter_t *filter)
+{
+	pool_init(&filter->pool);
+	
+	hash_table_init(&filter->hash_table,0);
+	filter->wildcard_start = NULL;
+	filter->count = 0;
+}
+
+void filename_filter_kill(filename_filter_t *filter)
+{
+	hash_table_kill(&filter->hash_table);
+	
+	pool_kill(&filter->pool);
+}
+
+// compile a semicolon delimited list of wildcards.
+// matching is case insensitive.
+// a wildcard without a path separator matches the name only.
+// list can be NULL.
+void filename_filter_compile(filename_filter_t *filter,const wchar_t *list)
+{
+	wchar_buf_t item_wcbuf;
+	const wchar_t *list_p;
+	
+	if (!list)
+	{
+		return;
+	}
+	
+	wchar_buf_init(&item_wcbuf);
+	
+	// add entries.
+	list_p = list;
+	
+	for(;;)
+	{
+		const wchar_t *text;
+		
+		list_p = wchar_string_parse_list_item(list_p,&item_wcbuf);
+		if (!list_p)
+		{
+			break;
+		}
+		
+		if (!item_wcbuf.length_in_wchars)
+		{
+			continue;
+		}
+		
+		wchar_string_make_lowercase(item_wcbuf.buf);
+		
+		text = item_wcbuf.buf;
+		
+		if ((text[0] == '*') && (text[1] == '.') && (text[2]) && (!_filename_filter_is_wildcard_or_separator(text + 2)))
+		{
+			// *.ext
+			// a dot in the extension can't be found with a single lookup, eg: *.tar.gz
+			const wchar_t *p;
+			
+			p = text + 2;
+			
+			while(*p)
+			{
+				if (*p == '.')
+				{
+					break;
+				}
+				
+				p++;
+			}
+			
+			if (*p)
+			{
+				_filename_filter_add(filter,FILENAME_FILTER_ENTRY_TYPE_WILDCARD,text,item_wcbuf.length_in_wchars);
+			}
+			else
+			{
+				_filename_filter_add(filter,FILENAME_FILTER_ENTRY_TYPE_EXTENSION,text + 2,item_wcbuf.length_in_wchars - 2);
+			}
+		}
+		else
+		if (!_filename_filter_is_wildcard_or_separator(text))
+		{
+			_filename_filter_add(filter,FILENAME_FILTER_ENTRY_TYPE_NAME,text,item_wcbuf.length_in_wchars);
+		}
+		else
+		{
+			_filename_filter_add(filter,FILENAME_FILTER_ENTRY_TYPE_WILDCARD,text,item_wcbuf.length_in_wchars);
+		}
+	}
+	
+	wchar_buf_kill(&item_wcbuf);
+}
+
+// check if a full path matches any entry in the filter.
+// lowercase_filename must be made lowercase with wchar_string_make_lowercase.
+// returns TRUE if matched.
+// Otherwise, returns FALSE, including when the filter is empty.
+BOOL filename_filter_exec(const filename_filter_t *filter,const wchar_t *lowercase_filename,SIZE_T filename_len)
+{
+	const wchar_t *name;
+	SIZE_T name_len;
+	
+	if (!filter->count)
+	{
+		return FALSE;
+	}
+	
+	// find the name part.
+	name_len = 0;
+	name = lowercase_filename + filename_len;
+	
+	while(name > lowercase_filename)
+	{
+		if ((name[-1] == '\\') || (name[-1] == '/'))
+		{
+			break;
+		}
+		
+		name--;
+		name_len++;
+	}
+	
+	if (_filename_filter_find(filter,FILENAME_FILTER_ENTRY_TYPE_NAME,name,name_len))
+	{
+		return TRUE;
+	}
+	
+	// extension
+	{
+		const wchar_t *extension;
+		
+		extension = name + name_len;
+		
+		while(extension > name)
+		{
+			if (extension[-1] == '.')
+			{
+				if (_filename_filter_find(filter,FILENAME_FILTER_ENTRY_TYPE_EXTENSION,extension,name + name_len - extension))
+				{
+					return TRUE;
+				}
+				
+				break;
+			}
+			
+			extension--;
+		}
+	}
+	
+	// wildcards
+	{
+		const filename_filter_entry_t *entry;
+		
+		entry = filter->wildcard_start;
+		
+		while(entry)
+		{
+			if (wchar_string_wildcard_exec(lowercase_filename,FILENAME_FILTER_ENTRY_TEXT(entry)))
+			{
+				return TRUE;
+			}
+			
+			entry = entry->next;
+		}
+	}
+	
+	return FALSE;
+}
+
+static void _filename_filter_add(filename_filter_t *filter,DWORD type,const wchar_t *text,SIZE_T len)
+{
+	filename_filter_entry_t *entry;
+	
+	entry = pool_alloc(&filter->pool,safe_size_add(sizeof(filename_filter_entry_t),safe_size_mul_sizeof_wchar(safe_size_add_one(len))));
+	
+	entry->type = type;
+	entry->len = len;
+	
+	os_copy_memory(FILENAME_FILTER_ENTRY_TEXT(entry),text,len * sizeof(wchar_t));
+	FILENAME_FILTER_ENTRY_TEXT(entry)[len] = 0;
+	
+	if (type == FILENAME_FILTER_ENTRY_TYPE_WILDCARD)
+	{
+		entry->next = filter->wildcard_start;
+		filter->wildcard_start = entry;
+	}
+	else
+	{
+		entry->next = NULL;
+		
+		hash_table_insert(&filter->hash_table,&entry->hash_entry,hash_fnv1a_64(text,safe_size_mul_sizeof_wchar(len)));
+	}
+	
+	filter->count++;
+}
+
+static const filename_filter_entry_t *_filename_filter_find(const filename_filter_t *filter,DWORD type,const wchar_t *text,SIZE_T len)
+{
+	const filename_filter_entry_t *entry;
+	
+	entry = (const filename_filter_entry_t *)hash_table_find_first(&filter->hash_table,hash_fnv1a_64(text,safe_size_mul_sizeof_wchar(len)));
+	
+	while(entry)
+	{
+		if ((entry->type == type) && (entry->len == len))
+		{
+			const wchar_t *a;
+			const wchar_t *b;
+			SIZE_T run;
+			
+			a = FILENAME_FILTER_ENTRY_TEXT(entry);
+			b = text;
+			run = len;
+			
+			while(run)
+			{
+				if (*a != *b)
+				{
+					break;
+				}
+				
+				a++;
+				b++;
+				run--;
+			}
+			
+			if (!run)
+			{
+				return entry;
+			}
+		}
+		
+		entry = (const filename_filter_entry_t *)hash_table_find_next(&entry->hash_entry);
+	}
+	
+	return NULL;
+}
+
+static BOOL _filename_filter_is_wildcard_or_separator(const wchar_t *text)
+{
+	const wchar_t *p;
+	
+	p = text;
+	
+	while(*p)
+	{
+		if ((*p == '*') || (*p == '?') || (*p == '\\') || (*p == '/'))
+		{
+			return TRUE;
+		}
+		
+		p++;
+	}
+	
+	return FALSE;
+}
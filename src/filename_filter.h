@@ -0,0 +1,78 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// compiled filename filters for -create-file-list
+// a filter is a semicolon delimited list of wildcards.
+// *.ext and plain names are looked up in a hash table, everything else is matched with wildcards.
+
+#define FILENAME_FILTER_ENTRY_TEXT(entry)		((wchar_t *)(((filename_filter_entry_t *)(entry)) + 1))
+
+// filename_filter_entry_t types.
+#define FILENAME_FILTER_ENTRY_TYPE_NAME			0
+#define FILENAME_FILTER_ENTRY_TYPE_EXTENSION	1
+#define FILENAME_FILTER_ENTRY_TYPE_WILDCARD		2
+
+typedef struct filename_filter_entry_s
+{
+	// must be first.
+	// name and extension entries are in the hash table with the FNV-1a hash of the text.
+	hash_entry_t hash_entry;
+	
+	// the next entry in the wildcard list.
+	struct filename_filter_entry_s *next;
+	
+	// FILENAME_FILTER_ENTRY_TYPE_*
+	DWORD type;
+	
+	// length of the text in wchars.
+	SIZE_T len;
+	
+	// lowercase text follows, null terminated.
+	// wchar_t text[len+1];
+	
+}filename_filter_entry_t;
+
+typedef struct filename_filter_s
+{
+	// entry storage.
+	pool_t pool;
+	
+	// name and extension entries.
+	hash_table_t hash_table;
+	
+	// wildcard entries.
+	filename_filter_entry_t *wildcard_start;
+	
+	// the total number of entries.
+	// an empty filter has no entries.
+	SIZE_T count;
+	
+}filename_filter_t;
+
+void filename_filter_init(filename_filter_t *filter);
+void filename_filter_kill(filename_filter_t *filter);
+void filename_filter_compile(filename_filter_t *filter,const wchar_t *list);
+BOOL filename_filter_exec(const filename_filter_t *filter,const wchar_t *lowercase_filename,SIZE_T filename_len);
@@ -0,0 +1,269 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// groups for -group-by
+// text keys are compared without case, so .JPG and .jpg are the same group.
+// the first spelling seen is the spelling shown.
+
+#include "es.h"
+
+#define _GROUP_LIST_MIN_HASH_TABLE_SIZE		256
+
+static BYTE _group_fold(BYTE c);
+static int _group_compare_text(const ES_UTF8 *a,SIZE_T a_len,const ES_UTF8 *b,SIZE_T b_len);
+static int _group_text_compare(const group_t *a,const group_t *b);
+static int _group_number_compare(const group_t *a,const group_t *b);
+static group_t *_group_list_insert(group_list_t *list,ES_UINT64 hash,ES_UINT64 key_value,const ES_UTF8 *key,SIZE_T key_len);
+
+void group_list_init(group_list_t *list,int key_type,const BYTE *agg_type_array,SIZE_T value_count)
+{
+	pool_init(&list->pool);
+	array_init(&list->array);
+	
+	hash_table_init(&list->hash_table,_GROUP_LIST_MIN_HASH_TABLE_SIZE);
+	
+	list->key_type = key_type;
+	list->agg_type_array = agg_type_array;
+	list->value_count = value_count;
+}
+
+void group_list_kill(group_list_t *list)
+{
+	hash_table_kill(&list->hash_table);
+	array_kill(&list->array);
+	pool_kill(&list->pool);
+}
+
+// find or add the group for a text key.
+group_t *group_list_add_text(group_list_t *list,const ES_UTF8 *key,SIZE_T key_len)
+{
+	ES_UINT64 hash;
+	group_t *group;
+	
+	hash = hash_fnv1a_64_lowercase_ascii(key,key_len);
+	
+	group = (group_t *)hash_table_find_first(&list->hash_table,hash);
+	
+	while(group)
+	{
+		if (_group_compare_text(group->key,group->key_len,key,key_len) == 0)
+		{
+			return group;
+		}
+		
+		group = (group_t *)hash_table_find_next(&group->hash_entry);
+	}
+	
+	return _group_list_insert(list,hash,0,key,key_len);
+}
+
+// find or add the group for a number key.
+group_t *group_list_add_number(group_list_t *list,ES_UINT64 key_value)
+{
+	ES_UINT64 hash;
+	group_t *group;
+	
+	hash = hash_fnv1a_64(&key_value,sizeof(ES_UINT64));
+	
+	group = (group_t *)hash_table_find_first(&list->hash_table,hash);
+	
+	while(group)
+	{
+		if (group->key_value == key_value)
+		{
+			return group;
+		}
+		
+		group = (group_t *)hash_table_find_next(&group->hash_entry);
+	}
+	
+	return _group_list_insert(list,hash,key_value,NULL,0);
+}
+
+// add an item to a group.
+// value_array has one value for each aggregate.
+// a value of ES_UINT64_MAX is unknown and is not aggregated.
+void group_add_values(group_list_t *list,group_t *group,const ES_UINT64 *value_array)
+{
+	group_value_t *group_value;
+	SIZE_T value_run;
+	const BYTE *agg_type_p;
+	
+	group->count++;
+	
+	group_value = GROUP_VALUE_ARRAY(group);
+	agg_type_p = list->agg_type_array;
+	value_run = list->value_count;
+	
+	while(value_run)
+	{
+		if (*value_array != ES_UINT64_MAX)
+		{
+			switch(*agg_type_p)
+			{
+				case GROUP_AGG_TYPE_SUM:
+				case GROUP_AGG_TYPE_AVG:
+					group_value->value += *value_array;
+					break;
+					
+				case GROUP_AGG_TYPE_MIN:
+					if ((!group_value->count) || (*value_array < group_value->value))
+					{
+						group_value->value = *value_array;
+					}
+					break;
+					
+				case GROUP_AGG_TYPE_MAX:
+					if ((!group_value->count) || (*value_array > group_value->value))
+					{
+						group_value->value = *value_array;
+					}
+					break;
+			}
+			
+			group_value->count++;
+		}
+		
+		group_value++;
+		agg_type_p++;
+		value_array++;
+		value_run--;
+	}
+}
+
+// sort the groups by key.
+void group_list_sort(group_list_t *list)
+{
+	if (list->key_type == GROUP_KEY_TYPE_TEXT)
+	{
+		os_sort(list->array.indexes,list->array.count,_group_text_compare);
+	}
+	else
+	{
+		os_sort(list->array.indexes,list->array.count,_group_number_compare);
+	}
+}
+
+static BYTE _group_fold(BYTE c)
+{
+	if ((c >= 'A') && (c <= 'Z'))
+	{
+		return c - 'A' + 'a';
+	}
+	
+	return c;
+}
+
+static int _group_compare_text(const ES_UTF8 *a,SIZE_T a_len,const ES_UTF8 *b,SIZE_T b_len)
+{
+	SIZE_T run;
+	
+	run = a_len < b_len ? a_len : b_len;
+	
+	while(run)
+	{
+		BYTE a_c;
+		BYTE b_c;
+		
+		a_c = _group_fold(*a);
+		b_c = _group_fold(*b);
+		
+		if (a_c < b_c)
+		{
+			return -1;
+		}
+		
+		if (a_c > b_c)
+		{
+			return 1;
+		}
+		
+		a++;
+		b++;
+		run--;
+	}
+	
+	if (a_len < b_len)
+	{
+		return -1;
+	}
+	
+	if (a_len > b_len)
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+static int _group_text_compare(const group_t *a,const group_t *b)
+{
+	return _group_compare_text(a->key,a->key_len,b->key,b->key_len);
+}
+
+static int _group_number_compare(const group_t *a,const group_t *b)
+{
+	if (a->key_value < b->key_value)
+	{
+		return -1;
+	}
+	
+	if (a->key_value > b->key_value)
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+// add a new empty group.
+static group_t *_group_list_insert(group_list_t *list,ES_UINT64 hash,ES_UINT64 key_value,const ES_UTF8 *key,SIZE_T key_len)
+{
+	group_t *group;
+	SIZE_T values_size;
+	ES_UTF8 *group_key;
+	
+	values_size = safe_size_mul(list->value_count,sizeof(group_value_t));
+	
+	group = pool_alloc(&list->pool,safe_size_add(safe_size_add(sizeof(group_t),values_size),safe_size_add_one(key_len)));
+	
+	group->count = 0;
+	group->key_value = key_value;
+	group->key_len = key_len;
+	
+	os_zero_memory(GROUP_VALUE_ARRAY(group),values_size);
+	
+	group_key = ((ES_UTF8 *)GROUP_VALUE_ARRAY(group)) + values_size;
+	os_copy_memory(group_key,key,key_len);
+	group_key[key_len] = 0;
+	group->key = group_key;
+	
+	hash_table_insert(&list->hash_table,&group->hash_entry,hash);
+	
+	array_insert(&list->array,SIZE_MAX,group);
+	
+	return group;
+}
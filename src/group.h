@@ -0,0 +1,105 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// groups for -group-by
+// each group holds a key and one aggregate value per -agg column.
+// groups are stored in a pool and found with a hash table, so only the groups are kept in memory.
+
+#define GROUP_VALUE_ARRAY(group)			((group_value_t *)(((group_t *)(group)) + 1))
+
+#define GROUP_KEY_TYPE_TEXT					0
+#define GROUP_KEY_TYPE_NUMBER				1
+
+#define GROUP_AGG_TYPE_COUNT				0
+#define GROUP_AGG_TYPE_SUM					1
+#define GROUP_AGG_TYPE_MIN					2
+#define GROUP_AGG_TYPE_MAX					3
+#define GROUP_AGG_TYPE_AVG					4
+
+// an aggregate value.
+typedef struct group_value_s
+{
+	// the sum, min or max.
+	ES_UINT64 value;
+	
+	// the number of values seen.
+	// a group with no values has no min or max.
+	ES_UINT64 count;
+
+}group_value_t;
+
+typedef struct group_s
+{
+	// must be first.
+	// the FNV-1a hash of the key.
+	hash_entry_t hash_entry;
+	
+	// the number of items in this group.
+	ES_UINT64 count;
+	
+	// the key for GROUP_KEY_TYPE_NUMBER.
+	ES_UINT64 key_value;
+	
+	// the key for GROUP_KEY_TYPE_TEXT.
+	// the key is stored after the values, null terminated.
+	const ES_UTF8 *key;
+	SIZE_T key_len;
+	
+	// values follow.
+	// group_value_t values[value_count];
+	
+	// text key follows.
+	// ES_UTF8 key[key_len+1];
+
+}group_t;
+
+typedef struct group_list_s
+{
+	// group storage.
+	pool_t pool;
+	
+	// array of group_t *
+	// sorted by group_list_sort.
+	array_t array;
+	
+	// groups by key.
+	hash_table_t hash_table;
+	
+	// GROUP_KEY_TYPE_*
+	int key_type;
+	
+	// the GROUP_AGG_TYPE_* for each value.
+	const BYTE *agg_type_array;
+	SIZE_T value_count;
+
+}group_list_t;
+
+void group_list_init(group_list_t *list,int key_type,const BYTE *agg_type_array,SIZE_T value_count);
+void group_list_kill(group_list_t *list);
+group_t *group_list_add_text(group_list_t *list,const ES_UTF8 *key,SIZE_T key_len);
+group_t *group_list_add_number(group_list_t *list,ES_UINT64 key_value);
+void group_add_values(group_list_t *list,group_t *group,const ES_UINT64 *value_array);
+void group_list_sort(group_list_t *list);
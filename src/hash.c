@@ -0,0 +1,223 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// FNV-1a hashing and chained hash tables.
+// the items are owned by the caller, usually in a pool.
+// the caller compares the item keys when a hash matches.
+
+#include "es.h"
+
+#define _HASH_FNV1A_64_OFFSET_BASIS		0xcbf29ce484222325UI64
+#define _HASH_FNV1A_64_PRIME			0x100000001b3UI64
+
+static void _hash_table_grow(hash_table_t *table);
+
+// FNV-1a of some bytes.
+ES_UINT64 hash_fnv1a_64(const void *data,SIZE_T size)
+{
+	return hash_fnv1a_64_append(_HASH_FNV1A_64_OFFSET_BASIS,data,size);
+}
+
+// continue a FNV-1a hash with some more bytes.
+ES_UINT64 hash_fnv1a_64_append(ES_UINT64 hash,const void *data,SIZE_T size)
+{
+	const BYTE *p;
+	SIZE_T run;
+	
+	p = (const BYTE *)data;
+	run = size;
+	
+	while(run)
+	{
+		hash ^= *p;
+		hash *= _HASH_FNV1A_64_PRIME;
+		
+		p++;
+		run--;
+	}
+	
+	return hash;
+}
+
+// FNV-1a of some text without ASCII case.
+ES_UINT64 hash_fnv1a_64_lowercase_ascii(const ES_UTF8 *text,SIZE_T len)
+{
+	return hash_fnv1a_64_append_lowercase_ascii(_HASH_FNV1A_64_OFFSET_BASIS,text,len);
+}
+
+// continue a FNV-1a hash with some more text without ASCII case.
+ES_UINT64 hash_fnv1a_64_append_lowercase_ascii(ES_UINT64 hash,const ES_UTF8 *text,SIZE_T len)
+{
+	const BYTE *p;
+	SIZE_T run;
+	
+	p = (const BYTE *)text;
+	run = len;
+	
+	while(run)
+	{
+		BYTE c;
+		
+		c = *p;
+		
+		if ((c >= 'A') && (c <= 'Z'))
+		{
+			c = c - 'A' + 'a';
+		}
+		
+		hash ^= c;
+		hash *= _HASH_FNV1A_64_PRIME;
+		
+		p++;
+		run--;
+	}
+	
+	return hash;
+}
+
+// initialize an empty hash table.
+// the table starts with at least min_size buckets.
+void hash_table_init(hash_table_t *table,SIZE_T min_size)
+{
+	table->size = 1;
+	
+	while(table->size < min_size)
+	{
+		table->size = safe_size_mul_2(table->size);
+	}
+	
+	table->bucket_array = mem_alloc(safe_size_mul_sizeof_pointer(table->size));
+	os_zero_memory(table->bucket_array,table->size * sizeof(hash_entry_t *));
+	
+	table->count = 0;
+}
+
+// the entries are not freed.
+void hash_table_kill(hash_table_t *table)
+{
+	mem_free(table->bucket_array);
+}
+
+// find the first entry with a hash.
+// returns NULL if not found.
+// use hash_table_find_next to find other entries with the same hash.
+hash_entry_t *hash_table_find_first(const hash_table_t *table,ES_UINT64 hash)
+{
+	hash_entry_t *entry;
+	
+	entry = table->bucket_array[(SIZE_T)hash & (table->size - 1)];
+	
+	while(entry)
+	{
+		if (entry->hash == hash)
+		{
+			return entry;
+		}
+		
+		entry = entry->next;
+	}
+	
+	return NULL;
+}
+
+// find the next entry with the same hash as entry.
+// returns NULL if there are no more entries.
+hash_entry_t *hash_table_find_next(const hash_entry_t *entry)
+{
+	hash_entry_t *next_entry;
+	
+	next_entry = entry->next;
+	
+	while(next_entry)
+	{
+		if (next_entry->hash == entry->hash)
+		{
+			return next_entry;
+		}
+		
+		next_entry = next_entry->next;
+	}
+	
+	return NULL;
+}
+
+// add an entry.
+// the caller should check the key is not already in the table.
+void hash_table_insert(hash_table_t *table,hash_entry_t *entry,ES_UINT64 hash)
+{
+	SIZE_T hash_index;
+	
+	if (table->count >= table->size)
+	{
+		_hash_table_grow(table);
+	}
+	
+	entry->hash = hash;
+	
+	hash_index = (SIZE_T)hash & (table->size - 1);
+	entry->next = table->bucket_array[hash_index];
+	table->bucket_array[hash_index] = entry;
+	
+	table->count++;
+}
+
+// double the table size and move the existing entries.
+static void _hash_table_grow(hash_table_t *table)
+{
+	SIZE_T new_size;
+	hash_entry_t **new_bucket_array;
+	SIZE_T bucket_index;
+	
+	new_size = safe_size_mul_2(table->size);
+	new_bucket_array = mem_alloc(safe_size_mul_sizeof_pointer(new_size));
+	os_zero_memory(new_bucket_array,new_size * sizeof(hash_entry_t *));
+	
+	for(bucket_index=0;bucket_index<table->size;bucket_index++)
+	{
+		hash_entry_t *entry;
+		
+		entry = table->bucket_array[bucket_index];
+		
+		while(entry)
+		{
+			hash_entry_t *next_entry;
+			SIZE_T hash_index;
+			
+			next_entry = entry->next;
+			
+			hash_index = (SIZE_T)entry->hash & (new_size - 1);
+			entry->next = new_bucket_array[hash_index];
+			new_bucket_array[hash_index] = entry;
+			
+			entry = next_entry;
+		}
+	}
+	
+	mem_free(table->bucket_array);
+	
+	table->bucket_array = new_bucket_array;
+	table->size = new_size;
+}
@@ -0,0 +1,62 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// FNV-1a hashing and chained hash tables.
+// hash_entry_t is stored at the start of each item in a hash_table_t.
+
+// an item in a hash table.
+typedef struct hash_entry_s
+{
+	// the next entry with the same hash index.
+	struct hash_entry_s *next;
+	
+	// the full hash of the item key.
+	ES_UINT64 hash;
+	
+}hash_entry_t;
+
+// a chained hash table.
+// the table doubles in size when the number of entries reaches the table size.
+typedef struct hash_table_s
+{
+	// size is a power of 2.
+	hash_entry_t **bucket_array;
+	SIZE_T size;
+	
+	// the number of entries in the table.
+	SIZE_T count;
+	
+}hash_table_t;
+
+ES_UINT64 hash_fnv1a_64(const void *data,SIZE_T size);
+ES_UINT64 hash_fnv1a_64_append(ES_UINT64 hash,const void *data,SIZE_T size);
+ES_UINT64 hash_fnv1a_64_lowercase_ascii(const ES_UTF8 *text,SIZE_T len);
+ES_UINT64 hash_fnv1a_64_append_lowercase_ascii(ES_UINT64 hash,const ES_UTF8 *text,SIZE_T len);
+void hash_table_init(hash_table_t *table,SIZE_T min_size);
+void hash_table_kill(hash_table_t *table);
+hash_entry_t *hash_table_find_first(const hash_table_t *table,ES_UINT64 hash);
+hash_entry_t *hash_table_find_next(const hash_entry_t *entry);
+void hash_table_insert(hash_table_t *table,hash_entry_t *entry,ES_UINT64 hash);
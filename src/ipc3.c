@@ -53,6 +53,18 @@ static void _ipc3_stream_pool_seek_proc(ipc3_stream_t *stream,ES_UINT64 position
 static ES_UINT64 _ipc3_stream_pool_tell_proc(ipc3_stream_t *stream);
 static SIZE_T _ipc3_stream_pool_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size);
 static void _ipc3_stream_pool_close_proc(ipc3_stream_t *stream);
+static void _ipc3_stream_file_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start);
+static ES_UINT64 _ipc3_stream_file_tell_proc(ipc3_stream_t *stream);
+static SIZE_T _ipc3_stream_file_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size);
+static void _ipc3_stream_file_close_proc(ipc3_stream_t *stream);
+static void _ipc3_stream_record_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start);
+static ES_UINT64 _ipc3_stream_record_tell_proc(ipc3_stream_t *stream);
+static SIZE_T _ipc3_stream_record_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size);
+static void _ipc3_stream_record_close_proc(ipc3_stream_t *stream);
+static void _ipc3_stream_memory_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start);
+static ES_UINT64 _ipc3_stream_memory_tell_proc(ipc3_stream_t *stream);
+static SIZE_T _ipc3_stream_memory_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size);
+static void _ipc3_stream_memory_close_proc(ipc3_stream_t *stream);
 
 static ipc3_stream_vtbl_t _ipc3_stream_pipe_vtbl =
 {
@@ -70,6 +82,30 @@ static ipc3_stream_vtbl_t _ipc3_stream_pool_vtbl =
 	_ipc3_stream_pool_close_proc,
 };
 
+static ipc3_stream_vtbl_t _ipc3_stream_file_vtbl =
+{
+	_ipc3_stream_file_seek_proc,
+	_ipc3_stream_file_tell_proc,
+	_ipc3_stream_file_read_proc,
+	_ipc3_stream_file_close_proc,
+};
+
+static ipc3_stream_vtbl_t _ipc3_stream_record_vtbl =
+{
+	_ipc3_stream_record_seek_proc,
+	_ipc3_stream_record_tell_proc,
+	_ipc3_stream_record_read_proc,
+	_ipc3_stream_record_close_proc,
+};
+
+static ipc3_stream_vtbl_t _ipc3_stream_memory_vtbl =
+{
+	_ipc3_stream_memory_seek_proc,
+	_ipc3_stream_memory_tell_proc,
+	_ipc3_stream_memory_read_proc,
+	_ipc3_stream_memory_close_proc,
+};
+
 #pragma pack (push,1)
 
 typedef struct _ipc3_read_journal_s
@@ -172,6 +208,28 @@ BOOL ipc3_write_pipe_message(HANDLE pipe_handle,DWORD code,const void *in_data,S
 	return FALSE;
 }
 
+// get the number of bytes that can be written to the pipe in either direction without waiting for the other end to read.
+// returns 0 if unknown or the pipe is unbuffered.
+SIZE_T ipc3_get_pipe_buffer_size(HANDLE pipe_handle)
+{
+	DWORD out_buffer_size;
+	DWORD in_buffer_size;
+	
+	if (GetNamedPipeInfo(pipe_handle,NULL,&out_buffer_size,&in_buffer_size,NULL))
+	{
+		if (out_buffer_size < in_buffer_size)
+		{
+			return out_buffer_size;
+		}
+		
+		return in_buffer_size;
+	}
+	
+	debug_error_printf("GetNamedPipeInfo failed %u\n",GetLastError());
+	
+	return 0;
+}
+
 // Read some data from the IPC Pipe.
 void ipc3_stream_read_data(ipc3_stream_t *stream,void *data,SIZE_T size)
 {
@@ -960,6 +1018,11 @@ static SIZE_T _ipc3_stream_pipe_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T
 						stream->is_error = 1;
 						stream->response_code = recv_header.code;
 						
+						// an error is always the last message.
+						// remember the error data size so ipc3_stream_pipe_skip_reply can skip it.
+						((ipc3_stream_pipe_t *)stream)->is_last = 1;
+						((ipc3_stream_pipe_t *)stream)->pipe_avail = recv_header.size;
+						
 						return d - (BYTE *)buf;
 					}
 					
@@ -997,6 +1060,59 @@ static void _ipc3_stream_pipe_close_proc(ipc3_stream_t *stream)
 	}
 }
 
+// skip the rest of the reply, including any unread data messages.
+// this keeps the pipe in sync so another request can be sent on the same pipe.
+// returns TRUE if the whole reply was skipped.
+// returns FALSE on a pipe error, the pipe should no longer be used.
+BOOL ipc3_stream_pipe_skip_reply(ipc3_stream_pipe_t *stream)
+{
+	// discard the buffered data.
+	stream->avail = 0;
+	
+	for(;;)
+	{
+		if (stream->pipe_avail)
+		{
+			if (!ipc3_skip_pipe(stream->pipe_handle,stream->pipe_avail))
+			{
+				stream->base.is_error = 1;
+				
+				return FALSE;
+			}
+			
+			stream->pipe_totread += stream->pipe_avail;
+			stream->pipe_avail = 0;
+		}
+		else
+		{
+			ipc3_message_t recv_header;
+			
+			if (stream->is_last)
+			{
+				stream->is_eof = 1;
+				
+				return TRUE;
+			}
+
+			// read the next header.
+			if (!ipc3_read_pipe(stream->pipe_handle,&recv_header,sizeof(ipc3_message_t)))
+			{
+				stream->base.is_error = 1;
+				
+				return FALSE;
+			}
+			
+			if (recv_header.code != IPC3_RESPONSE_OK_MORE_DATA)
+			{
+				// IPC3_RESPONSE_OK or an error.
+				stream->is_last = 1;
+			}
+			
+			stream->pipe_avail = recv_header.size;
+		}
+	}
+}
+
 // Look up a property by property id and check if it is indexed.
 // returns TRUE if indexed.
 // Otherwise returns FALSE.
@@ -1016,6 +1132,24 @@ BOOL ipc3_is_property_indexed(HANDLE pipe_handle,DWORD property_id)
 	return FALSE;
 }
 
+// check if the database is loaded.
+// stores the loaded state in out_is_db_loaded.
+// returns TRUE if successful.
+// returns FALSE if an error occurs.
+BOOL ipc3_is_db_loaded(HANDLE pipe_handle,BOOL *out_is_db_loaded)
+{
+	DWORD value;
+	
+	if (ipc3_ioctl_expect_output_size(pipe_handle,IPC3_COMMAND_IS_DB_LOADED,NULL,0,&value,sizeof(DWORD)))
+	{
+		*out_is_db_loaded = value ? TRUE : FALSE;
+		
+		return TRUE;
+	}
+	
+	return FALSE;
+}
+
 // initialize a result list.
 void ipc3_result_list_init(ipc3_result_list_t *result_list,ipc3_stream_t *stream)
 {
@@ -1133,6 +1267,71 @@ void ipc3_stream_pool_init(ipc3_stream_pool_t *stream,ipc3_stream_t *source_stre
 	array_init(&((ipc3_stream_pool_t *)stream)->chunk_array);
 }
 
+// read the rest of the source stream into memory.
+// MUST be called before reading from the pool stream.
+// the source stream is not used after this call.
+// this allows a reply to be read on one thread and parsed on another.
+void ipc3_stream_pool_read_all(ipc3_stream_pool_t *stream)
+{
+	while(!stream->is_last)
+	{
+		BYTE *chunk;
+		SIZE_T numread;
+		
+		chunk = mem_try_alloc(_IPC3_STREAM_POOL_CHUNK_SIZE);
+		if (!chunk)
+		{
+			stream->base.is_error = 1;
+			
+			break;
+		}
+		
+		array_insert(&stream->chunk_array,SIZE_MAX,chunk);
+		
+		numread = ipc3_stream_try_read_data(stream->source_stream,chunk,_IPC3_STREAM_POOL_CHUNK_SIZE);
+		
+		if (numread != _IPC3_STREAM_POOL_CHUNK_SIZE)
+		{
+			stream->is_last = 1;
+			stream->last_chunk_numread = numread;
+		}
+	}
+	
+	if (stream->source_stream->is_error)
+	{
+		stream->base.is_error = 1;
+		stream->base.response_code = stream->source_stream->response_code;
+	}
+}
+
+// write the data read into a pool stream to a file.
+// ipc3_stream_pool_read_all MUST be called first.
+// returns TRUE if all the data was written.
+// returns FALSE on a write error.
+BOOL ipc3_stream_pool_write_file(ipc3_stream_pool_t *stream,HANDLE file_handle)
+{
+	SIZE_T chunk_index;
+	
+	for(chunk_index=0;chunk_index<stream->chunk_array.count;chunk_index++)
+	{
+		SIZE_T size;
+		
+		size = _IPC3_STREAM_POOL_CHUNK_SIZE;
+		
+		if ((stream->is_last) && (chunk_index == stream->chunk_array.count - 1))
+		{
+			size = stream->last_chunk_numread;
+		}
+		
+		if (!os_write_file_utf8_string_n(file_handle,stream->chunk_array.indexes[chunk_index],size))
+		{
+			return FALSE;
+		}
+	}
+	
+	return TRUE;
+}
+
 // seek to a specific location in a pool stream.
 // we can calculate the chunk index from the position as we have fixed sized chunks.
 // add the remainder to the current chunk.
@@ -1212,7 +1411,9 @@ static SIZE_T _ipc3_stream_pool_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T
 		if (!((ipc3_stream_pool_t *)stream)->avail)
 		{
 			// is there some data to read from the memory?
-			if ((((ipc3_stream_pool_t *)stream)->chunk_cur == SIZE_MAX) || (((ipc3_stream_pool_t *)stream)->chunk_cur + 1 >= ((ipc3_stream_pool_t *)stream)->chunk_array.count))
+			// chunk_cur + 1 wraps to 0 before the first read.
+			// the chunks may already be read with ipc3_stream_pool_read_all.
+			if (((ipc3_stream_pool_t *)stream)->chunk_cur + 1 >= ((ipc3_stream_pool_t *)stream)->chunk_array.count)
 			{
 				BYTE *chunk;
 				SIZE_T numread;
@@ -1310,6 +1511,263 @@ static void _ipc3_stream_pool_close_proc(ipc3_stream_t *stream)
 	array_kill(&((ipc3_stream_pool_t *)stream)->chunk_array);
 }
 
+// initialize a file stream
+// reads from the current position of the file.
+// the file_handle is just used a reference and should not be closed until the stream is closed.
+void ipc3_stream_file_init(ipc3_stream_file_t *stream,HANDLE file_handle)
+{
+	stream->base.vtbl = &_ipc3_stream_file_vtbl;
+	stream->base.is_error = 0;
+	stream->base.is_64bit = 0;
+	stream->base.response_code = 0;
+	
+	stream->file_handle = file_handle;
+	stream->totread = 0;
+}
+
+// seeking is not supported, use a pool stream.
+static void _ipc3_stream_file_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start)
+{
+	// not supported.
+	stream->is_error = 1;
+}
+
+static ES_UINT64 _ipc3_stream_file_tell_proc(ipc3_stream_t *stream)
+{
+	return ((ipc3_stream_file_t *)stream)->totread;
+}
+
+// the read proc for a file stream.
+// returns less than size at the end of the file.
+// MUST set is_error on any errors.
+static SIZE_T _ipc3_stream_file_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size)
+{
+	BYTE *d;
+	SIZE_T run;
+	
+	if (stream->is_error)
+	{
+		return 0;
+	}
+	
+	d = (BYTE *)buf;
+	run = size;
+	
+	while(run)
+	{
+		DWORD read_size;
+		DWORD numread;
+		
+		if (run <= 65536)
+		{
+			read_size = (DWORD)run;
+		}
+		else
+		{
+			read_size = 65536;
+		}
+		
+		if (!ReadFile(((ipc3_stream_file_t *)stream)->file_handle,d,read_size,&numread,NULL))
+		{
+			stream->is_error = 1;
+			
+			break;
+		}
+		
+		if (!numread)
+		{
+			// EOF
+			break;
+		}
+		
+		d += numread;
+		run -= numread;
+	}
+	
+	((ipc3_stream_file_t *)stream)->totread += d - (BYTE *)buf;
+	
+	return d - (BYTE *)buf;
+}
+
+// close a file stream.
+// the file handle is owned by the caller.
+static void _ipc3_stream_file_close_proc(ipc3_stream_t *stream)
+{
+}
+
+// initialize a record stream.
+// save a reference to the source stream (doesn't hold ownership)
+// the source stream MUST exist while this stream exists.
+void ipc3_stream_record_init(ipc3_stream_record_t *stream,ipc3_stream_t *source_stream)
+{
+	stream->base.vtbl = &_ipc3_stream_record_vtbl;
+	stream->base.is_error = 0;
+	stream->base.is_64bit = source_stream->is_64bit;
+	stream->base.response_code = 0;
+	
+	stream->source_stream = source_stream;
+	stream->buf = NULL;
+	stream->size = 0;
+	stream->allocated_size = 0;
+	stream->totread = 0;
+}
+
+// forget the recorded data.
+// the next read is recorded from the start of the buffer.
+void ipc3_stream_record_clear(ipc3_stream_record_t *stream)
+{
+	stream->size = 0;
+}
+
+// seeking is not supported.
+static void _ipc3_stream_record_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start)
+{
+	// not supported.
+	stream->is_error = 1;
+}
+
+static ES_UINT64 _ipc3_stream_record_tell_proc(ipc3_stream_t *stream)
+{
+	return ((ipc3_stream_record_t *)stream)->totread;
+}
+
+// the read proc for a record stream.
+// reads from the source stream and appends the data to the recorded data.
+// MUST set is_error on any errors.
+static SIZE_T _ipc3_stream_record_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size)
+{
+	ipc3_stream_record_t *record_stream;
+	SIZE_T numread;
+	
+	record_stream = (ipc3_stream_record_t *)stream;
+	
+	if (stream->is_error)
+	{
+		return 0;
+	}
+	
+	numread = ipc3_stream_try_read_data(record_stream->source_stream,buf,size);
+	
+	if (record_stream->source_stream->is_error)
+	{
+		stream->is_error = 1;
+		stream->response_code = record_stream->source_stream->response_code;
+	}
+	
+	if (numread)
+	{
+		SIZE_T new_size;
+		
+		new_size = safe_size_add(record_stream->size,numread);
+		
+		if (new_size > record_stream->allocated_size)
+		{
+			SIZE_T new_allocated_size;
+			BYTE *new_buf;
+			
+			new_allocated_size = safe_size_mul_2(new_size);
+			if (new_allocated_size < 256)
+			{
+				new_allocated_size = 256;
+			}
+			
+			new_buf = mem_alloc(new_allocated_size);
+			
+			if (record_stream->buf)
+			{
+				os_copy_memory(new_buf,record_stream->buf,record_stream->size);
+				
+				mem_free(record_stream->buf);
+			}
+			
+			record_stream->buf = new_buf;
+			record_stream->allocated_size = new_allocated_size;
+		}
+		
+		os_copy_memory(record_stream->buf + record_stream->size,buf,numread);
+		
+		record_stream->size = new_size;
+		record_stream->totread += numread;
+	}
+	
+	return numread;
+}
+
+// close a record stream.
+// the source stream is owned by the caller.
+static void _ipc3_stream_record_close_proc(ipc3_stream_t *stream)
+{
+	if (((ipc3_stream_record_t *)stream)->buf)
+	{
+		mem_free(((ipc3_stream_record_t *)stream)->buf);
+	}
+}
+
+// initialize a memory stream.
+// the buffer is just used a reference and MUST exist while this stream exists.
+void ipc3_stream_memory_init(ipc3_stream_memory_t *stream,const void *buf,SIZE_T size,int is_64bit)
+{
+	stream->base.vtbl = &_ipc3_stream_memory_vtbl;
+	stream->base.is_error = 0;
+	stream->base.is_64bit = is_64bit;
+	stream->base.response_code = 0;
+	
+	stream->buf = (const BYTE *)buf;
+	stream->size = size;
+	stream->pos = 0;
+}
+
+// seek to a specific location in a memory stream.
+static void _ipc3_stream_memory_seek_proc(ipc3_stream_t *stream,ES_UINT64 position_from_start)
+{
+	if (position_from_start <= ((ipc3_stream_memory_t *)stream)->size)
+	{
+		((ipc3_stream_memory_t *)stream)->pos = (SIZE_T)position_from_start;
+	}
+	else
+	{
+		stream->is_error = 1;
+	}
+}
+
+static ES_UINT64 _ipc3_stream_memory_tell_proc(ipc3_stream_t *stream)
+{
+	return ((ipc3_stream_memory_t *)stream)->pos;
+}
+
+// the read proc for a memory stream.
+// returns less than size at the end of the buffer.
+static SIZE_T _ipc3_stream_memory_read_proc(ipc3_stream_t *stream,void *buf,SIZE_T size)
+{
+	ipc3_stream_memory_t *memory_stream;
+	SIZE_T numread;
+	
+	memory_stream = (ipc3_stream_memory_t *)stream;
+	
+	if (stream->is_error)
+	{
+		return 0;
+	}
+	
+	numread = memory_stream->size - memory_stream->pos;
+	if (numread > size)
+	{
+		numread = size;
+	}
+	
+	os_copy_memory(buf,memory_stream->buf + memory_stream->pos,numread);
+	
+	memory_stream->pos += numread;
+	
+	return numread;
+}
+
+// close a memory stream.
+// the buffer is owned by the caller.
+static void _ipc3_stream_memory_close_proc(ipc3_stream_t *stream)
+{
+}
+
 // seek to the specified position from the start of the pool stream.
 void ipc3_stream_seek(ipc3_stream_t *stream,ES_UINT64 position_from_start)
 {
@@ -1390,134 +1848,217 @@ void ipc3_result_list_seek_to_offset_from_index(ipc3_result_list_t *result_list,
 		property_request_run = property_request_count;
 		property_request_p = property_request_array;
 		
-		// read remaining pipe data.
-		// we shouldn't have any remaining data.
-		// this should really be an error.
 		while(property_request_run)
 		{
-			// skip it.
-			if (property_request_p->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
-			{
-				SIZE_T len;
-				
-				len = ipc3_stream_read_len_vlq(stream);
-				
-				ipc3_stream_skip(stream,len);
-			}
-			else
-			{
-				// add to total item size.
-				switch(property_request_p->value_type)
-				{
-					case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
-					case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
-					case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
-					case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
-					case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+			ipc3_result_list_skip_property_value(stream,property_request_p);
+			
+			property_request_p++;
+			property_request_run--;
+		}
+		
+		last_index++;
+		last_offset = (SIZE_T)ipc3_stream_tell(stream);
+		
+		// cache it.
+		result_list->index_to_stream_offset_array[result_list->index_to_stream_offset_valid_count] = last_offset;
+		result_list->index_to_stream_offset_valid_count++;
+	}
+}
 
-						{
-							SIZE_T len;
-							
-							len = ipc3_stream_read_len_vlq(stream);
-							
-							ipc3_stream_skip(stream,len);
-						}
 
-						break;
+// skip over a property value in a result list stream.
+void ipc3_result_list_skip_property_value(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request)
+{
+	if (property_request->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
+	{
+		SIZE_T len;
+		
+		len = ipc3_stream_read_len_vlq(stream);
+		
+		ipc3_stream_skip(stream,len);
+	}
+	else
+	{
+		switch(property_request->value_type)
+		{
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
 
-					case IPC3_PROPERTY_VALUE_TYPE_BYTE:
-					case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
+				{
+					SIZE_T len;
+					
+					len = ipc3_stream_read_len_vlq(stream);
+					
+					ipc3_stream_skip(stream,len);
+				}
 
-						ipc3_stream_skip(stream,sizeof(BYTE));
+				break;
 
-						break;
+			case IPC3_PROPERTY_VALUE_TYPE_BYTE:
+			case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
 
-					case IPC3_PROPERTY_VALUE_TYPE_WORD:
-					case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
+				ipc3_stream_skip(stream,sizeof(BYTE));
 
-						ipc3_stream_skip(stream,sizeof(WORD));
-						
-						break;
+				break;
 
-					case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
-					case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
-					case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
+			case IPC3_PROPERTY_VALUE_TYPE_WORD:
+			case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
 
-						ipc3_stream_skip(stream,sizeof(DWORD));
-						
-						break;
-						
-					case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
+				ipc3_stream_skip(stream,sizeof(WORD));
+				
+				break;
 
-						ipc3_stream_skip(stream,sizeof(ES_UINT64));
-						
-						break;
-						
-					case IPC3_PROPERTY_VALUE_TYPE_UINT128: 
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
 
-						ipc3_stream_skip(stream,sizeof(EVERYTHING3_UINT128));
-						
-						break;
-						
-					case IPC3_PROPERTY_VALUE_TYPE_DIMENSIONS: 
+				ipc3_stream_skip(stream,sizeof(DWORD));
+				
+				break;
+				
+			case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
 
-						ipc3_stream_skip(stream,sizeof(EVERYTHING3_DIMENSIONS));
-						
-						break;
-						
-					case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
-					
-						ipc3_stream_read_size_t(stream);
-						break;
-						
-					case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1K: 
-					case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1M: 
+				ipc3_stream_skip(stream,sizeof(ES_UINT64));
+				
+				break;
+				
+			case IPC3_PROPERTY_VALUE_TYPE_UINT128: 
 
-						ipc3_stream_skip(stream,sizeof(__int32));
-						
-						break;
+				ipc3_stream_skip(stream,sizeof(EVERYTHING3_UINT128));
+				
+				break;
+				
+			case IPC3_PROPERTY_VALUE_TYPE_DIMENSIONS: 
 
-					case IPC3_PROPERTY_VALUE_TYPE_BLOB8:
+				ipc3_stream_skip(stream,sizeof(EVERYTHING3_DIMENSIONS));
+				
+				break;
+				
+			case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
+			
+				ipc3_stream_read_size_t(stream);
+				break;
+				
+			case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1K: 
+			case IPC3_PROPERTY_VALUE_TYPE_INT32_FIXED_Q1M: 
 
-						{
-							BYTE len;
-							
-							len = ipc3_stream_read_byte(stream);
-							
-							ipc3_stream_skip(stream,len);
-						}
+				ipc3_stream_skip(stream,sizeof(__int32));
+				
+				break;
 
-						break;
+			case IPC3_PROPERTY_VALUE_TYPE_BLOB8:
 
-					case IPC3_PROPERTY_VALUE_TYPE_BLOB16:
+				{
+					BYTE len;
+					
+					len = ipc3_stream_read_byte(stream);
+					
+					ipc3_stream_skip(stream,len);
+				}
 
-						{
-							WORD len;
-							
-							len = ipc3_stream_read_word(stream);
-							
-							ipc3_stream_skip(stream,len);
-						}
+				break;
 
-						break;
+			case IPC3_PROPERTY_VALUE_TYPE_BLOB16:
 
+				{
+					WORD len;
+					
+					len = ipc3_stream_read_word(stream);
+					
+					ipc3_stream_skip(stream,len);
 				}
-			}
-			
-			property_request_p++;
-			property_request_run--;
+
+				break;
+
+		}
+	}
+}
+
+// read an integer property value from a result list stream.
+// returns the value widened to 64bits.
+// returns ES_UINT64_MAX if the property value is not an integer. (the value is skipped)
+ES_UINT64 ipc3_result_list_read_property_uint64(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request)
+{
+	if (!(property_request->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT)))
+	{
+		switch(property_request->value_type)
+		{
+			case IPC3_PROPERTY_VALUE_TYPE_BYTE:
+			case IPC3_PROPERTY_VALUE_TYPE_BYTE_GET_TEXT:
+				return ipc3_stream_read_byte(stream);
+
+			case IPC3_PROPERTY_VALUE_TYPE_WORD:
+			case IPC3_PROPERTY_VALUE_TYPE_WORD_GET_TEXT:
+				return ipc3_stream_read_word(stream);
+
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD: 
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD_FIXED_Q1K: 
+			case IPC3_PROPERTY_VALUE_TYPE_DWORD_GET_TEXT: 
+				return ipc3_stream_read_dword(stream);
+				
+			case IPC3_PROPERTY_VALUE_TYPE_UINT64: 
+				return ipc3_stream_read_uint64(stream);
+				
+			case IPC3_PROPERTY_VALUE_TYPE_SIZE_T:
+				return ipc3_stream_read_size_t(stream);
+		}
+	}
+	
+	ipc3_result_list_skip_property_value(stream,property_request);
+	
+	return ES_UINT64_MAX;
+}
+
+// read a text property value from a result list stream.
+// stores the NULL terminated text in out_cbuf.
+// out_cbuf is empty if the property value is not text. (the value is skipped)
+void ipc3_result_list_read_property_text(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request,utf8_buf_t *out_cbuf)
+{
+	int is_text;
+	
+	is_text = 0;
+	
+	if (property_request->flags & (IPC3_SEARCH_PROPERTY_REQUEST_FLAG_FORMAT|IPC3_SEARCH_PROPERTY_REQUEST_FLAG_HIGHLIGHT))
+	{
+		is_text = 1;
+	}
+	else
+	{
+		switch(property_request->value_type)
+		{
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_MULTISTRING: 
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_STRING_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FOLDER_REFERENCE:
+			case IPC3_PROPERTY_VALUE_TYPE_PSTRING_FILE_OR_FOLDER_REFERENCE:
+				is_text = 1;
+				break;
 		}
+	}
+	
+	if (is_text)
+	{
+		SIZE_T len;
 		
-		last_index++;
-		last_offset = (SIZE_T)ipc3_stream_tell(stream);
+		len = ipc3_stream_read_len_vlq(stream);
 		
-		// cache it.
-		result_list->index_to_stream_offset_array[result_list->index_to_stream_offset_valid_count] = last_offset;
-		result_list->index_to_stream_offset_valid_count++;
+		utf8_buf_grow_length(out_cbuf,len);
+		
+		ipc3_stream_read_data(stream,out_cbuf->buf,len);
+		
+		out_cbuf->buf[len] = 0;
+	}
+	else
+	{
+		ipc3_result_list_skip_property_value(stream,property_request);
+		
+		utf8_buf_empty(out_cbuf);
 	}
 }
 
-
 // fill in a buffer with a VLQ value and progress the buffer pointer.
 // buf can be NULL to calculate the length.
 BYTE *ipc3_copy_len_vlq(BYTE *buf,SIZE_T value)
@@ -248,6 +248,49 @@ typedef struct ipc3_stream_pool_s
 		
 }ipc3_stream_pool_t;
 
+// file stream.
+// reads a reply that was saved to a file.
+typedef struct ipc3_stream_file_s
+{
+	ipc3_stream_t base;
+	
+	HANDLE file_handle;
+	ES_UINT64 totread;
+	
+}ipc3_stream_file_t;
+
+// record stream.
+// keeps a copy of everything read from the source stream.
+// used to read one item at a time and read it again later with a memory stream.
+typedef struct ipc3_stream_record_s
+{
+	ipc3_stream_t base;
+	
+	// the original source input stream.
+	struct ipc3_stream_s *source_stream;
+	
+	// the recorded data.
+	// NULL if not yet allocated
+	BYTE *buf;
+	SIZE_T size;
+	SIZE_T allocated_size;
+	
+	ES_UINT64 totread;
+	
+}ipc3_stream_record_t;
+
+// memory stream.
+// reads from a single block of memory.
+typedef struct ipc3_stream_memory_s
+{
+	ipc3_stream_t base;
+	
+	const BYTE *buf;
+	SIZE_T size;
+	SIZE_T pos;
+	
+}ipc3_stream_memory_t;
+
 typedef struct ipc3_result_list_property_request_s
 {
 	DWORD property_id;
@@ -334,6 +377,7 @@ typedef struct ipc3_journal_info_s
 
 BOOL ipc3_write_pipe_data(HANDLE pipe_handle,const void *in_data,SIZE_T in_size);
 BOOL ipc3_write_pipe_message(HANDLE pipe_handle,DWORD code,const void *in_data,SIZE_T in_size);
+SIZE_T ipc3_get_pipe_buffer_size(HANDLE pipe_handle);
 void ipc3_stream_read_data(ipc3_stream_t *stream,void *data,SIZE_T size);
 void ipc3_stream_read_utf8_string(ipc3_stream_t *stream,utf8_buf_t *out_cbuf);
 SIZE_T ipc3_stream_try_read_data(ipc3_stream_t *stream,void *data,SIZE_T size);
@@ -352,14 +396,25 @@ BOOL ipc3_ioctl_expect_output_size(HANDLE pipe_handle,int command,const void *in
 BOOL ipc3_ioctl_alloc_out(HANDLE pipe_handle,int command,const void *in_buf,SIZE_T in_size,utf8_buf_t *out_cbuf);
 void ipc3_get_pipe_name(wchar_buf_t *out_wcbuf);
 void ipc3_stream_pipe_init(ipc3_stream_pipe_t *stream,HANDLE pipe_handle);
+BOOL ipc3_stream_pipe_skip_reply(ipc3_stream_pipe_t *stream);
 void ipc3_stream_close(ipc3_stream_t *stream);				
 BOOL ipc3_is_property_indexed(HANDLE pipe_handle,DWORD property_id);
+BOOL ipc3_is_db_loaded(HANDLE pipe_handle,BOOL *out_is_db_loaded);
 void ipc3_result_list_init(ipc3_result_list_t *result_list,ipc3_stream_t *stream);
 void ipc3_result_list_kill(ipc3_result_list_t *result_list);
 void ipc3_stream_pool_init(ipc3_stream_pool_t *stream,ipc3_stream_t *source_stream);
+void ipc3_stream_pool_read_all(ipc3_stream_pool_t *stream);
+BOOL ipc3_stream_pool_write_file(ipc3_stream_pool_t *stream,HANDLE file_handle);
+void ipc3_stream_file_init(ipc3_stream_file_t *stream,HANDLE file_handle);
+void ipc3_stream_record_init(ipc3_stream_record_t *stream,ipc3_stream_t *source_stream);
+void ipc3_stream_record_clear(ipc3_stream_record_t *stream);
+void ipc3_stream_memory_init(ipc3_stream_memory_t *stream,const void *buf,SIZE_T size,int is_64bit);
 void ipc3_stream_seek(ipc3_stream_t *stream,ES_UINT64 position_from_start);
 ES_UINT64 ipc3_stream_tell(ipc3_stream_t *stream);
 void ipc3_result_list_seek_to_offset_from_index(ipc3_result_list_t *result_list,SIZE_T start_index);
+void ipc3_result_list_skip_property_value(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request);
+ES_UINT64 ipc3_result_list_read_property_uint64(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request);
+void ipc3_result_list_read_property_text(ipc3_stream_t *stream,const ipc3_result_list_property_request_t *property_request,utf8_buf_t *out_cbuf);
 ES_UINT64 ipc3_stream_tell(ipc3_stream_t *stream);
 BYTE *ipc3_copy_len_vlq(BYTE *buf,SIZE_T value);
 DWORD ipc3_find_property(const wchar_t *search);
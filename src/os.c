@@ -30,6 +30,7 @@
 
 BOOL (WINAPI *_os_IsDebuggerPresent)(void) = NULL;
 static BOOL (WINAPI *_os_TzSpecificLocalTimeToSystemTime)(LPTIME_ZONE_INFORMATION lpTimeZoneInformation,LPSYSTEMTIME lpLocalTime,LPSYSTEMTIME lpUniversalTime) = NULL;
+static BOOL (WINAPI *_os_CancelSynchronousIo)(HANDLE hThread) = NULL;
 
 void os_init(void)
 {
@@ -40,6 +41,7 @@ void os_init(void)
 	{
 		_os_IsDebuggerPresent = (void *)GetProcAddress(kernel32_hmodule,"IsDebuggerPresent");
 		_os_TzSpecificLocalTimeToSystemTime = (void *)GetProcAddress(kernel32_hmodule,"TzSpecificLocalTimeToSystemTime");
+		_os_CancelSynchronousIo = (void *)GetProcAddress(kernel32_hmodule,"CancelSynchronousIo");
 	}
 }
 
@@ -185,7 +187,7 @@ BOOL os_write_file_utf8_string_n(HANDLE file_handle,const ES_UTF8 *s,SIZE_T slen
 			write_size = 65536;
 		}
 		
-		if (!WriteFile(file_handle,s,write_size,&num_written,NULL))
+		if (!WriteFile(file_handle,p,write_size,&num_written,NULL))
 		{
 			return FALSE;
 		}
@@ -726,6 +728,19 @@ BOOL os_filetime_to_localtime(ES_UINT64 ft,SYSTEMTIME *out_localst)
 	return FALSE;
 }
 
+// cancel a blocking ReadFile or WriteFile call on another thread.
+// returns TRUE if a call was cancelled.
+// returns FALSE if the thread was not blocked or on XP and earlier.
+BOOL os_cancel_synchronous_io(HANDLE thread_handle)
+{
+	if (_os_CancelSynchronousIo)
+	{
+		return _os_CancelSynchronousIo(thread_handle);
+	}
+	
+	return FALSE;
+}
+
 // The cool Win95 hack, so the compiler can launch on it, even compiled with VS2005
 // Basically, this function is needed by the libcmt.lib/gs_report.obj
 //
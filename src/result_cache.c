@@ -0,0 +1,267 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// on-disk cache of ipc3 search replies for -result-cache
+// each entry is a separate file named after the hash of the search request.
+// the file has a header, the search request and the raw reply data.
+// the reply is replayed through the normal output, so formatting options are not part of the key.
+
+#include "es.h"
+
+#define _RESULT_CACHE_MAGIC				"ESCACHE1"
+#define _RESULT_CACHE_MAGIC_SIZE		8
+
+// the search request is stored so a hash collision is never served.
+// a search request larger than this is never cached.
+#define _RESULT_CACHE_MAX_PACKET_SIZE	(16 * 1024 * 1024)
+
+typedef struct _result_cache_header_s
+{
+	BYTE magic[_RESULT_CACHE_MAGIC_SIZE];
+	
+	// the journal position when the search was sent.
+	ES_UINT64 journal_id;
+	ES_UINT64 next_change_id;
+	
+	// the size of the search request that follows.
+	ES_UINT64 packet_size;
+
+	// search request follows.
+	// BYTE packet[packet_size];
+	
+	// reply data follows until the end of the file.
+	
+}_result_cache_header_t;
+
+static void _result_cache_get_filename(const wchar_t *cache_path,const void *packet,SIZE_T packet_size,wchar_buf_t *out_wcbuf);
+static BOOL _result_cache_read(HANDLE file_handle,void *buf,SIZE_T size);
+static BOOL _result_cache_is_equal(const void *a,const void *b,SIZE_T size);
+
+// get the cache entry filename for a search request.
+static void _result_cache_get_filename(const wchar_t *cache_path,const void *packet,SIZE_T packet_size,wchar_buf_t *out_wcbuf)
+{
+	wchar_buf_t name_wcbuf;
+	
+	wchar_buf_init(&name_wcbuf);
+	
+	wchar_buf_printf(&name_wcbuf,"%016I64x.escache",hash_fnv1a_64(packet,packet_size));
+	
+	wchar_buf_path_cat_filename(cache_path,name_wcbuf.buf,out_wcbuf);
+	
+	wchar_buf_kill(&name_wcbuf);
+}
+
+// read exactly size bytes.
+static BOOL _result_cache_read(HANDLE file_handle,void *buf,SIZE_T size)
+{
+	BYTE *d;
+	SIZE_T run;
+	
+	d = buf;
+	run = size;
+	
+	while(run)
+	{
+		DWORD read_size;
+		DWORD numread;
+		
+		if (run <= 65536)
+		{
+			read_size = (DWORD)run;
+		}
+		else
+		{
+			read_size = 65536;
+		}
+		
+		if (!ReadFile(file_handle,d,read_size,&numread,NULL))
+		{
+			return FALSE;
+		}
+		
+		if (!numread)
+		{
+			return FALSE;
+		}
+		
+		d += numread;
+		run -= numread;
+	}
+	
+	return TRUE;
+}
+
+// compare two blocks of memory.
+static BOOL _result_cache_is_equal(const void *a,const void *b,SIZE_T size)
+{
+	const BYTE *a_p;
+	const BYTE *b_p;
+	SIZE_T run;
+	
+	a_p = a;
+	b_p = b;
+	run = size;
+	
+	while(run)
+	{
+		if (*a_p != *b_p)
+		{
+			return FALSE;
+		}
+		
+		a_p++;
+		b_p++;
+		run--;
+	}
+	
+	return TRUE;
+}
+
+// open the cache entry for a search request.
+// returns a file handle positioned at the start of the reply data.
+// returns INVALID_HANDLE_VALUE if there is no entry or the journal has moved since the entry was saved.
+// the caller should close the returned file handle.
+HANDLE result_cache_open(const wchar_t *cache_path,const void *packet,SIZE_T packet_size,const ipc3_journal_info_t *journal_info)
+{
+	HANDLE ret;
+	wchar_buf_t filename_wcbuf;
+	HANDLE file_handle;
+	
+	ret = INVALID_HANDLE_VALUE;
+	wchar_buf_init(&filename_wcbuf);
+	
+	_result_cache_get_filename(cache_path,packet,packet_size,&filename_wcbuf);
+
+	file_handle = os_open_file(filename_wcbuf.buf);
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		_result_cache_header_t header;
+		
+		if (_result_cache_read(file_handle,&header,sizeof(_result_cache_header_t)))
+		{
+			if ((_result_cache_is_equal(header.magic,_RESULT_CACHE_MAGIC,_RESULT_CACHE_MAGIC_SIZE)) && (header.journal_id == journal_info->journal_id) && (header.next_change_id == journal_info->next_change_id) && (header.packet_size == packet_size))
+			{
+				BYTE *saved_packet;
+				
+				saved_packet = mem_alloc(packet_size);
+				
+				if (_result_cache_read(file_handle,saved_packet,packet_size))
+				{
+					if (_result_cache_is_equal(saved_packet,packet,packet_size))
+					{
+						ret = file_handle;
+					}
+				}
+				
+				mem_free(saved_packet);
+			}
+		}
+		
+		if (ret == INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_handle);
+		}
+	}
+	
+	wchar_buf_kill(&filename_wcbuf);
+	
+	return ret;
+}
+
+// save a reply to the cache.
+// reply_stream MUST have been read with ipc3_stream_pool_read_all.
+// replaces any existing entry for the same search request.
+// returns TRUE if successful.
+// Otherwise, returns FALSE.
+BOOL result_cache_save(const wchar_t *cache_path,const void *packet,SIZE_T packet_size,const ipc3_journal_info_t *journal_info,ipc3_stream_pool_t *reply_stream)
+{
+	BOOL ret;
+	wchar_buf_t filename_wcbuf;
+	wchar_buf_t temp_filename_wcbuf;
+	HANDLE file_handle;
+	
+	ret = FALSE;
+	
+	if (packet_size > _RESULT_CACHE_MAX_PACKET_SIZE)
+	{
+		return FALSE;
+	}
+	
+	wchar_buf_init(&filename_wcbuf);
+	wchar_buf_init(&temp_filename_wcbuf);
+	
+	_result_cache_get_filename(cache_path,packet,packet_size,&filename_wcbuf);
+	
+	wchar_buf_copy_wchar_string_n(&temp_filename_wcbuf,filename_wcbuf.buf,filename_wcbuf.length_in_wchars);
+	wchar_buf_cat_utf8_string(&temp_filename_wcbuf,".tmp");
+	
+	os_make_sure_path_to_file_exists(temp_filename_wcbuf.buf);
+	
+	file_handle = os_create_file(temp_filename_wcbuf.buf);
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		_result_cache_header_t header;
+		BOOL is_written;
+		
+		os_copy_memory(header.magic,_RESULT_CACHE_MAGIC,_RESULT_CACHE_MAGIC_SIZE);
+		header.journal_id = journal_info->journal_id;
+		header.next_change_id = journal_info->next_change_id;
+		header.packet_size = packet_size;
+		
+		is_written = FALSE;
+		
+		if (os_write_file_utf8_string_n(file_handle,(const ES_UTF8 *)&header,sizeof(_result_cache_header_t)))
+		{
+			if (os_write_file_utf8_string_n(file_handle,packet,packet_size))
+			{
+				if (ipc3_stream_pool_write_file(reply_stream,file_handle))
+				{
+					is_written = TRUE;
+				}
+			}
+		}
+		
+		CloseHandle(file_handle);
+		
+		if (is_written)
+		{
+			if (os_replace_file(temp_filename_wcbuf.buf,filename_wcbuf.buf))
+			{
+				ret = TRUE;
+			}
+		}
+		
+		if (!ret)
+		{
+			DeleteFile(temp_filename_wcbuf.buf);
+		}
+	}
+	
+	wchar_buf_kill(&temp_filename_wcbuf);
+	wchar_buf_kill(&filename_wcbuf);
+	
+	return ret;
+}
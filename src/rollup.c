@@ -0,0 +1,288 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// folder trees for -rollup-depth
+// a file adds its size to each of its parent folders, up to the maximum depth.
+// the root is the drive or the \\server for UNC paths.
+// names are compared without ASCII case.
+
+#include "es.h"
+
+#define _ROLLUP_TREE_MIN_HASH_TABLE_SIZE	256
+
+static BYTE _rollup_fold(BYTE c);
+static ES_UINT64 _rollup_hash(const rollup_node_t *parent,const ES_UTF8 *name,SIZE_T name_len);
+static BOOL _rollup_is_name_equal(const rollup_node_t *node,const ES_UTF8 *name,SIZE_T name_len);
+static rollup_node_t *_rollup_tree_find_or_add(rollup_tree_t *tree,rollup_node_t *parent,const ES_UTF8 *name,SIZE_T name_len);
+static int _rollup_node_compare(const rollup_node_t *a,const rollup_node_t *b);
+
+void rollup_tree_init(rollup_tree_t *tree,SIZE_T max_depth)
+{
+	pool_init(&tree->pool);
+	array_init(&tree->array);
+	
+	hash_table_init(&tree->hash_table,_ROLLUP_TREE_MIN_HASH_TABLE_SIZE);
+	
+	tree->max_depth = max_depth;
+}
+
+void rollup_tree_kill(rollup_tree_t *tree)
+{
+	hash_table_kill(&tree->hash_table);
+	array_kill(&tree->array);
+	pool_kill(&tree->pool);
+}
+
+// add a file size to each parent folder of path.
+// the file name itself is not a node.
+void rollup_tree_add_file(rollup_tree_t *tree,const ES_UTF8 *path,SIZE_T path_len,ES_UINT64 size)
+{
+	rollup_node_t *parent;
+	SIZE_T depth;
+	SIZE_T start;
+	SIZE_T index;
+	
+	parent = NULL;
+	depth = 0;
+	start = 0;
+	index = 0;
+	
+	// keep the leading \\ of a UNC path in the root name.
+	if ((path_len >= 2) && (path[0] == '\\') && (path[1] == '\\'))
+	{
+		index = 2;
+	}
+	
+	while(index < path_len)
+	{
+		if (path[index] == '\\')
+		{
+			if (index > start)
+			{
+				rollup_node_t *node;
+				
+				node = _rollup_tree_find_or_add(tree,parent,path + start,index - start);
+				
+				node->size += size;
+				node->count++;
+				
+				depth++;
+				
+				if (depth == tree->max_depth)
+				{
+					break;
+				}
+				
+				parent = node;
+			}
+			
+			start = index + 1;
+		}
+		
+		index++;
+	}
+}
+
+// sort the nodes by size, largest first.
+void rollup_tree_sort(rollup_tree_t *tree)
+{
+	os_sort(tree->array.indexes,tree->array.count,_rollup_node_compare);
+}
+
+// get the full path of a folder node.
+void rollup_node_get_path(const rollup_node_t *node,utf8_buf_t *out_cbuf)
+{
+	const rollup_node_t *parent;
+	SIZE_T path_len;
+	ES_UTF8 *d;
+	
+	path_len = node->name_len;
+	parent = node->parent;
+	
+	while(parent)
+	{
+		path_len = safe_size_add(path_len,safe_size_add_one(parent->name_len));
+		
+		parent = parent->parent;
+	}
+	
+	utf8_buf_grow_length(out_cbuf,path_len);
+	
+	// fill from the end.
+	d = out_cbuf->buf + path_len;
+	*d = 0;
+	
+	for(;;)
+	{
+		d -= node->name_len;
+		os_copy_memory(d,ROLLUP_NODE_NAME(node),node->name_len);
+		
+		node = node->parent;
+		if (!node)
+		{
+			break;
+		}
+		
+		d--;
+		*d = '\\';
+	}
+}
+
+static BYTE _rollup_fold(BYTE c)
+{
+	if ((c >= 'A') && (c <= 'Z'))
+	{
+		return c - 'A' + 'a';
+	}
+	
+	return c;
+}
+
+// FNV-1a of the parent node address and the case folded name.
+static ES_UINT64 _rollup_hash(const rollup_node_t *parent,const ES_UTF8 *name,SIZE_T name_len)
+{
+	return hash_fnv1a_64_append_lowercase_ascii(hash_fnv1a_64(&parent,sizeof(const rollup_node_t *)),name,name_len);
+}
+
+static BOOL _rollup_is_name_equal(const rollup_node_t *node,const ES_UTF8 *name,SIZE_T name_len)
+{
+	const ES_UTF8 *p;
+	
+	if (node->name_len != name_len)
+	{
+		return FALSE;
+	}
+	
+	p = ROLLUP_NODE_NAME(node);
+	
+	while(name_len)
+	{
+		if (_rollup_fold(*p) != _rollup_fold(*name))
+		{
+			return FALSE;
+		}
+		
+		p++;
+		name++;
+		name_len--;
+	}
+	
+	return TRUE;
+}
+
+static rollup_node_t *_rollup_tree_find_or_add(rollup_tree_t *tree,rollup_node_t *parent,const ES_UTF8 *name,SIZE_T name_len)
+{
+	ES_UINT64 hash;
+	rollup_node_t *node;
+	
+	hash = _rollup_hash(parent,name,name_len);
+	
+	node = (rollup_node_t *)hash_table_find_first(&tree->hash_table,hash);
+	
+	while(node)
+	{
+		if (node->parent == parent)
+		{
+			if (_rollup_is_name_equal(node,name,name_len))
+			{
+				return node;
+			}
+		}
+		
+		node = (rollup_node_t *)hash_table_find_next(&node->hash_entry);
+	}
+	
+	node = pool_alloc(&tree->pool,safe_size_add(sizeof(rollup_node_t),safe_size_add_one(name_len)));
+	
+	node->parent = parent;
+	node->size = 0;
+	node->count = 0;
+	node->name_len = name_len;
+	
+	os_copy_memory(ROLLUP_NODE_NAME(node),name,name_len);
+	ROLLUP_NODE_NAME(node)[name_len] = 0;
+	
+	hash_table_insert(&tree->hash_table,&node->hash_entry,hash);
+	
+	array_insert(&tree->array,SIZE_MAX,node);
+	
+	return node;
+}
+
+// largest size first, then most files, then by name.
+static int _rollup_node_compare(const rollup_node_t *a,const rollup_node_t *b)
+{
+	if (a->size > b->size)
+	{
+		return -1;
+	}
+	
+	if (a->size < b->size)
+	{
+		return 1;
+	}
+	
+	if (a->count > b->count)
+	{
+		return -1;
+	}
+	
+	if (a->count < b->count)
+	{
+		return 1;
+	}
+	
+	{
+		const ES_UTF8 *a_p;
+		const ES_UTF8 *b_p;
+		SIZE_T run;
+		
+		a_p = ROLLUP_NODE_NAME(a);
+		b_p = ROLLUP_NODE_NAME(b);
+		
+		// names are null terminated.
+		run = (a->name_len < b->name_len ? a->name_len : b->name_len) + 1;
+		
+		while(run)
+		{
+			if (_rollup_fold(*a_p) < _rollup_fold(*b_p))
+			{
+				return -1;
+			}
+			
+			if (_rollup_fold(*a_p) > _rollup_fold(*b_p))
+			{
+				return 1;
+			}
+			
+			a_p++;
+			b_p++;
+			run--;
+		}
+	}
+	
+	return 0;
+}
@@ -0,0 +1,76 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// folder trees for -rollup-depth
+// each node is a folder with the total size and file count of everything below it.
+// nodes are stored in a pool and a child is found with a hash of its parent and name.
+
+#define ROLLUP_NODE_NAME(node)				((ES_UTF8 *)(((rollup_node_t *)(node)) + 1))
+
+typedef struct rollup_node_s
+{
+	// must be first.
+	// the hash of the parent and the case folded name.
+	hash_entry_t hash_entry;
+	
+	// the parent folder or NULL for a root.
+	struct rollup_node_s *parent;
+	
+	// the total size and number of files below this folder.
+	ES_UINT64 size;
+	ES_UINT64 count;
+	
+	// length of the name in bytes.
+	SIZE_T name_len;
+	
+	// name follows, null terminated.
+	// ES_UTF8 name[name_len+1];
+
+}rollup_node_t;
+
+typedef struct rollup_tree_s
+{
+	// node storage.
+	pool_t pool;
+	
+	// array of rollup_node_t *
+	// sorted by rollup_tree_sort.
+	array_t array;
+	
+	// nodes by parent and name.
+	hash_table_t hash_table;
+	
+	// the maximum folder depth.
+	// 0 is no limit.
+	SIZE_T max_depth;
+
+}rollup_tree_t;
+
+void rollup_tree_init(rollup_tree_t *tree,SIZE_T max_depth);
+void rollup_tree_kill(rollup_tree_t *tree);
+void rollup_tree_add_file(rollup_tree_t *tree,const ES_UTF8 *path,SIZE_T path_len,ES_UINT64 size);
+void rollup_tree_sort(rollup_tree_t *tree);
+void rollup_node_get_path(const rollup_node_t *node,utf8_buf_t *out_cbuf);
@@ -0,0 +1,308 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// reservoir sampling for -sample
+// uses Algorithm L (Li, 1994):
+// instead of drawing a random number for every item, the number of items to skip
+// before the next kept item is drawn from the distribution of the gap.
+// so random numbers are only needed for kept items.
+// only integer math is used.
+// the weight is kept as -log2(w) and logs are fixed point with 32 fraction bits.
+
+#include "es.h"
+
+// -log2(ln(2)) with 32 fraction bits.
+#define _SAMPLE_NEG_LOG2_LN2_FIXED		0x875d3ba7UI64
+
+// log2(e) with 31 fraction bits.
+#define _SAMPLE_LOG2_E_FIXED			0xb8aa3b29UI64
+
+// -log2(w) has 16 more fraction bits than the other logs.
+// so the weight doesn't drift when it is divided by a large sample size.
+#define _SAMPLE_W_EXTRA_FRACTION_BITS	16
+
+static ES_UINT64 _sample_random(sample_t *sample);
+static ES_UINT64 _sample_random_neg_log2_fixed(sample_t *sample);
+static void _sample_update_w(sample_t *sample);
+static void _sample_skip(sample_t *sample);
+static ES_UINT64 _sample_log2_fixed(ES_UINT64 x);
+static ES_UINT64 _sample_exp2_fixed(ES_UINT64 x);
+
+// 2^(2^-i) for i = 1 to 32, with 31 fraction bits.
+static const DWORD _sample_exp2_table[32] = 
+{
+	0xb504f334,0x9837f052,0x8b95c1e4,0x85aac368,0x82cd8699,0x8164d1f4,0x80b1ed50,0x8058d7d3,
+	0x802c6437,0x8016302f,0x800b179d,0x80058baf,0x8002c5d0,0x800162e6,0x8000b173,0x800058b9,
+	0x80002c5d,0x8000162e,0x80000b17,0x8000058c,0x800002c6,0x80000163,0x800000b1,0x80000059,
+	0x8000002c,0x80000016,0x8000000b,0x80000006,0x80000003,0x80000001,0x80000001,0x80000000,
+};
+
+// seed 0 is allowed.
+void sample_init(sample_t *sample,ES_UINT64 size,ES_UINT64 seed)
+{
+	sample->size = size;
+	sample->count = 0;
+	sample->next_index = ES_UINT64_MAX;
+	sample->neg_log2_w = 0;
+	
+	// splitmix64 so nearby seeds give unrelated streams and the state is never 0.
+	seed += 0x9e3779b97f4a7c15UI64;
+	seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9UI64;
+	seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebUI64;
+	seed ^= seed >> 31;
+	
+	sample->random_state = seed ? seed : 1;
+	
+	if (size)
+	{
+		_sample_update_w(sample);
+		sample->next_index = size;
+		
+		_sample_skip(sample);
+	}
+}
+
+// call once for each item in the stream.
+// returns the reservoir slot to store the item in, replacing any item in the slot.
+// returns ES_UINT64_MAX if the item is not kept.
+ES_UINT64 sample_next(sample_t *sample)
+{
+	ES_UINT64 index;
+	
+	index = sample->count;
+	sample->count++;
+	
+	// fill the reservoir first.
+	if (index < sample->size)
+	{
+		return index;
+	}
+	
+	if (index == sample->next_index)
+	{
+		ES_UINT64 slot;
+		
+		slot = _sample_random(sample) % sample->size;
+		
+		_sample_update_w(sample);
+		sample->next_index = index + 1;
+		
+		_sample_skip(sample);
+		
+		return slot;
+	}
+	
+	return ES_UINT64_MAX;
+}
+
+// xorshift64*
+static ES_UINT64 _sample_random(sample_t *sample)
+{
+	sample->random_state ^= sample->random_state >> 12;
+	sample->random_state ^= sample->random_state << 25;
+	sample->random_state ^= sample->random_state >> 27;
+	
+	return sample->random_state * 0x2545f4914f6cdd1dUI64;
+}
+
+// -log2(u) for a random u in (0,1), with 32 fraction bits.
+// never returns 0.
+static ES_UINT64 _sample_random_neg_log2_fixed(sample_t *sample)
+{
+	ES_UINT64 neg_log2_u;
+	
+	// u is an odd 54 bit number / 2^54
+	neg_log2_u = (54UI64 << 32) - _sample_log2_fixed(((_sample_random(sample) >> 11) << 1) | 1);
+	
+	return neg_log2_u ? neg_log2_u : 1;
+}
+
+// w = w * u^(1/size) for a random u in (0,1).
+// the first call sets w = u^(1/size).
+static void _sample_update_w(sample_t *sample)
+{
+	ES_UINT64 neg_log2_u;
+	
+	neg_log2_u = _sample_random_neg_log2_fixed(sample) << _SAMPLE_W_EXTRA_FRACTION_BITS;
+	
+	// round to nearest.
+	sample->neg_log2_w += (neg_log2_u + (sample->size / 2)) / sample->size;
+}
+
+// move next_index past the items that are not kept.
+// the skip is floor(log(u) / log(1 - w)) for a random u in (0,1).
+static void _sample_skip(sample_t *sample)
+{
+	ES_UINT64 neg_log2_u;
+	ES_UINT64 neg_log2_w;
+	ES_UINT64 skip;
+	
+	neg_log2_u = _sample_random_neg_log2_fixed(sample);
+	neg_log2_w = sample->neg_log2_w >> _SAMPLE_W_EXTRA_FRACTION_BITS;
+	
+	if (neg_log2_w <= (8UI64 << 32))
+	{
+		ES_UINT64 one_minus_w;
+		ES_UINT64 neg_log2_one_minus_w;
+		
+		// w >= 2^-8 so 1 - w has enough bits with 32 fraction bits.
+		one_minus_w = (1UI64 << 32) - _sample_exp2_fixed((32UI64 << 32) - neg_log2_w);
+		
+		if (!one_minus_w)
+		{
+			// w is 1, every item is kept.
+			return;
+		}
+		
+		neg_log2_one_minus_w = (32UI64 << 32) - _sample_log2_fixed(one_minus_w);
+		
+		skip = neg_log2_u / neg_log2_one_minus_w;
+	}
+	else
+	{
+		ES_UINT64 w;
+		ES_UINT64 x;
+		ES_UINT64 log2_skip_add;
+		ES_UINT64 log2_skip_sub;
+		
+		// w < 2^-8 so use -ln(1 - w) = w * (1 + x) where x = w/2 + w^2/3 + ...
+		// log2(skip) = log2(-log2(u)) + log2(ln(2)) - log2(w) - log2(1 + x)
+		// w is only needed for x, so it can lose bits when it is small.
+		if (neg_log2_w < (32UI64 << 32))
+		{
+			w = _sample_exp2_fixed((32UI64 << 32) - neg_log2_w);
+		}
+		else
+		{
+			w = 0;
+		}
+		
+		x = (w / 2) + ((w * w) / (3UI64 << 32));
+		
+		// -log2(u) has 32 fraction bits, which is subtracted below.
+		log2_skip_add = _sample_log2_fixed(neg_log2_u) + neg_log2_w;
+		
+		// log2(1 + x) = (x - x^2/2) * log2(e)
+		log2_skip_sub = (32UI64 << 32) + _SAMPLE_NEG_LOG2_LN2_FIXED + (((x - ((x * x) >> 33)) * _SAMPLE_LOG2_E_FIXED) >> 31);
+		
+		if (log2_skip_add <= log2_skip_sub)
+		{
+			skip = 0;
+		}
+		else
+		{
+			skip = _sample_exp2_fixed(log2_skip_add - log2_skip_sub);
+		}
+	}
+	
+	if (skip >= ES_UINT64_MAX - sample->next_index)
+	{
+		// w is so small that nothing else will be kept.
+		sample->next_index = ES_UINT64_MAX;
+		
+		return;
+	}
+	
+	sample->next_index += skip;
+}
+
+// log2(x) with 32 fraction bits.
+// x must be non-zero.
+static ES_UINT64 _sample_log2_fixed(ES_UINT64 x)
+{
+	ES_UINT64 result;
+	DWORD integer_part;
+	ES_UINT64 y;
+	DWORD bit;
+	
+	integer_part = 0;
+	
+	while((x >> integer_part) >= 2)
+	{
+		integer_part++;
+	}
+	
+	result = (ES_UINT64)integer_part << 32;
+	
+	// y is x / 2^integer_part with 31 fraction bits, in [1,2)
+	if (integer_part >= 31)
+	{
+		y = x >> (integer_part - 31);
+	}
+	else
+	{
+		y = x << (31 - integer_part);
+	}
+	
+	for(bit=0x80000000;bit;bit>>=1)
+	{
+		y = (y * y) >> 31;
+		
+		if (y >= 0x100000000UI64)
+		{
+			y >>= 1;
+			result |= bit;
+		}
+	}
+	
+	return result;
+}
+
+// floor(2^x) where x has 32 fraction bits.
+// returns ES_UINT64_MAX if the result doesn't fit.
+static ES_UINT64 _sample_exp2_fixed(ES_UINT64 x)
+{
+	DWORD integer_part;
+	DWORD fraction_part;
+	ES_UINT64 y;
+	DWORD table_index;
+	
+	if (x >= (64UI64 << 32))
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	integer_part = (DWORD)(x >> 32);
+	fraction_part = (DWORD)x;
+	
+	// y is 2^fraction_part with 31 fraction bits, in [1,2)
+	y = 0x80000000UI64;
+	
+	for(table_index=0;table_index<32;table_index++)
+	{
+		if (fraction_part & (0x80000000 >> table_index))
+		{
+			y = (y * _sample_exp2_table[table_index]) >> 31;
+		}
+	}
+	
+	if (integer_part >= 31)
+	{
+		return y << (integer_part - 31);
+	}
+	
+	return y >> (31 - integer_part);
+}
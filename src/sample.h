@@ -0,0 +1,50 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// reservoir sampling for -sample
+// keeps a uniform random sample of a stream of unknown length.
+
+typedef struct sample_s
+{
+	// the number of items to keep.
+	ES_UINT64 size;
+	
+	// the number of items seen.
+	ES_UINT64 count;
+	
+	// the index of the next item to keep once the reservoir is full.
+	ES_UINT64 next_index;
+	
+	// -log2 of the Algorithm L weight with 48 fraction bits.
+	ES_UINT64 neg_log2_w;
+	
+	// xorshift64* state.
+	ES_UINT64 random_state;
+
+}sample_t;
+
+void sample_init(sample_t *sample,ES_UINT64 size,ES_UINT64 seed);
+ES_UINT64 sample_next(sample_t *sample);
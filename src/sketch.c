@@ -0,0 +1,391 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// fixed memory sketches for -approx
+// only integer math is used.
+//
+// HyperLogLog:
+// each value is hashed, the top bits pick a register and the register keeps the
+// highest number of leading zeros seen in the remaining bits.
+// the estimate has a standard error of about 1%.
+//
+// quantiles:
+// values are added to level 0.
+// when a level is full it is sorted and every other value, starting at a random
+// offset, moves to the next level with double the weight.
+// memory is at most SKETCH_QUANTILE_LEVEL_SIZE values per level and
+// the number of levels grows with log2 of the number of values.
+
+#include "es.h"
+
+// alpha * 2^16 for 2^14 registers.
+#define _SKETCH_HLL_ALPHA_FIXED			47268
+
+// ln(2) * 2^16
+#define _SKETCH_LN2_FIXED				45426
+
+static ES_UINT64 _sketch_mix(ES_UINT64 hash);
+static DWORD _sketch_log2_fixed(DWORD x);
+static void _sketch_sort_values(ES_UINT64 *value_array,SIZE_T count);
+static void _sketch_quantile_insert(sketch_quantile_t *quantile,SIZE_T level,ES_UINT64 value);
+static void _sketch_quantile_compact(sketch_quantile_t *quantile,SIZE_T level);
+
+void sketch_hll_init(sketch_hll_t *hll)
+{
+	os_zero_memory(hll->register_array,SKETCH_HLL_REGISTER_COUNT);
+}
+
+// hash should be well mixed.
+void sketch_hll_add_hash(sketch_hll_t *hll,ES_UINT64 hash)
+{
+	SIZE_T register_index;
+	ES_UINT64 w;
+	BYTE rank;
+	
+	register_index = (SIZE_T)(hash >> (64 - SKETCH_HLL_PRECISION));
+	
+	w = hash << SKETCH_HLL_PRECISION;
+	rank = 1;
+	
+	while((rank <= 64 - SKETCH_HLL_PRECISION) && (!(w & 0x8000000000000000UI64)))
+	{
+		w <<= 1;
+		rank++;
+	}
+	
+	if (rank > hll->register_array[register_index])
+	{
+		hll->register_array[register_index] = rank;
+	}
+}
+
+// text is compared without ASCII case.
+void sketch_hll_add_text(sketch_hll_t *hll,const ES_UTF8 *text,SIZE_T text_len)
+{
+	sketch_hll_add_hash(hll,_sketch_mix(hash_fnv1a_64_lowercase_ascii(text,text_len)));
+}
+
+void sketch_hll_add_number(sketch_hll_t *hll,ES_UINT64 value)
+{
+	sketch_hll_add_hash(hll,_sketch_mix(value));
+}
+
+ES_UINT64 sketch_hll_get_estimate(const sketch_hll_t *hll)
+{
+	ES_UINT64 sum;
+	DWORD zero_count;
+	SIZE_T register_index;
+	ES_UINT64 estimate;
+	
+	// sum of 2^-register, scaled by 2^48.
+	sum = 0;
+	zero_count = 0;
+	
+	for(register_index=0;register_index<SKETCH_HLL_REGISTER_COUNT;register_index++)
+	{
+		BYTE rank;
+		
+		rank = hll->register_array[register_index];
+		
+		if (!rank)
+		{
+			zero_count++;
+		}
+		
+		if (rank > 48)
+		{
+			rank = 48;
+		}
+		
+		sum += (ES_UINT64)1 << (48 - rank);
+	}
+	
+	if (!(sum >> 16))
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	// alpha * m^2 / (sum / 2^48)
+	estimate = ((ES_UINT64)_SKETCH_HLL_ALPHA_FIXED << 44) / (sum >> 16);
+	
+	// use linear counting for small sets.
+	if ((estimate <= (SKETCH_HLL_REGISTER_COUNT * 5) / 2) && (zero_count))
+	{
+		// m * ln(m / zero_count)
+		estimate = ((ES_UINT64)SKETCH_HLL_REGISTER_COUNT * (((ES_UINT64)SKETCH_HLL_PRECISION << 16) - _sketch_log2_fixed(zero_count)) * _SKETCH_LN2_FIXED) >> 32;
+	}
+	
+	return estimate;
+}
+
+void sketch_quantile_init(sketch_quantile_t *quantile)
+{
+	quantile->level_count = 0;
+	quantile->count = 0;
+	quantile->min_value = 0;
+	quantile->max_value = 0;
+	quantile->random_state = 0x9e3779b97f4a7c15UI64;
+}
+
+void sketch_quantile_kill(sketch_quantile_t *quantile)
+{
+	SIZE_T level;
+	
+	for(level=0;level<quantile->level_count;level++)
+	{
+		mem_free(quantile->level_array[level]);
+	}
+}
+
+void sketch_quantile_add(sketch_quantile_t *quantile,ES_UINT64 value)
+{
+	if (quantile->count)
+	{
+		if (value < quantile->min_value)
+		{
+			quantile->min_value = value;
+		}
+		
+		if (value > quantile->max_value)
+		{
+			quantile->max_value = value;
+		}
+	}
+	else
+	{
+		quantile->min_value = value;
+		quantile->max_value = value;
+	}
+	
+	quantile->count++;
+	
+	_sketch_quantile_insert(quantile,0,value);
+}
+
+// get the value at percent (0-100) of the values.
+// 0 is the exact min and 100 is the exact max.
+// returns ES_UINT64_MAX if no values were added.
+// sorts the levels in place.
+ES_UINT64 sketch_quantile_get(sketch_quantile_t *quantile,DWORD percent)
+{
+	SIZE_T pos_array[SKETCH_QUANTILE_MAX_LEVELS];
+	ES_UINT64 rank;
+	ES_UINT64 weight_total;
+	SIZE_T level;
+	
+	if (!quantile->count)
+	{
+		return ES_UINT64_MAX;
+	}
+	
+	if (!percent)
+	{
+		return quantile->min_value;
+	}
+	
+	if (percent >= 100)
+	{
+		return quantile->max_value;
+	}
+	
+	// the count is not large enough to overflow.
+	rank = (quantile->count / 100) * percent + ((quantile->count % 100) * percent) / 100;
+	
+	for(level=0;level<quantile->level_count;level++)
+	{
+		_sketch_sort_values(quantile->level_array[level],quantile->level_count_array[level]);
+		
+		pos_array[level] = 0;
+	}
+	
+	// walk the sorted levels in value order.
+	weight_total = 0;
+	
+	for(;;)
+	{
+		SIZE_T min_level;
+		
+		min_level = SIZE_MAX;
+		
+		for(level=0;level<quantile->level_count;level++)
+		{
+			if (pos_array[level] < quantile->level_count_array[level])
+			{
+				if ((min_level == SIZE_MAX) || (quantile->level_array[level][pos_array[level]] < quantile->level_array[min_level][pos_array[min_level]]))
+				{
+					min_level = level;
+				}
+			}
+		}
+		
+		if (min_level == SIZE_MAX)
+		{
+			break;
+		}
+		
+		weight_total += (ES_UINT64)1 << min_level;
+		
+		if (weight_total > rank)
+		{
+			return quantile->level_array[min_level][pos_array[min_level]];
+		}
+		
+		pos_array[min_level]++;
+	}
+	
+	return quantile->max_value;
+}
+
+// splitmix64 finalizer.
+// FNV-1a alone does not spread the high bits well enough for the register index.
+static ES_UINT64 _sketch_mix(ES_UINT64 hash)
+{
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9UI64;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebUI64;
+	hash ^= hash >> 31;
+	
+	return hash;
+}
+
+// log2(x) with 16 fraction bits.
+// x must be non-zero.
+static DWORD _sketch_log2_fixed(DWORD x)
+{
+	DWORD result;
+	DWORD integer_part;
+	ES_UINT64 y;
+	DWORD bit;
+	
+	integer_part = 0;
+	
+	while((x >> integer_part) >= 2)
+	{
+		integer_part++;
+	}
+	
+	result = integer_part << 16;
+	
+	// y is x / 2^integer_part with 16 fraction bits, in [1,2)
+	y = ((ES_UINT64)x << 16) >> integer_part;
+	
+	for(bit=0x8000;bit;bit>>=1)
+	{
+		y = (y * y) >> 16;
+		
+		if (y >= 0x20000)
+		{
+			y >>= 1;
+			result |= bit;
+		}
+	}
+	
+	return result;
+}
+
+// shell sort.
+static void _sketch_sort_values(ES_UINT64 *value_array,SIZE_T count)
+{
+	SIZE_T gap;
+	
+	gap = 1;
+	
+	while(gap < count / 3)
+	{
+		gap = gap * 3 + 1;
+	}
+	
+	while(gap)
+	{
+		SIZE_T i;
+		
+		for(i=gap;i<count;i++)
+		{
+			ES_UINT64 value;
+			SIZE_T j;
+			
+			value = value_array[i];
+			j = i;
+			
+			while((j >= gap) && (value_array[j - gap] > value))
+			{
+				value_array[j] = value_array[j - gap];
+				j -= gap;
+			}
+			
+			value_array[j] = value;
+		}
+		
+		gap /= 3;
+	}
+}
+
+static void _sketch_quantile_insert(sketch_quantile_t *quantile,SIZE_T level,ES_UINT64 value)
+{
+	if (level >= quantile->level_count)
+	{
+		quantile->level_array[level] = mem_alloc(SKETCH_QUANTILE_LEVEL_SIZE * sizeof(ES_UINT64));
+		quantile->level_count_array[level] = 0;
+		quantile->level_count = level + 1;
+	}
+	
+	quantile->level_array[level][quantile->level_count_array[level]] = value;
+	quantile->level_count_array[level]++;
+	
+	if (quantile->level_count_array[level] == SKETCH_QUANTILE_LEVEL_SIZE)
+	{
+		_sketch_quantile_compact(quantile,level);
+	}
+}
+
+// move every other value of a full level to the next level.
+static void _sketch_quantile_compact(sketch_quantile_t *quantile,SIZE_T level)
+{
+	ES_UINT64 *value_array;
+	SIZE_T index;
+	
+	value_array = quantile->level_array[level];
+	
+	_sketch_sort_values(value_array,SKETCH_QUANTILE_LEVEL_SIZE);
+	
+	// xorshift64
+	quantile->random_state ^= quantile->random_state << 13;
+	quantile->random_state ^= quantile->random_state >> 7;
+	quantile->random_state ^= quantile->random_state << 17;
+	
+	// the values are still read from value_array.
+	// moving them only adds to higher levels.
+	quantile->level_count_array[level] = 0;
+	
+	if (level + 1 < SKETCH_QUANTILE_MAX_LEVELS)
+	{
+		for(index=(SIZE_T)(quantile->random_state & 1);index<SKETCH_QUANTILE_LEVEL_SIZE;index+=2)
+		{
+			_sketch_quantile_insert(quantile,level + 1,value_array[index]);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+
+//
+// Copyright (C) 2025 voidtools / David Carpenter
+// 
+// Permission is hereby granted, free of charge, 
+// to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), 
+// to deal in the Software without restriction, 
+// including without limitation the rights to use, 
+// copy, modify, merge, publish, distribute, sublicense, 
+// and/or sell copies of the Software, and to permit 
+// persons to whom the Software is furnished to do so, 
+// subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be 
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// fixed memory sketches for -approx
+// sketch_hll_t estimates the number of distinct values with HyperLogLog.
+// sketch_quantile_t estimates quantiles with levels of compactors, as in KLL.
+
+// 2^SKETCH_HLL_PRECISION registers.
+#define SKETCH_HLL_PRECISION			14
+#define SKETCH_HLL_REGISTER_COUNT		(1 << SKETCH_HLL_PRECISION)
+
+// the number of values each quantile level can hold.
+// must be even.
+#define SKETCH_QUANTILE_LEVEL_SIZE		256
+
+// enough levels for 2^64 values.
+#define SKETCH_QUANTILE_MAX_LEVELS		64
+
+typedef struct sketch_hll_s
+{
+	// the highest rank seen for each register.
+	BYTE register_array[SKETCH_HLL_REGISTER_COUNT];
+	
+}sketch_hll_t;
+
+typedef struct sketch_quantile_s
+{
+	// values at level n have a weight of 2^n.
+	// levels are allocated as needed.
+	ES_UINT64 *level_array[SKETCH_QUANTILE_MAX_LEVELS];
+	SIZE_T level_count_array[SKETCH_QUANTILE_MAX_LEVELS];
+	SIZE_T level_count;
+	
+	// the total weight of all values added.
+	ES_UINT64 count;
+	
+	// exact min and max.
+	ES_UINT64 min_value;
+	ES_UINT64 max_value;
+	
+	// xorshift state for choosing which half of a level to keep.
+	ES_UINT64 random_state;
+	
+}sketch_quantile_t;
+
+void sketch_hll_init(sketch_hll_t *hll);
+void sketch_hll_add_hash(sketch_hll_t *hll,ES_UINT64 hash);
+void sketch_hll_add_text(sketch_hll_t *hll,const ES_UTF8 *text,SIZE_T text_len);
+void sketch_hll_add_number(sketch_hll_t *hll,ES_UINT64 value);
+ES_UINT64 sketch_hll_get_estimate(const sketch_hll_t *hll);
+void sketch_quantile_init(sketch_quantile_t *quantile);
+void sketch_quantile_kill(sketch_quantile_t *quantile);
+void sketch_quantile_add(sketch_quantile_t *quantile,ES_UINT64 value);
+ES_UINT64 sketch_quantile_get(sketch_quantile_t *quantile,DWORD percent);